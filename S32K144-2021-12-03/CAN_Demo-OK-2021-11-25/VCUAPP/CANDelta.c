@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include "drvBoot.h"
+#include "CANDelta.h"
+
+//解析阶段
+#define CAN_DELTA_PH_HEAD				0
+#define CAN_DELTA_PH_OP					1
+#define CAN_DELTA_PH_ARG				2
+#define CAN_DELTA_PH_BODY				3
+#define CAN_DELTA_PH_DONE				4
+#define CAN_DELTA_PH_ERROR			5
+
+
+static uint32_t CANDelta_Get32(const uint8_t *p)
+{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//头部收齐后检查: 大小不超过slot, 运行中的映像与生成差分时的旧映像一致
+static uint8_t CANDelta_Head(CANDeltaType *Dz)
+{
+		if(CANDelta_Get32(&Dz->Head[0]) != CAN_DELTA_MAGIC)	return 1;
+		Dz->NewSize = CANDelta_Get32(&Dz->Head[4]);
+		Dz->OldSize = CANDelta_Get32(&Dz->Head[8]);
+		if((Dz->NewSize > Dz->SlotSize)||(Dz->OldSize > Dz->SlotSize))	return 1;
+		if(BootCrc32((const uint8_t *)Dz->OldBase, Dz->OldSize) != CANDelta_Get32(&Dz->Head[12]))	return 1;
+		return 0;
+}
+
+//参数收齐, 检查命令范围
+static uint8_t CANDelta_Check(CANDeltaType *Dz)
+{
+		if(Dz->Len > Dz->NewSize - Dz->Pos)	return 1;
+		if((Dz->Op == CAN_DELTA_OP_COPY)||(Dz->Op == CAN_DELTA_OP_RCOPY))
+		{
+				if((Dz->Off > Dz->OldSize)||(Dz->Len > Dz->OldSize - Dz->Off))	return 1;
+		}
+		if(Dz->Op == CAN_DELTA_OP_RCOPY)
+		{
+				if((Dz->Len & 3)||(Dz->Off & 3)||(Dz->Pos & 3))	return 1;
+		}
+		return 0;
+}
+
+
+
+/*************************************************************************
+*  函数名称：CANDeltaInit
+*  功能说明：开始解一个差分数据流
+*  参数说明：Dz：状态
+//	         OldBase：旧映像(运行中的slot)地址
+//	         NewBase：新映像写入的slot地址, 用于03命令的地址换算
+//	         SlotSize：slot大小
+*************************************************************************/
+void CANDeltaInit(CANDeltaType *Dz, uint32_t OldBase, uint32_t NewBase, uint32_t SlotSize)
+{
+		Dz->OldBase	 = OldBase;
+		Dz->NewBase	 = NewBase;
+		Dz->SlotSize = SlotSize;
+		Dz->NewSize	 = 0;
+		Dz->OldSize	 = 0;
+		Dz->Pos			 = 0;
+		Dz->Phase		 = CAN_DELTA_PH_HEAD;
+		Dz->Len			 = 0;
+}
+
+/*************************************************************************
+*  函数名称：CANDeltaRun
+*  功能说明：消耗输入, 向输出窗口写新映像, 输入不足或窗口写满时返回, 之后可继续
+//	         命令可以跨输入块和输出窗口
+*  参数说明：Dz：状态
+//	         In/InLen：输入, 返回时指向未消耗的部分
+//	         Out：输出窗口, OutMax为4的倍数
+//	         OutLen：窗口中已有字节数, 返回时更新
+*  函数返回：CAN_DELTA_xxx
+*************************************************************************/
+uint8_t CANDeltaRun(CANDeltaType *Dz, const uint8_t **In, uint32_t *InLen, uint8_t *Out, uint32_t *OutLen, uint32_t OutMax)
+{
+		const uint8_t	*src;
+		uint32_t			n,i,w;
+		uint8_t				b;
+
+		while(1)
+		{
+				switch(Dz->Phase)
+				{
+						case CAN_DELTA_PH_HEAD:
+								if(*InLen == 0)	return CAN_DELTA_NEED_INPUT;
+								Dz->Head[Dz->Len++] = *(*In)++;
+								(*InLen)--;
+								if(Dz->Len < CAN_DELTA_HEAD_BYTES)	break;
+								Dz->Phase = CANDelta_Head(Dz) ? CAN_DELTA_PH_ERROR : CAN_DELTA_PH_OP;
+								break;
+
+						case CAN_DELTA_PH_OP:
+								if(*InLen == 0)	return CAN_DELTA_NEED_INPUT;
+								Dz->Op = *(*In)++;
+								(*InLen)--;
+								if(Dz->Op == CAN_DELTA_OP_END)
+								{
+										Dz->Phase = (Dz->Pos == Dz->NewSize) ? CAN_DELTA_PH_DONE : CAN_DELTA_PH_ERROR;
+										break;
+								}
+								if(Dz->Op > CAN_DELTA_OP_FILL)
+								{
+										Dz->Phase = CAN_DELTA_PH_ERROR;
+										break;
+								}
+								Dz->Arg		= 0;
+								Dz->Var		= 0;
+								Dz->Shift = 0;
+								Dz->Phase = CAN_DELTA_PH_ARG;
+								break;
+
+						case CAN_DELTA_PH_ARG:
+								if(*InLen == 0)	return CAN_DELTA_NEED_INPUT;
+								b = *(*In)++;
+								(*InLen)--;
+								if((Dz->Op == CAN_DELTA_OP_FILL)&&(Dz->Arg == 1))
+								{
+										Dz->Fill	= b;
+										Dz->Phase = CAN_DELTA_PH_BODY;
+								}
+								else
+								{
+										if(Dz->Shift > 28)
+										{
+												Dz->Phase = CAN_DELTA_PH_ERROR;
+												break;
+										}
+										Dz->Var |= (uint32_t)(b & 0x7F) << Dz->Shift;
+										Dz->Shift += 7;
+										if(b & 0x80)	break;
+
+										if(Dz->Arg == 0)
+										{
+												Dz->Len		= Dz->Var;
+												Dz->Arg		= 1;
+												Dz->Var		= 0;
+												Dz->Shift = 0;
+												if(Dz->Op == CAN_DELTA_OP_LIT)	Dz->Phase = CAN_DELTA_PH_BODY;
+										}
+										else
+										{
+												Dz->Off		= Dz->Var;
+												Dz->Phase = CAN_DELTA_PH_BODY;
+										}
+								}
+								if((Dz->Phase == CAN_DELTA_PH_BODY)&&CANDelta_Check(Dz))	Dz->Phase = CAN_DELTA_PH_ERROR;
+								break;
+
+						case CAN_DELTA_PH_BODY:
+								if(Dz->Len == 0)
+								{
+										Dz->Phase = CAN_DELTA_PH_OP;
+										break;
+								}
+								n = OutMax - *OutLen;
+								if(Dz->Len < n)	n = Dz->Len;
+								if(Dz->Op == CAN_DELTA_OP_LIT)
+								{
+										if(*InLen == 0)	return CAN_DELTA_NEED_INPUT;
+										if(*InLen < n)	n = *InLen;
+								}
+								if(Dz->Op == CAN_DELTA_OP_RCOPY)	n &= ~3uL;
+								if(n == 0)	return CAN_DELTA_OUT_FULL;
+
+								src = (const uint8_t *)(Dz->OldBase + Dz->Off);
+								switch(Dz->Op)
+								{
+										case CAN_DELTA_OP_LIT:
+												for(i=0;i<n;i++)	Out[*OutLen + i] = (*In)[i];
+												*In		 += n;
+												*InLen -= n;
+												break;
+										case CAN_DELTA_OP_COPY:
+												for(i=0;i<n;i++)	Out[*OutLen + i] = src[i];
+												break;
+										case CAN_DELTA_OP_RCOPY:
+												for(i=0;i<n;i+=4)
+												{
+														w = CANDelta_Get32(&src[i]);
+														if(((w & ~1uL) - Dz->OldBase) < Dz->SlotSize)	w += Dz->NewBase - Dz->OldBase;
+														Out[*OutLen + i]		 = (uint8_t)w;
+														Out[*OutLen + i + 1] = (uint8_t)(w >> 8);
+														Out[*OutLen + i + 2] = (uint8_t)(w >> 16);
+														Out[*OutLen + i + 3] = (uint8_t)(w >> 24);
+												}
+												break;
+										default:
+												for(i=0;i<n;i++)	Out[*OutLen + i] = Dz->Fill;
+												break;
+								}
+								*OutLen += n;
+								Dz->Len -= n;
+								Dz->Off += n;
+								Dz->Pos += n;
+								break;
+
+						case CAN_DELTA_PH_DONE:
+								return CAN_DELTA_DONE;
+
+						default:
+								return CAN_DELTA_ERROR;
+				}
+		}
+}
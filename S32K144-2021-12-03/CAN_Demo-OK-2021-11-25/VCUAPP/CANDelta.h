@@ -0,0 +1,54 @@
+#ifndef __CAN_DELTA_H
+#define __CAN_DELTA_H
+
+#include <stdint.h>
+
+//差分升级数据流, 由 tools/mkdelta.py 生成, 以运行中的slot为旧映像:
+//  头16字节(小端): 标识 'DLT1', 新映像字节数, 引用的旧映像字节数, 旧映像CRC32
+//  之后为命令, 长度和偏移为LEB128变长整数:
+//    01 n 数据[n]     原样输出
+//    02 n off         从旧映像off处拷贝n字节
+//    03 n off         同02, 按32位字拷贝, 落在旧slot地址范围内的字(含Thumb位)换算到新slot
+//    04 n b           输出n个b
+//    00               结束, 输出须正好为新映像字节数
+#define CAN_DELTA_MAGIC					0x31544C44uL
+#define CAN_DELTA_HEAD_BYTES		16
+
+#define CAN_DELTA_OP_END				0x00
+#define CAN_DELTA_OP_LIT				0x01
+#define CAN_DELTA_OP_COPY				0x02
+#define CAN_DELTA_OP_RCOPY			0x03
+#define CAN_DELTA_OP_FILL				0x04
+
+//CANDeltaRun 返回
+#define CAN_DELTA_NEED_INPUT		0
+#define CAN_DELTA_OUT_FULL			1
+#define CAN_DELTA_DONE					2
+#define CAN_DELTA_ERROR					3
+
+typedef	struct
+{
+			uint32_t	OldBase;
+			uint32_t	NewBase;
+			uint32_t	SlotSize;
+			uint32_t	NewSize;
+			uint32_t	OldSize;
+			uint32_t	Pos;						//已输出字节数
+
+			uint8_t		Head[CAN_DELTA_HEAD_BYTES];
+			uint8_t		Phase;
+			uint8_t		Op;
+			uint8_t		Arg;						//正在解析第几个参数
+			uint8_t		Shift;
+			uint32_t	Var;						//正在解析的变长整数
+			uint32_t	Len;						//当前命令剩余字节数
+			uint32_t	Off;
+			uint8_t		Fill;
+
+}		CANDeltaType;
+
+void			CANDeltaInit(CANDeltaType *Dz, uint32_t OldBase, uint32_t NewBase, uint32_t SlotSize);
+uint8_t		CANDeltaRun(CANDeltaType *Dz, const uint8_t **In, uint32_t *InLen, uint8_t *Out, uint32_t *OutLen, uint32_t OutMax);
+
+
+#endif /* __CAN_DELTA_H */
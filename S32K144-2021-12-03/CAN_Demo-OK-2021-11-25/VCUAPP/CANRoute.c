@@ -0,0 +1,161 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "CANRoute.h"
+
+//每通道的索引. 标准帧: 2048位位图, 加每32位字之前的置位数, 位图秩即条目在本通道标准帧段中的序号;
+//扩展帧: 只记本通道扩展帧段在路由表中的位置
+typedef	struct
+{
+		uint32_t	Bitmap[CAN_ROUTE_STD_WORDS];
+		uint16_t	Rank[CAN_ROUTE_STD_WORDS];
+		uint16_t	Start;						//本通道标准帧段在路由表中的起始下标
+		uint16_t	ExtStart;					//本通道扩展帧段的起始下标和条数, 段内按SrcID升序, 二分查找
+		uint16_t	ExtNum;
+
+}		CANRouteStdType;
+
+static const CANRouteType	*RouteTab;
+static uint16_t						RouteNum;
+static CANRouteStdType		RouteStd[CAN_CHANNEL_NUM];
+
+static uint32_t CANRoute_BitCount(uint32_t x)
+{
+		x = x - ((x >> 1) & 0x55555555);
+		x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+		x = (x + (x >> 4)) & 0x0F0F0F0F;
+		return (x * 0x01010101) >> 24;
+}
+
+static uint32_t CANRoute_Key(const CANRouteType *pRoute)
+{
+		return ((uint32_t)pRoute->SrcCh << 30) | ((uint32_t)pRoute->IDE << 29) | pRoute->SrcID;
+}
+
+/*************************************************************************
+*  函数名称：CANRouteInit
+*  功能说明：根据Flash中的路由表建立标准帧位图索引, 记下各通道扩展帧段的位置;
+//	         扩展帧直接在Flash中的表上二分查找, 不占额外RAM
+*  参数说明：Table：路由表, 按 SrcCh、IDE、SrcID 升序且无重复
+//	         Num：条目数
+*  函数返回：0：成功，1：路由表无序/越界
+*************************************************************************/
+uint8_t CANRouteInit(const CANRouteType *Table, uint16_t Num)
+{
+		uint16_t	i,w;
+		uint32_t	id;
+		uint8_t		ch;
+
+		RouteTab = 0;
+		RouteNum = 0;
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				for(w=0;w<CAN_ROUTE_STD_WORDS;w++)	RouteStd[ch].Bitmap[w] = 0;
+				RouteStd[ch].Start		= 0;
+				RouteStd[ch].ExtStart = 0;
+				RouteStd[ch].ExtNum		= 0;
+		}
+
+		for(i=0;i<Num;i++)
+		{
+				ch = Table[i].SrcCh;
+				id = Table[i].SrcID;
+				if(ch >= CAN_CHANNEL_NUM)	return 1;
+				if((i > 0) && (CANRoute_Key(&Table[i]) <= CANRoute_Key(&Table[i-1])))	return 1;
+
+				if(Table[i].IDE == 0)
+				{
+						if(id >= CAN_ROUTE_STD_ID_NUM)	return 1;
+						RouteStd[ch].Bitmap[id>>5] |= 1u << (id & 31);
+				}
+				else
+				{
+						if(RouteStd[ch].ExtNum++ == 0)	RouteStd[ch].ExtStart = i;
+				}
+		}
+
+		//各通道标准帧段起点与位图前缀秩
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				for(i=0;(i<Num)&&(Table[i].SrcCh < ch);i++);
+				RouteStd[ch].Start = i;
+				RouteStd[ch].Rank[0] = 0;
+				for(w=1;w<CAN_ROUTE_STD_WORDS;w++)
+						RouteStd[ch].Rank[w] = RouteStd[ch].Rank[w-1] + CANRoute_BitCount(RouteStd[ch].Bitmap[w-1]);
+		}
+
+		RouteTab = Table;
+		RouteNum = Num;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANRouteLookup
+*  功能说明：查找接收帧对应的路由条目, 标准帧位图直接定位, 扩展帧在本通道扩展帧段内二分查找
+*  参数说明：SrcCh：接收通道
+//	         Frame：接收帧
+*  函数返回：路由条目, 无路由返回0
+*************************************************************************/
+const CANRouteType *CANRouteLookup(uint8_t SrcCh, const CANFrameType *Frame)
+{
+		const CANRouteStdType	*pStd;
+		uint32_t	id,bits;
+		uint16_t	idx,lo,hi;
+
+		if((RouteTab == 0) || (SrcCh >= CAN_CHANNEL_NUM))	return 0;
+		id = Frame->ID;
+
+		if(Frame->IDE == 0)
+		{
+				if(id >= CAN_ROUTE_STD_ID_NUM)	return 0;
+				pStd = &RouteStd[SrcCh];
+				bits = pStd->Bitmap[id>>5];
+				if((bits & (1u << (id & 31))) == 0)	return 0;
+				idx = pStd->Start + pStd->Rank[id>>5] + CANRoute_BitCount(bits & ((1u << (id & 31)) - 1));
+				return &RouteTab[idx];
+		}
+
+		pStd = &RouteStd[SrcCh];
+		lo = pStd->ExtStart;
+		hi = pStd->ExtStart + pStd->ExtNum;
+		while(lo < hi)
+		{
+				idx = lo + ((hi - lo) >> 1);
+				if(RouteTab[idx].SrcID < id)	lo = idx + 1;
+				else													hi = idx;
+		}
+		if((lo < pStd->ExtStart + pStd->ExtNum) && (RouteTab[lo].SrcID == id))	return &RouteTab[lo];
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANRouteForward
+*  功能说明：按路由表转发一帧, 可改ID、按字节屏蔽数据
+*  参数说明：SrcCh：接收通道
+//	         Frame：接收帧
+*  函数返回：发送失败的目标通道集合, 0：全部成功或无路由
+*************************************************************************/
+uint8_t CANRouteForward(uint8_t SrcCh, const CANFrameType *Frame)
+{
+		const CANRouteType	*pRoute;
+		CANFrameType	Out;
+		uint8_t				ch,i,fail;
+
+		pRoute = CANRouteLookup(SrcCh, Frame);
+		if(pRoute == 0)	return 0;
+
+		Out = *Frame;
+		if(pRoute->DstID != CAN_ROUTE_ID_KEEP)	Out.ID = pRoute->DstID;
+		if(pRoute->UseMask)
+		{
+				for(i=0;i<8;i++)	Out.Data[i] &= pRoute->DataMask[i];
+		}
+
+		fail = 0;
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				if((pRoute->DstMask & CAN_ROUTE_DST(ch)) == 0)	continue;
+				if(CANSendBurst(ch, &Out, 1) == 0)	fail |= CAN_ROUTE_DST(ch);
+		}
+		return fail;
+}
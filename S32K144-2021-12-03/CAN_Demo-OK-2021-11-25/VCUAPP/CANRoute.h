@@ -0,0 +1,33 @@
+#ifndef __CAN_ROUTE_H
+#define __CAN_ROUTE_H
+
+#include <stdint.h>
+#include "drvCAN.h"
+
+//目标通道位
+#define CAN_ROUTE_DST(ch)					(1u<<(ch))
+//DstID取此值时转发保持原ID
+#define CAN_ROUTE_ID_KEEP					(0xFFFFFFFFL)
+
+#define CAN_ROUTE_STD_ID_NUM			2048
+#define CAN_ROUTE_STD_WORDS				(CAN_ROUTE_STD_ID_NUM/32)
+
+//路由条目, 路由表按 SrcCh、IDE(标准帧在前)、SrcID 升序排列, 放在Flash中
+typedef	struct
+{
+			uint8_t		SrcCh;				//源通道
+			uint8_t		IDE;					//1:扩展帧 0:标准帧
+			uint8_t		DstMask;			//目标通道集合, CAN_ROUTE_DST(ch)组合
+			uint8_t		UseMask;			//1:数据按DataMask逐字节相与
+			uint32_t	SrcID;
+			uint32_t	DstID;				//转发ID, CAN_ROUTE_ID_KEEP不改
+			uint8_t		DataMask[8];
+
+}		CANRouteType;
+
+uint8_t CANRouteInit(const CANRouteType *Table, uint16_t Num);
+const CANRouteType *CANRouteLookup(uint8_t SrcCh, const CANFrameType *Frame);
+uint8_t CANRouteForward(uint8_t SrcCh, const CANFrameType *Frame);
+
+
+#endif /* __CAN_ROUTE_H */
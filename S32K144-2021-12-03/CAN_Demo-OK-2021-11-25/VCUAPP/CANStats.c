@@ -0,0 +1,160 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "drvTimer.h"
+#include "CANStats.h"
+
+//上一周期的累计计数, 本周期取差值
+typedef	struct
+{
+		uint32_t	RxFrames;
+		uint32_t	TxFrames;
+		uint32_t	Bits;
+		uint32_t	TxReject;
+		uint32_t	RxDrop;
+
+}		CANStatsPrevType;
+
+static CANStatsType			StatsOut[CAN_CHANNEL_NUM];
+static CANStatsPrevType	StatsPrev[CAN_CHANNEL_NUM];
+static uint64_t					StatsLastUs;
+
+static uint16_t CANStats_Sat16(uint64_t x)
+{
+		return (x > 0xFFFF) ? 0xFFFF : (uint16_t)x;
+}
+
+//CPU周期换算为0.1us
+static uint16_t CANStats_Cycles(uint64_t Cycles)
+{
+		return CANStats_Sat16(Cycles * 10 / (TIMER_CPU_HZ / 1000000));
+}
+
+static void CANStats_Put16(uint8_t *p, uint16_t x)
+{
+		p[0] = (uint8_t)x;
+		p[1] = (uint8_t)(x >> 8);
+}
+
+/*************************************************************************
+*  函数名称：CANStats_Update
+*  功能说明：按本周期的计数差值计算一个通道的统计结果
+*  参数说明：CANChannel：CAN模块号
+//	         PeriodUs：实际周期
+*************************************************************************/
+static void CANStats_Update(uint8_t CANChannel, uint32_t PeriodUs)
+{
+		CANStatType			Stat;
+		CANLatencyType	Lat;
+		CANStatsType		*pOut;
+		CANStatsPrevType	*pPrev;
+		uint32_t				bits;
+		uint8_t					i;
+
+		CANGetStat(CANChannel, &Stat, 1);
+		CANGetLatency(CANChannel, &Lat, 1);
+		pOut	= &StatsOut[CANChannel];
+		pPrev = &StatsPrev[CANChannel];
+
+		bits = (Stat.RxBits + Stat.TxBits) - pPrev->Bits;
+		pOut->RxFps		 = CANStats_Sat16((uint64_t)(Stat.RxFrames - pPrev->RxFrames) * 1000000 / PeriodUs);
+		pOut->TxFps		 = CANStats_Sat16((uint64_t)(Stat.TxFrames - pPrev->TxFrames) * 1000000 / PeriodUs);
+		pOut->LoadPermille = Stat.Bitrate ? CANStats_Sat16((uint64_t)bits * 1000000000uLL / ((uint64_t)Stat.Bitrate * PeriodUs)) : 0;
+		pOut->Tec			 = Stat.Tec;
+		pOut->Rec			 = Stat.Rec;
+		pOut->RxDrop	 = CANStats_Sat16(Stat.RxDrop - pPrev->RxDrop);
+		pOut->TxReject = CANStats_Sat16(Stat.TxReject - pPrev->TxReject);
+		pOut->IsrNum	 = CANStats_Sat16(Stat.IsrNum);
+		pOut->IsrAvg	 = Stat.IsrNum ? CANStats_Cycles(Stat.IsrSum / Stat.IsrNum) : 0;
+		pOut->IsrMax	 = CANStats_Cycles(Stat.IsrMax);
+		pOut->LatNum	 = CANStats_Sat16(Lat.Num);
+		pOut->LatAvg	 = Lat.Num ? CANStats_Sat16(Lat.Sum / Lat.Num) : 0;
+		pOut->LatMax	 = CANStats_Sat16(Lat.Max);
+		for(i=0;i<CAN_LATENCY_HIST_NUM;i++)
+				pOut->LatHist[i] = Lat.Num ? (uint8_t)((uint64_t)Lat.Hist[i] * 100 / Lat.Num) : 0;
+
+		pPrev->RxFrames = Stat.RxFrames;
+		pPrev->TxFrames = Stat.TxFrames;
+		pPrev->Bits			= Stat.RxBits + Stat.TxBits;
+		pPrev->TxReject = Stat.TxReject;
+		pPrev->RxDrop		= Stat.RxDrop;
+}
+
+/*************************************************************************
+*  函数名称：CANStats_Publish
+*  功能说明：在诊断ID上发出一个通道的统计结果, 格式见 CANStatsType
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+static void CANStats_Publish(uint8_t CANChannel)
+{
+		const CANStatsType	*pOut;
+		CANFrameType	Frames[4];
+		uint8_t				i;
+
+		pOut = &StatsOut[CANChannel];
+		for(i=0;i<4;i++)
+		{
+				Frames[i].ID	 = CAN_STATS_ID + CANChannel * 4 + i;
+				Frames[i].IDE	 = 0;
+				Frames[i].DLC	 = 8;
+				Frames[i].Time = 0;
+		}
+		CANStats_Put16(&Frames[0].Data[0], pOut->RxFps);
+		CANStats_Put16(&Frames[0].Data[2], pOut->TxFps);
+		CANStats_Put16(&Frames[0].Data[4], pOut->LoadPermille);
+		Frames[0].Data[6] = pOut->Tec;
+		Frames[0].Data[7] = pOut->Rec;
+		CANStats_Put16(&Frames[1].Data[0], pOut->RxDrop);
+		CANStats_Put16(&Frames[1].Data[2], pOut->TxReject);
+		CANStats_Put16(&Frames[1].Data[4], pOut->IsrAvg);
+		CANStats_Put16(&Frames[1].Data[6], pOut->IsrMax);
+		CANStats_Put16(&Frames[2].Data[0], pOut->LatAvg);
+		CANStats_Put16(&Frames[2].Data[2], pOut->LatMax);
+		CANStats_Put16(&Frames[2].Data[4], pOut->LatNum);
+		CANStats_Put16(&Frames[2].Data[6], pOut->IsrNum);
+		for(i=0;i<CAN_LATENCY_HIST_NUM;i++)	Frames[3].Data[i] = pOut->LatHist[i];
+
+		CANSendBurst(CAN_STATS_TX_CH, Frames, 4);
+}
+
+/*************************************************************************
+*  函数名称：CANStatsInit
+*  功能说明：以当前计数为起点开始统计, 在各通道CANInit之后调用
+*************************************************************************/
+void CANStatsInit(void)
+{
+		uint8_t	ch;
+
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)	CANStats_Update(ch, CAN_STATS_PERIOD_US);
+		StatsLastUs = TimerGetUs();
+}
+
+/*************************************************************************
+*  函数名称：CANStatsTask
+*  功能说明：主循环中调用, 每 CAN_STATS_PERIOD_US 统计一次并发布
+*************************************************************************/
+void CANStatsTask(void)
+{
+		uint64_t	now;
+		uint8_t		ch;
+
+		now = TimerGetUs();
+		if(now - StatsLastUs < CAN_STATS_PERIOD_US)	return;
+
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				CANStats_Update(ch, (uint32_t)(now - StatsLastUs));
+				CANStats_Publish(ch);
+		}
+		StatsLastUs = now;
+}
+
+/*************************************************************************
+*  函数名称：CANStatsGet
+*  功能说明：读取上一周期的统计结果
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+const CANStatsType *CANStatsGet(uint8_t CANChannel)
+{
+		return &StatsOut[CANChannel];
+}
@@ -0,0 +1,42 @@
+#ifndef __CAN_STATS_H
+#define __CAN_STATS_H
+
+#include <stdint.h>
+#include "drvCAN.h"
+
+//统计周期
+#define CAN_STATS_PERIOD_US				1000000uL
+//发布通道和诊断ID, 每个CAN通道4帧: ID = CAN_STATS_ID + 通道*4 + 帧号
+#define CAN_STATS_TX_CH						CAN0CH
+#define CAN_STATS_ID							0x6F0
+
+//一个统计周期的结果, 多字节量在报文中按小端发送
+//  帧0: RxFps(2)  TxFps(2)  LoadPermille(2)  Tec(1)  Rec(1)
+//  帧1: RxDrop(2) TxReject(2) IsrAvg(2) IsrMax(2)      中断耗时单位0.1us
+//  帧2: LatAvg(2) LatMax(2) LatNum(2) IsrNum(2)        延时单位us
+//  帧3: LatHist[8]                                     各格占比, 百分比
+typedef	struct
+{
+			uint16_t	RxFps;
+			uint16_t	TxFps;
+			uint16_t	LoadPermille;		//总线负载, 千分比
+			uint8_t		Tec;
+			uint8_t		Rec;
+			uint16_t	RxDrop;					//本周期接收丢帧
+			uint16_t	TxReject;				//本周期发送队列满拒绝
+			uint16_t	IsrAvg;					//0.1us
+			uint16_t	IsrMax;					//0.1us
+			uint16_t	LatAvg;					//us
+			uint16_t	LatMax;					//us
+			uint16_t	LatNum;
+			uint16_t	IsrNum;
+			uint8_t		LatHist[CAN_LATENCY_HIST_NUM];
+
+}		CANStatsType;
+
+void CANStatsInit(void);
+void CANStatsTask(void);
+const CANStatsType *CANStatsGet(uint8_t CANChannel);
+
+
+#endif /* __CAN_STATS_H */
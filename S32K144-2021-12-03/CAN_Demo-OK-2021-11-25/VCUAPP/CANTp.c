@@ -0,0 +1,485 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "drvTimer.h"
+#include "CANTp.h"
+
+//N_PCI类型
+#define CAN_TP_PCI_SF			0x00
+#define CAN_TP_PCI_FF			0x10
+#define CAN_TP_PCI_CF			0x20
+#define CAN_TP_PCI_FC			0x30
+
+//流控状态
+#define CAN_TP_FS_CTS			0
+#define CAN_TP_FS_WAIT		1
+#define CAN_TP_FS_OVFL		2
+
+//接收状态
+#define CAN_TP_RX_IDLE		0
+#define CAN_TP_RX_BUSY		1
+#define CAN_TP_RX_DONE		2
+
+//发送内部状态
+#define CAN_TP_TX_WAIT_FC	4
+
+//STmin=0时每次任务最多连续入队的连续帧数, 留出发送队列给网关转发
+#define CAN_TP_CF_BURST		8
+
+typedef	struct
+{
+		CANTpCfgType	Cfg;
+		uint8_t				Used;
+		uint8_t				DL;						//每帧最大字节数 8或64
+
+		//发送, 直接从调用者缓冲区分段, 完成前缓冲区不可改动
+		const uint8_t	*TxData;
+		uint32_t			TxLen;
+		uint32_t			TxPos;
+		uint64_t			TxNextUs;			//下一连续帧最早发送时刻
+		uint64_t			TxTimeoutUs;
+		uint32_t			TxSTminUs;
+		uint8_t				TxState;
+		uint8_t				TxSN;
+		uint8_t				TxBS;					//对方块大小, 0不分块
+		uint8_t				TxBSCnt;			//本块剩余帧数
+		uint8_t				TxWft;
+
+		//接收, 直接写入调用者缓冲区
+		uint8_t				*RxBuf;
+		uint32_t			RxSize;
+		uint32_t			RxLen;
+		uint32_t			RxPos;
+		uint64_t			RxTimeoutUs;
+		uint8_t				RxState;
+		uint8_t				RxSN;
+		uint8_t				RxBSCnt;
+
+}		CANTpSessionType;
+
+static CANTpSessionType	CANTp[CAN_CHANNEL_NUM];
+
+//STmin编码转换为us, 保留值按127ms处理
+static uint32_t CANTp_STminUs(uint8_t STmin)
+{
+		if(STmin <= 0x7F)												return (uint32_t)STmin * 1000;
+		if((STmin >= 0xF1)&&(STmin <= 0xF9))		return (uint32_t)(STmin - 0xF0) * 100;
+		return 127000;
+}
+
+/*************************************************************************
+*  函数名称：CANTp_Out
+*  功能说明：发出一帧, FD通道用CAN FD帧(驱动按DLC补齐), 否则按配置补齐到8字节
+*  参数说明：CANChannel：CAN模块号
+//	         Buf：帧数据
+//	         Len：字节数
+*  函数返回：0：成功  1：发送队列满
+*************************************************************************/
+static uint8_t CANTp_Out(uint8_t CANChannel, const uint8_t *Buf, uint8_t Len)
+{
+		CANTpSessionType	*s;
+		CANFDFrameType		FDFrame;
+		CANFrameType			Frame;
+		uint8_t						i;
+
+		s = &CANTp[CANChannel];
+		if(s->Cfg.FD)
+		{
+				FDFrame.ID	 = s->Cfg.TxID;
+				FDFrame.IDE	 = s->Cfg.IDE;
+				FDFrame.BRS	 = 1;
+				FDFrame.Len	 = Len;
+				FDFrame.Time = 0;
+				for(i=0;i<Len;i++)	FDFrame.Data[i] = Buf[i];
+				return CANSendFD(CANChannel, &FDFrame);
+		}
+
+		Frame.ID	 = s->Cfg.TxID;
+		Frame.IDE	 = s->Cfg.IDE;
+		Frame.Time = 0;
+		for(i=0;i<Len;i++)	Frame.Data[i] = Buf[i];
+		if(s->Cfg.Pad)
+		{
+				for(;i<8;i++)	Frame.Data[i] = CAN_TP_PAD_BYTE;
+				Len = 8;
+		}
+		Frame.DLC = Len;
+		return (CANSendBurst(CANChannel, &Frame, 1) == 1) ? 0 : 1;
+}
+
+static uint8_t CANTp_SendFC(uint8_t CANChannel, uint8_t FS)
+{
+		uint8_t	buf[3];
+
+		buf[0] = CAN_TP_PCI_FC | FS;
+		buf[1] = CANTp[CANChannel].Cfg.BS;
+		buf[2] = CANTp[CANChannel].Cfg.STmin;
+		return CANTp_Out(CANChannel, buf, 3);
+}
+
+/*************************************************************************
+*  函数名称：CANTp_TxCF
+*  功能说明：按STmin和块大小发出连续帧, STmin=0时成批入队使帧首尾相接
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+static void CANTp_TxCF(uint8_t CANChannel)
+{
+		CANTpSessionType	*s;
+		uint8_t						buf[64];
+		uint64_t					now;
+		uint32_t					n;
+		uint8_t						i,cnt;
+
+		s = &CANTp[CANChannel];
+		now = TimerGetUs();
+		for(cnt=0;(cnt<CAN_TP_CF_BURST)&&(s->TxState == CAN_TP_TX_BUSY);cnt++)
+		{
+				if(now < s->TxNextUs)	break;
+
+				n = s->TxLen - s->TxPos;
+				if(n > (uint32_t)(s->DL - 1))	n = s->DL - 1;
+				buf[0] = CAN_TP_PCI_CF | s->TxSN;
+				for(i=0;i<n;i++)	buf[1+i] = s->TxData[s->TxPos+i];
+				if(CANTp_Out(CANChannel, buf, (uint8_t)(n + 1)))	break;
+
+				s->TxPos += n;
+				s->TxSN = (s->TxSN + 1) & 0x0F;
+				s->TxNextUs = now + s->TxSTminUs;
+				if(s->TxPos >= s->TxLen)
+				{
+						s->TxState = CAN_TP_TX_DONE;
+				}
+				else if(s->TxBS && (--s->TxBSCnt == 0))
+				{
+						s->TxState = CAN_TP_TX_WAIT_FC;
+						s->TxTimeoutUs = now + CAN_TP_N_BS_US;
+				}
+				else if(s->TxSTminUs)
+				{
+						break;
+				}
+		}
+}
+
+/*************************************************************************
+*  函数名称：CANTpInit
+*  功能说明：配置一个通道的传输层会话, 各通道的会话互相独立可同时进行
+*  参数说明：CANChannel：CAN模块号
+//	         Cfg：ID、帧格式及本端流控参数
+*************************************************************************/
+void CANTpInit(uint8_t CANChannel, const CANTpCfgType *Cfg)
+{
+		CANTpSessionType	*s;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return;
+		s = &CANTp[CANChannel];
+		s->Cfg		 = *Cfg;
+		s->DL			 = Cfg->FD ? 64 : 8;
+		s->TxState = CAN_TP_TX_IDLE;
+		s->RxState = CAN_TP_RX_IDLE;
+		s->Used		 = 1;
+}
+
+/*************************************************************************
+*  函数名称：CANTpSetRxBuffer
+*  功能说明：指定接收缓冲区, 多帧报文直接写入, 长度超过Size时回复溢出流控帧
+*  参数说明：CANChannel：CAN模块号
+//	         Buf：缓冲区
+//	         Size：缓冲区字节数
+*************************************************************************/
+void CANTpSetRxBuffer(uint8_t CANChannel, uint8_t *Buf, uint32_t Size)
+{
+		if(CANChannel >= CAN_CHANNEL_NUM)	return;
+		CANTp[CANChannel].RxBuf		= Buf;
+		CANTp[CANChannel].RxSize	= Size;
+		CANTp[CANChannel].RxState = CAN_TP_RX_IDLE;
+}
+
+/*************************************************************************
+*  函数名称：CANTpSend
+*  功能说明：开始发送一条报文, 单帧立即发出, 多帧发出首帧后等待流控
+//	         数据不拷贝, 发送完成(CANTpTxStatus不为BUSY)前Data须保持有效
+*  参数说明：CANChannel：CAN模块号
+//	         Data：报文数据
+//	         Len：报文长度
+*  函数返回：0：已开始  1：通道未配置、正在发送或发送队列满
+*************************************************************************/
+uint8_t CANTpSend(uint8_t CANChannel, const uint8_t *Data, uint32_t Len)
+{
+		CANTpSessionType	*s;
+		uint8_t						buf[64];
+		uint8_t						i,n;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return 1;
+		s = &CANTp[CANChannel];
+		if((s->Used == 0)||(s->TxState == CAN_TP_TX_BUSY)||(s->TxState == CAN_TP_TX_WAIT_FC)||(Len == 0))	return 1;
+
+		//单帧, DL=8时1字节PCI, FD帧超过7字节用2字节PCI
+		if(Len <= 7)
+		{
+				buf[0] = CAN_TP_PCI_SF | (uint8_t)Len;
+				for(i=0;i<Len;i++)	buf[1+i] = Data[i];
+				if(CANTp_Out(CANChannel, buf, (uint8_t)(Len + 1)))	return 1;
+				s->TxState = CAN_TP_TX_DONE;
+				return 0;
+		}
+		if(Len <= (uint32_t)(s->DL - 2) && (s->DL > 8))
+		{
+				buf[0] = CAN_TP_PCI_SF;
+				buf[1] = (uint8_t)Len;
+				for(i=0;i<Len;i++)	buf[2+i] = Data[i];
+				if(CANTp_Out(CANChannel, buf, (uint8_t)(Len + 2)))	return 1;
+				s->TxState = CAN_TP_TX_DONE;
+				return 0;
+		}
+
+		//首帧, 超过4095字节用6字节PCI
+		if(Len <= 0xFFF)
+		{
+				buf[0] = CAN_TP_PCI_FF | (uint8_t)(Len >> 8);
+				buf[1] = (uint8_t)Len;
+				n = 2;
+		}
+		else
+		{
+				buf[0] = CAN_TP_PCI_FF;
+				buf[1] = 0;
+				buf[2] = (uint8_t)(Len >> 24);
+				buf[3] = (uint8_t)(Len >> 16);
+				buf[4] = (uint8_t)(Len >> 8);
+				buf[5] = (uint8_t)Len;
+				n = 6;
+		}
+		for(i=0;n+i<s->DL;i++)	buf[n+i] = Data[i];
+		if(CANTp_Out(CANChannel, buf, s->DL))	return 1;
+
+		s->TxData			 = Data;
+		s->TxLen			 = Len;
+		s->TxPos			 = i;
+		s->TxSN				 = 1;
+		s->TxWft			 = 0;
+		s->TxState		 = CAN_TP_TX_WAIT_FC;
+		s->TxTimeoutUs = TimerGetUs() + CAN_TP_N_BS_US;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANTpTxStatus
+*  功能说明：查询发送状态, DONE/ERROR后可发送下一条
+*  函数返回：CAN_TP_TX_IDLE/BUSY/DONE/ERROR
+*************************************************************************/
+uint8_t CANTpTxStatus(uint8_t CANChannel)
+{
+		uint8_t	st;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return CAN_TP_TX_ERROR;
+		st = CANTp[CANChannel].TxState;
+		return (st == CAN_TP_TX_WAIT_FC) ? CAN_TP_TX_BUSY : st;
+}
+
+/*************************************************************************
+*  函数名称：CANTpRecv
+*  功能说明：取出已收完的报文, 数据在CANTpSetRxBuffer指定的缓冲区中
+//	         取出后缓冲区重新用于接收
+*  参数说明：CANChannel：CAN模块号
+//	         Len：返回报文长度
+*  函数返回：0：有报文  1：无
+*************************************************************************/
+uint8_t CANTpRecv(uint8_t CANChannel, uint32_t *Len)
+{
+		CANTpSessionType	*s;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return 1;
+		s = &CANTp[CANChannel];
+		if(s->RxState != CAN_TP_RX_DONE)	return 1;
+		*Len = s->RxLen;
+		s->RxState = CAN_TP_RX_IDLE;
+		return 0;
+}
+
+//收到对方流控帧
+static void CANTp_RxFC(uint8_t CANChannel, const uint8_t *Data, uint8_t Len)
+{
+		CANTpSessionType	*s;
+
+		s = &CANTp[CANChannel];
+		if((s->TxState != CAN_TP_TX_WAIT_FC)||(Len < 3))	return;
+
+		switch(Data[0] & 0x0F)
+		{
+				case CAN_TP_FS_CTS:
+						s->TxBS			 = Data[1];
+						s->TxBSCnt	 = Data[1];
+						s->TxSTminUs = CANTp_STminUs(Data[2]);
+						s->TxWft		 = 0;
+						s->TxNextUs	 = 0;
+						s->TxState	 = CAN_TP_TX_BUSY;
+						CANTp_TxCF(CANChannel);
+						break;
+				case CAN_TP_FS_WAIT:
+						if(++s->TxWft > CAN_TP_WFT_MAX)
+								s->TxState = CAN_TP_TX_ERROR;
+						else
+								s->TxTimeoutUs = TimerGetUs() + CAN_TP_N_BS_US;
+						break;
+				default:
+						s->TxState = CAN_TP_TX_ERROR;
+						break;
+		}
+}
+
+/*************************************************************************
+*  函数名称：CANTp_Rx
+*  功能说明：处理一帧接收ID上的数据, 单帧/首帧/连续帧写入接收缓冲区
+*  参数说明：CANChannel：CAN模块号
+//	         Data：帧数据
+//	         Len：帧字节数
+*************************************************************************/
+static void CANTp_Rx(uint8_t CANChannel, const uint8_t *Data, uint8_t Len)
+{
+		CANTpSessionType	*s;
+		uint32_t					n,size;
+		uint8_t						pci,i;
+
+		s = &CANTp[CANChannel];
+		if(Len == 0)	return;
+		pci = Data[0] & 0xF0;
+
+		if(pci == CAN_TP_PCI_FC)
+		{
+				CANTp_RxFC(CANChannel, Data, Len);
+				return;
+		}
+		//上一条报文未取走时丢弃新报文
+		if((s->RxState == CAN_TP_RX_DONE)||(s->RxBuf == 0))	return;
+
+		switch(pci)
+		{
+				case CAN_TP_PCI_SF:
+						n = Data[0] & 0x0F;
+						i = 1;
+						if((n == 0)&&(Len > 8))
+						{
+								n = Data[1];
+								i = 2;
+						}
+						if((n == 0)||(n + i > Len)||(n > s->RxSize))	return;
+						for(size=0;size<n;size++)	s->RxBuf[size] = Data[i+size];
+						s->RxLen	 = n;
+						s->RxState = CAN_TP_RX_DONE;
+						break;
+
+				case CAN_TP_PCI_FF:
+						if(Len < 8)	return;
+						n = ((uint32_t)(Data[0] & 0x0F) << 8) | Data[1];
+						i = 2;
+						if(n == 0)
+						{
+								n = ((uint32_t)Data[2] << 24) | ((uint32_t)Data[3] << 16) | ((uint32_t)Data[4] << 8) | Data[5];
+								i = 6;
+						}
+						if(n > s->RxSize)
+						{
+								s->RxState = CAN_TP_RX_IDLE;
+								CANTp_SendFC(CANChannel, CAN_TP_FS_OVFL);
+								return;
+						}
+						size = Len - i;
+						if(size > n)	size = n;
+						s->RxLen = n;
+						for(n=0;n<size;n++)	s->RxBuf[n] = Data[i+n];
+						s->RxPos			 = size;
+						s->RxSN				 = 1;
+						s->RxBSCnt		 = s->Cfg.BS;
+						s->RxState		 = CAN_TP_RX_BUSY;
+						s->RxTimeoutUs = TimerGetUs() + CAN_TP_N_CR_US;
+						CANTp_SendFC(CANChannel, CAN_TP_FS_CTS);
+						break;
+
+				case CAN_TP_PCI_CF:
+						if(s->RxState != CAN_TP_RX_BUSY)	return;
+						if((Data[0] & 0x0F) != s->RxSN)
+						{
+								s->RxState = CAN_TP_RX_IDLE;
+								return;
+						}
+						n = s->RxLen - s->RxPos;
+						if(n > (uint32_t)(Len - 1))	n = Len - 1;
+						for(size=0;size<n;size++)	s->RxBuf[s->RxPos+size] = Data[1+size];
+						s->RxPos += n;
+						s->RxSN = (s->RxSN + 1) & 0x0F;
+						s->RxTimeoutUs = TimerGetUs() + CAN_TP_N_CR_US;
+						if(s->RxPos >= s->RxLen)
+						{
+								s->RxState = CAN_TP_RX_DONE;
+						}
+						else if(s->Cfg.BS && (--s->RxBSCnt == 0))
+						{
+								s->RxBSCnt = s->Cfg.BS;
+								CANTp_SendFC(CANChannel, CAN_TP_FS_CTS);
+						}
+						break;
+
+				default:
+						break;
+		}
+}
+
+/*************************************************************************
+*  函数名称：CANTpRxFrame
+*  功能说明：主循环收到的经典帧先交给传输层, 不是本层ID的帧返回给调用者
+*  参数说明：CANChannel：CAN模块号
+//	         Frame：接收到的帧
+*  函数返回：0：已由传输层处理  1：不是传输层的帧
+*************************************************************************/
+uint8_t CANTpRxFrame(uint8_t CANChannel, const CANFrameType *Frame)
+{
+		CANTpSessionType	*s;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return 1;
+		s = &CANTp[CANChannel];
+		if((s->Used == 0)||(Frame->ID != s->Cfg.RxID)||(Frame->IDE != s->Cfg.IDE))	return 1;
+		CANTp_Rx(CANChannel, Frame->Data, CAN_CLASSIC_DLC(Frame->DLC));
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANTpRxFDFrame
+*  功能说明：同CANTpRxFrame, 用于CAN FD帧
+*************************************************************************/
+uint8_t CANTpRxFDFrame(uint8_t CANChannel, const CANFDFrameType *Frame)
+{
+		CANTpSessionType	*s;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return 1;
+		s = &CANTp[CANChannel];
+		if((s->Used == 0)||(Frame->ID != s->Cfg.RxID)||(Frame->IDE != s->Cfg.IDE))	return 1;
+		CANTp_Rx(CANChannel, Frame->Data, Frame->Len);
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANTpTask
+*  功能说明：主循环周期调用, 按STmin发出连续帧并检查N_Bs/N_Cr超时
+//	         STmin以us时基计时, 0xF1~0xF9的100~900us间隔也能保证
+*************************************************************************/
+void CANTpTask(void)
+{
+		CANTpSessionType	*s;
+		uint64_t					now;
+		uint8_t						ch;
+
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				s = &CANTp[ch];
+				if(s->Used == 0)	continue;
+
+				if(s->TxState == CAN_TP_TX_BUSY)	CANTp_TxCF(ch);
+
+				now = TimerGetUs();
+				if((s->TxState == CAN_TP_TX_WAIT_FC)&&(now > s->TxTimeoutUs))
+						s->TxState = CAN_TP_TX_ERROR;
+				if((s->RxState == CAN_TP_RX_BUSY)&&(now > s->RxTimeoutUs))
+						s->RxState = CAN_TP_RX_IDLE;
+		}
+}
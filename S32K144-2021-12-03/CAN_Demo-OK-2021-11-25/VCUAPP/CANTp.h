@@ -0,0 +1,44 @@
+#ifndef __CAN_TP_H
+#define __CAN_TP_H
+
+#include <stdint.h>
+#include "drvCAN.h"
+
+//超时: 等待流控帧 N_Bs, 等待连续帧 N_Cr
+#define CAN_TP_N_BS_US				1000000uL
+#define CAN_TP_N_CR_US				1000000uL
+//连续收到流控等待帧的上限
+#define CAN_TP_WFT_MAX				16
+//经典帧填充字节
+#define CAN_TP_PAD_BYTE				0xCC
+
+//发送状态
+#define CAN_TP_TX_IDLE				0
+#define CAN_TP_TX_BUSY				1
+#define CAN_TP_TX_DONE				2
+#define CAN_TP_TX_ERROR				3
+
+//通道配置, 物理寻址一对ID
+typedef	struct
+{
+			uint32_t	RxID;					//接收ID(数据帧和对方的流控帧)
+			uint32_t	TxID;					//发送ID
+			uint8_t		IDE;					//1:扩展帧
+			uint8_t		FD;						//1:用CAN FD帧(TX_DL=64), 通道须由CANInitFD初始化
+			uint8_t		Pad;					//1:经典帧补齐到8字节
+			uint8_t		BS;						//接收时流控帧的块大小, 0不分块
+			uint8_t		STmin;				//接收时流控帧的STmin, 0x00~0x7F ms, 0xF1~0xF9 100~900us
+
+}		CANTpCfgType;
+
+void		CANTpInit(uint8_t CANChannel, const CANTpCfgType *Cfg);
+void		CANTpSetRxBuffer(uint8_t CANChannel, uint8_t *Buf, uint32_t Size);
+uint8_t CANTpSend(uint8_t CANChannel, const uint8_t *Data, uint32_t Len);
+uint8_t CANTpTxStatus(uint8_t CANChannel);
+uint8_t CANTpRecv(uint8_t CANChannel, uint32_t *Len);
+uint8_t CANTpRxFrame(uint8_t CANChannel, const CANFrameType *Frame);
+uint8_t CANTpRxFDFrame(uint8_t CANChannel, const CANFDFrameType *Frame);
+void		CANTpTask(void);
+
+
+#endif /* __CAN_TP_H */
@@ -0,0 +1,903 @@
+#include <stdint.h>
+#include <string.h>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "drvTimer.h"
+#include "drvflash.h"
+#include "drvBoot.h"
+#include "drvJournal.h"
+#include "drvEee.h"
+#include "CANTp.h"
+#include "CANDelta.h"
+#include "CANUds.h"
+
+//服务
+#define UDS_SID_DSC					0x10
+#define UDS_SID_ER					0x11
+#define UDS_SID_RDBI				0x22
+#define UDS_SID_SA					0x27
+#define UDS_SID_WDBI				0x2E
+#define UDS_SID_RC					0x31
+#define UDS_SID_RD					0x34
+#define UDS_SID_TD					0x36
+#define UDS_SID_RTE					0x37
+#define UDS_SID_TP					0x3E
+#define UDS_SID_NEG					0x7F
+
+//否定响应码
+#define UDS_NRC_SNS					0x11
+#define UDS_NRC_SFNS				0x12
+#define UDS_NRC_IMLOIF			0x13
+#define UDS_NRC_CNC					0x22
+#define UDS_NRC_RSE					0x24
+#define UDS_NRC_ROOR				0x31
+#define UDS_NRC_SAD					0x33
+#define UDS_NRC_IK					0x35
+#define UDS_NRC_ENOA				0x36
+#define UDS_NRC_RTDNE				0x37
+#define UDS_NRC_TDS					0x71
+#define UDS_NRC_GPF					0x72
+#define UDS_NRC_WBSC				0x73
+#define UDS_NRC_RCRRP				0x78
+#define UDS_NRC_SNSIAS			0x7F
+
+//会话
+#define UDS_SESSION_DEFAULT			1
+#define UDS_SESSION_PROGRAMMING	2
+#define UDS_SESSION_EXTENDED		3
+
+//例程: 擦除目标slot, 校验映像CRC32, Flash写入速度测试, 断点续传, 回退到另一个slot
+#define UDS_RID_ERASE				0xFF00
+#define UDS_RID_CHECK				0xFF01
+#define UDS_RID_BENCH				0xFF02
+#define UDS_RID_RESUME			0xFF03
+#define UDS_RID_ROLLBACK		0xFF04
+
+typedef	struct
+{
+		//会话与安全访问
+		uint8_t				Session;
+		uint8_t				Unlocked;
+		uint8_t				SeedSent;
+		uint8_t				KeyFails;
+		uint32_t			Seed;
+		uint64_t			KeyLockUs;
+		uint64_t			S3Us;
+
+		//下载目标: 未运行的slot
+		uint8_t				Slot;
+		uint32_t			SlotBase;
+
+		//擦除范围(Flash地址), EraseNext之前的扇区已擦除
+		uint32_t			EraseStart;
+		uint32_t			EraseNext;
+		uint32_t			EraseEnd;
+
+		//下载, DlAddr为下一块的Flash地址
+		uint8_t				DlActive;
+		uint8_t				DlBsc;
+		uint8_t				DlBscValid;
+		uint32_t			DlAddr;
+		uint32_t			DlEnd;
+		uint32_t			ImageEnd;				//已下载数据的最高slot内偏移
+		uint32_t			JournalProg;		//日志中记录的已写入进度, 扇区对齐
+
+		//差分下载: TransferData为差分数据, 解出的新映像满一个扇区写入一次
+		uint8_t				Delta;
+		uint8_t				DzRet;
+		CANDeltaType	Dz;
+		const uint8_t	*DzIn;					//未解完的差分数据块
+		uint32_t			DzInLen;
+		uint32_t			WinFill;				//UdsWin中已解出的字节数
+
+		//Flash写入, 一块缓冲区由异步擦写队列写入, 同时另一块缓冲区接收下一块
+		const uint8_t	*ProgData;
+		uint32_t			ProgAddr;
+		uint32_t			ProgLen;
+		uint8_t				ProgBusy;
+		uint8_t				ProgQueued;
+		volatile uint8_t	ProgDone;
+		uint8_t				ProgErr;
+		uint8_t				Valid;
+
+		//写入未完成时收到的TransferData/RequestTransferExit延后处理
+		uint8_t				Pending;
+		uint32_t			PendingLen;
+		uint64_t			PendingRspUs;
+
+		uint8_t				ResetReq;
+		uint64_t			ResetUs;
+
+}		CANUdsStateType;
+
+static CANUdsStateType	Uds;
+static uint8_t					UdsBuf[2][CAN_UDS_BLOCK_DATA + 2];
+static uint8_t					UdsWin[CAN_UDS_SECTOR_BYTES];	//差分下载解出的一个扇区
+static uint8_t					UdsRxIdx;					//传输层正在使用的缓冲区
+static uint8_t					UdsResp[20];
+static uint8_t					UdsRespLen;
+
+static uint32_t CANUds_Key(uint32_t Seed)
+{
+		Seed ^= CAN_UDS_KEY_MASK;
+		return ((Seed << 11) | (Seed >> 21)) + 0x1D2C3B4Au;
+}
+
+static uint32_t CANUds_Get(const uint8_t *p, uint8_t n)
+{
+		uint32_t	x = 0;
+
+		while(n--)	x = (x << 8) | *p++;
+		return x;
+}
+
+static void CANUds_Put32(uint8_t *p, uint32_t x)
+{
+		p[0] = (uint8_t)(x >> 24);
+		p[1] = (uint8_t)(x >> 16);
+		p[2] = (uint8_t)(x >> 8);
+		p[3] = (uint8_t)x;
+}
+
+static void CANUds_Nrc(uint8_t Sid, uint8_t Nrc)
+{
+		UdsResp[0] = UDS_SID_NEG;
+		UdsResp[1] = Sid;
+		UdsResp[2] = Nrc;
+		CANTpSend(CAN_UDS_CHANNEL, UdsResp, 3);
+}
+
+/*************************************************************************
+*  函数名称：CANUds_Prog
+*  功能说明：Flash后台任务, 块的擦除和写入交给异步擦写队列, 完成后回读校验
+//	         写入地址所在扇区未擦除时先排队擦除; 空闲时提前擦除后续扇区,
+//	         使TransferData到达时不必等待擦除
+//	         每写满一个扇区在日志中记录进度, 断电后可从此处续传
+//	         差分下载时先把数据块解到UdsWin, 满一个扇区或数据流结束时写入;
+//	         解压读旧slot, 须在异步擦写队列空闲时进行
+*************************************************************************/
+static void CANUds_Prog(void)
+{
+		uint32_t	end,j,done;
+		uint8_t		r;
+
+		if(Uds.ProgBusy == 0)
+		{
+				if((FlashAsyncBusy() == 0)&&(Uds.EraseNext < Uds.EraseEnd))
+				{
+						if(FlashAsyncErase(Uds.EraseNext, 0) == 0)	Uds.EraseNext += CAN_UDS_SECTOR_BYTES;
+				}
+				return;
+		}
+
+		if(Uds.Delta && (Uds.ProgLen == 0))
+		{
+				if(FlashAsyncBusy())	return;
+				r = CANDeltaRun(&Uds.Dz, &Uds.DzIn, &Uds.DzInLen, UdsWin, &Uds.WinFill, CAN_UDS_SECTOR_BYTES);
+				Uds.DzRet = r;
+				if((r == CAN_DELTA_ERROR)||(Uds.WinFill > Uds.DlEnd - Uds.DlAddr))
+				{
+						Uds.ProgErr	 = 1;
+						Uds.DzInLen	 = 0;
+						Uds.ProgBusy = 0;
+						return;
+				}
+				if((r == CAN_DELTA_OUT_FULL)||((r == CAN_DELTA_DONE)&&Uds.WinFill))
+				{
+						Uds.ProgData = UdsWin;
+						Uds.ProgAddr = Uds.DlAddr;
+						Uds.ProgLen	 = Uds.WinFill;
+				}
+				else
+				{
+						//数据块已解完, 不足一个扇区的部分留在UdsWin中等下一块
+						Uds.ProgBusy = 0;
+						return;
+				}
+		}
+
+		if(Uds.ProgQueued == 0)
+		{
+				end = Uds.ProgAddr + Uds.ProgLen;
+				while(Uds.EraseNext < end)
+				{
+						if(FlashAsyncErase(Uds.EraseNext, 0))	return;
+						Uds.EraseNext += CAN_UDS_SECTOR_BYTES;
+				}
+				if(FlashAsyncWrite(Uds.ProgAddr, Uds.ProgLen, Uds.ProgData, &Uds.ProgDone))	return;
+				Uds.ProgQueued = 1;
+				return;
+		}
+		if((Uds.ProgDone == FLASH_JOB_PENDING)||FlashAsyncBusy())	return;
+
+		//回读校验, 先使缓存失效
+		if((Uds.ProgDone != FLASH_JOB_OK)||FlashAsyncError(1))	Uds.ProgErr = 1;
+		LMEM->PCCCR = 0x85000001;
+		for(j=0;j<Uds.ProgLen;j++)
+		{
+				if(*(const uint8_t *)(Uds.ProgAddr + j) != Uds.ProgData[j])
+				{
+						Uds.ProgErr = 1;
+						break;
+				}
+		}
+		Uds.ProgQueued = 0;
+		Uds.ProgBusy	 = 0;
+
+		done = (Uds.ProgAddr + Uds.ProgLen - Uds.SlotBase) & ~(CAN_UDS_SECTOR_BYTES - 1);
+		if((Uds.ProgErr == 0)&&(done > Uds.JournalProg))
+		{
+				if(JournalAppend(BOOT_REC_PROGRESS, Uds.Slot, done, 0) == 0)	Uds.JournalProg = done;
+		}
+
+		if(Uds.Delta)
+		{
+				Uds.DlAddr += Uds.ProgLen;
+				if(Uds.DlAddr - Uds.SlotBase > Uds.ImageEnd)	Uds.ImageEnd = Uds.DlAddr - Uds.SlotBase;
+				Uds.WinFill	 = 0;
+				Uds.ProgLen	 = 0;
+				Uds.ProgBusy = (Uds.DzInLen != 0) ? 1 : 0;
+		}
+}
+
+/*************************************************************************
+*  函数名称：CANUds_Pattern
+*  功能说明：测速的数据源, 在UdsWin中生成一个扇区的固定图样
+//	         FF02不在下载中执行, UdsWin此时空闲
+*************************************************************************/
+static void CANUds_Pattern(void)
+{
+		uint32_t	j;
+
+		for(j=0;j<CAN_UDS_SECTOR_BYTES;j++)	UdsWin[j] = (uint8_t)((j * 0x9D) ^ (j >> 8));
+}
+
+/*************************************************************************
+*  函数名称：CANUds_Bench
+*  功能说明：擦除一个扇区后按phrase或Program Section写满, 计算写入速度
+//	         数据源为UdsWin中的图样(CANUds_Pattern)
+*  参数说明：Addr：扇区地址
+//	         Section：0:逐phrase  1:Program Section
+*  函数返回：字节/秒
+*************************************************************************/
+static uint32_t CANUds_Bench(uint32_t Addr, uint8_t Section)
+{
+		uint64_t	t;
+		uint32_t	j;
+
+		FLASH_Erase_OneSector(Addr);
+		t = TimerGetUs();
+		if(Section)
+		{
+				Flash_Write_Section(Addr, CAN_UDS_SECTOR_BYTES, UdsWin);
+		}
+		else
+		{
+				for(j=0;j<CAN_UDS_SECTOR_BYTES;j+=8)	Flash_Write(Addr + j, 8, &UdsWin[j]);
+		}
+		t = TimerGetUs() - t;
+		return t ? (uint32_t)((uint64_t)CAN_UDS_SECTOR_BYTES * 1000000 / t) : 0;
+}
+
+static uint8_t CANUds_RD(const uint8_t *Req, uint32_t Len);
+static uint8_t CANUds_TD(const uint8_t *Req, uint32_t Len);
+static uint8_t CANUds_RTE(const uint8_t *Req, uint32_t Len);
+
+/*************************************************************************
+*  函数名称：CANUds_BenchWait
+*  功能说明：像主循环一样推进Flash后台任务, 直到当前块写完
+*************************************************************************/
+static void CANUds_BenchWait(void)
+{
+		while(Uds.ProgBusy)
+		{
+				CANUds_Prog();
+				FlashAsyncTask();
+		}
+}
+
+/*************************************************************************
+*  函数名称：CANUds_BenchDownload
+*  功能说明：不经CAN, 直接按34/36/37处理流程向目标slot下载CAN_UDS_BENCH_BYTES字节图样,
+//	         每块先拷入传输层空闲的那块缓冲区(代替接收), 再等上一块写完后交给TransferData,
+//	         与实际下载一样一块写Flash时另一块接收; 一次下载不超过slot大小, 分几遍完成
+//	         目标slot日志记为开始下载, 之后须重新FF00
+*  函数返回：字节/秒, 0：失败
+*************************************************************************/
+static uint32_t CANUds_BenchDownload(void)
+{
+		uint8_t		req[11],*buf;
+		uint32_t	total,size,off,n;
+		uint64_t	t;
+
+		if(JournalAppend(BOOT_REC_START, Uds.Slot, 0, 0))	return 0;
+		t = TimerGetUs();
+		for(total=0;total<CAN_UDS_BENCH_BYTES;total+=size)
+		{
+				size = CAN_UDS_BENCH_BYTES - total;
+				if(size > BOOT_SLOT_SIZE)	size = BOOT_SLOT_SIZE;
+
+				//同FF00
+				Uds.EraseStart	= Uds.SlotBase;
+				Uds.EraseNext		= Uds.SlotBase;
+				Uds.EraseEnd		= Uds.SlotBase + ((size + CAN_UDS_SECTOR_BYTES - 1) & ~(CAN_UDS_SECTOR_BYTES - 1));
+				Uds.ImageEnd		= 0;
+				Uds.JournalProg = 0;
+				Uds.ProgErr			= 0;
+
+				req[0] = UDS_SID_RD;
+				req[1] = 0x00;
+				req[2] = 0x44;
+				CANUds_Put32(&req[3], 0);
+				CANUds_Put32(&req[7], size);
+				if(CANUds_RD(req, 11))	break;
+				for(off=0;off<size;off+=n)
+				{
+						n = size - off;
+						if(n > CAN_UDS_BLOCK_DATA)	n = CAN_UDS_BLOCK_DATA;
+						buf = UdsBuf[UdsRxIdx];
+						buf[0] = UDS_SID_TD;
+						buf[1] = (uint8_t)(Uds.DlBsc + 1);
+						memcpy(&buf[2], &UdsWin[off & (CAN_UDS_SECTOR_BYTES - 1)], n);
+						CANUds_BenchWait();
+						if(CANUds_TD(buf, n + 2))	break;
+				}
+				CANUds_BenchWait();
+				req[0] = UDS_SID_RTE;
+				if((off < size)||CANUds_RTE(req, 1))	break;
+		}
+		t = TimerGetUs() - t;
+
+		Uds.DlActive	 = 0;
+		Uds.EraseStart = Uds.EraseNext = Uds.EraseEnd = Uds.SlotBase;
+		Uds.ImageEnd	 = 0;
+		Uds.Valid			 = 0;
+		if((total < CAN_UDS_BENCH_BYTES)||(t == 0))	return 0;
+		return (uint32_t)((uint64_t)CAN_UDS_BENCH_BYTES * 1000000 / t);
+}
+
+static void CANUds_Lock(void)
+{
+		Uds.Unlocked = 0;
+		Uds.SeedSent = 0;
+		Uds.DlActive = 0;
+}
+
+static uint8_t CANUds_DSC(const uint8_t *Req, uint32_t Len)
+{
+		uint8_t	sub;
+
+		if(Len != 2)	return UDS_NRC_IMLOIF;
+		sub = Req[1] & 0x7F;
+		if((sub < UDS_SESSION_DEFAULT)||(sub > UDS_SESSION_EXTENDED))	return UDS_NRC_SFNS;
+		if(sub != Uds.Session)	CANUds_Lock();
+		Uds.Session = sub;
+
+		UdsResp[0] = UDS_SID_DSC + 0x40;
+		UdsResp[1] = sub;
+		UdsResp[2] = (uint8_t)(CAN_UDS_P2_MS >> 8);
+		UdsResp[3] = (uint8_t)CAN_UDS_P2_MS;
+		UdsResp[4] = (uint8_t)((CAN_UDS_P2X_MS / 10) >> 8);
+		UdsResp[5] = (uint8_t)(CAN_UDS_P2X_MS / 10);
+		UdsRespLen = 6;
+		return 0;
+}
+
+static uint8_t CANUds_ER(const uint8_t *Req, uint32_t Len)
+{
+		uint8_t	sub;
+
+		if(Len != 2)	return UDS_NRC_IMLOIF;
+		sub = Req[1] & 0x7F;
+		if((sub != 1)&&(sub != 3))	return UDS_NRC_SFNS;
+		if(Uds.ProgBusy || Uds.DlActive)	return UDS_NRC_CNC;
+
+		Uds.ResetReq = 1;
+		Uds.ResetUs	 = TimerGetUs() + 10000;
+		UdsResp[0] = UDS_SID_ER + 0x40;
+		UdsResp[1] = sub;
+		UdsRespLen = 2;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANUds_RDBI
+*  功能说明：ReadDataByIdentifier, 只读一个DID
+//	         CAN_UDS_DID_EEE+键号: EEE标定参数, 4字节原始值
+//	         CAN_UDS_DID_EEE_WRITES: EEE累计写入次数(4)
+*************************************************************************/
+static uint8_t CANUds_RDBI(const uint8_t *Req, uint32_t Len)
+{
+		uint32_t	did,v;
+
+		if(Len != 3)	return UDS_NRC_IMLOIF;
+		did = CANUds_Get(&Req[1], 2);
+		if(did == CAN_UDS_DID_EEE_WRITES)
+				v = EeeWriteCount();
+		else if((did < CAN_UDS_DID_EEE)||EeeGetRaw((uint16_t)(did - CAN_UDS_DID_EEE), &v))
+				return UDS_NRC_ROOR;
+
+		UdsResp[0] = UDS_SID_RDBI + 0x40;
+		UdsResp[1] = Req[1];
+		UdsResp[2] = Req[2];
+		CANUds_Put32(&UdsResp[3], v);
+		UdsRespLen = 7;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANUds_WDBI
+*  功能说明：WriteDataByIdentifier, 写EEE标定参数: 2E DID(2) 值(4), 非默认会话
+//	         值先记入RAM立即响应, EEE在后台写入
+*************************************************************************/
+static uint8_t CANUds_WDBI(const uint8_t *Req, uint32_t Len)
+{
+		uint32_t	did;
+
+		if(Len != 7)	return UDS_NRC_IMLOIF;
+		if(Uds.Session == UDS_SESSION_DEFAULT)	return UDS_NRC_SNSIAS;
+		did = CANUds_Get(&Req[1], 2);
+		if((did < CAN_UDS_DID_EEE)||(did == CAN_UDS_DID_EEE_WRITES)||
+			 EeeSetRaw((uint16_t)(did - CAN_UDS_DID_EEE), CANUds_Get(&Req[3], 4)))
+				return UDS_NRC_ROOR;
+
+		UdsResp[0] = UDS_SID_WDBI + 0x40;
+		UdsResp[1] = Req[1];
+		UdsResp[2] = Req[2];
+		UdsRespLen = 3;
+		return 0;
+}
+
+static uint8_t CANUds_SA(const uint8_t *Req, uint32_t Len)
+{
+		uint64_t	now;
+		uint8_t		sub;
+
+		if(Len < 2)	return UDS_NRC_IMLOIF;
+		if(Uds.Session != UDS_SESSION_PROGRAMMING)	return UDS_NRC_SNSIAS;
+		sub = Req[1] & 0x7F;
+		now = TimerGetUs();
+
+		if(sub == 1)
+		{
+				if(Len != 2)	return UDS_NRC_IMLOIF;
+				if(now < Uds.KeyLockUs)	return UDS_NRC_RTDNE;
+				if(Uds.Unlocked)
+				{
+						Uds.Seed = 0;
+				}
+				else
+				{
+						Uds.Seed = (uint32_t)now ^ TIMER_CYCLES();
+						if(Uds.Seed == 0)	Uds.Seed = CAN_UDS_KEY_MASK;
+						Uds.SeedSent = 1;
+				}
+				UdsResp[0] = UDS_SID_SA + 0x40;
+				UdsResp[1] = sub;
+				CANUds_Put32(&UdsResp[2], Uds.Seed);
+				UdsRespLen = 6;
+				return 0;
+		}
+		if(sub == 2)
+		{
+				if(Len != 6)	return UDS_NRC_IMLOIF;
+				if(Uds.SeedSent == 0)	return UDS_NRC_RSE;
+				Uds.SeedSent = 0;
+				if(CANUds_Get(&Req[2], 4) != CANUds_Key(Uds.Seed))
+				{
+						if(++Uds.KeyFails >= CAN_UDS_KEY_ATTEMPTS)
+						{
+								Uds.KeyFails	= 0;
+								Uds.KeyLockUs = now + CAN_UDS_KEY_DELAY_US;
+								return UDS_NRC_ENOA;
+						}
+						return UDS_NRC_IK;
+				}
+				Uds.KeyFails = 0;
+				Uds.Unlocked = 1;
+				UdsResp[0] = UDS_SID_SA + 0x40;
+				UdsResp[1] = sub;
+				UdsRespLen = 2;
+				return 0;
+		}
+		return UDS_NRC_SFNS;
+}
+
+/*************************************************************************
+*  函数名称：CANUds_RC
+*  功能说明：例程控制, 只支持启动(01)
+//	         地址均为目标slot内偏移, 目标slot为未运行的一个
+//	         FF00 擦除: 31 01 FF 00 44 地址(4) 长度(4), 日志记录开始下载, 立即响应, 扇区在后台擦除
+//	         FF01 校验: 31 01 FF 01 CRC32(4), CRC模块计算slot中已下载部分, 结果0为正确,
+//	                   正确时日志记录映像完整, ECU复位后由引导程序切换到该slot
+//	         FF02 测速: 31 01 FF 02, 用备用扇区测phrase和Program Section的写入速度, 再按34/36/37
+//	                   向目标slot下载CAN_UDS_BENCH_BYTES字节图样, 测经双缓冲的下载速度(不含CAN传输),
+//	                   响应 71 01 FF 02 00 phrase(4) section(4) 下载(4), 单位字节/秒, 下载失败为0;
+//	                   目标slot被改写, 之后下载须重新FF00
+//	         FF03 续传: 31 01 FF 03, 响应 71 01 FF 03 00 slot(1) 偏移(4), 日志中有未完成的下载时
+//	                   恢复擦除状态, 测试仪从偏移处RequestDownload; 偏移为0时须重新FF00
+//	         FF04 回退: 31 01 FF 04, 另一个slot映像完整且CRC相符时设为启动slot, 结果0为成功,
+//	                   ECU复位后生效
+*************************************************************************/
+static uint8_t CANUds_RC(const uint8_t *Req, uint32_t Len)
+{
+		const BootStateType	*st;
+		uint32_t	addr,size,crc;
+		uint16_t	rid;
+		uint8_t		la,ls;
+
+		if(Len < 4)	return UDS_NRC_IMLOIF;
+		if(Uds.Session != UDS_SESSION_PROGRAMMING)	return UDS_NRC_SNSIAS;
+		if((Req[1] & 0x7F) != 1)	return UDS_NRC_SFNS;
+		if(Uds.Unlocked == 0)	return UDS_NRC_SAD;
+		rid = (uint16_t)CANUds_Get(&Req[2], 2);
+
+		UdsResp[0] = UDS_SID_RC + 0x40;
+		UdsResp[1] = 1;
+		UdsResp[2] = Req[2];
+		UdsResp[3] = Req[3];
+		UdsRespLen = 5;
+
+		if(rid == UDS_RID_ERASE)
+		{
+				if(Len < 5)	return UDS_NRC_IMLOIF;
+				la = Req[4] & 0x0F;
+				ls = Req[4] >> 4;
+				if((la == 0)||(la > 4)||(ls == 0)||(ls > 4))	return UDS_NRC_ROOR;
+				if(Len != 5u + la + ls)	return UDS_NRC_IMLOIF;
+				addr = CANUds_Get(&Req[5], la);
+				size = CANUds_Get(&Req[5+la], ls);
+				if((size == 0)||(addr >= BOOT_SLOT_SIZE)||(size > BOOT_SLOT_SIZE - addr))	return UDS_NRC_ROOR;
+				if(Uds.ProgBusy || Uds.DlActive || FlashAsyncBusy())	return UDS_NRC_CNC;
+				if(JournalAppend(BOOT_REC_START, Uds.Slot, 0, 0))	return UDS_NRC_GPF;
+
+				Uds.EraseStart = Uds.SlotBase + (addr & ~(CAN_UDS_SECTOR_BYTES - 1));
+				Uds.EraseNext	 = Uds.EraseStart;
+				Uds.EraseEnd	 = Uds.SlotBase + ((addr + size + CAN_UDS_SECTOR_BYTES - 1) & ~(CAN_UDS_SECTOR_BYTES - 1));
+				Uds.ImageEnd	 = 0;
+				Uds.JournalProg = 0;
+				Uds.ProgErr		 = 0;
+				Uds.Valid			 = 0;
+				FlashAsyncError(1);
+				UdsResp[4] = 0;
+				return 0;
+		}
+		if(rid == UDS_RID_CHECK)
+		{
+				if(Len != 8)	return UDS_NRC_IMLOIF;
+				if(Uds.DlActive || (Uds.ImageEnd == 0))	return UDS_NRC_RSE;
+				//不再提前擦除, 日志写入须等异步擦写队列空闲
+				Uds.EraseEnd = Uds.EraseNext;
+				if(Uds.ProgBusy || FlashAsyncBusy())	return UDS_NRC_CNC;
+				crc = BootCrc32((const uint8_t *)Uds.SlotBase, Uds.ImageEnd);
+				Uds.Valid = ((Uds.ProgErr == 0)&&(CANUds_Get(&Req[4], 4) == crc)) ? 1 : 0;
+				if(Uds.Valid && JournalAppend(BOOT_REC_IMAGE, Uds.Slot, Uds.ImageEnd, crc))	Uds.Valid = 0;
+				UdsResp[4] = Uds.Valid ? 0 : 1;
+				return 0;
+		}
+		if(rid == UDS_RID_BENCH)
+		{
+				if(Len != 4)	return UDS_NRC_IMLOIF;
+				if(Uds.ProgBusy || Uds.DlActive || FlashAsyncBusy())	return UDS_NRC_CNC;
+				//整个下载需数秒, 先发0x78
+				CANUds_Nrc(UDS_SID_RC, UDS_NRC_RCRRP);
+				CANUds_Pattern();
+				CANUds_Put32(&UdsResp[5], CANUds_Bench(BOOT_SPARE_ADDR, 0));
+				CANUds_Put32(&UdsResp[9], CANUds_Bench(BOOT_SPARE_ADDR, 1));
+				CANUds_Put32(&UdsResp[13], CANUds_BenchDownload());
+				//0x78和模拟下载已覆盖UdsResp头部和请求缓冲区
+				UdsResp[0] = UDS_SID_RC + 0x40;
+				UdsResp[1] = 1;
+				UdsResp[2] = (uint8_t)(UDS_RID_BENCH >> 8);
+				UdsResp[3] = (uint8_t)UDS_RID_BENCH;
+				UdsResp[4] = 0;
+				UdsRespLen = 17;
+				return 0;
+		}
+		if(rid == UDS_RID_RESUME)
+		{
+				if(Len != 4)	return UDS_NRC_IMLOIF;
+				if(Uds.ProgBusy || Uds.DlActive)	return UDS_NRC_CNC;
+				st = JournalGet();
+				addr = 0;
+				if(st->Pending[Uds.Slot] && (st->Progress[Uds.Slot] < BOOT_SLOT_SIZE))
+				{
+						addr = st->Progress[Uds.Slot];
+						Uds.EraseStart	= Uds.SlotBase;
+						Uds.EraseNext		= Uds.SlotBase + addr;
+						Uds.EraseEnd		= Uds.SlotBase + BOOT_SLOT_SIZE;
+						Uds.ImageEnd		= addr;
+						Uds.JournalProg = addr;
+						Uds.ProgErr			= 0;
+						Uds.Valid				= 0;
+						FlashAsyncError(1);
+				}
+				UdsResp[4] = 0;
+				UdsResp[5] = Uds.Slot;
+				CANUds_Put32(&UdsResp[6], addr);
+				UdsRespLen = 10;
+				return 0;
+		}
+		if(rid == UDS_RID_ROLLBACK)
+		{
+				if(Len != 4)	return UDS_NRC_IMLOIF;
+				if(Uds.ProgBusy || Uds.DlActive || FlashAsyncBusy())	return UDS_NRC_CNC;
+				st = JournalGet();
+				UdsResp[4] = 1;
+				if(st->Valid[Uds.Slot] && BootSlotSane(Uds.Slot) &&
+					 (BootCrc32((const uint8_t *)Uds.SlotBase, st->Size[Uds.Slot]) == st->Crc[Uds.Slot]) &&
+					 (JournalAppend(BOOT_REC_ACTIVE, Uds.Slot, 0, 0) == 0))
+						UdsResp[4] = 0;
+				return 0;
+		}
+		return UDS_NRC_ROOR;
+}
+
+/*************************************************************************
+*  函数名称：CANUds_RD
+*  功能说明：RequestDownload, 地址和长度为目标slot内偏移
+//	         dataFormatIdentifier 00: 数据原样写入
+//	                              10: 差分数据(见CANDelta.h), 以运行中的slot为旧映像,
+//	                                  须从偏移0开始, 长度为新映像字节数
+*************************************************************************/
+static uint8_t CANUds_RD(const uint8_t *Req, uint32_t Len)
+{
+		uint32_t	addr,size;
+		uint8_t		la,ls;
+
+		if(Len < 3)	return UDS_NRC_IMLOIF;
+		if(Uds.Session != UDS_SESSION_PROGRAMMING)	return UDS_NRC_SNSIAS;
+		if(Uds.Unlocked == 0)	return UDS_NRC_SAD;
+		la = Req[2] & 0x0F;
+		ls = Req[2] >> 4;
+		if((la == 0)||(la > 4)||(ls == 0)||(ls > 4))	return UDS_NRC_ROOR;
+		if(Len != 3u + la + ls)	return UDS_NRC_IMLOIF;
+		if((Req[1] != 0x00)&&(Req[1] != 0x10))	return UDS_NRC_ROOR;
+		if(Uds.DlActive)	return UDS_NRC_CNC;
+
+		//须在擦除范围内, phrase对齐, 且不早于已下载数据
+		addr = CANUds_Get(&Req[3], la);
+		size = CANUds_Get(&Req[3+la], ls);
+		if((size == 0)||(addr & 7)||(addr < Uds.ImageEnd)||
+			 (Uds.SlotBase + addr < Uds.EraseStart)||(size > Uds.EraseEnd - Uds.EraseStart)||
+			 (Uds.SlotBase + addr + size > Uds.EraseEnd)||(Req[1] && addr))
+				return UDS_NRC_ROOR;
+
+		Uds.DlAddr		 = Uds.SlotBase + addr;
+		Uds.DlEnd			 = Uds.DlAddr + size;
+		Uds.DlBsc			 = 0;
+		Uds.DlBscValid = 0;
+		Uds.DlActive	 = 1;
+		Uds.Delta			 = Req[1] ? 1 : 0;
+		if(Uds.Delta)
+		{
+				CANDeltaInit(&Uds.Dz, BOOT_SLOT_ADDR(Uds.Slot ^ 1), Uds.SlotBase, BOOT_SLOT_SIZE);
+				Uds.DzRet		= CAN_DELTA_NEED_INPUT;
+				Uds.DzInLen = 0;
+				Uds.WinFill = 0;
+				Uds.ProgLen = 0;
+		}
+
+		UdsResp[0] = UDS_SID_RD + 0x40;
+		UdsResp[1] = 0x20;
+		UdsResp[2] = (uint8_t)((CAN_UDS_BLOCK_DATA + 2) >> 8);
+		UdsResp[3] = (uint8_t)(CAN_UDS_BLOCK_DATA + 2);
+		UdsRespLen = 4;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANUds_TD
+*  功能说明：TransferData, 数据块交给Flash后台任务写入后立即肯定响应,
+//	         传输层换到另一块缓冲区接收下一块; 写入错误在下一块或退出时报告
+//	         调用时Flash后台任务空闲(否则已延后)
+*************************************************************************/
+static uint8_t CANUds_TD(const uint8_t *Req, uint32_t Len)
+{
+		uint32_t	n;
+		uint8_t		bsc;
+
+		if(Len < 2)	return UDS_NRC_IMLOIF;
+		if(Uds.DlActive == 0)	return UDS_NRC_RSE;
+		bsc = Req[1];
+		UdsResp[0] = UDS_SID_TD + 0x40;
+		UdsResp[1] = bsc;
+		UdsRespLen = 2;
+
+		//重发的上一块不再写入
+		if(Uds.DlBscValid && (bsc == Uds.DlBsc))	return 0;
+		if(bsc != (uint8_t)(Uds.DlBsc + 1))	return UDS_NRC_WBSC;
+		if(Uds.ProgErr)
+		{
+				Uds.DlActive = 0;
+				return UDS_NRC_GPF;
+		}
+		n = Len - 2;
+		if((n == 0)||(n > CAN_UDS_BLOCK_DATA))	return UDS_NRC_IMLOIF;
+
+		//差分数据块交给Flash后台任务解压, DlAddr在写入后推进
+		if(Uds.Delta)
+		{
+				if(Uds.DzRet == CAN_DELTA_DONE)	return UDS_NRC_TDS;
+				Uds.DzIn		 = &UdsBuf[UdsRxIdx][2];
+				Uds.DzInLen	 = n;
+				Uds.ProgLen	 = 0;
+				Uds.ProgBusy = 1;
+				UdsRxIdx ^= 1;
+				Uds.DlBsc			 = bsc;
+				Uds.DlBscValid = 1;
+				return 0;
+		}
+
+		if(n > Uds.DlEnd - Uds.DlAddr)	return UDS_NRC_TDS;
+		if((n & 7)&&(Uds.DlAddr + n < Uds.DlEnd))	return UDS_NRC_ROOR;
+
+		Uds.ProgData = &UdsBuf[UdsRxIdx][2];
+		Uds.ProgAddr = Uds.DlAddr;
+		Uds.ProgLen	 = n;
+		Uds.ProgBusy = 1;
+		UdsRxIdx ^= 1;
+
+		Uds.DlAddr		+= n;
+		Uds.DlBsc			 = bsc;
+		Uds.DlBscValid = 1;
+		if(Uds.DlAddr - Uds.SlotBase > Uds.ImageEnd)	Uds.ImageEnd = Uds.DlAddr - Uds.SlotBase;
+		return 0;
+}
+
+static uint8_t CANUds_RTE(const uint8_t *Req, uint32_t Len)
+{
+		if(Len != 1)	return UDS_NRC_IMLOIF;
+		if((Uds.DlActive == 0)||((Uds.Delta == 0)&&(Uds.DlAddr != Uds.DlEnd)))	return UDS_NRC_RSE;
+		//差分数据解压出错时不会写满, 直接报告写入错误
+		if(Uds.Delta && (Uds.ProgErr == 0)&&((Uds.DzRet != CAN_DELTA_DONE)||(Uds.DlAddr != Uds.DlEnd)))
+				return UDS_NRC_RSE;
+		Uds.DlActive = 0;
+		if(Uds.ProgErr)	return UDS_NRC_GPF;
+		UdsResp[0] = UDS_SID_RTE + 0x40;
+		UdsRespLen = 1;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANUds_Dispatch
+*  功能说明：处理一条请求并发送响应, 请求在 UdsBuf[UdsRxIdx] 中
+//	         子功能最高位置1时不发肯定响应
+*  参数说明：Len：请求长度
+*************************************************************************/
+static void CANUds_Dispatch(uint32_t Len)
+{
+		const uint8_t	*req;
+		uint8_t				nrc,sid,supp;
+
+		req = UdsBuf[UdsRxIdx];
+		sid = req[0];
+		supp = 0;
+		UdsRespLen = 0;
+
+		switch(sid)
+		{
+				case UDS_SID_DSC:	nrc = CANUds_DSC(req, Len);	supp = (Len > 1) ? (req[1] & 0x80) : 0;	break;
+				case UDS_SID_ER:	nrc = CANUds_ER(req, Len);	supp = (Len > 1) ? (req[1] & 0x80) : 0;	break;
+				case UDS_SID_RDBI:	nrc = CANUds_RDBI(req, Len);	break;
+				case UDS_SID_SA:	nrc = CANUds_SA(req, Len);	break;
+				case UDS_SID_WDBI:	nrc = CANUds_WDBI(req, Len);	break;
+				case UDS_SID_RC:	nrc = CANUds_RC(req, Len);	break;
+				case UDS_SID_RD:	nrc = CANUds_RD(req, Len);	break;
+				case UDS_SID_TD:	nrc = CANUds_TD(req, Len);	break;
+				case UDS_SID_RTE:	nrc = CANUds_RTE(req, Len);	break;
+				case UDS_SID_TP:
+						if(Len != 2)									nrc = UDS_NRC_IMLOIF;
+						else if((req[1] & 0x7F) != 0)	nrc = UDS_NRC_SFNS;
+						else
+						{
+								nrc = 0;
+								supp = req[1] & 0x80;
+								UdsResp[0] = UDS_SID_TP + 0x40;
+								UdsResp[1] = 0;
+								UdsRespLen = 2;
+						}
+						break;
+				default:
+						nrc = UDS_NRC_SNS;
+						break;
+		}
+
+		if(nrc)
+				CANUds_Nrc(sid, nrc);
+		else if(supp == 0)
+				CANTpSend(CAN_UDS_CHANNEL, UdsResp, UdsRespLen);
+
+		//TransferData接受后 UdsRxIdx 已换为空闲缓冲区
+		CANTpSetRxBuffer(CAN_UDS_CHANNEL, UdsBuf[UdsRxIdx], sizeof(UdsBuf[0]));
+}
+
+/*************************************************************************
+*  函数名称：CANUdsInit
+*  功能说明：配置诊断通道传输层, 进入默认会话
+//	         按本函数所在地址判断运行的slot, 下载写入另一个
+*************************************************************************/
+void CANUdsInit(void)
+{
+		CANTpCfgType	cfg;
+
+		cfg.RxID	= CAN_UDS_RX_ID;
+		cfg.TxID	= CAN_UDS_TX_ID;
+		cfg.IDE		= 0;
+		cfg.FD		= CAN_UDS_FD;
+		cfg.Pad		= 1;
+		cfg.BS		= 0;
+		cfg.STmin = 0;
+		CANTpInit(CAN_UDS_CHANNEL, &cfg);
+
+		Uds.Session	 = UDS_SESSION_DEFAULT;
+		Uds.Slot		 = ((uint32_t)CANUdsInit >= BOOT_SLOT_B_ADDR) ? 0 : 1;
+		Uds.SlotBase = BOOT_SLOT_ADDR(Uds.Slot);
+		UdsRxIdx = 0;
+		CANTpSetRxBuffer(CAN_UDS_CHANNEL, UdsBuf[UdsRxIdx], sizeof(UdsBuf[0]));
+}
+
+/*************************************************************************
+*  函数名称：CANUdsTask
+*  功能说明：主循环调用, 推进Flash写入, 处理请求, 会话超时和ECU复位, 按会话切换FlexRAM模式
+//	         写入未完成时到达的下一块先挂起(传输层暂停接收), 超过P2发0x78
+*************************************************************************/
+void CANUdsTask(void)
+{
+		uint64_t	now;
+		uint32_t	len;
+		uint8_t		sid;
+
+		CANUds_Prog();
+		now = TimerGetUs();
+
+		//编程会话中FlexRAM切为RAM, 下载按Program Section写入; 离开会话或复位前切回EEE
+		//Flash作业未完成时切换不了, 下一轮再试, 期间的写入按phrase进行
+		if((Uds.Session == UDS_SESSION_PROGRAMMING)&&(Uds.ResetReq == 0))	EeeSuspend();
+		else																													EeeResume();
+
+		if(Uds.Pending)
+		{
+				if(Uds.ProgBusy == 0)
+				{
+						Uds.Pending = 0;
+						CANUds_Dispatch(Uds.PendingLen);
+				}
+				else if(now >= Uds.PendingRspUs)
+				{
+						CANUds_Nrc(UdsBuf[UdsRxIdx][0], UDS_NRC_RCRRP);
+						Uds.PendingRspUs = now + (uint64_t)CAN_UDS_P2X_MS * 500;
+				}
+		}
+		else if(CANTpRecv(CAN_UDS_CHANNEL, &len) == 0)
+		{
+				Uds.S3Us = now + CAN_UDS_S3_US;
+				sid = UdsBuf[UdsRxIdx][0];
+				if(Uds.ProgBusy && ((sid == UDS_SID_TD)||(sid == UDS_SID_RTE)))
+				{
+						CANTpSetRxBuffer(CAN_UDS_CHANNEL, 0, 0);
+						Uds.Pending			 = 1;
+						Uds.PendingLen	 = len;
+						Uds.PendingRspUs = now + (uint64_t)CAN_UDS_P2_MS * 800;
+				}
+				else
+				{
+						CANUds_Dispatch(len);
+				}
+		}
+
+		if((Uds.Session != UDS_SESSION_DEFAULT)&&(now > Uds.S3Us)&&(Uds.ProgBusy == 0)&&(Uds.Pending == 0))
+		{
+				Uds.Session = UDS_SESSION_DEFAULT;
+				CANUds_Lock();
+		}
+
+		//等响应发出、标定参数写入EEE后复位, 目标slot有校验通过的映像时先在日志中设为启动slot
+		if(Uds.ResetReq && (now >= Uds.ResetUs)&&(CANTpTxStatus(CAN_UDS_CHANNEL) != CAN_TP_TX_BUSY)&&
+			 (EeeBusy() == 0)&&(FlashAsyncBusy() == 0))
+		{
+				if(Uds.Valid)	JournalAppend(BOOT_REC_ACTIVE, Uds.Slot, 0, 0);
+				__disable_irq();
+				NVIC_SystemReset();
+		}
+}
@@ -0,0 +1,40 @@
+#ifndef __CAN_UDS_H
+#define __CAN_UDS_H
+
+#include <stdint.h>
+#include "drvCAN.h"
+#include "drvflash.h"
+
+//诊断通道和物理寻址ID, CAN0为FD通道, 传输层用64字节FD帧
+#define CAN_UDS_CHANNEL					CAN0CH
+#define CAN_UDS_RX_ID						0x7E0
+#define CAN_UDS_TX_ID						0x7E8
+#define CAN_UDS_FD							1
+
+//TransferData每块数据字节数(不含SID和块序号), 两块缓冲区交替: 一块接收, 一块写Flash
+#define CAN_UDS_BLOCK_DATA			2048
+
+//下载地址为slot内偏移(0起), 写入未运行的slot(见drvBoot.h), ECU复位后由引导程序切换
+#define CAN_UDS_SECTOR_BYTES		4096
+
+//例程FF02模拟下载的总字节数, 按slot大小分几遍
+#define CAN_UDS_BENCH_BYTES			0x80000uL
+
+//标定参数DID: CAN_UDS_DID_EEE+键号, 读写EEE键的32位原始值; 写入次数只读
+#define CAN_UDS_DID_EEE					0xFD00
+#define CAN_UDS_DID_EEE_WRITES	0xFDFF
+
+//会话时间参数
+#define CAN_UDS_P2_MS						50
+#define CAN_UDS_P2X_MS					5000
+#define CAN_UDS_S3_US						5000000uL
+//安全访问: 密钥算法掩码, 连续错误次数上限和锁定时间
+#define CAN_UDS_KEY_MASK				0x5A3C96E1uL
+#define CAN_UDS_KEY_ATTEMPTS		3
+#define CAN_UDS_KEY_DELAY_US		10000000uL
+
+void CANUdsInit(void);
+void CANUdsTask(void);
+
+
+#endif /* __CAN_UDS_H */
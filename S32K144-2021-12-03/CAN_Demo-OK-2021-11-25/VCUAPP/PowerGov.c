@@ -0,0 +1,166 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "drvTimer.h"
+#include "drvflash.h"
+#include "drvPower.h"
+#include "PowerGov.h"
+
+typedef	struct
+{
+		uint64_t	LastUs;					//上次调用的时刻
+		uint64_t	WinStart;				//统计窗口开始时刻
+		uint32_t	BusyUs;					//窗口内收到帧的循环的时间
+		uint64_t	TrafficUs;			//最近一次收到帧或总线唤醒的时刻
+		uint64_t	HoldUs;					//此时刻之前不再切换
+
+}		PowerGovType;
+
+static PowerGovType			Gov;
+static PowerGovStatType	GovStat;
+
+//各通道队列深度的最大值
+static uint16_t PowerGov_Depth(void)
+{
+		uint16_t	d,max;
+		uint8_t		ch;
+
+		max = 0;
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				d = CANGetQueueDepth(ch);
+				if(d > max)	max = d;
+		}
+		return max;
+}
+
+/*************************************************************************
+*  函数名称：PowerGov_Set
+*  功能说明：切换模式并记录结果, 成功后GOV_DWELL_US内不再切换, 被拒绝或失败后等GOV_RETRY_US
+*  参数说明：Mode：目标模式
+//	         Count：成功时加1的计数
+//	         Now：当前时刻
+*  函数返回：0：成功；1：被拒绝或失败
+*************************************************************************/
+static uint8_t PowerGov_Set(uint8_t Mode, uint32_t *Count, uint64_t Now)
+{
+		uint8_t	r;
+
+		r = PowerSetMode(Mode);
+		GovStat.Mode = PowerGetMode();
+		if(r == POWER_OK)
+		{
+				(*Count)++;
+				Gov.HoldUs = Now + GOV_DWELL_US;
+				return 0;
+		}
+		if(r == POWER_REFUSED)	GovStat.Refused++;
+		else										GovStat.Fail++;
+		Gov.HoldUs = Now + GOV_RETRY_US;
+		return 1;
+}
+
+/*************************************************************************
+*  函数名称：PowerGovInit
+*  功能说明：调频初始化, 在PowerInit之后调用; 上电后GOV_DWELL_US内不切换
+*************************************************************************/
+void PowerGovInit(void)
+{
+		uint64_t	now;
+
+		now = TimerGetUs();
+		Gov.LastUs		= now;
+		Gov.WinStart	= now;
+		Gov.BusyUs		= 0;
+		Gov.TrafficUs	= now;
+		Gov.HoldUs		= now + GOV_DWELL_US;
+
+		GovStat.Mode		= PowerGetMode();
+		GovStat.IdlePct	= 100;
+		GovStat.Depth		= 0;
+		GovStat.Up			= 0;
+		GovStat.Down		= 0;
+		GovStat.Park		= 0;
+		GovStat.Wake		= 0;
+		GovStat.Refused	= 0;
+		GovStat.Fail		= 0;
+}
+
+/*************************************************************************
+*  函数名称：PowerGovTask
+*  功能说明：每轮主循环末尾调用, 统计空闲率并按阈值切换模式
+//	         VLPR下CAN按SIRC时钟照常收帧: 总线唤醒、有待发帧或Flash作业时回RUN, 否则WFI等中断
+//	         HSRUN下Flash作业暂停, 有作业等待时回RUN
+*  参数说明：Busy：本轮循环收到了帧
+*************************************************************************/
+void PowerGovTask(uint8_t Busy)
+{
+		uint64_t	now;
+		uint32_t	win,primask;
+		uint16_t	depth;
+		uint8_t		mode,wake,eval;
+
+		now = TimerGetUs();
+		if(Busy)
+		{
+				Gov.BusyUs += (uint32_t)(now - Gov.LastUs);
+				Gov.TrafficUs = now;
+		}
+		Gov.LastUs = now;
+		depth = PowerGov_Depth();
+		GovStat.Depth = depth;
+		mode = PowerGetMode();
+
+		if(mode == CLOCK_MODE_VLPR)
+		{
+				//关中断检查再WFI, 检查后到来的中断仍能唤醒
+				primask = __get_PRIMASK();
+				__disable_irq();
+				wake = CANPowerWake();
+				if((wake == 0)&&(depth == 0)&&(FlashAsyncBusy() == 0))	__WFI();
+				__set_PRIMASK(primask);
+				wake |= CANPowerWake();
+
+				if(wake||depth||FlashAsyncBusy())
+				{
+						now = TimerGetUs();
+						if(wake)	Gov.TrafficUs = now;
+						if(PowerGov_Set(CLOCK_MODE_RUN, &GovStat.Wake, now) == 0)
+						{
+								Gov.LastUs	 = now;
+								Gov.WinStart = now;
+								Gov.BusyUs	 = 0;
+						}
+				}
+				return;
+		}
+
+		eval = 0;
+		win = (uint32_t)(now - Gov.WinStart);
+		if(win >= GOV_WINDOW_US)
+		{
+				GovStat.IdlePct = (uint8_t)(100 - (uint64_t)Gov.BusyUs * 100 / win);
+				Gov.WinStart = now;
+				Gov.BusyUs = 0;
+				eval = 1;
+		}
+		if(now < Gov.HoldUs)	return;
+
+		if(mode == CLOCK_MODE_HSRUN)
+		{
+				if(FlashAsyncBusy()||(eval&&(GovStat.IdlePct > GOV_DOWN_IDLE_PCT)&&(depth < GOV_DOWN_DEPTH)))
+						PowerGov_Set(CLOCK_MODE_RUN, &GovStat.Down, now);
+				return;
+		}
+
+		//CAN会拒绝HSRUN时(FD数据段在晶振下无解)不去尝试, 免得每隔GOV_RETRY_US白白询问一次
+		if(((depth >= GOV_UP_DEPTH)||(eval&&(GovStat.IdlePct < GOV_UP_IDLE_PCT)))&&(CANPowerVeto(CLOCK_MODE_HSRUN) == 0))
+				PowerGov_Set(CLOCK_MODE_HSRUN, &GovStat.Up, now);
+		else if((now - Gov.TrafficUs >= GOV_PARK_US)&&(depth == 0)&&(FlashAsyncBusy() == 0))
+				PowerGov_Set(CLOCK_MODE_VLPR, &GovStat.Park, now);
+}
+
+const PowerGovStatType *PowerGovGet(void)
+{
+		return &GovStat;
+}
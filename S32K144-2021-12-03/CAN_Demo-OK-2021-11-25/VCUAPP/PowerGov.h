@@ -0,0 +1,46 @@
+#ifndef __POWER_GOV_H
+#define __POWER_GOV_H
+
+#include <stdint.h>
+#include "drvPower.h"
+
+//负载自适应调频: 按主循环空闲率和CAN队列深度在RUN/HSRUN/VLPR之间切换, 切换由drvPower执行
+//空闲率为统计窗口内没有收到帧的循环所占时间的比例; 队列深度取各通道CANGetQueueDepth的最大值
+//HSRUN的112MHz超过CLOCK_CAN_PE_MAX_HZ, FD通道在HSRUN下改用8MHz晶振; 数据段在晶振下无解时(如2M)
+//CANPowerNotify会拒绝, 此时调频按CANPowerVeto直接不升HSRUN, 只在RUN与VLPR之间切换
+
+//统计窗口
+#define GOV_WINDOW_US				100000uL
+//空闲率低于此值或队列深度达到GOV_UP_DEPTH时RUN升到HSRUN
+#define GOV_UP_IDLE_PCT			20
+#define GOV_UP_DEPTH				16
+//空闲率高于此值且队列深度低于GOV_DOWN_DEPTH时HSRUN降回RUN
+#define GOV_DOWN_IDLE_PCT		60
+#define GOV_DOWN_DEPTH			4
+//总线上没有收到帧超过此时间时进入VLPR
+#define GOV_PARK_US					5000000uL
+//两次切换的最小间隔, 防止来回切换; 退出VLPR不受限制
+#define GOV_DWELL_US				500000uL
+//切换被拒绝或失败后等待的时间
+#define GOV_RETRY_US				2000000uL
+
+typedef	struct
+{
+			uint8_t		Mode;						//当前模式 CLOCK_MODE_xxx
+			uint8_t		IdlePct;				//上一窗口的空闲率
+			uint16_t	Depth;					//最近一次的队列深度
+			uint32_t	Up;							//RUN->HSRUN
+			uint32_t	Down;						//HSRUN->RUN
+			uint32_t	Park;						//RUN->VLPR
+			uint32_t	Wake;						//VLPR->RUN
+			uint32_t	Refused;
+			uint32_t	Fail;
+
+}		PowerGovStatType;
+
+void PowerGovInit(void);
+void PowerGovTask(uint8_t Busy);
+const PowerGovStatType *PowerGovGet(void);
+
+
+#endif /* __POWER_GOV_H */
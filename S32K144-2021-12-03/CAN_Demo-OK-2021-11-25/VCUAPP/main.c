@@ -1,33 +1,181 @@
 #include "device_registers.h"
 #include <stdint.h>
+#include <string.h>
 #include "drvGPIO.h"
+#include "drvClock.h"
 #include "drvCAN.h"
+#include "drvTimer.h"
 #include "drvflash.h"
+#include "drvJournal.h"
+#include "drvEee.h"
+#include "drvDLog.h"
+#include "drvPower.h"
+#include "CANRoute.h"
+#include "CANStats.h"
+#include "CANTp.h"
+#include "CANUds.h"
+#include "PowerGov.h"
 
 
-#pragma pack(1)   // Ԥ߱1ֽΪλж룬sizeofֵпܲ
+#pragma pack(1)   // 预处理命名，告诉编译器以1字节为单位进行对齐，否则，sizeof的值有可能不对
 
 uint8_t CANTXdata0[8]={0X11,0X22,0X33,0X44,0X55,0X66,0X77,0X88};
 uint8_t CANTXdata1[8]={0X11,0X22,0X33,0X44,0X55,0X66,0X77,0X88};
 uint8_t CANTXdata2[8]={0X88,0X77,0X66,0X55,0X44,0X33,0X22,0X11};
-uint8_t RXData0[8],RXData1[8],RXData2[8];
+CANFrameType RxFrames[8];
+CANFDFrameType RxFDFrame;
 
-uint32_t ID1,ID2,ID0;
-uint8_t Datalen0,Datalen1,Datalen2;
-uint8_t flag0, flag1,flag2;
+// 网关路由表, 按 源通道、IDE(标准帧在前)、源ID 升序排列
+//   源通道   IDE  目标通道                                          屏蔽  源ID         目标ID              数据屏蔽
+const CANRouteType CANRouteTable[] =
+{
+	{ CAN0CH, 0,   CAN_ROUTE_DST(CAN1CH),                            0,    0x100,       CAN_ROUTE_ID_KEEP,  {0} },
+	{ CAN0CH, 0,   CAN_ROUTE_DST(CAN1CH) | CAN_ROUTE_DST(CAN2CH),    0,    0x101,       CAN_ROUTE_ID_KEEP,  {0} },
+	{ CAN0CH, 1,   CAN_ROUTE_DST(CAN2CH),                            0,    0x0CF00400,  CAN_ROUTE_ID_KEEP,  {0} },
+	{ CAN1CH, 0,   CAN_ROUTE_DST(CAN0CH),                            1,    0x200,       0x210,              {0xFF,0xFF,0x00,0x00,0xFF,0xFF,0xFF,0xFF} },
+	{ CAN1CH, 1,   CAN_ROUTE_DST(CAN0CH),                            0,    0x18FEF100,  CAN_ROUTE_ID_KEEP,  {0} },
+	{ CAN2CH, 1,   CAN_ROUTE_DST(CAN0CH) | CAN_ROUTE_DST(CAN1CH),    0,    0x18FF0001,  CAN_ROUTE_ID_KEEP,  {0} },
+};
+
+// 标定/配置参数表, 存于FlexNVM EEE, 下标即键号, 诊断DID为 CAN_UDS_DID_EEE+键号
+// 新增参数只能加在表尾
+#define CAL_KEY_VERSION			0
+#define CAL_KEY_SERIAL			1
+#define CAL_KEY_ADC_GAIN		2
+#define CAL_KEY_ADC_OFFSET	3
+//   类型            默认值
+const EeeKeyType EeeKeyTable[] =
+{
+	{ EEE_TYPE_U32,  {.u = 1} },					// 标定数据版本
+	{ EEE_TYPE_U32,  {.u = 0} },					// ECU序列号
+	{ EEE_TYPE_F32,  {.f = 1.0f} },				// ADC增益
+	{ EEE_TYPE_I32,  {.i = 0} },					// ADC零点, LSB
+};
+
+// D-Flash记录日志的键
+#define LOG_KEY_POWER_ON		0				// 上电次数(4)
+#define LOG_KEY_FILTER_OPEN	1				// 路由源ID放不进过滤表、过滤表全放行的通道, 按位(1)
 
-// ǰһԪرʾADCţһԪرʾADCͨ
+// 运行模式切换回调, 切换前按表序询问: 最可能拒绝的放前面, LPIT换时钟放最后
+const PowerNotifyType PowerNotifyTable[] =
+{
+	CANPowerNotify,												// FD数据段在晶振下无解时拒绝HSRUN; VLPR下按SIRC时钟收帧, RX引脚唤醒
+	FlashPowerNotify,											// 有擦写作业时拒绝HSRUN/VLPR
+	TimerPowerNotify,											// VLPR下LPIT改用SIRCDIV2
+};
+
+// 前一个元素表示ADC编号，后一个元素表示ADC通道
 uint8_t ADC_CH[6][2]={{1,8},{1,7},{0,3},{1,15},{1,14},{1,9} };
 
+CANFilterIDType		CANFilterIDs[CAN_FILTER_ID_MAX];
+CANFilterTabType	CANFilterTab;
+
+/*************************************************************************
+*  函数名称：CANRouteFilterInit
+*  功能说明：用路由表中各通道的源ID生成硬件接收过滤表, 不转发的帧由FlexCAN丢弃
+//	         源ID超过CAN_FILTER_ID_MAX或过滤表无法生成时不截断, 该通道过滤表全放行
+*  函数返回：过滤表全放行的通道, 按位; 0：各通道均已按路由表过滤
+*************************************************************************/
+uint8_t CANRouteFilterInit(void)
+{
+	uint8_t  ch,open;
+	uint16_t i,n;
+
+	open = 0;
+	for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+	{
+		n = 0;
+		for(i=0;i<sizeof(CANRouteTable)/sizeof(CANRouteTable[0]);i++)
+		{
+			if(CANRouteTable[i].SrcCh != ch)	continue;
+			if(n < CAN_FILTER_ID_MAX)
+			{
+				CANFilterIDs[n].ID  = CANRouteTable[i].SrcID;
+				CANFilterIDs[n].IDE = CANRouteTable[i].IDE;
+			}
+			n++;
+		}
+		if((n > CAN_FILTER_ID_MAX)||
+			 CANFilterCompile(CANFilterIDs, n, CAN_RX_FILTER_RFFN_MAX, 8*(CAN_RX_FILTER_RFFN_MAX+1), &CANFilterTab))
+		{
+			//格式A, 个体掩码和全局掩码为0: 所有帧都通过
+			memset(&CANFilterTab, 0, sizeof(CANFilterTab));
+			CANFilterTab.Format = CAN_FILTER_FORMAT_A;
+			open |= 1 << ch;
+		}
+		CANSetRxFilter(ch, &CANFilterTab);
+	}
+	return open;
+}
+
+/*************************************************************************
+*  函数名称：GatewayInit
+*  功能说明：初始化CAN通道、路由表和接收过滤表; 主机上的日志回放(tools/cansim/replay.cpp)共用
+*  函数返回：接收过滤表全放行的通道, 见CANRouteFilterInit
+*************************************************************************/
+uint8_t GatewayInit(void)
+{
+	CANInitFD(CAN0CH,250,2000) ;					//CAN0通道初始化，CAN FD 250K/2M
+ 	CANInit(CAN1CH,250) ;                 //CAN1通道初始化，250K
+  CANInit(CAN2CH,250) ;                 //CAN2通道初始化，250K		
+	CANRouteInit(CANRouteTable, sizeof(CANRouteTable)/sizeof(CANRouteTable[0]));
+	return CANRouteFilterInit();
+}
+
+/*************************************************************************
+*  函数名称：GatewayPoll
+*  功能说明：中断已将帧收入缓冲区, 每轮成批取出按路由表转发, 诊断帧交给CANTp
+*  函数返回：0：本轮没有帧
+*************************************************************************/
+uint8_t GatewayPoll(void)
+{
+	uint8_t ch,i,n,busy;
+
+	busy = 0;
+	for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+	{
+			n = CANRecBurst(ch, RxFrames, 8);
+			busy |= n;
+			for(i=0;i<n;i++)
+			{
+					if(CANTpRxFrame(ch, &RxFrames[i]))	CANRouteForward(ch, &RxFrames[i]);
+			}
+	}
+	while(CANRecFD(CAN_FD_CHANNEL, &RxFDFrame) == 0)
+	{
+			busy = 1;
+			CANTpRxFDFrame(CAN_FD_CHANNEL, &RxFDFrame);
+	}
+	return busy;
+}
+
 int main(void)
 {
 	int Cnt =0;
-	Clock_Config();
-	GPIO_enable_port ();                  //GPIO˿ʱʹ
+	uint8_t i,n,busy;
+	uint8_t LogBuf[DLOG_DATA_MAX];
+	uint32_t PowerOn;
+	ClockInit();													//SOSC 8MHz, SPLL, 内核80MHz, 见drvClock.h
+	GPIO_enable_port ();                  //GPIO端口时钟使能
+	TimerInit();													//us时基, CAN帧时间戳
+	FlashAsyncInit();											//D-Flash擦写由FTFC中断推进, P-Flash由FlashAsyncTask
+	JournalInit();												//升级日志, A/B分区状态
+	EeeInit(EeeKeyTable, sizeof(EeeKeyTable)/sizeof(EeeKeyTable[0]));	//标定参数, 首次上电时FlexNVM分区
+	DLogInit();														//D-Flash记录日志
 
-	CANInit(CAN0CH,250) ;									//CAN0ͨʼ250K
- 	CANInit(CAN1CH,250) ;                 //CAN1ͨʼ250K
-  CANInit(CAN2CH,250) ;                 //CAN2ͨʼ250K		
+	PowerOn = 0;
+	if((DLogRead(LOG_KEY_POWER_ON, LogBuf, &n) == 0)&&(n == 4))
+		PowerOn = (uint32_t)LogBuf[0] | ((uint32_t)LogBuf[1] << 8) | ((uint32_t)LogBuf[2] << 16) | ((uint32_t)LogBuf[3] << 24);
+	PowerOn++;
+	for(i=0;i<4;i++)	LogBuf[i] = (uint8_t)(PowerOn >> (8*i));
+	DLogAppend(LOG_KEY_POWER_ON, LogBuf, 4);
+
+	LogBuf[0] = GatewayInit();
+	if(LogBuf[0])	DLogAppend(LOG_KEY_FILTER_OPEN, LogBuf, 1);
+	CANStatsInit();
+	CANUdsInit();													//诊断通道, UDS刷写
+	PowerInit(PowerNotifyTable, sizeof(PowerNotifyTable)/sizeof(PowerNotifyTable[0]));
+	PowerGovInit();												//按负载在RUN/HSRUN/VLPR间切换
 	
 	for(;;)
 	{    
@@ -37,30 +185,13 @@ int main(void)
 		else
 				PINS_GPIO_WritePin(PTB,PORTB,0,1);
 
-		flag0=CANRecData(CAN0CH,&ID0,&Datalen0,RXData0);
-		if(flag0==0)
-    {      
-			CANSendData(CAN0CH, 1 , ID0, Datalen0, RXData0);   // ظ״̬ 				
-    }
-		
-		
-		flag1=CANRecData(CAN1CH,&ID1,&Datalen1,RXData1);
-		if(flag1==0)
-    {      
-			CANSendData(CAN1CH, 1 , ID1, Datalen1, RXData1);   // ظ״̬ 				
-    }
-		
-		flag2=CANRecData(CAN2CH,&ID2,&Datalen2,RXData2);
-		if(flag2==0)
-    {
-			CANSendData(CAN2CH, 1 , ID2, Datalen2, RXData2);   //  ظADC4,5		 
-    }								
+		busy = GatewayPoll();
+		CANTpTask();
+		CANUdsTask();
+		FlashAsyncTask();
+		EeeTask();
+		DLogTask();
+		CANStatsTask();
+		PowerGovTask(busy);
 	}
 }
-
-
- 
-
-
-
-
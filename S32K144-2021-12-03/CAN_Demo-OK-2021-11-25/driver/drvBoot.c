@@ -0,0 +1,260 @@
+#include <stdint.h>
+#include "drvBoot.h"
+
+//本文件整体链接到常驻引导扇区(见 S32K144_64_flash.sct), 复位后先于应用运行:
+//不能有全局/静态变量(此时RW/ZI未初始化), 不能调用库函数(库函数链接在应用区)
+
+#define BOOT_SRAM_START					0x1FFF8000
+#define BOOT_SRAM_END						0x20007000
+#define BOOT_VECTOR_BYTES				0x400
+
+
+static void BootDefault(void)
+{
+	for(;;);
+}
+
+//引导向量表, 放在0地址; 应用的向量表在各自slot起始处, 跳转前写入VTOR
+void (* const BootVectors[])(void) __attribute__((section("BootVectors"))) =
+{
+	(void (*)(void))BOOT_STACK_TOP,		//Initial SP
+	BootSelect,												//Reset
+	BootDefault,											//NMI
+	BootDefault,											//HardFault
+	BootDefault,											//MemManage
+	BootDefault,											//BusFault
+	BootDefault,											//UsageFault
+};
+
+
+#if defined(__CC_ARM)
+static __asm void Boot_Start(uint32_t Sp, uint32_t Pc)
+{
+	MSR		MSP, r0
+	BX		r1
+}
+#else
+static void Boot_Start(uint32_t Sp, uint32_t Pc)
+{
+	__asm volatile ("msr msp, %0\n\tbx %1" : : "r" (Sp), "r" (Pc));
+}
+#endif
+
+
+static uint8_t Boot_RecOk(const BootRecType *Rec)
+{
+	if((Rec->Tag & BOOT_TAG_MASK) != BOOT_TAG)
+		return 0;
+	return (Rec->Check == (Rec->Tag ^ Rec->Size ^ Rec->Crc ^ BOOT_CHECK_XOR)) ? 1 : 0;
+}
+
+static uint8_t Boot_RecErased(const BootRecType *Rec)
+{
+	return (Rec->Tag == 0xFFFFFFFF && Rec->Size == 0xFFFFFFFF &&
+					Rec->Crc == 0xFFFFFFFF && Rec->Check == 0xFFFFFFFF) ? 1 : 0;
+}
+
+static uint32_t Boot_HeaderGen(uint32_t Sector)
+{
+	const BootRecType	*pRec = (const BootRecType *)Sector;
+
+	if(Boot_RecOk(pRec) == 0 || pRec->Tag != BOOT_TAG_MAKE(BOOT_REC_HEADER, 0))
+		return 0;
+	return pRec->Size;
+}
+
+
+
+/*************************************************************************
+*  函数名称：BootApply
+*  功能说明：把一条日志记录作用到状态上
+*  参数说明：State：状态
+//	         Rec：已校验的记录
+*  函数返回：无
+*************************************************************************/
+void BootApply(BootStateType *State, const BootRecType *Rec)
+{
+	uint8_t		Type,Slot;
+
+	Type = (uint8_t)(Rec->Tag >> 8);
+	Slot = (uint8_t)(Rec->Tag);
+	if(Slot >= BOOT_SLOT_NUM)
+		return;
+
+	switch(Type)
+	{
+		case BOOT_REC_START:
+				State->Valid[Slot] = 0;
+				State->Pending[Slot] = 1;
+				State->Progress[Slot] = 0;
+				break;
+
+		case BOOT_REC_PROGRESS:
+				if(State->Pending[Slot])
+					State->Progress[Slot] = Rec->Size;
+				break;
+
+		case BOOT_REC_IMAGE:
+				State->Valid[Slot] = 1;
+				State->Pending[Slot] = 0;
+				State->Size[Slot] = Rec->Size;
+				State->Crc[Slot] = Rec->Crc;
+				break;
+
+		case BOOT_REC_ACTIVE:
+				State->Active = Slot;
+				break;
+
+		default:
+				break;
+	}
+}
+
+/*************************************************************************
+*  函数名称：BootScan
+*  功能说明：扫描两个日志扇区, 取代数大且扇区头完整的一个, 按顺序回放其中的记录
+//	         写了一半的记录(Tag或Check不符)跳过, 遇到全FF的记录结束
+*  参数说明：State：输出状态
+*  函数返回：无
+*************************************************************************/
+void BootScan(BootStateType *State)
+{
+	const BootRecType	*pRec;
+	uint32_t					Gen0,Gen1,Addr;
+	uint8_t						i;
+
+	State->Gen = 0;
+	State->Sector = BOOT_JOURNAL0_ADDR;
+	State->Next = BOOT_JOURNAL0_ADDR;
+	State->Active = 0;
+	for(i=0;i<BOOT_SLOT_NUM;i++)
+	{
+		State->Valid[i] = 0;
+		State->Pending[i] = 0;
+		State->Size[i] = 0;
+		State->Crc[i] = 0;
+		State->Progress[i] = 0;
+	}
+
+	Gen0 = Boot_HeaderGen(BOOT_JOURNAL0_ADDR);
+	Gen1 = Boot_HeaderGen(BOOT_JOURNAL1_ADDR);
+	if(Gen0 == 0 && Gen1 == 0)
+		return;
+
+	if(Gen1 > Gen0)
+	{
+		State->Gen = Gen1;
+		State->Sector = BOOT_JOURNAL1_ADDR;
+	}
+	else
+	{
+		State->Gen = Gen0;
+		State->Sector = BOOT_JOURNAL0_ADDR;
+	}
+
+	for(Addr=State->Sector+BOOT_REC_BYTES;Addr<State->Sector+BOOT_JOURNAL_BYTES;Addr+=BOOT_REC_BYTES)
+	{
+		pRec = (const BootRecType *)Addr;
+		if(Boot_RecErased(pRec))
+			break;
+		if(Boot_RecOk(pRec))
+			BootApply(State, pRec);
+	}
+	State->Next = Addr;
+}
+
+/*************************************************************************
+*  函数名称：BootCrc32
+*  功能说明：用CRC模块计算CRC-32(多项式04C11DB7, 初值FFFFFFFF, 反射, 结果取反)
+//	         对齐部分按32位写入(位和字节都转置), 余下字节按8位写入(只转置位)
+*  参数说明：Data：数据
+//	         Len：字节数
+*  函数返回：CRC-32
+*************************************************************************/
+uint32_t BootCrc32(const uint8_t *Data, uint32_t Len)
+{
+	PCC->PCCn[PCC_CRC_INDEX] |= PCC_PCCn_CGC_MASK;
+	CRC->GPOLY = 0x04C11DB7;
+	CRC->CTRL = CRC_CTRL_TCRC(1) | CRC_CTRL_WAS(1) | CRC_CTRL_FXOR(1) | CRC_CTRL_TOTR(2) | CRC_CTRL_TOT(2);
+	CRC->DATAu.DATA = 0xFFFFFFFF;																//种子
+	CRC->CTRL &= ~CRC_CTRL_WAS_MASK;
+
+	if(((uint32_t)Data & 3) == 0)
+	{
+		for(;Len>=4;Len-=4,Data+=4)
+			CRC->DATAu.DATA = *(const uint32_t *)Data;
+	}
+	CRC->CTRL = (CRC->CTRL & ~CRC_CTRL_TOT_MASK) | CRC_CTRL_TOT(1);
+	for(;Len;Len--)
+		CRC->DATAu.DATA_8.LL = *Data++;
+
+	return CRC->DATAu.DATA;
+}
+
+/*************************************************************************
+*  函数名称：BootSlotSane
+*  功能说明：检查slot向量表: SP在SRAM内且4字节对齐, 复位入口为Thumb地址且在slot内
+*  参数说明：Slot：0:A区  1:B区
+*  函数返回：1：合理  0：不合理(空白或损坏)
+*************************************************************************/
+uint8_t BootSlotSane(uint8_t Slot)
+{
+	const uint32_t	*pVec;
+	uint32_t				Base;
+
+	Base = BOOT_SLOT_ADDR(Slot);
+	pVec = (const uint32_t *)Base;
+	if(pVec[0] <= BOOT_SRAM_START || pVec[0] > BOOT_SRAM_END || (pVec[0] & 3))
+		return 0;
+	if((pVec[1] & 1) == 0 || pVec[1] < Base + BOOT_VECTOR_BYTES || pVec[1] >= Base + BOOT_SLOT_SIZE)
+		return 0;
+	return 1;
+}
+
+static void Boot_Jump(uint8_t Slot)
+{
+	const uint32_t	*pVec;
+
+	pVec = (const uint32_t *)BOOT_SLOT_ADDR(Slot);
+	S32_SCB->VTOR = BOOT_SLOT_ADDR(Slot);
+	Boot_Start(pVec[0], pVec[1]);
+}
+
+/*************************************************************************
+*  函数名称：BootSelect
+*  功能说明：复位入口. 按日志选择启动slot:
+//	         先试启动slot, 再试另一个, 映像须完整(IMAGE记录)且向量表合理、CRC相符;
+//	         都不满足时(如调试器直接下载), 启动日志中没有记录(既无IMAGE也无START)且向量表合理的slot;
+//	         日志中登记过的slot必须通过CRC, CRC不符或下载未完成的不启动
+*  参数说明：无
+*  函数返回：无
+*************************************************************************/
+void BootSelect(void)
+{
+	BootStateType	State;
+	uint8_t				i,Slot;
+
+	WDOG->CNT = 0xD928C520;																			//关看门狗, 同SystemInit, 应用中可重新配置
+	(void)WDOG->CNT;
+	WDOG->CS = WDOG_CS_CMD32EN_MASK | WDOG_CS_CLK(1) | WDOG_CS_UPDATE_MASK;
+	WDOG->TOVAL = 0xFFFF;
+
+	BootScan(&State);
+
+	for(i=0;i<BOOT_SLOT_NUM;i++)
+	{
+		Slot = State.Active ^ i;
+		if(State.Valid[Slot] && State.Size[Slot] <= BOOT_SLOT_SIZE && BootSlotSane(Slot) &&
+			 BootCrc32((const uint8_t *)BOOT_SLOT_ADDR(Slot), State.Size[Slot]) == State.Crc[Slot])
+			Boot_Jump(Slot);
+	}
+
+	for(i=0;i<BOOT_SLOT_NUM;i++)
+	{
+		Slot = State.Active ^ i;
+		if(State.Valid[Slot] == 0 && State.Pending[Slot] == 0 && BootSlotSane(Slot))
+			Boot_Jump(Slot);
+	}
+
+	for(;;);
+}
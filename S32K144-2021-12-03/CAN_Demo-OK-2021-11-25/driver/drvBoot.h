@@ -0,0 +1,73 @@
+#ifndef __DRV_BOOT_H
+#define __DRV_BOOT_H
+
+#include <stdint.h>
+#include "S32K144.h"
+
+//P-Flash分区(512KB, 4KB扇区), 与 S32K144_64_flash.sct 一致
+//  0x00000~0x00FFF  常驻引导扇区: 引导向量表, Flash配置字, 引导选择程序, 升级时不改写
+//  0x01000~0x02FFF  升级日志, 两个扇区轮换
+//  0x03000~0x40FFF  A区应用(默认链接地址)
+//  0x41000~0x7EFFF  B区应用(链接时定义APP_SLOT_B)
+//  0x7F000~0x7FFFF  备用扇区(Flash写入测速)
+#define BOOT_JOURNAL0_ADDR			0x00001000
+#define BOOT_JOURNAL1_ADDR			0x00002000
+#define BOOT_JOURNAL_BYTES			4096
+#define BOOT_SLOT_A_ADDR				0x00003000
+#define BOOT_SLOT_B_ADDR				0x00041000
+#define BOOT_SLOT_SIZE					0x0003E000
+#define BOOT_SPARE_ADDR					0x0007F000
+#define BOOT_SLOT_NUM						2
+#define BOOT_SLOT_ADDR(s)				((s) ? BOOT_SLOT_B_ADDR : BOOT_SLOT_A_ADDR)
+
+//引导程序使用的栈顶(SRAM_U末端), 应用的栈由应用向量表给出
+#define BOOT_STACK_TOP					0x20007000
+
+//日志记录, 16字节: Tag Size | Crc Check
+//先写后一个phrase, 再写含Tag的phrase, Tag有效且Check相符才算一条完整记录
+#define BOOT_REC_BYTES					16
+#define BOOT_TAG								0xB0070000uL
+#define BOOT_TAG_MASK						0xFFFF0000uL
+#define BOOT_CHECK_XOR					0x5AA5C33CuL
+#define BOOT_TAG_MAKE(type,slot)	(BOOT_TAG | ((uint32_t)(type) << 8) | (slot))
+
+//记录类型
+#define BOOT_REC_HEADER					0				//扇区头, Size为扇区代数, 代数大的扇区有效
+#define BOOT_REC_START					1				//开始向slot下载, 原映像作废
+#define BOOT_REC_PROGRESS				2				//slot已连续写入Size字节, 断电后从此处续传
+#define BOOT_REC_IMAGE					3				//slot映像完整, 长度Size, CRC32为Crc
+#define BOOT_REC_ACTIVE					4				//从slot启动
+
+typedef	struct
+{
+			uint32_t	Tag;
+			uint32_t	Size;
+			uint32_t	Crc;
+			uint32_t	Check;
+
+}		BootRecType;
+
+//扫描日志得到的状态
+typedef	struct
+{
+			uint32_t	Gen;						//当前日志扇区代数, 0:日志为空
+			uint32_t	Sector;					//当前日志扇区地址
+			uint32_t	Next;						//下一条记录的写入地址
+			uint8_t		Active;					//启动slot
+			uint8_t		Valid[BOOT_SLOT_NUM];
+			uint8_t		Pending[BOOT_SLOT_NUM];		//下载未完成
+			uint32_t	Size[BOOT_SLOT_NUM];
+			uint32_t	Crc[BOOT_SLOT_NUM];
+			uint32_t	Progress[BOOT_SLOT_NUM];
+
+}		BootStateType;
+
+//以下函数位于常驻引导扇区, 不依赖应用的RW/ZI初始化, 应用也可调用
+void			BootApply(BootStateType *State, const BootRecType *Rec);
+void			BootScan(BootStateType *State);
+uint32_t	BootCrc32(const uint8_t *Data, uint32_t Len);
+uint8_t		BootSlotSane(uint8_t Slot);
+void			BootSelect(void);
+
+
+#endif /* __DRV_BOOT_H */
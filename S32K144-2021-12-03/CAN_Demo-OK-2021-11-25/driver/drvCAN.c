@@ -1,49 +1,334 @@
 #include <stdint.h>
 #include "S32K144.h"
 #include "drvCAN.h"
+#include "drvCANFilter.h"
+#include "drvCANTiming.h"
+#include "drvTimer.h"
 #include "drvGPIO.h"
+#include "drvPower.h"
 
 /**********************************  CAN    ***************************************/
-//      ģͨ    ˿          ѡΧ              
-#define CAN0_TX    PTE5        // PTE5PTC3
-#define CAN0_RX    PTE4        // PTE4PTC2
+//      模块通道    端口          可选范围              建议
+#define CAN0_TX    PTE5        // PTE5、PTC3、
+#define CAN0_RX    PTE4        // PTE4、PTC2、
 
-#define CAN1_TX    PTA13       // PTA13PTC7
-#define CAN1_RX    PTA12       // PTA12PTC6
+#define CAN1_TX    PTA13       // PTA13、PTC7、
+#define CAN1_RX    PTA12       // PTA12、PTC6、
 
-#define CAN2_TX    PTB13       // PTB13PTC17
-#define CAN2_RX    PTB12       // PTB12PTC16
+#define CAN2_TX    PTB13       // PTB13、PTC17、
+#define CAN2_RX    PTB12       // PTB12、PTC16、
+
+//接收环形缓冲区, 中断为唯一写者(Head), 主循环为唯一读者(Tail)
+typedef	struct
+{
+		volatile uint16_t	Head;
+		volatile uint16_t	Tail;
+		volatile uint32_t	Overrun;			//缓冲区满丢弃的帧数
+		volatile uint32_t	FifoOverflow;	//硬件Rx FIFO溢出次数(BUF7I)
+		CANFrameType		Buf[CAN_RX_RING_SIZE];
+
+}		CANRxRingType;
+
+//发送队列元素
+typedef	struct
+{
+		CANFrameType	Frame;
+		uint32_t			Key;			//仲裁优先级, 越小越优先
+		uint16_t			Seq;			//入队序号, 同优先级先进先出
+
+}		CANTxItemType;
+
+//发送优先级队列(最小堆), 主循环入队, 发送完成中断补充MailBox, 操作时关中断
+typedef	struct
+{
+		CANTxItemType	Heap[CAN_TX_QUEUE_SIZE];
+		uint8_t				Num;
+		uint16_t			Seq;
+		CANTxItemType	MB[8];		//已装入TxMBox[i]的帧, 中止后重新入队
+		uint8_t				Busy;			//位i: TxMBox[i]正在发送
+		uint8_t				Abort;		//位i: TxMBox[i]已请求中止
+		uint8_t				Aged;			//位i: TxMBox[i]中为等待超时的帧, 发出前不装入其它帧
+
+}		CANTxQueueType;
+
+//MailBox布局, 经典模式: Rx FIFO + MB8~15发送; FD模式见CAN_FD_xxx定义
+typedef	struct
+{
+		uint8_t		FD;					//1: CAN FD模式
+		uint8_t		RxDma;			//1: Rx FIFO由eDMA搬运
+		uint8_t		Stride;			//每个MailBox占的字数
+		uint8_t		TxStart;		//优先级队列使用的发送MailBox
+		uint8_t		TxNum;
+		uint32_t	TxFlags;		//发送MailBox中断标志(含FD发送MailBox)
+		uint32_t	UsPerBitQ16;	//仲裁段位时间, us, Q16定点, FlexCAN TIMER按位计数
+		uint32_t	Bitrate;			//仲裁段实际波特率
+		uint16_t	DataRatioQ8;	//FD数据段位时间/仲裁段位时间, Q8定点
+		uint32_t	BaudKHz;			//初始化参数, 0:通道未初始化
+		uint32_t	DataKHz;
+		uint32_t	PeHz;					//求解位时间所用的协议引擎时钟
+
+}		CANLayoutType;
+
+//FD帧接收缓冲区, 写者/读者同 CANRxRingType
+typedef	struct
+{
+		volatile uint16_t	Head;
+		volatile uint16_t	Tail;
+		volatile uint32_t	Overrun;
+		CANFDFrameType	Buf[CAN_FD_RX_RING_SIZE];
+
+}		CANFDRxRingType;
+
+//FD帧发送队列, 先进先出, 占用一个发送MailBox
+typedef	struct
+{
+		volatile uint16_t	Head;
+		volatile uint16_t	Tail;
+		volatile uint8_t	Busy;
+		uint16_t			BusyBits;		//MailBox中帧的估计位数
+		uint64_t			BusyTime;		//MailBox中帧的Time, 其缓冲区已可被覆盖
+		CANFDFrameType	Buf[CAN_FD_TX_QUEUE_SIZE];
+
+}		CANFDTxQueueType;
+
+static CAN_MemMapPtr const CANBaseTab[CAN_CHANNEL_NUM] = CAN_BASE_TABLE;
+static const IRQn_Type	CANMBIrqTab[CAN_CHANNEL_NUM] = CAN_ORed_0_15_MB_IRQS;
+static CANRxRingType	CANRxRing[CAN_CHANNEL_NUM];
+static CANTxQueueType	CANTxQueue[CAN_CHANNEL_NUM];
+static CANLayoutType	CANLayout[CAN_CHANNEL_NUM];
+static CANLatencyType	CANLatency[CAN_CHANNEL_NUM];
+static CANStatType		CANStat[CAN_CHANNEL_NUM];
+//FD缓冲区只为CAN_FD_CHANNEL分配
+static CANFDRxRingType	CANFDRxRing;
+static CANFDTxQueueType	CANFDTxQueue;
+
+//Rx FIFO输出MailBox原样映像, DMA每帧搬运16字节
+typedef	struct
+{
+		uint32_t	CS;
+		uint32_t	ID;
+		uint32_t	Data[2];
+
+}		CANDmaMBType;
+
+//DMA环形缓冲区, DMA为写者, 其余字段只在关中断或DMA中断中修改
+//写入帧数由计数通道给出(见CAN_RX_DMA_COUNT_CH), 与Rd之差超过缓冲区深度即为覆盖丢帧
+typedef	struct
+{
+		CANDmaMBType	Buf[CAN_RX_DMA_SIZE];
+		uint32_t			Tick;				//计数通道的搬运目的, 内容无用
+		uint16_t			Rd;					//已取走的帧数, 模CAN_RX_DMA_COUNT_MOD
+		uint32_t			Overrun;		//未及时取走被DMA覆盖的帧数
+
+}		CANRxDmaType;
+
+#if (CAN_RX_DMA_COUNT_MOD % CAN_RX_DMA_SIZE) != 0 || CAN_RX_DMA_COUNT_MOD > 0x7FFF || CAN_RX_DMA_SIZE > 0x1FF
+#error "CAN_RX_DMA_COUNT_MOD must be a multiple of CAN_RX_DMA_SIZE and fit CITER"
+#endif
+
+static CANRxDmaType		CANRxDma[CAN_CHANNEL_NUM];
+
+//RX引脚, VLPR下用引脚下降沿中断把内核从WFI唤醒; 模块在VLPR下照常收帧, 位时间无解而关闭的通道只能靠它唤醒
+static const uint8_t	CANRxPinTab[CAN_CHANNEL_NUM] = {CAN0_RX, CAN1_RX, CAN2_RX};
+static PORT_Type * const	CANPortTab[5] = PORT_BASE_PTRS;
+static const IRQn_Type	CANPortIrqTab[5] = PORT_IRQS;
+static volatile uint8_t	CANWake;		//位i: CANi 在VLPR下收到总线活动
+static uint8_t					CANPowerMode = CLOCK_BOOT_MODE;		//当前运行模式, 由CANPowerNotify跟踪
+
+//DLC编码对应的数据长度
+static const uint8_t	CANDlcLenTab[16] = {0,1,2,3,4,5,6,7,8,12,16,20,24,32,48,64};
+
+//通道ch的MailBox n 首字地址
+#define CAN_MB_ADDR(base,ch,n)	(&(base)->RAMn[(n)*CANLayout[ch].Stride])
+
+static void CAN_TxKick(uint8_t CANChannel);
+static void CAN_LatencyAdd(uint8_t CANChannel, uint64_t TxUs, uint64_t Time);
+static uint32_t CAN_FrameBits(uint8_t CANChannel, uint8_t IDE, uint8_t Len, uint8_t FD, uint8_t BRS);
+static void CAN_FDTxKick(uint8_t CANChannel);
+static void CAN_FDRxISR(uint8_t CANChannel);
+static void CAN_IsrTime(uint8_t CANChannel, uint32_t Cycles);
+static void CAN_RxDmaInit(uint8_t CANChannel);
+static void CAN_RxDmaDrain(uint8_t CANChannel);
 
 /*************************************************************************
-*  ƣCANInit
-*  ˵CANChannelģ 0,1,2
-//		       baudrateKHz: , 250,500,1000
-*  أ0ɹ1ʧ
+*  函数名称：CAN_StampUs
+*  功能说明：把MailBox中16位时间戳(位时间计数)换算成us时基上的时刻
+//	         Timer/NowUs为同一时刻采样的FlexCAN TIMER和TimerGetUs(), 帧早于采样点
+*  参数说明：CANChannel：CAN模块号
+//	         Stamp：CS中的TIME_STAMP
+*  函数返回：帧的us时间戳
 *************************************************************************/
-uint8_t CANInit(uint8_t CANChannel,uint32_t baudrateKHz)
+static uint64_t CAN_StampUs(uint8_t CANChannel, uint32_t Stamp, uint32_t Timer, uint64_t NowUs)
+{
+		int32_t		bits;
+
+		bits = (int16_t)(Timer - Stamp);
+		if(bits < 0)	bits = 0;
+		return NowUs - (((uint64_t)(uint32_t)bits * CANLayout[CANChannel].UsPerBitQ16) >> 16);
+}
+
+/*************************************************************************
+*  函数名称：CAN_SolveTiming
+*  功能说明：按协议引擎时钟求解仲裁段(和FD数据段)位时间, 结果存入pLayout
+*  参数说明：PeHz：协议引擎时钟
+//	         Timing/DataTiming：输出位时间; Cbt：输出1为需用CBT; Tdc：输出发送延时补偿
+*  函数返回：0：成功；1：无解, pLayout不变
+*************************************************************************/
+static uint8_t CAN_SolveTiming(CANLayoutType *pLayout, uint32_t PeHz, uint32_t baudrateKHz, uint32_t dataKHz,
+															 CANBitTimingType *Timing, CANBitTimingType *DataTiming, uint8_t *Cbt, uint8_t *Tdc)
+{
+		*Cbt = 0;
+		*Tdc = 0;
+		if(dataKHz)
+		{
+				//FD模式仲裁段用CBT, 数据段用FDCBT
+				if(CANCalcBitTiming(PeHz, baudrateKHz * 1000, CAN_SAMPLE_POINT, &CANTimingCbt, Timing))	return 1;
+				*Cbt = 1;
+				if(dataKHz <= CAN_FD_TDC_MIN_KHZ)
+				{
+						if(CANCalcBitTiming(PeHz, dataKHz * 1000, CAN_FD_DATA_SAMPLE_POINT, &CANTimingFdData, DataTiming))	return 1;
+				}
+				else
+				{
+						//发送延时补偿: 第二采样点位于数据段采样点, 单位PE时钟, 求解时已限制在TDCOFF范围内
+						if(CANCalcBitTiming(PeHz, dataKHz * 1000, CAN_FD_DATA_SAMPLE_POINT, &CANTimingFdTdc, DataTiming))	return 1;
+						*Tdc = (1 + DataTiming->Prop + DataTiming->Pseg1) * DataTiming->Presc;
+				}
+		}
+		else if(CANCalcBitTiming(PeHz, baudrateKHz * 1000, CAN_SAMPLE_POINT, &CANTimingClassic, Timing))
+		{
+				if(CANCalcBitTiming(PeHz, baudrateKHz * 1000, CAN_SAMPLE_POINT, &CANTimingCbt, Timing))	return 1;
+				*Cbt = 1;
+		}
+
+		pLayout->UsPerBitQ16 = (uint32_t)((1000000uLL << 16) / Timing->Bitrate);
+		pLayout->Bitrate		 = Timing->Bitrate;
+		pLayout->DataRatioQ8 = dataKHz ? (uint16_t)(((uint64_t)Timing->Bitrate << 8) / DataTiming->Bitrate) : 256;
+		pLayout->BaudKHz		 = baudrateKHz;
+		pLayout->DataKHz		 = dataKHz;
+		pLayout->PeHz				 = PeHz;
+		return 0;
+}
+
+//写位时间寄存器, 须在冻结模式下调用: CTRL1可满足时用CTRL1, 否则启用CBT扩展位时间
+static void CAN_WriteTiming(CAN_MemMapPtr CANBaseAdd, uint8_t Cbt, const CANBitTimingType *Timing, const CANBitTimingType *DataTiming)
+{
+		if(Cbt)
+		{
+					CANBaseAdd->CBT = (
+																CAN_CBT_BTF_MASK
+															| CAN_CBT_EPRESDIV(Timing->Presc - 1)
+															| CAN_CBT_ERJW(Timing->Rjw - 1)
+															| CAN_CBT_EPROPSEG(Timing->Prop - 1)
+															| CAN_CBT_EPSEG1(Timing->Pseg1 - 1)
+															| CAN_CBT_EPSEG2(Timing->Pseg2 - 1));
+		}
+		else
+		{
+					CANBaseAdd->CBT = 0;
+					CANBaseAdd->CTRL1 = (CANBaseAdd->CTRL1 & CAN_CTRL1_CLKSRC_MASK)
+															| CAN_CTRL1_PRESDIV(Timing->Presc - 1)
+															| CAN_CTRL1_RJW(Timing->Rjw - 1)
+															| CAN_CTRL1_PROPSEG(Timing->Prop - 1)
+															| CAN_CTRL1_PSEG1(Timing->Pseg1 - 1)
+															| CAN_CTRL1_PSEG2(Timing->Pseg2 - 1);
+		}
+		if(DataTiming)
+		{
+					CANBaseAdd->FDCBT = (
+																CAN_FDCBT_FPRESDIV(DataTiming->Presc - 1)
+															| CAN_FDCBT_FRJW(DataTiming->Rjw - 1)
+															| CAN_FDCBT_FPROPSEG(DataTiming->Prop)
+															| CAN_FDCBT_FPSEG1(DataTiming->Pseg1 - 1)
+															| CAN_FDCBT_FPSEG2(DataTiming->Pseg2 - 1));
+		}
+}
+
+/*************************************************************************
+*  函数名称：CAN_PowerClock
+*  功能说明：运行模式Mode下通道的协议引擎时钟: 经典通道用SOSCDIV2; FD通道用SYS_CLK,
+//	         超过CLOCK_CAN_PE_MAX_HZ时(HSRUN)改用SOSCDIV2; VLPR下SOSC关闭, 各通道都用SYS_CLK
+*  参数说明：FD：1为FD通道
+//	         PeHz：输出时钟频率
+*  函数返回：CTRL1[CLKSRC]
+*************************************************************************/
+static uint8_t CAN_PowerClock(uint8_t FD, uint8_t Mode, uint32_t *PeHz)
+{
+		if(Mode == CLOCK_MODE_VLPR)
+		{
+				*PeHz = CLOCK_VLPR_CORE_HZ;
+				return 1;
+		}
+		if(FD)
+		{
+				*PeHz = (Mode == CLOCK_MODE_HSRUN) ? CLOCK_HSRUN_CORE_HZ : CLOCK_RUN_CORE_HZ;
+				if(*PeHz <= CLOCK_CAN_PE_MAX_HZ)	return 1;
+		}
+		*PeHz = CAN_PE_CLOCK_HZ;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CAN_Init
+*  功能说明：CANInit/CANInitFD 的公共部分
+*  参数说明：CANChannel：模块号 0,1,2
+//		       baudrateKHz: 仲裁段波特率
+//		       dataKHz: FD数据段波特率, 0为经典CAN
+*  函数返回：0：成功；1：失败
+*************************************************************************/
+static uint8_t CAN_Init(uint8_t CANChannel, uint32_t baudrateKHz, uint32_t dataKHz)
 {
     uint8_t i;
     CAN_MemMapPtr CANBaseAdd;
 		MailBox				*pMBox;
+		CANLayoutType	*pLayout;
+		CANBitTimingType	Timing,DataTiming;
+		uint32_t			PeHz;
+		uint8_t				Cbt,Tdc,ClkSrc;
     
-    //ͨģѡģַ,ʹFlexCANⲿʱ
+    if(CANChannel >= CAN_CHANNEL_NUM)	return 1;
+		if(dataKHz&&(CANChannel != CAN_FD_CHANNEL))	return 1;
+
+		//先求解位时间, 无解时不动硬件
+		pLayout = &CANLayout[CANChannel];
+		ClkSrc = CAN_PowerClock(dataKHz ? 1 : 0, CANPowerMode, &PeHz);
+		if(CAN_SolveTiming(pLayout, PeHz, baudrateKHz, dataKHz,
+											 &Timing, &DataTiming, &Cbt, &Tdc))	return 1;
+		if(dataKHz)
+		{
+				pLayout->FD				= 1;
+				pLayout->RxDma		= 0;
+				pLayout->Stride		= CAN_FD_MB_WORDS;
+				pLayout->TxStart	= CAN_FD_TX_MB_START_NO;
+				pLayout->TxNum		= CAN_FD_TX_MB_NUM;
+				pLayout->TxFlags	= (((1uL<<CAN_FD_TX_MB_NUM) - 1)<<CAN_FD_TX_MB_START_NO) | (1uL<<CAN_FD_TX_FD_MB_NO);
+		}
+		else
+		{
+				pLayout->FD				= 0;
+				pLayout->RxDma		= (CAN_RX_DMA_CHANNELS >> CANChannel) & 1;
+				pLayout->Stride		= 4;
+				pLayout->TxStart	= FLEXCAN_TX_MB_START_NO;
+				pLayout->TxNum		= 8;
+				pLayout->TxFlags	= CAN_TX_MB_FLAGS;
+		}
+
+    //通过模块号选择模块基地址,使能FlexCAN外部时钟
+    CANBaseAdd = CANBaseTab[CANChannel];
     if(CANChannel == 0)
     {
-        CANBaseAdd = CAN0;
         PCC-> PCCn[PCC_FlexCAN0_INDEX] = PCC_PCCn_CGC_MASK;   //BUSCLK
     }
     else if(CANChannel == 1)
     {
-        CANBaseAdd = CAN1;
         PCC-> PCCn[PCC_FlexCAN1_INDEX] = PCC_PCCn_CGC_MASK;   //BUSCLK
     }
     else if(CANChannel == 2)
     {
-        CANBaseAdd = CAN2;
         PCC-> PCCn[PCC_FlexCAN2_INDEX] = PCC_PCCn_CGC_MASK;   //BUSCLK
     }
   
-    //PIN
+    //配置PIN脚
     if(CANChannel == 0)
     {
       if(CAN0_TX == PTE5 )
@@ -87,9 +372,10 @@ uint8_t CANInit(uint8_t CANChannel,uint32_t baudrateKHz)
       }
     }
 		
-    // The CAN engine clock source is XTAL  8MHz
+    // The CAN engine clock source is XTAL  8MHz, FD模式为SYS_CLK, 见CAN_PowerClock
     CANBaseAdd->MCR |= CAN_MCR_MDIS_MASK;
-    CANBaseAdd->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
+    if(ClkSrc)		CANBaseAdd->CTRL1 |= CAN_CTRL1_CLKSRC_MASK;
+    else					CANBaseAdd->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
     CANBaseAdd->MCR &= ~CAN_MCR_MDIS_MASK;
     
     // Soft Reset
@@ -100,91 +386,103 @@ uint8_t CANInit(uint8_t CANChannel,uint32_t baudrateKHz)
     CANBaseAdd->MCR |= CAN_MCR_FRZ_MASK ;
     CANBaseAdd->MCR |= CAN_MCR_HALT_MASK ;
     while(!(CAN_MCR_FRZACK_MASK & CANBaseAdd->MCR));
-		
 
-		// ò
-    if(baudrateKHz>=1000)
-    {
-					// PE clock frequency = XTAL 8M
-					// PRESDIV = 0, Sclock frequency = 8M / (0+1) = 8M
-					// RJW = 0,			1Tq
-					// ----------------
-					// Sync			Fix	1Tq
-				  // PROPSEG = 3,	4Tq
-					// PSEG1 = 0,		1Tq
-					// PSEG2 = 1,		2Tq
-					// ----------------
-					CANBaseAdd->CTRL1 = (
-																CAN_CTRL1_PRESDIV(0)
- 												      | CAN_CTRL1_RJW(0)
-															| CAN_CTRL1_PROPSEG(3) 
-												      | CAN_CTRL1_PSEG1(0)
-												      | CAN_CTRL1_PSEG2(1));
-		 }
-		 else if(baudrateKHz>=500)
-     {
-					// PE clock frequency = XTAL 8M
-					// PRESDIV = 1, Sclock frequency = 8M / (1+1) = 4M
-					// RJW = 0,			1Tq
-					// ----------------
-					// Sync			Fix	1Tq
-				  // PROPSEG = 3,	4Tq
-					// PSEG1 = 0,		1Tq
-					// PSEG2 = 1,		2Tq
-					// ----------------
-					CANBaseAdd->CTRL1 = (
-																CAN_CTRL1_PRESDIV(1)
- 												      | CAN_CTRL1_RJW(0)
-															| CAN_CTRL1_PROPSEG(3) 
-												      | CAN_CTRL1_PSEG1(0)
-												      | CAN_CTRL1_PSEG2(1));
-		 }
-		 else
-     {
-					// PE clock frequency = XTAL 8M
-					// PRESDIV = 3, Sclock frequency = 8M / (3+1) = 2M
-					// RJW = 0,			1Tq
-					// ----------------
-					// Sync			Fix	1Tq
-				  // PROPSEG = 3,	4Tq
-					// PSEG1 = 0,		1Tq
-					// PSEG2 = 1,		2Tq
-					// ----------------
-					CANBaseAdd->CTRL1 = (
-																CAN_CTRL1_PRESDIV(3)
- 												      | CAN_CTRL1_RJW(0)
-															| CAN_CTRL1_PROPSEG(3) 
-												      | CAN_CTRL1_PSEG1(0)
-												      | CAN_CTRL1_PSEG2(1));
-		 }
+    // 设置波特率
+    CAN_WriteTiming(CANBaseAdd, Cbt, &Timing, dataKHz ? &DataTiming : 0);
 		
 
-    //ʼĴ
+    //初始化掩码寄存器
    	CANBaseAdd->RXMGMASK = 0;
  	  CANBaseAdd->RXFGMASK = 0;
 		for(i=0;i<16;i++)  CANBaseAdd->RXIMR[i] = 0;
 	
 	
-		// ÷ͽMailBox 
+		// 设置发送接受MailBox 
     CANBaseAdd->MCR |= CAN_MCR_SRXDIS_MASK;
-    CANBaseAdd->MCR |= 15; 									// 16MailBox
-    CANBaseAdd->MCR |= CAN_MCR_RFEN_MASK; 	// Rx FIFO 	 
-		CANBaseAdd->CTRL2 = 0x00A00000;
-	  pMBox	= (MailBox *)(CANBaseAdd->RAMn);
-		//	Rx Filter
-		for(i=0;i<8;i++)
+		if(dataKHz)
 		{
-				pMBox->RxFilter[i].RXIDA	= 0;
-				pMBox->RxFilter[i].IDE 		= i&1;
-				pMBox->RxFilter[i].RTR 		= 0;
+				// 64字节MailBox, 7个, 无Rx FIFO; ISO CAN FD, 数据段切换波特率
+				// 软复位后MAXMB为15, 须先清掉再写, 否则MCR中仍是15, 超出64字节MailBox可用数
+				CANBaseAdd->MCR = (CANBaseAdd->MCR & ~CAN_MCR_MAXMB_MASK)
+												| CAN_MCR_FDEN_MASK | CAN_MCR_IRMQ_MASK | CAN_MCR_MAXMB(CAN_FD_MB_NUM - 1);
+				CANBaseAdd->CTRL2 = 0x00A00000 | CAN_CTRL2_ISOCANFDEN_MASK;
+				CANBaseAdd->FDCTRL = CAN_FDCTRL_FDRATE_MASK | CAN_FDCTRL_MBDSR0(3)
+													 | (Tdc ? (CAN_FDCTRL_TDCEN_MASK | CAN_FDCTRL_TDCOFF(Tdc)) : 0);
+				for(i=0;i<CAN_FD_RX_MB_NUM;i++)
+				{
+						CAN_MB_ADDR(CANBaseAdd, CANChannel, i)[1] = 0;
+						CAN_MB_ADDR(CANBaseAdd, CANChannel, i)[0] = FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_RX_EMPTY)
+																											| ((i >= CAN_FD_RX_MB_EXT_NO) ? (FLEXCAN_MB_CS_IDE | FLEXCAN_MB_CS_SRR) : 0);
+				}
+				CAN_MB_ADDR(CANBaseAdd, CANChannel, CAN_FD_TX_FD_MB_NO)[0] = FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_INACTIVE);
+				CANFDRxRing.Head = 0;
+				CANFDRxRing.Tail = 0;
+				CANFDRxRing.Overrun = 0;
+				CANFDTxQueue.Head = 0;
+				CANFDTxQueue.Tail = 0;
+				CANFDTxQueue.Busy = 0;
+		}
+		else
+		{
+				CANBaseAdd->MCR = (CANBaseAdd->MCR & ~CAN_MCR_MAXMB_MASK) | CAN_MCR_MAXMB(15); 	// 16个MailBox
+				CANBaseAdd->MCR |= CAN_MCR_RFEN_MASK; 	// Rx FIFO 	 
+				CANBaseAdd->CTRL2 = 0x00A00000;
+				pMBox	= (MailBox *)(CANBaseAdd->RAMn);
+				//	Rx Filter
+				for(i=0;i<8;i++)
+				{
+						pMBox->RxFilter[i].RXIDA	= 0;
+						pMBox->RxFilter[i].IDE 		= i&1;
+						pMBox->RxFilter[i].RTR 		= 0;
+				}
 		}
     // Tx MailBox
-		for(i=0;i<8;i++)
+		for(i=0;i<pLayout->TxNum;i++)
 		{
-				pMBox ->TxMBox[i].CODE = FLEXCAN_MB_CODE_TX_INACTIVE;
+				CAN_MB_ADDR(CANBaseAdd, CANChannel, pLayout->TxStart+i)[0] = FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_INACTIVE);
 		}
 
-		
+		// Tx MailBox 中止功能, 用于优先级反转时替换低优先级帧
+		CANBaseAdd->MCR |= CAN_MCR_AEN_MASK;
+		CANTxQueue[CANChannel].Num = 0;
+		CANTxQueue[CANChannel].Busy = 0;
+		CANTxQueue[CANChannel].Abort = 0;
+		CANTxQueue[CANChannel].Aged = 0;
+		CANGetLatency(CANChannel, &CANLatency[CANChannel], 1);
+		CANStat[CANChannel].RxFrames = 0;
+		CANStat[CANChannel].TxFrames = 0;
+		CANStat[CANChannel].RxBits	 = 0;
+		CANStat[CANChannel].TxBits	 = 0;
+		CANStat[CANChannel].TxReject = 0;
+		CANGetStat(CANChannel, &CANStat[CANChannel], 1);
+
+		// Rx FIFO 中断: BUF5I 有帧, BUF7I 溢出; Tx MailBox 发送完成中断
+		CANRxRing[CANChannel].Head = 0;
+		CANRxRing[CANChannel].Tail = 0;
+		CANRxRing[CANChannel].Overrun = 0;
+		CANRxRing[CANChannel].FifoOverflow = 0;
+		// FD模式: 接收MailBox有帧中断
+		if(dataKHz)
+		{
+				CANBaseAdd->IFLAG1 = ((1uL<<CAN_FD_RX_MB_NUM) - 1) | pLayout->TxFlags;
+				CANBaseAdd->IMASK1 = ((1uL<<CAN_FD_RX_MB_NUM) - 1) | pLayout->TxFlags;
+		}
+		else if(pLayout->RxDma)
+		{
+				// DMA模式: BUF5I作为DMA请求, 不开FIFO中断
+				CANBaseAdd->MCR |= CAN_MCR_DMA_MASK;
+				CANBaseAdd->IFLAG1 = CAN_IFLAG1_BUF5I_MASK | CAN_IFLAG1_BUF6I_MASK | CAN_IFLAG1_BUF7I_MASK | pLayout->TxFlags;
+				CANBaseAdd->IMASK1 = pLayout->TxFlags;
+				CAN_RxDmaInit(CANChannel);
+		}
+		else
+		{
+				CANBaseAdd->IFLAG1 = CAN_IFLAG1_BUF5I_MASK | CAN_IFLAG1_BUF6I_MASK | CAN_IFLAG1_BUF7I_MASK | pLayout->TxFlags;
+				CANBaseAdd->IMASK1 = CAN_IFLAG1_BUF5I_MASK | CAN_IFLAG1_BUF7I_MASK | pLayout->TxFlags;
+		}
+		NVIC_ClearPendingIRQ(CANMBIrqTab[CANChannel]);
+		NVIC_EnableIRQ(CANMBIrqTab[CANChannel]);
+
     // Exit Fraze Mode
 	  CANBaseAdd->MCR &= ~(CAN_MCR_FRZ_MASK);
 	  while( CANBaseAdd->MCR & CAN_MCR_FRZACK_MASK);    
@@ -193,102 +491,1370 @@ uint8_t CANInit(uint8_t CANChannel,uint32_t baudrateKHz)
     return 0;
 }
 
+/*************************************************************************
+*  函数名称：CANInit
+*  功能说明：收发帧时间戳取自 TimerGetUs, 须先调用 TimerInit
+*  参数说明：CANChannel：模块号 0,1,2
+//		       baudrateKHz: 波特率, 任意值, 由CANCalcBitTiming按CAN_PE_CLOCK_HZ求解
+*  函数返回：0：成功；1：失败
+*************************************************************************/
+uint8_t CANInit(uint8_t CANChannel,uint32_t baudrateKHz)
+{
+		return CAN_Init(CANChannel, baudrateKHz, 0);
+}
+
+/*************************************************************************
+*  函数名称：CANInitFD
+*  功能说明：以CAN FD模式初始化, 经典帧仍走 CANSendBurst/CANRecBurst,
+//	         FD帧走 CANSendFD/CANRecFD; 不支持Rx FIFO过滤表
+*  参数说明：CANChannel：模块号, 只能为CAN_FD_CHANNEL
+//		       baudrateKHz: 仲裁段波特率
+//		       dataKHz: 数据段波特率, 按CAN_PowerClock给出的协议引擎时钟求解
+*  函数返回：0：成功；1：失败
+*************************************************************************/
+uint8_t CANInitFD(uint8_t CANChannel, uint32_t baudrateKHz, uint32_t dataKHz)
+{
+		if(dataKHz == 0)	return 1;
+		return CAN_Init(CANChannel, baudrateKHz, dataKHz);
+}
+
 
 /*************************************************************************
-*  ƣCANSendData
-*  ˵
-*  ˵CANChannelģ 
-//	         id: ID
-//           lengthݳ
-//	         Data[8]:ݻ
-*  أ0ɹ1ʧ
+*  函数名称：CANSetRxFilter
+*  功能说明：写入由 CANFilterCompile 生成的Rx FIFO ID过滤表, 不需要的帧由硬件丢弃
+*  参数说明：CANChannel：模块号
+//	         Tab：过滤表, RFFN不超过CAN_RX_FILTER_RFFN_MAX
+*  函数返回：0：成功；1：失败(含FD模式)
 *************************************************************************/
-uint8_t CANSendData(uint8_t CANChannel, uint32_t id_ext, uint32_t id, uint8_t length,uint8_t Data[])
+uint8_t CANSetRxFilter(uint8_t CANChannel, const CANFilterTabType *Tab)
 {
     CAN_MemMapPtr CANBaseAdd;
-		MailBox		*pMBox;
-    uint16_t  i;  
-    
+		uint8_t				i,n;
 
-    if(CANChannel == 0)
-        CANBaseAdd = CAN0;  
-    else if(CANChannel == 1)
-        CANBaseAdd = CAN1;
-    else if(CANChannel == 2)
-        CANBaseAdd = CAN2;
- 
-	  pMBox	= (MailBox *)(CANBaseAdd->RAMn);
-		
-		for(i=0;i<8;i++)
+		if((CANChannel >= CAN_CHANNEL_NUM)||(Tab->RFFN > CAN_RX_FILTER_RFFN_MAX))	return 1;
+		//FD模式没有Rx FIFO
+		if(CANLayout[CANChannel].FD)	return 1;
+		CANBaseAdd = CANBaseTab[CANChannel];
+
+    // Enter Fraze Mode
+    CANBaseAdd->MCR |= CAN_MCR_FRZ_MASK ;
+    CANBaseAdd->MCR |= CAN_MCR_HALT_MASK ;
+    while(!(CAN_MCR_FRZACK_MASK & CANBaseAdd->MCR));
+
+    // 过滤表从MB6开始, 每个MB占4个字
+    n = 8 * (Tab->RFFN + 1);
+		for(i=0;i<n;i++)
 		{
-				
-			  if(pMBox->TxMBox[i].CODE == FLEXCAN_MB_CODE_TX_INACTIVE) break;
-			  if(pMBox->TxMBox[i].CODE == FLEXCAN_MB_CODE_TX_ABORT) break;
+				CANBaseAdd->RAMn[6*4 + i] = Tab->Elem[i];
+				if(i < CAN_RXIMR_COUNT)	CANBaseAdd->RXIMR[i] = Tab->Mask[i];
 		}
-		if(i==8)	return 1;
-		
-		if(id_ext) 	pMBox->TxMBox[i].ID = id;
-		else				pMBox->TxMBox[i].ID = id<<18;
-		pMBox->TxMBox[i].DLC = length;
-		
-		pMBox->TxMBox[i].Data[3] = Data[0];
-		pMBox->TxMBox[i].Data[2] = Data[1];
-		pMBox->TxMBox[i].Data[1] = Data[2];
-		pMBox->TxMBox[i].Data[0] = Data[3];
-		pMBox->TxMBox[i].Data[7] = Data[4];
-		pMBox->TxMBox[i].Data[6] = Data[5];
-		pMBox->TxMBox[i].Data[5] = Data[6];
-		pMBox->TxMBox[i].Data[4] = Data[7];
-		
-		pMBox->TxMBox[i].IDE  = id_ext;
-		pMBox->TxMBox[i].RTR  = 0;
-		pMBox->TxMBox[i].CODE = FLEXCAN_MB_CODE_TX_ONCE;
-		
+		CANBaseAdd->RXFGMASK = Tab->GlobalMask;
+		FLEXCAN_set_rffn(CANBaseAdd->CTRL2, Tab->RFFN);
+		CANBaseAdd->MCR = (CANBaseAdd->MCR & ~CAN_MCR_IDAM_MASK) | CAN_MCR_IDAM(Tab->Format) | CAN_MCR_IRMQ_MASK;
+
+    // Exit Fraze Mode
+	  CANBaseAdd->MCR &= ~(CAN_MCR_FRZ_MASK);
+	  while( CANBaseAdd->MCR & CAN_MCR_FRZACK_MASK);
     return 0;
 }
 
+
+/*************************************************************************
+*  函数名称：CANSendData
+*  功能说明：发送数据
+*  参数说明：CANChannel：模块号 
+//	         id: ID号
+//           length：数据长度
+//	         Data[8]:发送数据缓冲区
+*  函数返回：0：成功，1：失败
+*************************************************************************/
+uint8_t CANSendData(uint8_t CANChannel, uint32_t id_ext, uint32_t id, uint8_t length,uint8_t Data[])
+{
+		CANFrameType	Frame;
+		uint8_t				i;
+
+		Frame.ID	= id;
+		Frame.IDE = id_ext;
+		Frame.DLC = length;
+		for(i=0;i<8;i++)	Frame.Data[i] = Data[i];
+		Frame.Time = 0;
+
+		if(CANSendBurst(CANChannel, &Frame, 1)==0)	return 1;
+    return 0;
+}
+
+//仲裁优先级: 按总线上ID位顺序比较, 同基本ID时标准帧优先
+static uint32_t CAN_TxKey(const CANFrameType *Frame)
+{
+		if(Frame->IDE)	return ((Frame->ID & 0x1FFFFFFF) << 1) | 1;
+		return (Frame->ID & 0x7FF) << 19;
+}
+
+static uint8_t CAN_TxBefore(const CANTxItemType *a, const CANTxItemType *b)
+{
+		if(a->Key != b->Key)	return a->Key < b->Key;
+		return (int16_t)(a->Seq - b->Seq) < 0;
+}
+
+static void CAN_TxPush(CANTxQueueType *q, const CANTxItemType *Item)
+{
+		uint8_t	i,p;
+
+		i = q->Num++;
+		while(i > 0)
+		{
+				p = (i - 1) / 2;
+				if(!CAN_TxBefore(Item, &q->Heap[p]))	break;
+				q->Heap[i] = q->Heap[p];
+				i = p;
+		}
+		q->Heap[i] = *Item;
+}
+
+//取出堆中第k个元素, 末尾元素补到k处: 比父节点优先时向上调整, 否则向下调整
+static void CAN_TxTake(CANTxQueueType *q, uint8_t k, CANTxItemType *Item)
+{
+		CANTxItemType	*pLast;
+		uint8_t	i,c;
+
+		*Item = q->Heap[k];
+		pLast = &q->Heap[--q->Num];
+		if(k == q->Num)	return;
+		i = k;
+		while((i > 0)&&CAN_TxBefore(pLast, &q->Heap[(i - 1) / 2]))
+		{
+				q->Heap[i] = q->Heap[(i - 1) / 2];
+				i = (i - 1) / 2;
+		}
+		if(i == k)
+		{
+				for(;;)
+				{
+						c = 2*i + 1;
+						if(c >= q->Num)	break;
+						if((c + 1 < q->Num)&&CAN_TxBefore(&q->Heap[c+1], &q->Heap[c]))	c++;
+						if(!CAN_TxBefore(&q->Heap[c], pLast))	break;
+						q->Heap[i] = q->Heap[c];
+						i = c;
+				}
+		}
+		q->Heap[i] = *pLast;
+}
+
+#if CAN_TX_AGE_US
+//最早提交的帧等待超过CAN_TX_AGE_US时返回其在堆中的位置, 否则返回CAN_TX_QUEUE_SIZE
+//按入队序号取最早的帧, 同ID帧仍按提交顺序发出
+static uint8_t CAN_TxAged(const CANTxQueueType *q, uint64_t Now)
+{
+		uint8_t	i,k;
+
+		if(q->Num == 0)	return CAN_TX_QUEUE_SIZE;
+		k = 0;
+		for(i=1;i<q->Num;i++)
+				if((int16_t)(q->Heap[i].Seq - q->Heap[k].Seq) < 0)	k = i;
+		return (Now - q->Heap[k].Frame.Time >= CAN_TX_AGE_US) ? k : CAN_TX_QUEUE_SIZE;
+}
+#endif
+
+/*************************************************************************
+*  函数名称：CAN_WriteTxMB
+*  功能说明：整字写发送MailBox, ID、数据在寄存器中拼好后各写一次, CODE最后写
+//	         数据用REV指令换成MailBox的大端字节序
+*************************************************************************/
+static void CAN_WriteTxMB(volatile uint32_t *pMB, const CANFrameType *Frame)
+{
+		uint32_t	cs;
+
+		if(Frame->IDE)
+		{
+				pMB[1] = Frame->ID & FLEXCAN_MB_ID_EXT_MASK;
+				cs = FLEXCAN_MB_CS_IDE | FLEXCAN_MB_CS_SRR;
+		}
+		else
+		{
+				pMB[1] = FLEXCAN_MB_ID_IDSTD(Frame->ID);
+				cs = 0;
+		}
+		pMB[2] = __REV(CAN_FRAME_WORD(Frame, 0));
+		pMB[3] = __REV(CAN_FRAME_WORD(Frame, 1));
+		pMB[0] = cs | FLEXCAN_MB_CS_LENGTH(Frame->DLC) | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_ONCE);
+}
+
+/*************************************************************************
+*  函数名称：CAN_TxKick
+*  功能说明：把队列中优先级最高的帧装入空闲发送MailBox, 须在关中断或中断中调用
+//	         MailBox全忙且队首优先级高于MailBox中最低优先级帧时, 中止该MailBox
+*  参数说明：CANChannel：模块号
+*************************************************************************/
+static void CAN_TxKick(uint8_t CANChannel)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		CANTxQueueType	*q;
+		const CANLayoutType	*pLayout;
+		volatile uint32_t	*pMB;
+		uint8_t				i,j,k,num,aged;
+
+		q = &CANTxQueue[CANChannel];
+		CANBaseAdd = CANBaseTab[CANChannel];
+		pLayout = &CANLayout[CANChannel];
+		num = pLayout->TxNum;
+		//VLPR下模块关闭, 帧留在队列中, 恢复后再装入
+		if(CANBaseAdd->MCR & CAN_MCR_MDIS_MASK)	return;
+
+		while(q->Num)
+		{
+				k = 0;
+				aged = 0;
+#if CAN_TX_AGE_US
+				//等待超时的帧先装入; MailBox中有超时帧时不装入其它帧, 使其不再输给本节点的高优先级帧
+				k = CAN_TxAged(q, TimerGetUs());
+				aged = (k < CAN_TX_QUEUE_SIZE) ? 1 : 0;
+				if(aged == 0)
+				{
+						if(q->Aged)	break;
+						k = 0;
+				}
+#endif
+				//同ID帧已在MailBox中时等待其发完, MailBox间按编号仲裁会打乱同ID帧顺序
+				for(j=0;j<num;j++)
+						if((q->Busy & (1u<<j))&&(q->MB[j].Key == q->Heap[k].Key))	return;
+
+				for(i=0;(i<num)&&(q->Busy & (1u<<i));i++);
+				if(i == num)	break;
+
+				if(aged)	q->Aged |= 1u<<i;
+				CAN_TxTake(q, k, &q->MB[i]);
+				CAN_WriteTxMB(CAN_MB_ADDR(CANBaseAdd, CANChannel, pLayout->TxStart+i), &q->MB[i].Frame);
+				q->Busy |= 1u<<i;
+		}
+
+#if CAN_TX_ABORT_ENABLE
+		//中止的帧要回到队列, 须留一个空位
+		if((q->Num == 0)||(q->Num >= CAN_TX_QUEUE_SIZE)||(q->Abort))	return;
+		//找MailBox中优先级最低的帧, 超时帧不中止
+		j = num;
+		for(i=0;i<num;i++)
+		{
+				if(((q->Busy & ~q->Aged) & (1u<<i)) == 0)	continue;
+				if((j == num)||CAN_TxBefore(&q->MB[j], &q->MB[i]))	j = i;
+		}
+		if((j < num)&&(q->Heap[0].Key < q->MB[j].Key))
+		{
+				pMB = CAN_MB_ADDR(CANBaseAdd, CANChannel, pLayout->TxStart+j);
+				pMB[0] = (pMB[0] & ~FLEXCAN_MB_CS_CODE_MASK) | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_ABORT);
+				q->Abort |= 1u<<j;
+		}
+#endif
+}
+
+/*************************************************************************
+*  函数名称：CANSendBurst
+*  功能说明：批量发送, 帧按ID优先级进入软件发送队列, 并立即装满空闲发送MailBox
+*  参数说明：CANChannel：模块号
+//	         Frames: 发送帧数组
+//	         Num: 帧数
+*  函数返回：进入队列的帧数, 队列满时未入队的帧由调用者保留
+*************************************************************************/
+uint8_t CANSendBurst(uint8_t CANChannel, const CANFrameType *Frames, uint8_t Num)
+{
+		CANTxQueueType	*q;
+		CANTxItemType	Item;
+		uint64_t			now;
+		uint32_t			primask;
+		uint8_t				n;
+
+		q = &CANTxQueue[CANChannel];
+		now = TimerGetUs();
+		primask = __get_PRIMASK();
+		__disable_irq();
+
+		for(n=0;(n<Num)&&(q->Num < CAN_TX_QUEUE_SIZE - (q->Abort ? 1 : 0));n++)
+		{
+				Item.Frame = Frames[n];
+				if(Item.Frame.Time == 0)	Item.Frame.Time = now;
+				Item.Key	 = CAN_TxKey(&Frames[n]);
+				Item.Seq	 = q->Seq++;
+				CAN_TxPush(q, &Item);
+		}
+		CANStat[CANChannel].TxReject += Num - n;
+		CAN_TxKick(CANChannel);
+
+		__set_PRIMASK(primask);
+    return n;
+}
+
+/*************************************************************************
+*  函数名称：CAN_TxISR
+*  功能说明：发送MailBox中断处理, 中止成功的帧重新入队, 再补充MailBox
+//	         发出的帧按MailBox时间戳记录发送延时
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+void CAN_TxISR(uint8_t CANChannel)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		CANTxQueueType	*q;
+		const CANLayoutType	*pLayout;
+		uint64_t			now;
+		uint32_t			flags,timer,cs;
+		uint8_t				i,mb;
+
+		CANBaseAdd = CANBaseTab[CANChannel];
+		q = &CANTxQueue[CANChannel];
+		pLayout = &CANLayout[CANChannel];
+
+		flags = CANBaseAdd->IFLAG1 & pLayout->TxFlags;
+		if(flags == 0)	return;
+		CANBaseAdd->IFLAG1 = flags;
+		timer = CANBaseAdd->TIMER;
+		now		= TimerGetUs();
+
+		for(i=0;i<pLayout->TxNum;i++)
+		{
+				mb = pLayout->TxStart + i;
+				if((flags & (1uL<<mb)) == 0)	continue;
+				cs = CAN_MB_ADDR(CANBaseAdd, CANChannel, mb)[0];
+				//已请求中止且未发出的帧回到队列
+				if((q->Abort & (1u<<i))&&(FLEXCAN_get_code(cs) == FLEXCAN_MB_CODE_TX_ABORT))
+						CAN_TxPush(q, &q->MB[i]);
+				else
+				{
+						CAN_LatencyAdd(CANChannel, CAN_StampUs(CANChannel, cs & FLEXCAN_MB_CS_TIMESTAMP_MASK, timer, now), q->MB[i].Frame.Time);
+						CANStat[CANChannel].TxFrames++;
+						CANStat[CANChannel].TxBits += CAN_FrameBits(CANChannel, q->MB[i].Frame.IDE, q->MB[i].Frame.DLC, 0, 0);
+				}
+				q->Busy  &= ~(1u<<i);
+				q->Abort &= ~(1u<<i);
+				q->Aged	 &= ~(1u<<i);
+		}
+		CAN_TxKick(CANChannel);
+
+		if(pLayout->FD&&(flags & (1uL<<CAN_FD_TX_FD_MB_NO)))
+		{
+				cs = CAN_MB_ADDR(CANBaseAdd, CANChannel, CAN_FD_TX_FD_MB_NO)[0];
+				CAN_LatencyAdd(CANChannel, CAN_StampUs(CANChannel, cs & FLEXCAN_MB_CS_TIMESTAMP_MASK, timer, now), CANFDTxQueue.BusyTime);
+				CANStat[CANChannel].TxFrames++;
+				CANStat[CANChannel].TxBits += CANFDTxQueue.BusyBits;
+				CANFDTxQueue.Busy = 0;
+				CAN_FDTxKick(CANChannel);
+		}
+}
+
+/*************************************************************************
+*  函数名称：CAN_LatencyAdd
+*  功能说明：累计一帧的发送延时, 在发送中断中调用
+*  参数说明：CANChannel：CAN模块号
+//	         TxUs：帧发出时刻
+//	         Time：帧的 Time(接收或入队时刻)
+*************************************************************************/
+static void CAN_LatencyAdd(uint8_t CANChannel, uint64_t TxUs, uint64_t Time)
+{
+		CANLatencyType	*pLat;
+		uint32_t			d;
+		uint8_t				i;
+
+		pLat = &CANLatency[CANChannel];
+		d = (TxUs <= Time) ? 0 : ((TxUs - Time > 0xFFFFFFFFuL) ? 0xFFFFFFFFuL : (uint32_t)(TxUs - Time));
+		pLat->Last = d;
+		if(d < pLat->Min)	pLat->Min = d;
+		if(d > pLat->Max)	pLat->Max = d;
+		pLat->Sum += d;
+		pLat->Num++;
+		for(i=0;(i<CAN_LATENCY_HIST_NUM-1)&&(d >= ((uint32_t)CAN_LATENCY_HIST_US0<<i));i++);
+		pLat->Hist[i]++;
+		CAN_LATENCY_HOOK(CANChannel, d);
+}
+
+/*************************************************************************
+*  函数名称：CANGetLatency
+*  功能说明：读取发送延时统计, 平均值 = Sum / Num
+*  参数说明：CANChannel：CAN模块号
+//	         Lat：输出
+//	         Clear：1 读取后清零
+*************************************************************************/
+void CANGetLatency(uint8_t CANChannel, CANLatencyType *Lat, uint8_t Clear)
+{
+		CANLatencyType	*pLat;
+		uint32_t			primask;
+		uint8_t				i;
+
+		pLat = &CANLatency[CANChannel];
+		primask = __get_PRIMASK();
+		__disable_irq();
+		if(Lat != pLat)	*Lat = *pLat;
+		if(Clear)
+		{
+				pLat->Last = 0;
+				pLat->Min	 = 0xFFFFFFFFuL;
+				pLat->Max	 = 0;
+				pLat->Num	 = 0;
+				pLat->Sum	 = 0;
+				for(i=0;i<CAN_LATENCY_HIST_NUM;i++)	pLat->Hist[i] = 0;
+		}
+		__set_PRIMASK(primask);
+}
+
+/*************************************************************************
+*  函数名称：CAN_FrameBits
+*  功能说明：按DLC估计一帧占用的总线位数, 含最坏情况位填充和3位帧间隔
+//	         经典帧可填充区: 标准帧34+8n, 扩展帧54+8n, 每4位最多填充1位
+//	         FD帧数据段(ESI~CRC)按 DataRatioQ8 折算为仲裁段位
+*  参数说明：CANChannel：CAN模块号
+//	         IDE：1扩展帧
+//	         Len：数据字节数
+//	         FD、BRS：FD帧标志
+*  函数返回：仲裁段位数
+*************************************************************************/
+static uint32_t CAN_FrameBits(uint8_t CANChannel, uint8_t IDE, uint8_t Len, uint8_t FD, uint8_t BRS)
+{
+		uint32_t	hdr,data,crc;
+
+		if(FD == 0)
+		{
+				data = (IDE ? 54 : 34) + 8 * (uint32_t)Len;
+				return data + (data - 1) / 4 + 10 + 3;
+		}
+
+		//仲裁段: SOF~BRS
+		hdr  = IDE ? 36 : 17;
+		//数据段: ESI、DLC、数据、填充计数、CRC, CRC段每4位固定填充1位
+		crc  = (Len > 16) ? 21 : 17;
+		data = 5 + 8 * (uint32_t)Len;
+		data = data + data / 4 + 4 + crc + (4 + crc) / 4;
+		if(BRS)	data = (data * CANLayout[CANChannel].DataRatioQ8) >> 8;
+		//CRC界定符、ACK、EOF 10位, 帧间隔3位
+		return hdr + (hdr - 1) / 4 + data + 10 + 3;
+}
+
+/*************************************************************************
+*  函数名称：CAN_IsrTime
+*  功能说明：记录一次CAN/DMA中断的耗时
+*  参数说明：CANChannel：CAN模块号
+//	         Cycles：CPU周期数
+*************************************************************************/
+static void CAN_IsrTime(uint8_t CANChannel, uint32_t Cycles)
+{
+		CANStatType	*pStat;
+
+		pStat = &CANStat[CANChannel];
+		if(Cycles < pStat->IsrMin)	pStat->IsrMin = Cycles;
+		if(Cycles > pStat->IsrMax)	pStat->IsrMax = Cycles;
+		pStat->IsrSum += Cycles;
+		pStat->IsrNum++;
+}
+
+/*************************************************************************
+*  函数名称：CANGetStat
+*  功能说明：读取通道统计, 错误计数取自ECR
+*  参数说明：CANChannel：CAN模块号
+//	         Stat：输出
+//	         Clear：1 读取后清零中断耗时统计, 累计计数不清
+*************************************************************************/
+void CANGetStat(uint8_t CANChannel, CANStatType *Stat, uint8_t Clear)
+{
+		CANStatType	*pStat;
+		uint32_t		primask,ecr;
+
+		pStat = &CANStat[CANChannel];
+		ecr = CANBaseTab[CANChannel]->ECR;
+		primask = __get_PRIMASK();
+		__disable_irq();
+		pStat->Bitrate = CANLayout[CANChannel].Bitrate;
+		pStat->RxDrop	 = CANGetRxOverrun(CANChannel);
+		pStat->Tec		 = (uint8_t)((ecr & CAN_ECR_TXERRCNT_MASK) >> CAN_ECR_TXERRCNT_SHIFT);
+		pStat->Rec		 = (uint8_t)((ecr & CAN_ECR_RXERRCNT_MASK) >> CAN_ECR_RXERRCNT_SHIFT);
+		if(Stat != pStat)	*Stat = *pStat;
+		if(Clear)
+		{
+				pStat->IsrMin = 0xFFFFFFFFuL;
+				pStat->IsrMax = 0;
+				pStat->IsrNum = 0;
+				pStat->IsrSum = 0;
+		}
+		__set_PRIMASK(primask);
+}
+
+/*************************************************************************
+*  函数名称：CAN_FDTxKick
+*  功能说明：FD发送MailBox空闲时装入队首帧, 须在关中断或中断中调用
+//	         数据按DLC长度整字写入, 字节序换成MailBox的大端
+*  参数说明：CANChannel：模块号
+*************************************************************************/
+static void CAN_FDTxKick(uint8_t CANChannel)
+{
+		CANFDTxQueueType	*q;
+		const CANFDFrameType	*pFrame;
+		volatile uint32_t	*pMB;
+		uint32_t			cs;
+		uint8_t				dlc,i;
+
+		q = &CANFDTxQueue;
+		if(q->Busy||(q->Tail == q->Head))	return;
+		if(CANBaseTab[CANChannel]->MCR & CAN_MCR_MDIS_MASK)	return;
+
+		pFrame = &q->Buf[q->Tail];
+		pMB = CAN_MB_ADDR(CANBaseTab[CANChannel], CANChannel, CAN_FD_TX_FD_MB_NO);
+		for(dlc=0;CANDlcLenTab[dlc] < pFrame->Len;dlc++);
+
+		if(pFrame->IDE)
+		{
+				pMB[1] = pFrame->ID & FLEXCAN_MB_ID_EXT_MASK;
+				cs = FLEXCAN_MB_CS_IDE | FLEXCAN_MB_CS_SRR;
+		}
+		else
+		{
+				pMB[1] = FLEXCAN_MB_ID_IDSTD(pFrame->ID);
+				cs = 0;
+		}
+		for(i=0;i<(CANDlcLenTab[dlc] + 3) / 4;i++)
+				pMB[2+i] = __REV(((const uint32_t *)pFrame->Data)[i]);
+		if(pFrame->BRS)	cs |= FLEXCAN_MB_CS_BRS;
+		pMB[0] = cs | FLEXCAN_MB_CS_EDL | FLEXCAN_MB_CS_LENGTH(dlc) | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_ONCE);
+
+		q->BusyTime = pFrame->Time;
+		q->BusyBits = (uint16_t)CAN_FrameBits(CANChannel, pFrame->IDE, CANDlcLenTab[dlc], 1, pFrame->BRS);
+		q->Tail = (q->Tail + 1) & (CAN_FD_TX_QUEUE_SIZE - 1);
+		q->Busy = 1;
+}
+
 /*************************************************************************
-*  ƣ
-*  ˵ʹܽջ
-*  ˵CANChannelCANģ
-*  أ0ɹ1ʧ
-//	         id: ID
-//	         lenghtݳ
-//	         Data: ݻ
+*  函数名称：CANSendFD
+*  功能说明：发送一帧CAN FD帧, 先进先出, 与经典帧队列相互独立
+//	         Len不是合法FD长度时用CAN_FD_PAD_BYTE补齐
+*  参数说明：CANChannel：模块号, 须已由CANInitFD初始化
+//	         Frame: 发送帧
+*  函数返回：0：成功，1：失败(非FD模式、长度超限或队列满)
+*************************************************************************/
+uint8_t CANSendFD(uint8_t CANChannel, const CANFDFrameType *Frame)
+{
+		CANFDTxQueueType	*q;
+		CANFDFrameType	*pBuf;
+		uint32_t			primask;
+		uint16_t			head,next;
+		uint8_t				i;
+
+		if((CANChannel >= CAN_CHANNEL_NUM)||(CANLayout[CANChannel].FD == 0)||(Frame->Len > 64))	return 1;
+
+		q = &CANFDTxQueue;
+		head = q->Head;
+		next = (head + 1) & (CAN_FD_TX_QUEUE_SIZE - 1);
+		if(next == q->Tail)
+		{
+				CANStat[CANChannel].TxReject++;
+				return 1;
+		}
+
+		pBuf = &q->Buf[head];
+		*pBuf = *Frame;
+		for(i=Frame->Len;i<64;i++)	pBuf->Data[i] = CAN_FD_PAD_BYTE;
+		if(pBuf->Time == 0)	pBuf->Time = TimerGetUs();
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		q->Head = next;
+		CAN_FDTxKick(CANChannel);
+		__set_PRIMASK(primask);
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANRecFD
+*  功能说明：从FD接收缓冲区取出一帧
+*  参数说明：CANChannel：CAN模块号
+//	         Frame: 接收帧, Len为DLC对应的长度
+*  函数返回：0：成功，1：缓冲区空或非FD模式
+*************************************************************************/
+uint8_t CANRecFD(uint8_t CANChannel, CANFDFrameType *Frame)
+{
+		CANFDRxRingType	*pRing;
+		uint16_t		tail;
+
+		if((CANChannel >= CAN_CHANNEL_NUM)||(CANLayout[CANChannel].FD == 0))	return 1;
+
+		pRing = &CANFDRxRing;
+		tail	= pRing->Tail;
+		if(tail == pRing->Head)	return 1;
+
+		*Frame = pRing->Buf[tail];
+		pRing->Tail = (tail + 1) & (CAN_FD_RX_RING_SIZE - 1);
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CAN_RxDmaInit
+*  功能说明：配置eDMA把Rx FIFO输出(MB0, 4字)逐帧搬入 CANRxDma 环形缓冲区
+//	         源地址按16字节取模(SMOD=4), 每帧都从MB0读起; MB0在RAMn偏移0x80, 满足对齐
+//	         主循环计数到底后目的地址回绕, DREQ=0通道不停, 半满、满时中断
+//	         每帧搬完后经次循环/主循环链接启动一次计数通道, 计数通道的CITER即为回绕的帧计数
+*  参数说明：CANChannel：CAN模块号, 使用同号DMA通道和 CANChannel + CAN_RX_DMA_COUNT_CH 计数通道
+*************************************************************************/
+static void CAN_RxDmaInit(uint8_t CANChannel)
+{
+		static const uint32_t	tick = 0;
+		uint8_t	ch,cc;
+
+		ch = CANChannel;
+		cc = CANChannel + CAN_RX_DMA_COUNT_CH;
+		PCC->PCCn[PCC_DMAMUX_INDEX] |= PCC_PCCn_CGC_MASK;
+		DMA->CERQ = ch;
+		DMAMUX->CHCFG[ch] = 0;
+
+		//计数通道: 每次启动搬4字节, 只由链接启动, 不开请求和中断
+		DMA->TCD[cc].CSR			= 0;
+		DMA->TCD[cc].SADDR		= (uint32_t)(uintptr_t)&tick;
+		DMA->TCD[cc].SOFF			= 0;
+		DMA->TCD[cc].ATTR			= DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2);
+		DMA->TCD[cc].NBYTES.MLNO = 4;
+		DMA->TCD[cc].SLAST		= 0;
+		DMA->TCD[cc].DADDR		= (uint32_t)(uintptr_t)&CANRxDma[CANChannel].Tick;
+		DMA->TCD[cc].DOFF			= 0;
+		DMA->TCD[cc].CITER.ELINKNO = CAN_RX_DMA_COUNT_MOD;
+		DMA->TCD[cc].BITER.ELINKNO = CAN_RX_DMA_COUNT_MOD;
+		DMA->TCD[cc].DLASTSGA	= 0;
+
+		CANRxDma[CANChannel].Rd			 = 0;
+		CANRxDma[CANChannel].Overrun = 0;
+		DMA->TCD[ch].SADDR		= (uint32_t)(uintptr_t)CAN_MB_WORDS(CANBaseTab[CANChannel], 0);
+		DMA->TCD[ch].SOFF			= 4;
+		DMA->TCD[ch].ATTR			= DMA_TCD_ATTR_SMOD(4) | DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2);
+		DMA->TCD[ch].NBYTES.MLNO = sizeof(CANDmaMBType);
+		DMA->TCD[ch].SLAST		= 0;
+		DMA->TCD[ch].DADDR		= (uint32_t)(uintptr_t)CANRxDma[CANChannel].Buf;
+		DMA->TCD[ch].DOFF			= 4;
+		DMA->TCD[ch].CITER.ELINKYES = DMA_TCD_CITER_ELINKYES_ELINK_MASK | DMA_TCD_CITER_ELINKYES_LINKCH(cc) | DMA_TCD_CITER_ELINKYES_CITER_LE(CAN_RX_DMA_SIZE);
+		DMA->TCD[ch].BITER.ELINKYES = DMA_TCD_BITER_ELINKYES_ELINK_MASK | DMA_TCD_BITER_ELINKYES_LINKCH(cc) | DMA_TCD_BITER_ELINKYES_BITER(CAN_RX_DMA_SIZE);
+		DMA->TCD[ch].DLASTSGA	= (uint32_t)(-(int32_t)sizeof(CANRxDma[CANChannel].Buf));
+		DMA->TCD[ch].CSR			= DMA_TCD_CSR_INTHALF_MASK | DMA_TCD_CSR_INTMAJOR_MASK | DMA_TCD_CSR_MAJORELINK_MASK | DMA_TCD_CSR_MAJORLINKCH(cc);
+
+		DMAMUX->CHCFG[ch] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(CAN_RX_DMA_SOURCE + CANChannel);
+		DMA->CINT = ch;
+		DMA->SERQ = ch;
+		NVIC_ClearPendingIRQ((IRQn_Type)(DMA0_IRQn + ch));
+		NVIC_EnableIRQ((IRQn_Type)(DMA0_IRQn + ch));
+}
+
+/*************************************************************************
+*  函数名称：CAN_RxDmaDrain
+*  功能说明：把DMA已写完的帧转换后放入接收环形缓冲区, 须在关中断或中断中调用
+//	         已写入帧数取自计数通道, 与中断是否及时无关, 缓冲区恰好写满一圈也能与空区分
+//	         积压超过缓冲区深度时最旧的帧已被覆盖, 跳过并计入Overrun
+//	         时间戳按取出时刻回推, 帧在DMA缓冲区中停留须少于32767个位时间
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+static void CAN_RxDmaDrain(uint8_t CANChannel)
+{
+		CANRxDmaType	*pDma;
+		CANRxRingType	*pRing;
+		CANFrameType	*pFrame;
+		const CANDmaMBType	*pMB;
+		uint64_t			now;
+		uint32_t			cs,id,timer;
+		uint16_t			rd,wr,num,head,next;
+		uint8_t				dlc;
+
+		pDma	= &CANRxDma[CANChannel];
+		pRing = &CANRxRing[CANChannel];
+		timer = CANBaseTab[CANChannel]->TIMER;
+		now		= TimerGetUs();
+		//CITER从CAN_RX_DMA_COUNT_MOD递减到1后重装, 重装值对应0
+		wr = CAN_RX_DMA_COUNT_MOD - (DMA->TCD[CANChannel + CAN_RX_DMA_COUNT_CH].CITER.ELINKNO & DMA_TCD_CITER_ELINKNO_CITER_MASK);
+		if(wr >= CAN_RX_DMA_COUNT_MOD)	wr = 0;
+
+		rd	= pDma->Rd;
+		num = (wr + CAN_RX_DMA_COUNT_MOD - rd) % CAN_RX_DMA_COUNT_MOD;
+		if(num > CAN_RX_DMA_SIZE)
+		{
+				pDma->Overrun += num - CAN_RX_DMA_SIZE;
+				rd	= (wr + CAN_RX_DMA_COUNT_MOD - CAN_RX_DMA_SIZE) % CAN_RX_DMA_COUNT_MOD;
+				num = CAN_RX_DMA_SIZE;
+		}
+		head = pRing->Head;
+		while(num--)
+		{
+				pMB	= &pDma->Buf[rd % CAN_RX_DMA_SIZE];
+				cs	= pMB->CS;
+				dlc = CAN_CLASSIC_DLC(FLEXCAN_get_length(cs));
+				CANStat[CANChannel].RxFrames++;
+				CANStat[CANChannel].RxBits += CAN_FrameBits(CANChannel, (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0, dlc, 0, 0);
+				next = (head + 1) & (CAN_RX_RING_SIZE - 1);
+				if(next == pRing->Tail)
+				{
+						pRing->Overrun++;
+				}
+				else
+				{
+						pFrame = &pRing->Buf[head];
+						id = pMB->ID & FLEXCAN_MB_ID_EXT_MASK;
+						CAN_FRAME_WORD(pFrame, 0) = __REV(pMB->Data[0]);
+						CAN_FRAME_WORD(pFrame, 1) = __REV(pMB->Data[1]);
+						pFrame->IDE = (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0;
+						pFrame->ID	= pFrame->IDE ? id : (id >> FLEXCAN_MB_ID_STD_BIT_NO);
+						pFrame->DLC = dlc;
+						pFrame->Time = CAN_StampUs(CANChannel, cs & FLEXCAN_MB_CS_TIMESTAMP_MASK, timer, now);
+						head = next;
+				}
+				rd = (rd + 1) % CAN_RX_DMA_COUNT_MOD;
+		}
+		pRing->Head = head;
+		pDma->Rd = rd;
+}
+
+/*************************************************************************
+*  函数名称：CAN_RxDmaPoll
+*  功能说明：主循环读取前取走DMA缓冲区中的帧, 与DMA中断互斥
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+static void CAN_RxDmaPoll(uint8_t CANChannel)
+{
+		uint32_t	primask;
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		CAN_RxDmaDrain(CANChannel);
+		__set_PRIMASK(primask);
+}
+
+/*************************************************************************
+*  函数名称：CAN_RxDmaISR
+*  功能说明：DMA半满/满中断, 一次转换半个缓冲区
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+static void CAN_RxDmaISR(uint8_t CANChannel)
+{
+		DMA->CINT = CANChannel;
+		CAN_RxDmaDrain(CANChannel);
+}
+
+void DMA0_IRQHandler(void)
+{
+		uint32_t	t0 = TIMER_CYCLES();
+
+		CAN_RxDmaISR(CAN0CH);
+		CAN_IsrTime(CAN0CH, TIMER_CYCLES() - t0);
+}
+
+void DMA1_IRQHandler(void)
+{
+		uint32_t	t0 = TIMER_CYCLES();
+
+		CAN_RxDmaISR(CAN1CH);
+		CAN_IsrTime(CAN1CH, TIMER_CYCLES() - t0);
+}
+
+void DMA2_IRQHandler(void)
+{
+		uint32_t	t0 = TIMER_CYCLES();
+
+		CAN_RxDmaISR(CAN2CH);
+		CAN_IsrTime(CAN2CH, TIMER_CYCLES() - t0);
+}
+
+/*************************************************************************
+*  函数名称：CANRecBurst
+*  功能说明：批量接收, 一次取出接收缓冲区中的多帧
+//	         DMA模式下先取走DMA缓冲区中未满半区的帧, 低负载时不必等中断
+*  参数说明：CANChannel：CAN模块号
+//	         Frames: 接收帧数组
+//	         Max: 数组长度
+*  函数返回：取出的帧数
+*************************************************************************/
+uint8_t CANRecBurst(uint8_t CANChannel, CANFrameType *Frames, uint8_t Max)
+{
+		CANRxRingType	*pRing;
+		uint16_t		head,tail;
+		uint8_t			n;
+
+		if(CANLayout[CANChannel].RxDma)	CAN_RxDmaPoll(CANChannel);
+		pRing = &CANRxRing[CANChannel];
+		head	= pRing->Head;
+		tail	= pRing->Tail;
+
+		n = 0;
+		while((tail != head)&&(n < Max))
+		{
+				Frames[n++] = pRing->Buf[tail];
+				tail = (tail + 1) & (CAN_RX_RING_SIZE - 1);
+		}
+		pRing->Tail = tail;
+		return n;
+}
+
+/*************************************************************************
+*  函数名称：CANRecFrame
+*  功能说明：从接收环形缓冲区取出一帧
+*  参数说明：CANChannel：CAN模块号
+//	         Frame: 接收帧
+*  函数返回：0：成功，1：缓冲区空
+*************************************************************************/
+uint8_t CANRecFrame(uint8_t CANChannel, CANFrameType *Frame)
+{
+		CANRxRingType	*pRing;
+		uint16_t		tail;
+
+		if(CANLayout[CANChannel].RxDma)	CAN_RxDmaPoll(CANChannel);
+		pRing = &CANRxRing[CANChannel];
+		tail	= pRing->Tail;
+		if(tail == pRing->Head)	return 1;
+
+		*Frame = pRing->Buf[tail];
+		pRing->Tail = (tail + 1) & (CAN_RX_RING_SIZE - 1);
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANRxInject
+*  功能说明：把一帧放入接收环形缓冲区, 对上层与总线收到的帧相同, 用于报文回放
+//	         不计入总线统计; Time为0时取当前时刻
+*  参数说明：CANChannel：CAN模块号
+//	         Frame: 注入帧
+*  函数返回：0：成功，1：缓冲区满
+*************************************************************************/
+uint8_t CANRxInject(uint8_t CANChannel, const CANFrameType *Frame)
+{
+		CANRxRingType	*pRing;
+		uint64_t			now;
+		uint32_t			primask;
+		uint16_t			head,next;
+		uint8_t				ret;
+
+		if(CANChannel >= CAN_CHANNEL_NUM)	return 1;
+		pRing = &CANRxRing[CANChannel];
+		now = TimerGetUs();
+
+		//与接收中断同为写者, 关中断
+		primask = __get_PRIMASK();
+		__disable_irq();
+		head = pRing->Head;
+		next = (head + 1) & (CAN_RX_RING_SIZE - 1);
+		if(next == pRing->Tail)
+		{
+				pRing->Overrun++;
+				ret = 1;
+		}
+		else
+		{
+				pRing->Buf[head] = *Frame;
+				pRing->Buf[head].DLC = CAN_CLASSIC_DLC(Frame->DLC);
+				if(Frame->Time == 0)	pRing->Buf[head].Time = now;
+				pRing->Head = next;
+				ret = 0;
+		}
+		__set_PRIMASK(primask);
+		return ret;
+}
+
+/*************************************************************************
+*  函数名称：接收数据
+*  功能说明：从接收环形缓冲区取出一帧
+*  参数说明：CANChannel：CAN模块号
+*  函数返回：0：成功，1：失败
+//	         id: ID号
+//	         lenght：数据长度
+//	         Data: 接收数据缓冲区
 *************************************************************************/
 uint8_t CANRecData(uint8_t CANChannel, uint32_t *id,uint8_t *Datalenght,uint8_t *Data)
+{
+		CANFrameType	Frame;
+		uint8_t				i;
+
+		if(CANRecFrame(CANChannel, &Frame))	return 1;
+
+		*id = Frame.ID;
+		*Datalenght = Frame.DLC;
+		for(i=0;i<8;i++)	Data[i] = Frame.Data[i];
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANGetRxOverrun
+*  功能说明：读取接收丢帧数(软件缓冲区满 + 硬件FIFO溢出 + DMA缓冲区覆盖, FD模式含FD缓冲区)
+*  参数说明：CANChannel：CAN模块号
+*  函数返回：丢帧计数
+*************************************************************************/
+uint32_t CANGetRxOverrun(uint8_t CANChannel)
+{
+		uint32_t	n;
+
+		n = CANRxRing[CANChannel].Overrun + CANRxRing[CANChannel].FifoOverflow;
+		if(CANLayout[CANChannel].RxDma)	n += CANRxDma[CANChannel].Overrun;
+		if(CANLayout[CANChannel].FD)	n += CANFDRxRing.Overrun;
+		return n;
+}
+
+/*************************************************************************
+*  函数名称：CAN_RxISR
+*  功能说明：Rx FIFO 中断处理, 一次取空FIFO中的全部帧; FD模式转 CAN_FDRxISR, DMA模式不处理
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+void CAN_RxISR(uint8_t CANChannel)
 {
     CAN_MemMapPtr CANBaseAdd;
-		MailBox		*pMBox;
-    
+		volatile uint32_t	*pMB;
+		CANRxRingType	*pRing;
+		CANFrameType	*pFrame;
+		uint64_t			now;
+		uint32_t			cs,id,timer;
+		uint16_t			head,next;
+		uint8_t				dlc;
 
-     if(CANChannel == 0)
-        CANBaseAdd = CAN0;  
-    else if(CANChannel == 1)
-        CANBaseAdd = CAN1;
-    else if(CANChannel == 2)
-        CANBaseAdd = CAN2;
- 
-	  pMBox	= (MailBox *)(CANBaseAdd->RAMn);
+		if(CANLayout[CANChannel].FD)
+		{
+				CAN_FDRxISR(CANChannel);
+				return;
+		}
+		//DMA模式FIFO由DMA读取
+		if(CANLayout[CANChannel].RxDma)	return;
 
-		if((CANBaseAdd->IFLAG1 & CAN_IFLAG1_BUF5I_MASK)==0)	return 1;
+		CANBaseAdd = CANBaseTab[CANChannel];
+		pMB		= CAN_MB_WORDS(CANBaseAdd, 0);		// Rx FIFO 输出在MB0
+		pRing = &CANRxRing[CANChannel];
+		timer = CANBaseAdd->TIMER;
+		now		= TimerGetUs();
 
-		*id = pMBox->RxMBox[0].ID;
-    if(pMBox->RxMBox[0].IDE==0) *id >>= 18;
+		if(CANBaseAdd->IFLAG1 & CAN_IFLAG1_BUF7I_MASK)
+		{
+				pRing->FifoOverflow++;
+				CANBaseAdd->IFLAG1 = CAN_IFLAG1_BUF7I_MASK | CAN_IFLAG1_BUF6I_MASK;
+		}
 
-		
-		*Datalenght = pMBox->RxMBox[0].DLC;
-		
-    Data[0] = pMBox->RxMBox[0].Data[3];
-    Data[1] = pMBox->RxMBox[0].Data[2];
-    Data[2] = pMBox->RxMBox[0].Data[1];
-    Data[3] = pMBox->RxMBox[0].Data[0];
-    Data[4] = pMBox->RxMBox[0].Data[7];
-    Data[5] = pMBox->RxMBox[0].Data[6];
-    Data[6] = pMBox->RxMBox[0].Data[5];
-    Data[7] = pMBox->RxMBox[0].Data[4];
-
-		CANBaseAdd->IFLAG1 |= CAN_IFLAG1_BUF5I_MASK;
+		head = pRing->Head;
+		while(CANBaseAdd->IFLAG1 & CAN_IFLAG1_BUF5I_MASK)
+		{
+				//每个字只读一次
+				cs = pMB[0];
+				CANStat[CANChannel].RxFrames++;
+				dlc = CAN_CLASSIC_DLC(FLEXCAN_get_length(cs));
+				CANStat[CANChannel].RxBits += CAN_FrameBits(CANChannel, (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0, dlc, 0, 0);
+				next = (head + 1) & (CAN_RX_RING_SIZE - 1);
+				if(next == pRing->Tail)
+				{
+						pRing->Overrun++;
+				}
+				else
+				{
+						pFrame = &pRing->Buf[head];
+						id = pMB[1] & FLEXCAN_MB_ID_EXT_MASK;
+						CAN_FRAME_WORD(pFrame, 0) = __REV(pMB[2]);
+						CAN_FRAME_WORD(pFrame, 1) = __REV(pMB[3]);
+						pFrame->IDE = (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0;
+						pFrame->ID	= pFrame->IDE ? id : (id >> FLEXCAN_MB_ID_STD_BIT_NO);
+						pFrame->DLC = dlc;
+						pFrame->Time = CAN_StampUs(CANChannel, cs & FLEXCAN_MB_CS_TIMESTAMP_MASK, timer, now);
+						head = next;
+				}
+				//写1清零, 只清BUF5I, FIFO移出下一帧
+				CANBaseAdd->IFLAG1 = CAN_IFLAG1_BUF5I_MASK;
+		}
+		pRing->Head = head;
+}
+
+/*************************************************************************
+*  函数名称：CAN_FDRxISR
+*  功能说明：FD模式接收MailBox中断处理, 经典帧进 CANRxRing, FD帧进 CANFDRxRing
+//	         读CS锁定MailBox, 读TIMER解锁, MailBox保持FULL即可再次接收
+*  参数说明：CANChannel：CAN模块号
+*************************************************************************/
+static void CAN_FDRxISR(uint8_t CANChannel)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		volatile uint32_t	*pMB;
+		CANRxRingType	*pRing;
+		CANFDRxRingType	*pFDRing;
+		CANFrameType	*pFrame;
+		CANFDFrameType	*pFDFrame;
+		uint64_t			now;
+		uint32_t			flags,cs,id,timer;
+		uint16_t			head,next;
+		uint8_t				mb,i,len;
+
+		CANBaseAdd = CANBaseTab[CANChannel];
+		pRing		= &CANRxRing[CANChannel];
+		pFDRing = &CANFDRxRing;
+
+		//按MailBox编号顺序取, 取完再查一次, 期间到达的帧也一并处理
+		while((flags = CANBaseAdd->IFLAG1 & ((1uL<<CAN_FD_RX_MB_NUM) - 1)) != 0)
+		{
+				timer = CANBaseAdd->TIMER;
+				now		= TimerGetUs();
+				for(mb=0;mb<CAN_FD_RX_MB_NUM;mb++)
+				{
+						if((flags & (1uL<<mb)) == 0)	continue;
+
+						pMB = CAN_MB_ADDR(CANBaseAdd, CANChannel, mb);
+						cs = pMB[0];
+						id = pMB[1] & FLEXCAN_MB_ID_EXT_MASK;
+						len = CANDlcLenTab[FLEXCAN_get_length(cs)];
+						if(((cs & FLEXCAN_MB_CS_EDL) == 0)&&(len > 8))	len = 8;
+						CANStat[CANChannel].RxFrames++;
+						CANStat[CANChannel].RxBits += CAN_FrameBits(CANChannel, (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0, len,
+																												(cs & FLEXCAN_MB_CS_EDL) ? 1 : 0, (cs & FLEXCAN_MB_CS_BRS) ? 1 : 0);
+						if(cs & FLEXCAN_MB_CS_EDL)
+						{
+								head = pFDRing->Head;
+								next = (head + 1) & (CAN_FD_RX_RING_SIZE - 1);
+								if(next == pFDRing->Tail)
+								{
+										pFDRing->Overrun++;
+								}
+								else
+								{
+										pFDFrame = &pFDRing->Buf[head];
+										for(i=0;i<(len + 3) / 4;i++)
+												((uint32_t *)pFDFrame->Data)[i] = __REV(pMB[2+i]);
+										pFDFrame->IDE = (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0;
+										pFDFrame->ID	= pFDFrame->IDE ? id : (id >> FLEXCAN_MB_ID_STD_BIT_NO);
+										pFDFrame->Len = len;
+										pFDFrame->BRS = (cs & FLEXCAN_MB_CS_BRS) ? 1 : 0;
+										pFDFrame->Time = CAN_StampUs(CANChannel, cs & FLEXCAN_MB_CS_TIMESTAMP_MASK, timer, now);
+										pFDRing->Head = next;
+								}
+						}
+						else
+						{
+								head = pRing->Head;
+								next = (head + 1) & (CAN_RX_RING_SIZE - 1);
+								if(next == pRing->Tail)
+								{
+										pRing->Overrun++;
+								}
+								else
+								{
+										pFrame = &pRing->Buf[head];
+										CAN_FRAME_WORD(pFrame, 0) = __REV(pMB[2]);
+										CAN_FRAME_WORD(pFrame, 1) = __REV(pMB[3]);
+										pFrame->IDE = (cs & FLEXCAN_MB_CS_IDE) ? 1 : 0;
+										pFrame->ID	= pFrame->IDE ? id : (id >> FLEXCAN_MB_ID_STD_BIT_NO);
+										pFrame->DLC = len;
+										pFrame->Time = CAN_StampUs(CANChannel, cs & FLEXCAN_MB_CS_TIMESTAMP_MASK, timer, now);
+										pRing->Head = next;
+								}
+						}
+						(void)CANBaseAdd->TIMER;
+						CANBaseAdd->IFLAG1 = 1uL<<mb;
+				}
+		}
+}
+
+void CAN0_ORed_0_15_MB_IRQHandler(void)
+{
+		uint32_t	t0 = TIMER_CYCLES();
+
+		CAN_RxISR(CAN0CH);
+		CAN_TxISR(CAN0CH);
+		CAN_IsrTime(CAN0CH, TIMER_CYCLES() - t0);
+}
+
+void CAN1_ORed_0_15_MB_IRQHandler(void)
+{
+		uint32_t	t0 = TIMER_CYCLES();
+
+		CAN_RxISR(CAN1CH);
+		CAN_TxISR(CAN1CH);
+		CAN_IsrTime(CAN1CH, TIMER_CYCLES() - t0);
+}
+
+void CAN2_ORed_0_15_MB_IRQHandler(void)
+{
+		uint32_t	t0 = TIMER_CYCLES();
+
+		CAN_RxISR(CAN2CH);
+		CAN_TxISR(CAN2CH);
+		CAN_IsrTime(CAN2CH, TIMER_CYCLES() - t0);
+}
+
+
+/*************************************************************************
+*  函数名称：CANGetQueueDepth
+*  功能说明：读取通道待处理的帧数: 接收缓冲区 + 发送队列, FD模式含FD收发缓冲区
+//	         供调频判断负载
+*************************************************************************/
+uint16_t CANGetQueueDepth(uint8_t CANChannel)
+{
+		uint16_t	n;
+
+		n = (CANRxRing[CANChannel].Head - CANRxRing[CANChannel].Tail) & (CAN_RX_RING_SIZE - 1);
+		n += CANTxQueue[CANChannel].Num;
+		if(CANLayout[CANChannel].FD)
+		{
+				n += (CANFDRxRing.Head - CANFDRxRing.Tail) & (CAN_FD_RX_RING_SIZE - 1);
+				n += (CANFDTxQueue.Head - CANFDTxQueue.Tail) & (CAN_FD_TX_QUEUE_SIZE - 1);
+		}
+		return n;
+}
+
+/*************************************************************************
+*  函数名称：CAN_PowerRetime
+*  功能说明：等当前帧结束后关闭模块, 换协议引擎时钟源并按新时钟写入位时间, 完成后停在冻结模式;
+//	         冻结中不收发, 此后切换系统时钟也不会以错误的位时间上总线, 由CAN_PowerThaw恢复收发
+*  参数说明：ch：通道号
+//	         ClkSrc/PeHz：新时钟, 见CAN_PowerClock
+*  函数返回：0：成功；1：位时间无解或模块未应答, 模块和CANLayout不变
+*************************************************************************/
+static uint8_t CAN_PowerRetime(uint8_t ch, uint8_t ClkSrc, uint32_t PeHz)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		CANLayoutType		*pLayout,Layout;
+		CANBitTimingType	Timing,DataTiming;
+		uint32_t				n,mdis;
+		uint8_t					Cbt,Tdc;
+
+		pLayout = &CANLayout[ch];
+		Layout = *pLayout;
+		if(CAN_SolveTiming(&Layout, PeHz, pLayout->BaudKHz, pLayout->DataKHz,
+											 &Timing, &DataTiming, &Cbt, &Tdc))	return 1;
+
+		CANBaseAdd = CANBaseTab[ch];
+		mdis = CANBaseAdd->MCR & CAN_MCR_MDIS_MASK;
+		CANBaseAdd->MCR |= CAN_MCR_MDIS_MASK;
+		for(n=0;(n<CLOCK_WAIT_POLLS)&&((CANBaseAdd->MCR & CAN_MCR_LPMACK_MASK) == 0);n++);
+		if(n == CLOCK_WAIT_POLLS)
+		{
+				if(mdis == 0)	CANBaseAdd->MCR &= ~CAN_MCR_MDIS_MASK;
+				return 1;
+		}
+
+		//CLKSRC只能在关闭时写; 退出关闭直接进入冻结模式, 写入新位时间
+		if(ClkSrc)	CANBaseAdd->CTRL1 |= CAN_CTRL1_CLKSRC_MASK;
+		else				CANBaseAdd->CTRL1 &= ~CAN_CTRL1_CLKSRC_MASK;
+		CANBaseAdd->MCR = (CANBaseAdd->MCR & ~CAN_MCR_MDIS_MASK) | CAN_MCR_FRZ_MASK | CAN_MCR_HALT_MASK;
+		while(!(CAN_MCR_FRZACK_MASK & CANBaseAdd->MCR));
+		CAN_WriteTiming(CANBaseAdd, Cbt, &Timing, pLayout->FD ? &DataTiming : 0);
+		if(pLayout->FD)
+				CANBaseAdd->FDCTRL = (CANBaseAdd->FDCTRL & ~(CAN_FDCTRL_TDCEN_MASK | CAN_FDCTRL_TDCOFF_MASK))
+													 | (Tdc ? (CAN_FDCTRL_TDCEN_MASK | CAN_FDCTRL_TDCOFF(Tdc)) : 0);
+		*pLayout = Layout;
+		return 0;
+}
+
+//退出冻结模式, 发出冻结或关闭期间排队的帧
+static void CAN_PowerThaw(uint8_t ch)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		uint32_t			primask;
+
+		CANBaseAdd = CANBaseTab[ch];
+		CANBaseAdd->MCR &= ~(CAN_MCR_FRZ_MASK);
+		while( CANBaseAdd->MCR & CAN_MCR_FRZACK_MASK);
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		CAN_TxKick(ch);
+		if(CANLayout[ch].FD)	CAN_FDTxKick(ch);
+		__set_PRIMASK(primask);
+}
+
+/*************************************************************************
+*  函数名称：CAN_PowerResume
+*  功能说明：前Num个通道按运行模式Mode的协议引擎时钟恢复收发, 撤销RX引脚唤醒中断
+//	         已关闭、停在冻结模式或时钟与Mode不符的通道重新求解位时间; 无解时保持关闭
+*************************************************************************/
+static void CAN_PowerResume(uint8_t Num, uint8_t Mode)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		CANLayoutType		*pLayout;
+		PORT_Type				*pPort;
+		uint32_t				PeHz;
+		uint8_t					ch,pin,ClkSrc;
+
+		for(ch=0;ch<Num;ch++)
+		{
+				pLayout = &CANLayout[ch];
+				if(pLayout->BaudKHz == 0)	continue;
+				pin = CANRxPinTab[ch];
+				pPort = CANPortTab[pin >> 5];
+				pPort->PCR[pin & 31] &= ~PORT_PCR_IRQC_MASK;
+
+				CANBaseAdd = CANBaseTab[ch];
+				ClkSrc = CAN_PowerClock(pLayout->FD, Mode, &PeHz);
+				if((CANBaseAdd->MCR & CAN_MCR_MDIS_MASK)||(pLayout->PeHz != PeHz)||
+					 (((CANBaseAdd->CTRL1 & CAN_CTRL1_CLKSRC_MASK) ? 1 : 0) != ClkSrc))
+				{
+						if(CAN_PowerRetime(ch, ClkSrc, PeHz))	continue;
+				}
+				if(CANBaseAdd->MCR & CAN_MCR_FRZ_MASK)	CAN_PowerThaw(ch);
+		}
+}
+
+/*************************************************************************
+*  函数名称：CANPowerVeto
+*  功能说明：查询CANPowerNotify是否会拒绝切换到Mode, 不改动任何状态, 供调频预先判断
+//	         HSRUN: 各通道按CAN_PowerClock给出的时钟(FD通道为SOSCDIV2)求解位时间, 有无解的通道时拒绝
+//	         VLPR不拒绝: 位时间无解的通道关闭, 靠RX引脚唤醒
+*  参数说明：Mode：目标模式
+*  函数返回：0：不拒绝；1：拒绝
+*************************************************************************/
+uint8_t CANPowerVeto(uint8_t Mode)
+{
+		CANLayoutType			Layout;
+		CANBitTimingType	Timing,DataTiming;
+		uint32_t					PeHz;
+		uint8_t						ch,Cbt,Tdc;
+
+		if(Mode != CLOCK_MODE_HSRUN)	return 0;
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				Layout = CANLayout[ch];
+				if(Layout.BaudKHz == 0)	continue;
+				CAN_PowerClock(Layout.FD, Mode, &PeHz);
+				if(CAN_SolveTiming(&Layout, PeHz, Layout.BaudKHz, Layout.DataKHz, &Timing, &DataTiming, &Cbt, &Tdc))	return 1;
+		}
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：CANPowerNotify
+*  功能说明：运行模式切换回调, 登记在PowerInit的回调表中
+//	         HSRUN: 按CANPowerVeto拒绝; 切换前FD通道改用SOSCDIV2, 不随SYS_CLK升到112MHz
+//	         VLPR: SOSC关闭, 各通道切换前改用SYS_CLK并按SIRC分频后的时钟写好位时间, 停在冻结模式,
+//	               切换后恢复收发, 唤醒帧照常收到; 位时间无解的通道(如2M数据段)关闭模块;
+//	               另开RX引脚下降沿中断, 由CANPowerWake通知调用者退出VLPR
+//	         VLPR->RUN: 切换前关闭各模块, 免得SYS_CLK变化时以错误的位时间收发, 切换后按RUN时钟恢复
+*  参数说明：Event：POWER_BEFORE/POWER_AFTER
+//	         Mode：目标模式/切换后模式
+*  函数返回：0：同意；1：拒绝
+*************************************************************************/
+uint8_t CANPowerNotify(uint8_t Event, uint8_t Mode)
+{
+    CAN_MemMapPtr CANBaseAdd;
+		PORT_Type		*pPort;
+		uint32_t		n,PeHz;
+		uint8_t			ch,pin,ClkSrc,off;
+
+		if(Event == POWER_AFTER)
+		{
+				CANPowerMode = Mode;
+				if(Mode != CLOCK_MODE_VLPR)
+				{
+						CAN_PowerResume(CAN_CHANNEL_NUM, Mode);
+						return 0;
+				}
+				for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+				{
+						CANBaseAdd = CANBaseTab[ch];
+						if((CANLayout[ch].BaudKHz != 0)&&((CANBaseAdd->MCR & (CAN_MCR_MDIS_MASK | CAN_MCR_FRZ_MASK)) == CAN_MCR_FRZ_MASK))
+								CAN_PowerThaw(ch);
+				}
+				return 0;
+		}
+
+		if(Mode == CLOCK_MODE_HSRUN)
+		{
+				if(CANPowerVeto(Mode))	return 1;
+				//SOSCDIV2在切换前后不变, 换好时钟即可恢复收发
+				for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+				{
+						if(CANLayout[ch].BaudKHz == 0)	continue;
+						ClkSrc = CAN_PowerClock(CANLayout[ch].FD, Mode, &PeHz);
+						if(CANLayout[ch].PeHz == PeHz)	continue;
+						if(CAN_PowerRetime(ch, ClkSrc, PeHz))
+						{
+								CAN_PowerResume(ch, CANPowerMode);
+								return 1;
+						}
+						CAN_PowerThaw(ch);
+				}
+				return 0;
+		}
+
+		if(Mode != CLOCK_MODE_VLPR)
+		{
+				if(CANPowerMode != CLOCK_MODE_VLPR)	return 0;
+				//VLPR下用SYS_CLK的通道先关闭, 未应答时重新打开已关闭的通道并拒绝
+				off = 0;
+				for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+				{
+						CANBaseAdd = CANBaseTab[ch];
+						if((CANLayout[ch].BaudKHz == 0)||(CANBaseAdd->MCR & CAN_MCR_MDIS_MASK))	continue;
+						CANBaseAdd->MCR |= CAN_MCR_MDIS_MASK;
+						off |= 1u<<ch;
+						for(n=0;(n<CLOCK_WAIT_POLLS)&&((CANBaseAdd->MCR & CAN_MCR_LPMACK_MASK) == 0);n++);
+						if(n < CLOCK_WAIT_POLLS)	continue;
+						for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+						{
+								if(off & (1u<<ch))	CANBaseTab[ch]->MCR &= ~CAN_MCR_MDIS_MASK;
+						}
+						return 1;
+				}
+				return 0;
+		}
+
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				if(CANLayout[ch].BaudKHz == 0)	continue;
+				ClkSrc = CAN_PowerClock(CANLayout[ch].FD, Mode, &PeHz);
+				if(CAN_PowerRetime(ch, ClkSrc, PeHz) == 0)	continue;
+				CANBaseAdd = CANBaseTab[ch];
+				CANBaseAdd->MCR |= CAN_MCR_MDIS_MASK;
+				for(n=0;(n<CLOCK_WAIT_POLLS)&&((CANBaseAdd->MCR & CAN_MCR_LPMACK_MASK) == 0);n++);
+				if(n == CLOCK_WAIT_POLLS)
+				{
+						CAN_PowerResume(ch + 1, CANPowerMode);
+						return 1;
+				}
+		}
+
+		CANWake = 0;
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				if(CANLayout[ch].BaudKHz == 0)	continue;
+				pin = CANRxPinTab[ch];
+				pPort = CANPortTab[pin >> 5];
+				pPort->PCR[pin & 31] = (pPort->PCR[pin & 31] & ~PORT_PCR_IRQC_MASK) | PORT_PCR_ISF_MASK | PORT_PCR_IRQC(0x0A);
+				NVIC_ClearPendingIRQ(CANPortIrqTab[pin >> 5]);
+				NVIC_EnableIRQ(CANPortIrqTab[pin >> 5]);
+		}
 		return 0;
 }
 
+/*************************************************************************
+*  函数名称：CANPowerWake
+*  功能说明：读取并清除VLPR下的总线唤醒标志
+*  函数返回：位i: CANi 的RX引脚有下降沿
+*************************************************************************/
+uint8_t CANPowerWake(void)
+{
+		uint32_t	primask;
+		uint8_t		wake;
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		wake = CANWake;
+		CANWake = 0;
+		__set_PRIMASK(primask);
+		return wake;
+}
+
+//RX引脚中断: 记录唤醒并撤销中断, 总线上每个下降沿都会触发
+static void CAN_WakeISR(uint8_t Port)
+{
+		PORT_Type	*pPort;
+		uint8_t		ch,pin;
+
+		pPort = CANPortTab[Port];
+		for(ch=0;ch<CAN_CHANNEL_NUM;ch++)
+		{
+				pin = CANRxPinTab[ch];
+				if(((pin >> 5) != Port)||((pPort->PCR[pin & 31] & PORT_PCR_ISF_MASK) == 0))	continue;
+				pPort->PCR[pin & 31] &= ~PORT_PCR_IRQC_MASK;
+				CANWake |= 1u<<ch;
+		}
+}
+
+void PORTA_IRQHandler(void)
+{
+		CAN_WakeISR(0);
+}
+
+void PORTB_IRQHandler(void)
+{
+		CAN_WakeISR(1);
+}
+
+void PORTC_IRQHandler(void)
+{
+		CAN_WakeISR(2);
+}
+
+void PORTE_IRQHandler(void)
+{
+		CAN_WakeISR(4);
+}
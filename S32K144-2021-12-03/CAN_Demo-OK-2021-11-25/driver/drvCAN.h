@@ -1,20 +1,23 @@
 #ifndef __DRV_CAN_H
 #define __DRV_CAN_H
 
-//ĻIRQ
+#include "drvCANFilter.h"
+#include "drvClock.h"
+
+//报文缓冲IRQ号
 #define CAN0_Message_buffer_irq_no 29
 #define CAN1_Message_buffer_irq_no 37
 
-//CANͨ
+//CAN通道号
 #define CAN0CH 0
 #define CAN1CH 1
 #define CAN2CH 2
 
-//MBs
-#define	FLEXCAN_RX_MB_START	8 //MBĿʼ 
-#define	FLEXCAN_RX_MB_END	9 //MBĽβ
+//接收MBs索引定义
+#define	FLEXCAN_RX_MB_START	8 //接收MB的开始 
+#define	FLEXCAN_RX_MB_END	9 //接收MB的结尾
 
-//MBs
+//发送MBs索引定义
 #define FLEXCAN_TX_MB_START	10 //(FLEXCAN_RX_MB_END+1)
 #define	FLEXCAN_TX_MB_END	(NUMBER_OF_MB-1)
 
@@ -30,7 +33,7 @@
 
 #define NUMBER_OF_MB 16
 
-//CANĽṹλ
+//CAN报文结构位定义
 #define	CAN_MSG_IDE_MASK	(0x10000000L)
 #define CAN_MSG_IDE_BIT_NO	(28)
 #define CAN_MSG_ID_EXTENDED	(CAN_MSG_ID_MASK)
@@ -40,7 +43,7 @@
 #define CAN_MSG_TYPE_DATA_FRAME	(CAN_MSG_TYPE_MASK)
 #define CAN_MSG_TYPE_REMOTE_FRAME	(0)
 
-//FELEX_MB_CSλͺ
+//FELEX_MB_CS的位定义和宏
 #define FLEXCAN_MB_CS_TIMESTAMP(x)    (((x)&0x0000FFFF)<<0)
 #define FLEXCAN_MB_CS_TIMESTAMP_MASK  (0x0000FFFFL)
 #define FLEXCAN_MB_CS_LENGTH(x)       (((x)&0x0000000F)<<16)
@@ -48,6 +51,9 @@
 #define FLEXCAN_MB_CS_IDE             (0x00200000)
 #define FLEXCAN_MB_CS_SRR             (0x00400000)
 #define FLEXCAN_MB_CS_CODE(x)         (((x)&0x0000000F)<<24)
+#define FLEXCAN_MB_CS_ESI             (0x20000000L)
+#define FLEXCAN_MB_CS_BRS             (0x40000000L)
+#define FLEXCAN_MB_CS_EDL             (0x80000000L)
 #define FLEXCAN_MB_CS_CODE_MASK	      (0x0F000000L)
 #define FLEXCAN_MB_CS_DLC_MASK	      (0x000F0000L)
 #define FLEXCAN_MB_CODE_RX_INACTIVE	(0)
@@ -67,9 +73,11 @@
 #define FLEXCAN_MB_CODE_TX_RESPONSE_TEMPO	(0x0E)
 #define FLEXCAN_get_code(cs)				(((cs) & FLEXCAN_MB_CS_CODE_MASK)>>24)
 #define FLEXCAN_get_length(cs)      (((cs) & FLEXCAN_MB_CS_DLC_MASK)>>16)
+//经典帧DLC 9~15 仍只有8字节数据, 接收时截到8, 防止按DLC拷贝越过Data[8]
+#define CAN_CLASSIC_DLC(dlc)				(((dlc) > 8) ? 8 : (dlc))
 
 
-//FLEXCAN_MB_IDλͺ
+//FLEXCAN_MB_ID的位定义和宏
 #define FLEXCAN_MB_ID_STD_MASK		   (0x1FFC0000L)
 #define FLEXCAN_MB_ID_EXT_MASK		   (0x1FFFFFFFL)
 #define FLEXCAN_MB_ID_IDEXT(x)        (((x)&0x0003FFFF)<<0)
@@ -79,13 +87,13 @@
 #define FLEXCAN_MB_ID_STD_BIT_NO	  (18)
 #define FLEXCAN_MB_ID_EXT_BIT_NO	  (0)
 
-//FLEXCAN_MB_WORD0λͺ
+//FLEXCAN_MB_WORD0的位定义和宏
 #define FLEXCAN_MB_WORD0_DATA3(x)     (((x)&0x000000FF)<<0)
 #define FLEXCAN_MB_WORD0_DATA2(x)     (((x)&0x000000FF)<<8)
 #define FLEXCAN_MB_WORD0_DATA1(x)     (((x)&0x000000FF)<<16)
 #define FLEXCAN_MB_WORD0_DATA0(x)     (((x)&0x000000FF)<<24)
 
-//FLEXCAN_MB_WORD1λͺ
+//FLEXCAN_MB_WORD1的位定义和宏
 #define FLEXCAN_MB_WORD1_DATA7(x)     (((x)&0x000000FF)<<0)
 #define FLEXCAN_MB_WORD1_DATA6(x)     (((x)&0x000000FF)<<8)
 #define FLEXCAN_MB_WORD1_DATA5(x)     (((x)&0x000000FF)<<16)
@@ -136,10 +144,161 @@ typedef	struct
 
 }		MailBox;
 
+//CAN协议引擎时钟(CLKSRC=0, SOSCDIV2 8MHz), 位时间据此求解
+#define CAN_PE_CLOCK_HZ		CLOCK_SOSCDIV2_HZ
+//目标采样点, 千分比
+#define CAN_SAMPLE_POINT	875
+
+//CAN通道数
+#define CAN_CHANNEL_NUM		3
+
+//FlexCAN基地址表, 默认为芯片上的CAN0~2; 可在编译选项中重定义, 把驱动接到别的寄存器实体上
+#ifndef CAN_BASE_TABLE
+#define CAN_BASE_TABLE		CAN_BASE_PTRS
+#endif
+
+//CAN FD, S32K144只有CAN0支持
+#define CAN_FD_CHANNEL							CAN0CH
+//FD协议引擎时钟用SYS_CLK(CLKSRC=1), 8MHz晶振满足不了2M数据段的Tq数; SYS_CLK超过CLOCK_CAN_PE_MAX_HZ
+//的模式(HSRUN)下改用晶振, 晶振下数据段无解时拒绝该模式; 各模式的时钟见drvCAN.c的CAN_PowerClock
+//数据段目标采样点, 千分比
+#define CAN_FD_DATA_SAMPLE_POINT		750
+//数据段波特率高于此值(kbit/s)时启用发送延时补偿, 位时间按TDCOFF上限求解, 放不下则CANInitFD失败
+#define CAN_FD_TDC_MIN_KHZ					1000
+//64字节数据MailBox占18个字(CS、ID + 16字数据), 512字节RAM共7个
+#define CAN_FD_MB_WORDS							18
+#define CAN_FD_MB_NUM								7
+//FD模式不能用Rx FIFO, 改用独立接收MailBox: MB0~1标准帧, MB2~3扩展帧, ID全不屏蔽
+#define CAN_FD_RX_MB_EXT_NO					2
+#define CAN_FD_RX_MB_NUM						4
+//MB4~5: 经典帧优先级发送队列; MB6: FD帧发送
+#define CAN_FD_TX_MB_START_NO				4
+#define CAN_FD_TX_MB_NUM						2
+#define CAN_FD_TX_FD_MB_NO					6
+//FD帧接收缓冲区、发送队列深度(帧), 必须为2的幂
+#define CAN_FD_RX_RING_SIZE					8
+#define CAN_FD_TX_QUEUE_SIZE				8
+//长度不是合法FD长度时的填充字节
+#define CAN_FD_PAD_BYTE							0xCC
+
+//发送MailBox固定在MB8~15, Rx FIFO过滤表只能占MB6~7, 即最多8个过滤元素
+#define CAN_RX_FILTER_RFFN_MAX	0
+
+//TxMBox[0~7]对应MB8~15
+#define FLEXCAN_TX_MB_START_NO	8
+#define CAN_TX_MB_FLAGS					(0xFFuL<<FLEXCAN_TX_MB_START_NO)
+
+//软件发送队列深度(帧)
+#define CAN_TX_QUEUE_SIZE		32
+//1: MailBox全忙时中止低优先级帧, 让位于队列中更高优先级的帧
+#define CAN_TX_ABORT_ENABLE	1
+//最早提交的帧等待超过此时间(us)后不再按ID排队: 先装入MailBox, 发出前不装入其它帧也不中止,
+//满负载时低优先级帧的发送延时不超过此值加几帧时间; 0: 不启用
+#define CAN_TX_AGE_US				20000
+
+//接收环形缓冲区深度(帧), 必须为2的幂
+#define CAN_RX_RING_SIZE	64
+
+//用eDMA搬运Rx FIFO的通道, 位i对应CANi; FD模式无Rx FIFO, 不使用DMA
+#define CAN_RX_DMA_CHANNELS		((1u<<CAN1CH)|(1u<<CAN2CH))
+//CANi 使用 DMA通道i, DMAMUX请求源 FlexCAN0~2 = 54~56
+#define CAN_RX_DMA_SOURCE			54
+//DMA环形缓冲区深度(帧), 半满、满时各中断一次
+#define CAN_RX_DMA_SIZE				32
+//CANi 的帧计数DMA通道 = i + CAN_RX_DMA_COUNT_CH, 计数模值为缓冲区深度的整数倍且不超过0x7FFF
+#define CAN_RX_DMA_COUNT_CH		4
+#define CAN_RX_DMA_COUNT_MOD	(CAN_RX_DMA_SIZE * 1023)
+
+//应用层CAN帧, Data按总线字节顺序存放, 紧跟ID保证4字节对齐以便整字访问
+typedef	struct
+{
+			uint32_t	ID;
+			uint8_t		Data[8];
+			uint8_t		IDE;		//1:扩展帧 0:标准帧
+			uint8_t		DLC;
+			uint64_t	Time;		//us时间戳(TimerGetUs), 接收帧为帧在总线上的时刻,
+												//发送帧为0时入队时刻, 转发帧保留接收时刻
+
+}		CANFrameType;
+
+//CAN FD帧, Data按总线字节顺序存放
+typedef	struct
+{
+			uint32_t	ID;
+			uint8_t		Data[64];
+			uint8_t		IDE;		//1:扩展帧 0:标准帧
+			uint8_t		Len;		//数据字节数 0~64, 非法长度发送时向上补齐到合法长度
+			uint8_t		BRS;		//1:数据段切换到高波特率
+			uint64_t	Time;		//同 CANFrameType.Time
+
+}		CANFDFrameType;
+
+//发送延时直方图: 第i格为 [US0<<(i-1), US0<<i), 第0格从0开始, 最后一格不设上限
+#define CAN_LATENCY_HIST_NUM		8
+#define CAN_LATENCY_HIST_US0		64
+//逐帧的发送延时(us), 在发送中断中调用; 默认为空, 主机上的回放工具据此统计分位数
+#ifndef CAN_LATENCY_HOOK
+#define CAN_LATENCY_HOOK(ch,us)
+#endif
+
+//发送延时统计, 单位us: 发送完成时刻 - Frame.Time, 对转发帧即网关入口到出口延时
+typedef	struct
+{
+			uint32_t	Last;
+			uint32_t	Min;
+			uint32_t	Max;
+			uint32_t	Num;
+			uint64_t	Sum;
+			uint32_t	Hist[CAN_LATENCY_HIST_NUM];
+
+}		CANLatencyType;
+
+//通道统计, 帧数、位数为累计值(回绕后按差值使用), 中断耗时在读取时可清零
+typedef	struct
+{
+			uint32_t	Bitrate;			//仲裁段实际波特率
+			uint32_t	RxFrames;
+			uint32_t	TxFrames;
+			uint32_t	RxBits;				//按DLC和最坏位填充估计的总线位数, FD数据段折算为仲裁段位
+			uint32_t	TxBits;
+			uint32_t	TxReject;			//发送队列满未入队的帧
+			uint32_t	RxDrop;				//接收丢帧, 同 CANGetRxOverrun
+			uint8_t		Tec;					//发送错误计数
+			uint8_t		Rec;					//接收错误计数
+			uint32_t	IsrMin;				//CAN/DMA中断耗时, CPU周期
+			uint32_t	IsrMax;
+			uint32_t	IsrNum;
+			uint64_t	IsrSum;
+
+}		CANStatType;
+
+//按32位字访问帧数据, n=0:Data[0~3] n=1:Data[4~7]
+#define CAN_FRAME_WORD(f,n)		(((uint32_t *)((f)->Data))[n])
+
+//MailBox n 在 RAMn 中的首字地址, 字0:CS 字1:ID 字2~3:数据(大端)
+#define CAN_MB_WORDS(base,n)	(&(base)->RAMn[(n)*4])
+
 
 uint8_t CANInit(uint8_t CANChannel,uint32_t baudrateKHz);
+uint8_t CANInitFD(uint8_t CANChannel, uint32_t baudrateKHz, uint32_t dataKHz);
+uint8_t CANSetRxFilter(uint8_t CANChannel, const CANFilterTabType *Tab);
 uint8_t CANSendData(uint8_t CANChannel, uint32_t id_ext, uint32_t id, uint8_t length,uint8_t Data[]);
 uint8_t CANRecData(uint8_t CANChannel, uint32_t *id,uint8_t *Datalenght,uint8_t *Data);
+uint8_t CANRecFrame(uint8_t CANChannel, CANFrameType *Frame);
+uint8_t CANRxInject(uint8_t CANChannel, const CANFrameType *Frame);
+uint8_t CANSendBurst(uint8_t CANChannel, const CANFrameType *Frames, uint8_t Num);
+uint8_t CANRecBurst(uint8_t CANChannel, CANFrameType *Frames, uint8_t Max);
+uint8_t CANSendFD(uint8_t CANChannel, const CANFDFrameType *Frame);
+uint8_t CANRecFD(uint8_t CANChannel, CANFDFrameType *Frame);
+uint32_t CANGetRxOverrun(uint8_t CANChannel);
+void		CANGetLatency(uint8_t CANChannel, CANLatencyType *Lat, uint8_t Clear);
+void		CANGetStat(uint8_t CANChannel, CANStatType *Stat, uint8_t Clear);
+uint16_t CANGetQueueDepth(uint8_t CANChannel);
+uint8_t CANPowerVeto(uint8_t Mode);
+uint8_t CANPowerNotify(uint8_t Event, uint8_t Mode);
+uint8_t CANPowerWake(void);
+void		CAN_RxISR(uint8_t CANChannel);
+void		CAN_TxISR(uint8_t CANChannel);
 
 
 #endif /* __DRV_CAN_H */
@@ -0,0 +1,339 @@
+#include <stdint.h>
+#include "drvCANFilter.h"
+
+//过滤编译器只做计算, 不访问寄存器, 由 CANSetRxFilter 写入 FlexCAN
+
+#define CAN_FILTER_STD_BITS		11
+#define CAN_FILTER_EXT_BITS		29
+
+#define CAN_FILTER_A_RTR			(0x80000000L)
+#define CAN_FILTER_A_IDE			(0x40000000L)
+#define CAN_FILTER_B_IDE(h)		((h) ? 0x00004000L : 0x40000000L)
+
+//掩码合并中的一组: 按 (ID, Mask) 放行, Mask 位为1表示必须匹配
+typedef	struct
+{
+			uint32_t	ID;
+			uint32_t	Mask;
+			uint8_t		IDE;
+
+}		CANFilterGroupType;
+
+static CANFilterGroupType	FilterGroup[CAN_FILTER_ID_MAX];
+
+static uint32_t CANFilter_BitCount(uint32_t x)
+{
+		x = x - ((x >> 1) & 0x55555555);
+		x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+		x = (x + (x >> 4)) & 0x0F0F0F0F;
+		return (x * 0x01010101) >> 24;
+}
+
+//一组放行的ID个数
+static uint32_t CANFilter_Space(uint32_t Mask, uint8_t IDE)
+{
+		uint8_t	bits;
+
+		bits = IDE ? CAN_FILTER_EXT_BITS : CAN_FILTER_STD_BITS;
+		bits -= CANFilter_BitCount(Mask);
+		return (bits >= 32) ? 0xFFFFFFFFL : (1uL << bits);
+}
+
+static uint32_t CANFilter_FullMask(uint8_t IDE)
+{
+		return IDE ? 0x1FFFFFFFL : 0x7FFL;
+}
+
+/*************************************************************************
+*  函数名称：CANFilter_Sort
+*  功能说明：按 IDE、ID 升序排序并去重, 相邻ID高位相同, 便于合并
+*  函数返回：去重后的组数
+*************************************************************************/
+static uint16_t CANFilter_Sort(uint16_t Num)
+{
+		CANFilterGroupType	t;
+		uint16_t	i,j,n;
+
+		for(i=1;i<Num;i++)
+		{
+				t = FilterGroup[i];
+				for(j=i;(j>0)&&((FilterGroup[j-1].IDE > t.IDE)||((FilterGroup[j-1].IDE == t.IDE)&&(FilterGroup[j-1].ID > t.ID)));j--)
+						FilterGroup[j] = FilterGroup[j-1];
+				FilterGroup[j] = t;
+		}
+		n = 0;
+		for(i=0;i<Num;i++)
+		{
+				if((n > 0)&&(FilterGroup[n-1].IDE == FilterGroup[i].IDE)&&(FilterGroup[n-1].ID == FilterGroup[i].ID))	continue;
+				FilterGroup[n++] = FilterGroup[i];
+		}
+		return n;
+}
+
+/*************************************************************************
+*  函数名称：CANFilter_Merge
+*  功能说明：反复合并代价(新增放行ID数)最小的相邻两组, 直到组数不超过Slots,
+//	         且合并产生的带掩码组不超过MaxMasked(需占用个体掩码)
+*  函数返回：合并后的组数
+*************************************************************************/
+static uint16_t CANFilter_Merge(uint16_t Num, uint16_t Slots, uint8_t MaxMasked)
+{
+		uint16_t	i,best,masked;
+		uint32_t	m,cost,bestCost;
+
+		for(;;)
+		{
+				masked = 0;
+				for(i=0;i<Num;i++)
+						if(FilterGroup[i].Mask != CANFilter_FullMask(FilterGroup[i].IDE))	masked++;
+				if((Num <= Slots)&&(masked <= MaxMasked))	return Num;
+
+				best = 0xFFFF;
+				bestCost = 0xFFFFFFFFL;
+				for(i=0;i+1<Num;i++)
+				{
+						if(FilterGroup[i].IDE != FilterGroup[i+1].IDE)	continue;
+						m = FilterGroup[i].Mask & FilterGroup[i+1].Mask & ~(FilterGroup[i].ID ^ FilterGroup[i+1].ID);
+						cost = CANFilter_Space(m, FilterGroup[i].IDE)
+								 - CANFilter_Space(FilterGroup[i].Mask, FilterGroup[i].IDE)
+								 - CANFilter_Space(FilterGroup[i+1].Mask, FilterGroup[i+1].IDE);
+						if(cost < bestCost)
+						{
+								bestCost = cost;
+								best = i;
+						}
+				}
+				//只剩一组标准帧和一组扩展帧, 无法再合并
+				if(best == 0xFFFF)	return Num;
+
+				m = FilterGroup[best].Mask & FilterGroup[best+1].Mask & ~(FilterGroup[best].ID ^ FilterGroup[best+1].ID);
+				FilterGroup[best].Mask = m;
+				FilterGroup[best].ID &= m;
+				for(i=best+1;i+1<Num;i++)	FilterGroup[i] = FilterGroup[i+1];
+				Num--;
+		}
+}
+
+static uint32_t CANFilter_EncodeA(uint32_t ID, uint8_t IDE)
+{
+		if(IDE)	return CAN_FILTER_A_IDE | (ID << 1);
+		return ID << 19;
+}
+
+static uint32_t CANFilter_EncodeB(uint32_t ID, uint8_t IDE, uint8_t Half)
+{
+		uint32_t	v;
+
+		v = IDE ? ((ID >> 15) & 0x3FFF) : ((ID & 0x7FF) << 3);
+		if(IDE)	v |= CAN_FILTER_B_IDE(1);
+		return Half ? v : (v << 16);
+}
+
+static uint32_t CANFilter_EncodeC(uint32_t ID, uint8_t IDE, uint8_t Byte)
+{
+		uint32_t	v;
+
+		v = IDE ? ((ID >> 21) & 0xFF) : ((ID >> 3) & 0xFF);
+		return v << (24 - 8*Byte);
+}
+
+//元素数取满8的倍数, 空位复制第0个元素, 避免全0元素放行所有帧
+static void CANFilter_Finish(CANFilterTabType *Tab, uint16_t Used, uint8_t MaxIndividual)
+{
+		uint16_t	i,total;
+
+		Tab->RFFN = (Used == 0) ? 0 : (uint8_t)((Used - 1) / 8);
+		total = 8 * (Tab->RFFN + 1);
+		for(i=Used;i<total;i++)
+		{
+				Tab->Elem[i] = Tab->Elem[0];
+				Tab->Mask[i] = Tab->Mask[0];
+		}
+		for(i=MaxIndividual;i<total;i++)	Tab->Mask[i] = Tab->GlobalMask;
+		Tab->Num = (uint8_t)Used;
+}
+
+static uint8_t CANFilter_BuildA(uint16_t Num, uint8_t MaxRFFN, uint8_t MaxIndividual, CANFilterTabType *Tab)
+{
+		uint16_t	i,n,slots;
+		uint16_t	k,ids;
+		uint32_t	fa;
+
+		ids = Num;
+		slots = 8 * (MaxRFFN + 1);
+		n = CANFilter_Merge(Num, slots, MaxIndividual);
+		if(n > slots)	return 1;
+
+		//带掩码的组放在有个体掩码的元素上, 精确组放在后面共用RXFGMASK
+		Tab->GlobalMask = CAN_FILTER_A_RTR | CAN_FILTER_A_IDE | 0x3FFFFFFEL;
+		k = 0;
+		fa = 0;
+		for(i=0;i<n;i++)
+		{
+				if(FilterGroup[i].Mask == CANFilter_FullMask(FilterGroup[i].IDE))	continue;
+				Tab->Elem[k] = CANFilter_EncodeA(FilterGroup[i].ID, FilterGroup[i].IDE);
+				Tab->Mask[k] = CAN_FILTER_A_RTR | CAN_FILTER_A_IDE | CANFilter_EncodeA(FilterGroup[i].Mask, FilterGroup[i].IDE);
+				fa += CANFilter_Space(FilterGroup[i].Mask, FilterGroup[i].IDE);
+				k++;
+		}
+		for(i=0;i<n;i++)
+		{
+				if(FilterGroup[i].Mask != CANFilter_FullMask(FilterGroup[i].IDE))	continue;
+				Tab->Elem[k] = CANFilter_EncodeA(FilterGroup[i].ID, FilterGroup[i].IDE);
+				Tab->Mask[k] = Tab->GlobalMask;
+				fa++;
+				k++;
+		}
+		Tab->Format = CAN_FILTER_FORMAT_A;
+		Tab->FalseAccept = fa - ids;
+		CANFilter_Finish(Tab, k, MaxIndividual);
+		return 0;
+}
+
+//格式B: 标准帧精确, 扩展帧只比较高14位
+static void CANFilter_BuildB(uint16_t Num, uint8_t MaxIndividual, CANFilterTabType *Tab)
+{
+		uint16_t	i;
+		uint32_t	fa;
+
+		Tab->GlobalMask = 0xFFFFFFFFL;
+		fa = 0;
+		for(i=0;i<Num;i++)
+		{
+				if(i & 1)	Tab->Elem[i/2] |= CANFilter_EncodeB(FilterGroup[i].ID, FilterGroup[i].IDE, 1);
+				else			Tab->Elem[i/2]  = CANFilter_EncodeB(FilterGroup[i].ID, FilterGroup[i].IDE, 0);
+				Tab->Mask[i/2] = Tab->GlobalMask;
+				if(FilterGroup[i].IDE)	fa += (1uL << 15) - 1;
+		}
+		//奇数个ID时后半部分复制前半部分
+		if(Num & 1)	Tab->Elem[Num/2] |= Tab->Elem[Num/2] >> 16;
+		Tab->Format = CAN_FILTER_FORMAT_B;
+		Tab->FalseAccept = fa;
+		CANFilter_Finish(Tab, (Num + 1) / 2, MaxIndividual);
+}
+
+//格式C: 只比较ID高8位, 不区分标准帧和扩展帧
+static uint16_t CANFilter_KeysC(uint16_t Num)
+{
+		uint16_t	i,n;
+		uint32_t	key,last;
+
+		n = 0;
+		last = 0xFFFFFFFFL;
+		for(i=0;i<Num;i++)
+		{
+				key = (CANFilter_EncodeC(FilterGroup[i].ID, FilterGroup[i].IDE, 0) >> 24) | ((uint32_t)FilterGroup[i].IDE << 8);
+				if(key == last)	continue;
+				last = key;
+				FilterGroup[n].ID  = key & 0xFF;
+				FilterGroup[n].IDE = FilterGroup[i].IDE;
+				n++;
+		}
+		return n;
+}
+
+static void CANFilter_BuildC(uint16_t Keys, uint8_t MaxIndividual, CANFilterTabType *Tab)
+{
+		uint16_t	i,used;
+		uint32_t	fa;
+
+		Tab->GlobalMask = 0xFFFFFFFFL;
+		fa = 0;
+		for(i=0;i<Keys;i++)
+		{
+				if((i & 3) == 0)	Tab->Elem[i/4] = 0;
+				Tab->Elem[i/4] |= FilterGroup[i].ID << (24 - 8*(i & 3));
+				Tab->Mask[i/4] = Tab->GlobalMask;
+				fa += FilterGroup[i].IDE ? ((1uL << 21) - 1) : 7;
+				fa += FilterGroup[i].IDE ? 8 : (1uL << 21);		//另一种帧格式的同高8位ID
+		}
+		//不满4个的元素用第一个字节补齐
+		for(i=Keys;(i & 3)!=0;i++)	Tab->Elem[i/4] |= (Tab->Elem[i/4] >> 24) << (24 - 8*(i & 3));
+		used = (Keys + 3) / 4;
+		Tab->Format = CAN_FILTER_FORMAT_C;
+		Tab->FalseAccept = fa;
+		CANFilter_Finish(Tab, used, MaxIndividual);
+}
+
+static uint16_t CANFilter_Load(const CANFilterIDType *IDs, uint16_t Num)
+{
+		uint16_t	i;
+
+		for(i=0;i<Num;i++)
+		{
+				FilterGroup[i].IDE	= IDs[i].IDE ? 1 : 0;
+				FilterGroup[i].ID		= IDs[i].ID & CANFilter_FullMask(FilterGroup[i].IDE);
+				FilterGroup[i].Mask = CANFilter_FullMask(FilterGroup[i].IDE);
+		}
+		return CANFilter_Sort(Num);
+}
+
+/*************************************************************************
+*  函数名称：CANFilterCompile
+*  功能说明：根据应用关心的ID集合生成Rx FIFO ID过滤表
+//	         槽位够用时格式A精确匹配; 不够时比较 格式A掩码合并、格式B、格式C
+//	         三种方案额外放行的ID数, 取最少者
+*  参数说明：IDs：ID集合, 可重复
+//	         Num：ID个数, 不超过CAN_FILTER_ID_MAX
+//	         MaxRFFN：允许的最大RFFN(0~15), 由MailBox布局决定
+//	         MaxIndividual：有个体掩码寄存器RXIMR的过滤元素数
+//	         Tab：输出过滤表
+*  函数返回：0：成功，1：参数错误
+*************************************************************************/
+uint8_t CANFilterCompile(const CANFilterIDType *IDs, uint16_t Num, uint8_t MaxRFFN, uint8_t MaxIndividual, CANFilterTabType *Tab)
+{
+		uint16_t	n,slots,keys;
+		uint32_t	faB,faC;
+		uint8_t		best;
+
+		if((Num > CAN_FILTER_ID_MAX)||(MaxRFFN > 15))	return 1;
+		slots = 8 * (MaxRFFN + 1);
+		if(MaxIndividual > slots)	MaxIndividual = (uint8_t)slots;
+
+		n = CANFilter_Load(IDs, Num);
+		if(n == 0)
+		{
+				Tab->Format = CAN_FILTER_FORMAT_D;
+				Tab->RFFN = 0;
+				Tab->Num = 0;
+				Tab->FalseAccept = 0;
+				Tab->GlobalMask = 0xFFFFFFFFL;
+				return 0;
+		}
+		if(n <= slots)	return CANFilter_BuildA(n, MaxRFFN, MaxIndividual, Tab);
+
+		//估算格式B、C的额外放行数
+		faB = 0xFFFFFFFFL;
+		faC = 0xFFFFFFFFL;
+		if(n <= 2*slots)
+		{
+				CANFilter_BuildB(n, MaxIndividual, Tab);
+				faB = Tab->FalseAccept;
+		}
+		keys = CANFilter_KeysC(n);
+		if(keys <= 4*slots)
+		{
+				CANFilter_BuildC(keys, MaxIndividual, Tab);
+				faC = Tab->FalseAccept;
+		}
+
+		n = CANFilter_Load(IDs, Num);
+		if(CANFilter_BuildA(n, MaxRFFN, MaxIndividual, Tab) == 0)
+		{
+				if((Tab->FalseAccept <= faB)&&(Tab->FalseAccept <= faC))	return 0;
+		}
+		best = (faB <= faC) ? CAN_FILTER_FORMAT_B : CAN_FILTER_FORMAT_C;
+		if((best == CAN_FILTER_FORMAT_B)&&(faB == 0xFFFFFFFFL))	return 1;
+
+		n = CANFilter_Load(IDs, Num);
+		if(best == CAN_FILTER_FORMAT_B)
+		{
+				CANFilter_BuildB(n, MaxIndividual, Tab);
+		}
+		else
+		{
+				keys = CANFilter_KeysC(n);
+				CANFilter_BuildC(keys, MaxIndividual, Tab);
+		}
+		return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef __DRV_CAN_FILTER_H
+#define __DRV_CAN_FILTER_H
+
+#include <stdint.h>
+
+//Rx FIFO ID过滤表格式, 即 MCR[IDAM]
+#define CAN_FILTER_FORMAT_A		0		//每元素1个完整ID
+#define CAN_FILTER_FORMAT_B		1		//每元素2个14位ID(标准帧完整, 扩展帧高14位)
+#define CAN_FILTER_FORMAT_C		2		//每元素4个8位ID(高8位, 不区分IDE)
+#define CAN_FILTER_FORMAT_D		3		//拒收所有帧
+
+//过滤表元素最大数, RFFN=15
+#define CAN_FILTER_MAX				128
+//参与掩码合并的ID最大数
+#define CAN_FILTER_ID_MAX			512
+
+typedef	struct
+{
+			uint32_t	ID;
+			uint8_t		IDE;		//1:扩展帧 0:标准帧
+
+}		CANFilterIDType;
+
+typedef	struct
+{
+			uint8_t		Format;									//CAN_FILTER_FORMAT_x
+			uint8_t		RFFN;										//过滤表元素数 = 8*(RFFN+1)
+			uint8_t		Num;										//有效元素数
+			uint32_t	FalseAccept;						//额外放行的ID个数估计
+			uint32_t	GlobalMask;							//RXFGMASK, 用于无个体掩码的元素
+			uint32_t	Elem[CAN_FILTER_MAX];		//已编码的过滤表元素
+			uint32_t	Mask[CAN_FILTER_MAX];		//对应RXIMR
+
+}		CANFilterTabType;
+
+uint8_t CANFilterCompile(const CANFilterIDType *IDs, uint16_t Num, uint8_t MaxRFFN, uint8_t MaxIndividual, CANFilterTabType *Tab);
+
+
+#endif /* __DRV_CAN_FILTER_H */
@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include "drvCANTiming.h"
+
+//位时间求解只做计算, 不访问寄存器, 可在初始化时调用
+
+//                                       PrescMax  PropMin  PropMax  Pseg1Max  Pseg2Min  Pseg2Max  RjwMax  SpClkMax
+const CANTimingLimitType	CANTimingClassic = {  256,      1,       8,       8,        2,        8,        4,      0  };
+const CANTimingLimitType	CANTimingCbt		 = { 1024,      1,      64,      32,        2,       32,       32,      0  };
+const CANTimingLimitType	CANTimingFdData	 = { 1024,      0,      31,       8,        2,        8,        8,      0  };
+const CANTimingLimitType	CANTimingFdTdc	 = { 1024,      0,      31,       8,        2,        8,        8,     31  };
+
+//每位最少Tq数
+#define CAN_TIMING_TQ_MIN		8
+
+/*************************************************************************
+*  函数名称：CANCalcBitTiming
+*  功能说明：搜索预分频与各段长度, 波特率误差最小优先, 其次采样点误差最小,
+//	         再次每位Tq数最多(再同步分辨率最高); Limit->SpClkMax非0时采样点不得晚于该时钟数
+*  参数说明：PEClkHz：CAN协议引擎时钟
+//	         Bitrate：目标波特率
+//	         SamplePermille：目标采样点, 千分比, 如875
+//	         Limit：寄存器取值范围, CANTimingClassic、CANTimingCbt 或 CANTimingFdData
+//	         Timing：输出结果
+*  函数返回：0：成功；1：无解或波特率误差超过1%
+*************************************************************************/
+uint8_t CANCalcBitTiming(uint32_t PEClkHz, uint32_t Bitrate, uint16_t SamplePermille, const CANTimingLimitType *Limit, CANBitTimingType *Timing)
+{
+		uint32_t	tqMax,tq,presc,rate,err,spErr;
+		uint32_t	bestErr,bestSpErr;
+		uint32_t	tseg1,pseg1,pseg2,prop;
+		uint16_t	sp;
+
+		if((Bitrate == 0)||(PEClkHz < Bitrate * CAN_TIMING_TQ_MIN))	return 1;
+		tqMax = 1 + Limit->PropMax + Limit->Pseg1Max + Limit->Pseg2Max;
+		bestErr = 0xFFFFFFFFL;
+		bestSpErr = 0xFFFFFFFFL;
+
+		for(tq=tqMax;tq>=CAN_TIMING_TQ_MIN;tq--)
+		{
+				//就近取整的预分频
+				presc = (PEClkHz + Bitrate * tq / 2) / (Bitrate * tq);
+				if((presc == 0)||(presc > Limit->PrescMax))	continue;
+				rate = PEClkHz / (presc * tq);
+				err	 = (rate > Bitrate) ? (rate - Bitrate) : (Bitrate - rate);
+				if(err > bestErr)	continue;
+
+				//PSEG2 = 采样点之后的Tq数
+				pseg2 = (tq * (1000 - SamplePermille) + 500) / 1000;
+				if(pseg2 < Limit->Pseg2Min)	pseg2 = Limit->Pseg2Min;
+				if(pseg2 > Limit->Pseg2Max)	pseg2 = Limit->Pseg2Max;
+				if(tq < 1 + Limit->PropMin + 1 + pseg2)	continue;
+				tseg1 = tq - 1 - pseg2;
+
+				//PSEG1不小于PSEG2(保证RJW), 其余给传播段
+				pseg1 = (pseg2 <= Limit->Pseg1Max) ? pseg2 : Limit->Pseg1Max;
+				if(tseg1 - pseg1 < Limit->PropMin)	pseg1 = tseg1 - Limit->PropMin;
+				prop = tseg1 - pseg1;
+				if(prop > Limit->PropMax)
+				{
+						prop	= Limit->PropMax;
+						pseg1 = tseg1 - prop;
+						if(pseg1 > Limit->Pseg1Max)	continue;
+				}
+				if(pseg1 == 0)	continue;
+				if(Limit->SpClkMax&&((1 + tseg1) * presc > Limit->SpClkMax))	continue;
+
+				sp = (uint16_t)((1 + tseg1) * 1000 / tq);
+				spErr = (sp > SamplePermille) ? (sp - SamplePermille) : (SamplePermille - sp);
+				if((err == bestErr)&&(spErr >= bestSpErr))	continue;
+
+				bestErr = err;
+				bestSpErr = spErr;
+				Timing->Presc = (uint16_t)presc;
+				Timing->Prop	= (uint8_t)prop;
+				Timing->Pseg1 = (uint8_t)pseg1;
+				Timing->Pseg2 = (uint8_t)pseg2;
+				Timing->Rjw		= (uint8_t)((pseg1 < pseg2) ? pseg1 : pseg2);
+				if(Timing->Rjw > Limit->RjwMax)	Timing->Rjw = Limit->RjwMax;
+				Timing->Tq		= (uint8_t)tq;
+				Timing->SamplePoint = sp;
+				Timing->Bitrate = rate;
+		}
+
+		if(bestErr == 0xFFFFFFFFL)	return 1;
+		if(bestErr * 100 > Bitrate)	return 1;
+		return 0;
+}
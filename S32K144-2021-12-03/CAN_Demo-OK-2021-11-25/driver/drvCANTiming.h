@@ -0,0 +1,47 @@
+#ifndef __DRV_CAN_TIMING_H
+#define __DRV_CAN_TIMING_H
+
+#include <stdint.h>
+
+//位时间各段的取值范围, 单位Tq(分频为实际分频数)
+typedef	struct
+{
+			uint16_t	PrescMax;
+			uint8_t		PropMin;
+			uint8_t		PropMax;
+			uint8_t		Pseg1Max;
+			uint8_t		Pseg2Min;
+			uint8_t		Pseg2Max;
+			uint8_t		RjwMax;
+			uint16_t	SpClkMax;			//位起点到采样点的协议引擎时钟数上限, 0为不限; 用于TDCOFF
+
+}		CANTimingLimitType;
+
+//求解结果, 均为实际值(Tq个数/分频数), 写寄存器时按各寄存器编码换算
+typedef	struct
+{
+			uint16_t	Presc;				//预分频
+			uint8_t		Prop;					//传播段
+			uint8_t		Pseg1;				//相位缓冲段1
+			uint8_t		Pseg2;				//相位缓冲段2
+			uint8_t		Rjw;					//再同步跳转宽度
+			uint8_t		Tq;						//每位Tq数 = 1 + Prop + Pseg1 + Pseg2
+			uint16_t	SamplePoint;	//实际采样点, 千分比
+			uint32_t	Bitrate;			//实际波特率
+
+}		CANBitTimingType;
+
+//CTRL1: PRESDIV 8位, PROPSEG/PSEG1/PSEG2 3位, RJW 2位
+extern const CANTimingLimitType	CANTimingClassic;
+//CBT扩展位时间: EPRESDIV 10位, EPROPSEG 6位, EPSEG1/EPSEG2/ERJW 5位
+extern const CANTimingLimitType	CANTimingCbt;
+
+//FDCBT数据段位时间: FPRESDIV 10位, FPROPSEG 5位(可为0), FPSEG1/FPSEG2/FRJW 3位
+extern const CANTimingLimitType	CANTimingFdData;
+//同上, 另要求采样点位置可写入FDCTRL.TDCOFF(5位, 协议引擎时钟), 需要发送延时补偿时使用
+extern const CANTimingLimitType	CANTimingFdTdc;
+
+uint8_t CANCalcBitTiming(uint32_t PEClkHz, uint32_t Bitrate, uint16_t SamplePermille, const CANTimingLimitType *Limit, CANBitTimingType *Timing);
+
+
+#endif /* __DRV_CAN_TIMING_H */
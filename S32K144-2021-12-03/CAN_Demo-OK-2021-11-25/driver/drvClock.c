@@ -0,0 +1,242 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvClock.h"
+
+//芯片限值, 见S32K1xx参考手册时钟章节
+#define CLOCK_REF_MIN_HZ				8000000uL			//SPLL参考时钟 SOSC/PREDIV
+#define CLOCK_REF_MAX_HZ				16000000uL
+#define CLOCK_VCO_MIN_HZ				180000000uL
+#define CLOCK_VCO_MAX_HZ				320000000uL
+#define CLOCK_RUN_CORE_MAX_HZ		80000000uL
+#define CLOCK_RUN_BUS_MAX_HZ		40000000uL
+#define CLOCK_RUN_SLOW_MAX_HZ		26670000uL
+#define CLOCK_HSRUN_CORE_MAX_HZ	112000000uL
+#define CLOCK_HSRUN_BUS_MAX_HZ	56000000uL
+#define CLOCK_HSRUN_SLOW_MAX_HZ	28000000uL
+#define CLOCK_DIV1_MAX_HZ				80000000uL			//SPLLDIV1/SOSCDIV1
+#define CLOCK_DIV2_MAX_HZ				40000000uL			//SPLLDIV2/SOSCDIV2
+#define CLOCK_VLPR_CORE_MAX_HZ	4000000uL
+#define CLOCK_VLPR_BUS_MAX_HZ		4000000uL
+#define CLOCK_VLPR_SLOW_MAX_HZ	1000000uL
+
+#define CLOCK_ASYNC_OK(n)				(((n)==1)||((n)==2)||((n)==4)||((n)==8)||((n)==16)||((n)==32)||((n)==64))
+#define CLOCK_PMSTAT_HSRUN			0x80
+#define CLOCK_SCS_SOSC					1
+#define CLOCK_SCS_SIRC					2
+#define CLOCK_SCS_FIRC					3
+#define CLOCK_SCS_SPLL					6
+#define CLOCK_CSR_SCS()					((SCG->CSR & SCG_CSR_SCS_MASK) >> SCG_CSR_SCS_SHIFT)
+
+//---------------- 编译时检查 ----------------
+
+#if (!CLOCK_ASYNC_OK(CLOCK_SOSC_DIV1))||(!CLOCK_ASYNC_OK(CLOCK_SOSC_DIV2))
+#error "drvClock.h: CLOCK_SOSC_DIV1/2 只能为1,2,4..64"
+#endif
+#if (CLOCK_SOSCDIV1_HZ > CLOCK_DIV1_MAX_HZ)||(CLOCK_SOSCDIV2_HZ > CLOCK_DIV2_MAX_HZ)
+#error "drvClock.h: SOSCDIV1/2 时钟超限"
+#endif
+
+#if (CLOCK_RUN_PREDIV < 1)||(CLOCK_RUN_PREDIV > 8)||(CLOCK_RUN_MULT < 16)||(CLOCK_RUN_MULT > 47)
+#error "drvClock.h: RUN SPLL PREDIV 1~8, MULT 16~47"
+#endif
+#if (CLOCK_SOSC_HZ / CLOCK_RUN_PREDIV < CLOCK_REF_MIN_HZ)||(CLOCK_SOSC_HZ / CLOCK_RUN_PREDIV > CLOCK_REF_MAX_HZ)
+#error "drvClock.h: RUN SPLL参考时钟须在8~16MHz"
+#endif
+#if (CLOCK_RUN_VCO_HZ < CLOCK_VCO_MIN_HZ)||(CLOCK_RUN_VCO_HZ > CLOCK_VCO_MAX_HZ)
+#error "drvClock.h: RUN SPLL VCO须在180~320MHz"
+#endif
+#if (CLOCK_RUN_DIVCORE < 1)||(CLOCK_RUN_DIVCORE > 16)||(CLOCK_RUN_DIVBUS < 1)||(CLOCK_RUN_DIVBUS > 16)||(CLOCK_RUN_DIVSLOW < 1)||(CLOCK_RUN_DIVSLOW > 8)
+#error "drvClock.h: RUN DIVCORE/DIVBUS 1~16, DIVSLOW 1~8"
+#endif
+#if (CLOCK_RUN_CORE_HZ > CLOCK_RUN_CORE_MAX_HZ)||(CLOCK_RUN_BUS_HZ > CLOCK_RUN_BUS_MAX_HZ)||(CLOCK_RUN_SLOW_HZ > CLOCK_RUN_SLOW_MAX_HZ)
+#error "drvClock.h: RUN 内核/总线/Flash时钟超限(80/40/26.67MHz)"
+#endif
+#if (!CLOCK_ASYNC_OK(CLOCK_RUN_SPLLDIV1))||(!CLOCK_ASYNC_OK(CLOCK_RUN_SPLLDIV2))
+#error "drvClock.h: CLOCK_RUN_SPLLDIV1/2 只能为1,2,4..64"
+#endif
+#if (CLOCK_RUN_SPLL_HZ / CLOCK_RUN_SPLLDIV1 > CLOCK_DIV1_MAX_HZ)||(CLOCK_RUN_SPLL_HZ / CLOCK_RUN_SPLLDIV2 > CLOCK_DIV2_MAX_HZ)
+#error "drvClock.h: RUN SPLLDIV1/2 时钟超限"
+#endif
+
+#if (CLOCK_HSRUN_PREDIV < 1)||(CLOCK_HSRUN_PREDIV > 8)||(CLOCK_HSRUN_MULT < 16)||(CLOCK_HSRUN_MULT > 47)
+#error "drvClock.h: HSRUN SPLL PREDIV 1~8, MULT 16~47"
+#endif
+#if (CLOCK_SOSC_HZ / CLOCK_HSRUN_PREDIV < CLOCK_REF_MIN_HZ)||(CLOCK_SOSC_HZ / CLOCK_HSRUN_PREDIV > CLOCK_REF_MAX_HZ)
+#error "drvClock.h: HSRUN SPLL参考时钟须在8~16MHz"
+#endif
+#if (CLOCK_HSRUN_VCO_HZ < CLOCK_VCO_MIN_HZ)||(CLOCK_HSRUN_VCO_HZ > CLOCK_VCO_MAX_HZ)
+#error "drvClock.h: HSRUN SPLL VCO须在180~320MHz"
+#endif
+#if (CLOCK_HSRUN_DIVCORE < 1)||(CLOCK_HSRUN_DIVCORE > 16)||(CLOCK_HSRUN_DIVBUS < 1)||(CLOCK_HSRUN_DIVBUS > 16)||(CLOCK_HSRUN_DIVSLOW < 1)||(CLOCK_HSRUN_DIVSLOW > 8)
+#error "drvClock.h: HSRUN DIVCORE/DIVBUS 1~16, DIVSLOW 1~8"
+#endif
+#if (CLOCK_HSRUN_CORE_HZ > CLOCK_HSRUN_CORE_MAX_HZ)||(CLOCK_HSRUN_BUS_HZ > CLOCK_HSRUN_BUS_MAX_HZ)||(CLOCK_HSRUN_SLOW_HZ > CLOCK_HSRUN_SLOW_MAX_HZ)
+#error "drvClock.h: HSRUN 内核/总线/Flash时钟超限(112/56/28MHz)"
+#endif
+#if (!CLOCK_ASYNC_OK(CLOCK_HSRUN_SPLLDIV1))||(!CLOCK_ASYNC_OK(CLOCK_HSRUN_SPLLDIV2))
+#error "drvClock.h: CLOCK_HSRUN_SPLLDIV1/2 只能为1,2,4..64"
+#endif
+#if (CLOCK_HSRUN_SPLL_HZ / CLOCK_HSRUN_SPLLDIV1 > CLOCK_DIV1_MAX_HZ)||(CLOCK_HSRUN_SPLL_HZ / CLOCK_HSRUN_SPLLDIV2 > CLOCK_DIV2_MAX_HZ)
+#error "drvClock.h: HSRUN SPLLDIV1/2 时钟超限"
+#endif
+
+#if (CLOCK_VLPR_DIVCORE < 1)||(CLOCK_VLPR_DIVCORE > 16)||(CLOCK_VLPR_DIVBUS < 1)||(CLOCK_VLPR_DIVBUS > 16)||(CLOCK_VLPR_DIVSLOW < 1)||(CLOCK_VLPR_DIVSLOW > 8)
+#error "drvClock.h: VLPR DIVCORE/DIVBUS 1~16, DIVSLOW 1~8"
+#endif
+#if (CLOCK_VLPR_CORE_HZ > CLOCK_VLPR_CORE_MAX_HZ)||(CLOCK_VLPR_BUS_HZ > CLOCK_VLPR_BUS_MAX_HZ)||(CLOCK_VLPR_SLOW_HZ > CLOCK_VLPR_SLOW_MAX_HZ)
+#error "drvClock.h: VLPR 内核/总线/Flash时钟超限(4/4/1MHz)"
+#endif
+#if (!CLOCK_ASYNC_OK(CLOCK_SIRC_DIV2))
+#error "drvClock.h: CLOCK_SIRC_DIV2 只能为1,2,4..64"
+#endif
+
+#if (CLOCK_CORE_HZ > CLOCK_CAN_PE_MAX_HZ)
+#error "drvClock.h: CAN FD协议引擎用SYS_CLK, 上电模式的内核时钟不能超过80MHz"
+#endif
+
+
+uint32_t SystemCoreClock = CLOCK_CORE_HZ;
+
+/*************************************************************************
+*  函数名称：ClockSelect
+*  功能说明：RUN模式下切换系统时钟源和分频, 等待生效
+*  参数说明：Ccr：RCCR的值, 如CLOCK_RUN_CCR、CLOCK_FIRC_CCR
+*  函数返回：0：成功；1：超时
+*************************************************************************/
+uint8_t ClockSelect(uint32_t Ccr)
+{
+		uint32_t	n;
+
+		SCG->RCCR = Ccr;
+		for(n=0;n<CLOCK_WAIT_POLLS;n++)
+		{
+				if(CLOCK_CSR_SCS() == ((Ccr & SCG_RCCR_SCS_MASK) >> SCG_RCCR_SCS_SHIFT))	return 0;
+		}
+		return 1;
+}
+
+//启动SOSC, 已在运行时直接返回
+uint8_t ClockSoscStart(void)
+{
+		uint32_t	n;
+
+		if((SCG->SOSCCSR & SCG_SOSCCSR_SOSCVLD_MASK) == 0)
+		{
+				while(SCG->SOSCCSR & SCG_SOSCCSR_LK_MASK);
+				SCG->SOSCCSR = 0;
+				SCG->SOSCDIV = CLOCK_SOSCDIV;
+				SCG->SOSCCFG = SCG_SOSCCFG_RANGE(2) | SCG_SOSCCFG_EREFS_MASK;			//1~8MHz晶振, 低功耗
+				SCG->SOSCCSR = SCG_SOSCCSR_SOSCEN_MASK;
+		}
+		for(n=0;n<CLOCK_WAIT_POLLS;n++)
+		{
+				if(SCG->SOSCCSR & SCG_SOSCCSR_SOSCVLD_MASK)	return 0;
+		}
+		return 1;
+}
+
+//启动FIRC, 已在运行时直接返回
+uint8_t ClockFircStart(void)
+{
+		uint32_t	n;
+
+		if((SCG->FIRCCSR & SCG_FIRCCSR_FIRCVLD_MASK) == 0)	SCG->FIRCCSR = SCG_FIRCCSR_FIRCEN_MASK;
+		for(n=0;n<CLOCK_WAIT_POLLS;n++)
+		{
+				if(SCG->FIRCCSR & SCG_FIRCCSR_FIRCVLD_MASK)	return 0;
+		}
+		return 1;
+}
+
+/*************************************************************************
+*  函数名称：ClockSpllStart
+*  功能说明：按模式重新配置并启动SPLL, 调用时SPLL不能是系统时钟, SOSC须已启动
+*  参数说明：Mode：CLOCK_MODE_RUN 或 CLOCK_MODE_HSRUN
+*  函数返回：0：成功；1：未锁定, SPLL保持关闭
+*************************************************************************/
+uint8_t ClockSpllStart(uint8_t Mode)
+{
+		uint32_t	n;
+
+		while(SCG->SPLLCSR & SCG_SPLLCSR_LK_MASK);
+		SCG->SPLLCSR = 0;
+		if(Mode == CLOCK_MODE_HSRUN)
+		{
+				SCG->SPLLDIV = CLOCK_HSRUN_SPLLDIV;
+				SCG->SPLLCFG = CLOCK_HSRUN_SPLLCFG;
+		}
+		else
+		{
+				SCG->SPLLDIV = CLOCK_RUN_SPLLDIV;
+				SCG->SPLLCFG = CLOCK_RUN_SPLLCFG;
+		}
+		SCG->SPLLCSR = SCG_SPLLCSR_SPLLEN_MASK;
+		for(n=0;n<CLOCK_WAIT_POLLS;n++)
+		{
+				if(SCG->SPLLCSR & SCG_SPLLCSR_SPLLVLD_MASK)	return 0;
+		}
+		SCG->SPLLCSR = 0;
+		return 1;
+}
+
+/*************************************************************************
+*  函数名称：ClockGetCoreHz
+*  功能说明：按SCG当前的时钟源和分频计算内核时钟, 切换失败停在过渡时钟时也正确
+*************************************************************************/
+uint32_t ClockGetCoreHz(void)
+{
+		uint32_t	csr,cfg,hz;
+
+		csr = SCG->CSR;
+		switch((csr & SCG_CSR_SCS_MASK) >> SCG_CSR_SCS_SHIFT)
+		{
+				case CLOCK_SCS_SOSC:	hz = CLOCK_SOSC_HZ;	break;
+				case CLOCK_SCS_SIRC:	hz = CLOCK_SIRC_HZ;	break;
+				case CLOCK_SCS_FIRC:	hz = CLOCK_FIRC_HZ;	break;
+				case CLOCK_SCS_SPLL:
+						cfg = SCG->SPLLCFG;
+						hz = CLOCK_SOSC_HZ / (((cfg & SCG_SPLLCFG_PREDIV_MASK) >> SCG_SPLLCFG_PREDIV_SHIFT) + 1)
+								 * (((cfg & SCG_SPLLCFG_MULT_MASK) >> SCG_SPLLCFG_MULT_SHIFT) + 16) / 2;
+						break;
+				default:	hz = 0;	break;
+		}
+		return hz / (((csr & SCG_CSR_DIVCORE_MASK) >> SCG_CSR_DIVCORE_SHIFT) + 1);
+}
+
+/*************************************************************************
+*  函数名称：ClockInit
+*  功能说明：按drvClock.h的配置启动SOSC和SPLL, 进入上电运行模式, 更新SystemCoreClock
+//	         SPLL正用作系统时钟时(如调试时复位未断电)先切到FIRC再重新配置
+//	         PMPROT复位后只能写一次, 这里同时允许HSRUN和VLPR; SIRC在VLP模式下保持
+*************************************************************************/
+void ClockInit(void)
+{
+		SMC->PMPROT = SMC_PMPROT_AHSRUN_MASK | SMC_PMPROT_AVLP_MASK;
+
+		//系统时钟先回到FIRC 48MHz
+		if(CLOCK_CSR_SCS() != CLOCK_SCS_FIRC)
+		{
+				ClockFircStart();
+				ClockSelect(CLOCK_FIRC_CCR);
+		}
+
+		while(SCG->SIRCCSR & SCG_SIRCCSR_LK_MASK);
+		SCG->SIRCCSR = 0;
+		SCG->SIRCDIV = CLOCK_SIRCDIV;
+		SCG->SIRCCSR = SCG_SIRCCSR_SIRCEN_MASK | SCG_SIRCCSR_SIRCLPEN_MASK;
+
+		//SOSC、SPLL未起振时停在FIRC, SystemCoreClock按实际时钟
+		if((ClockSoscStart() == 0)&&(ClockSpllStart(CLOCK_BOOT_MODE) == 0))
+		{
+#if (CLOCK_BOOT_MODE == CLOCK_MODE_HSRUN)
+				SCG->HCCR = CLOCK_HSRUN_CCR;
+				SMC->PMCTRL = SMC_PMCTRL_RUNM(3);
+				while((SMC->PMSTAT & SMC_PMSTAT_PMSTAT_MASK) != CLOCK_PMSTAT_HSRUN);
+				while(CLOCK_CSR_SCS() != CLOCK_SCS_SPLL);
+#else
+				ClockSelect(CLOCK_RUN_CCR);
+#endif
+		}
+
+		SystemCoreClock = ClockGetCoreHz();
+}
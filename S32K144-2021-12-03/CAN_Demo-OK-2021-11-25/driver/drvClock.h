@@ -0,0 +1,126 @@
+#ifndef __DRV_CLOCK_H
+#define __DRV_CLOCK_H
+
+#include <stdint.h>
+#include "S32K144.h"
+
+//时钟树配置: 只在这里改分频, 频率和SCG寄存器值由下面的宏推出, drvClock.c编译时按芯片限值检查
+//其他驱动的时钟频率(CAN位时间、LPIT、DWT)都引用本文件, 不再各自写常数
+
+//外部晶振
+#define CLOCK_SOSC_HZ					8000000uL
+//SOSCDIV1/SOSCDIV2分频(1,2,4..64), SOSCDIV2_CLK供FlexCAN(CLKSRC=0)和LPIT
+#define CLOCK_SOSC_DIV1				1
+#define CLOCK_SOSC_DIV2				1
+
+//片内时钟源
+#define CLOCK_SIRC_HZ					8000000uL
+#define CLOCK_FIRC_HZ					48000000uL
+//SIRCDIV2分频, VLPR下SOSC关闭, LPIT改用SIRCDIV2_CLK
+#define CLOCK_SIRC_DIV2				2
+
+//运行模式
+#define CLOCK_MODE_RUN				0
+#define CLOCK_MODE_HSRUN			1
+#define CLOCK_MODE_VLPR				2
+//上电后的运行模式. HSRUN/VLPR下FTFC不执行擦写命令(EEE、日志、刷写都要用), 故默认RUN
+#define CLOCK_BOOT_MODE				CLOCK_MODE_RUN
+//FlexCAN协议引擎时钟上限, CAN FD用SYS_CLK, HSRUN下超限
+#define CLOCK_CAN_PE_MAX_HZ		80000000uL
+
+//SPLL: VCO = SOSC / PREDIV * MULT, SPLL_CLK = VCO / 2
+//内核 = SPLL_CLK / DIVCORE, 总线 = 内核 / DIVBUS, Flash = 内核 / DIVSLOW
+//SPLLDIV1/2(1,2,4..64)为外设的异步时钟
+
+//RUN: SPLL 160MHz, 内核80MHz, 总线40MHz, Flash 26.67MHz
+#define CLOCK_RUN_PREDIV			1
+#define CLOCK_RUN_MULT				40
+#define CLOCK_RUN_DIVCORE			2
+#define CLOCK_RUN_DIVBUS			2
+#define CLOCK_RUN_DIVSLOW			3
+#define CLOCK_RUN_SPLLDIV1		2
+#define CLOCK_RUN_SPLLDIV2		4
+
+//HSRUN: SPLL 112MHz, 内核112MHz, 总线56MHz, Flash 28MHz
+#define CLOCK_HSRUN_PREDIV		1
+#define CLOCK_HSRUN_MULT			28
+#define CLOCK_HSRUN_DIVCORE		1
+#define CLOCK_HSRUN_DIVBUS		2
+#define CLOCK_HSRUN_DIVSLOW		4
+#define CLOCK_HSRUN_SPLLDIV1	2
+#define CLOCK_HSRUN_SPLLDIV2	4
+
+//VLPR: SIRC 8MHz, 内核4MHz, 总线4MHz, Flash 1MHz; SOSC、FIRC、SPLL都须关闭
+#define CLOCK_VLPR_DIVCORE		2
+#define CLOCK_VLPR_DIVBUS			1
+#define CLOCK_VLPR_DIVSLOW		4
+
+//切换时钟源时等待状态位的最多查询次数, 超过即报错, 限制切换耗时
+#define CLOCK_WAIT_POLLS			100000uL
+
+
+//---------------- 以下由上面的配置推出 ----------------
+
+#define CLOCK_SOSCDIV1_HZ			(CLOCK_SOSC_HZ / CLOCK_SOSC_DIV1)
+#define CLOCK_SOSCDIV2_HZ			(CLOCK_SOSC_HZ / CLOCK_SOSC_DIV2)
+#define CLOCK_SIRCDIV2_HZ			(CLOCK_SIRC_HZ / CLOCK_SIRC_DIV2)
+
+#define CLOCK_RUN_VCO_HZ			(CLOCK_SOSC_HZ / CLOCK_RUN_PREDIV * CLOCK_RUN_MULT)
+#define CLOCK_RUN_SPLL_HZ			(CLOCK_RUN_VCO_HZ / 2)
+#define CLOCK_RUN_CORE_HZ			(CLOCK_RUN_SPLL_HZ / CLOCK_RUN_DIVCORE)
+#define CLOCK_RUN_BUS_HZ			(CLOCK_RUN_CORE_HZ / CLOCK_RUN_DIVBUS)
+#define CLOCK_RUN_SLOW_HZ			(CLOCK_RUN_CORE_HZ / CLOCK_RUN_DIVSLOW)
+
+#define CLOCK_HSRUN_VCO_HZ		(CLOCK_SOSC_HZ / CLOCK_HSRUN_PREDIV * CLOCK_HSRUN_MULT)
+#define CLOCK_HSRUN_SPLL_HZ		(CLOCK_HSRUN_VCO_HZ / 2)
+#define CLOCK_HSRUN_CORE_HZ		(CLOCK_HSRUN_SPLL_HZ / CLOCK_HSRUN_DIVCORE)
+#define CLOCK_HSRUN_BUS_HZ		(CLOCK_HSRUN_CORE_HZ / CLOCK_HSRUN_DIVBUS)
+#define CLOCK_HSRUN_SLOW_HZ		(CLOCK_HSRUN_CORE_HZ / CLOCK_HSRUN_DIVSLOW)
+
+#define CLOCK_VLPR_CORE_HZ		(CLOCK_SIRC_HZ / CLOCK_VLPR_DIVCORE)
+#define CLOCK_VLPR_BUS_HZ			(CLOCK_VLPR_CORE_HZ / CLOCK_VLPR_DIVBUS)
+#define CLOCK_VLPR_SLOW_HZ		(CLOCK_VLPR_CORE_HZ / CLOCK_VLPR_DIVSLOW)
+
+//上电后的频率
+#if (CLOCK_BOOT_MODE == CLOCK_MODE_HSRUN)
+#define CLOCK_CORE_HZ					CLOCK_HSRUN_CORE_HZ
+#define CLOCK_BUS_HZ					CLOCK_HSRUN_BUS_HZ
+#define CLOCK_SLOW_HZ					CLOCK_HSRUN_SLOW_HZ
+#else
+#define CLOCK_CORE_HZ					CLOCK_RUN_CORE_HZ
+#define CLOCK_BUS_HZ					CLOCK_RUN_BUS_HZ
+#define CLOCK_SLOW_HZ					CLOCK_RUN_SLOW_HZ
+#endif
+
+//异步分频值(1,2,4..64)换成寄存器编码(1..7)
+#define CLOCK_ASYNC_DIV(n)		((n)==1 ? 1u : (n)==2 ? 2u : (n)==4 ? 3u : (n)==8 ? 4u : (n)==16 ? 5u : (n)==32 ? 6u : 7u)
+
+//SCG寄存器值
+#define CLOCK_SOSCDIV					(SCG_SOSCDIV_SOSCDIV1(CLOCK_ASYNC_DIV(CLOCK_SOSC_DIV1)) | SCG_SOSCDIV_SOSCDIV2(CLOCK_ASYNC_DIV(CLOCK_SOSC_DIV2)))
+#define CLOCK_RUN_SPLLCFG			(SCG_SPLLCFG_PREDIV(CLOCK_RUN_PREDIV - 1) | SCG_SPLLCFG_MULT(CLOCK_RUN_MULT - 16))
+#define CLOCK_RUN_SPLLDIV			(SCG_SPLLDIV_SPLLDIV1(CLOCK_ASYNC_DIV(CLOCK_RUN_SPLLDIV1)) | SCG_SPLLDIV_SPLLDIV2(CLOCK_ASYNC_DIV(CLOCK_RUN_SPLLDIV2)))
+#define CLOCK_RUN_CCR					(SCG_RCCR_SCS(6) | SCG_RCCR_DIVCORE(CLOCK_RUN_DIVCORE - 1) | \
+															 SCG_RCCR_DIVBUS(CLOCK_RUN_DIVBUS - 1) | SCG_RCCR_DIVSLOW(CLOCK_RUN_DIVSLOW - 1))
+#define CLOCK_HSRUN_SPLLCFG		(SCG_SPLLCFG_PREDIV(CLOCK_HSRUN_PREDIV - 1) | SCG_SPLLCFG_MULT(CLOCK_HSRUN_MULT - 16))
+#define CLOCK_HSRUN_SPLLDIV		(SCG_SPLLDIV_SPLLDIV1(CLOCK_ASYNC_DIV(CLOCK_HSRUN_SPLLDIV1)) | SCG_SPLLDIV_SPLLDIV2(CLOCK_ASYNC_DIV(CLOCK_HSRUN_SPLLDIV2)))
+#define CLOCK_HSRUN_CCR				(SCG_HCCR_SCS(6) | SCG_HCCR_DIVCORE(CLOCK_HSRUN_DIVCORE - 1) | \
+															 SCG_HCCR_DIVBUS(CLOCK_HSRUN_DIVBUS - 1) | SCG_HCCR_DIVSLOW(CLOCK_HSRUN_DIVSLOW - 1))
+#define CLOCK_VLPR_CCR				(SCG_VCCR_SCS(2) | SCG_VCCR_DIVCORE(CLOCK_VLPR_DIVCORE - 1) | \
+															 SCG_VCCR_DIVBUS(CLOCK_VLPR_DIVBUS - 1) | SCG_VCCR_DIVSLOW(CLOCK_VLPR_DIVSLOW - 1))
+#define CLOCK_SIRCDIV					(SCG_SIRCDIV_SIRCDIV1(1) | SCG_SIRCDIV_SIRCDIV2(CLOCK_ASYNC_DIV(CLOCK_SIRC_DIV2)))
+//模式切换中的过渡时钟: RUN下用FIRC 48/24/24MHz或SIRC 8/8/4MHz
+#define CLOCK_FIRC_CCR				(SCG_RCCR_SCS(3) | SCG_RCCR_DIVCORE(0) | SCG_RCCR_DIVBUS(1) | SCG_RCCR_DIVSLOW(1))
+#define CLOCK_SIRC_CCR				(SCG_RCCR_SCS(2) | SCG_RCCR_DIVCORE(0) | SCG_RCCR_DIVBUS(0) | SCG_RCCR_DIVSLOW(1))
+
+
+extern uint32_t SystemCoreClock;
+
+void			ClockInit(void);
+uint8_t		ClockSelect(uint32_t Ccr);
+uint8_t		ClockSoscStart(void);
+uint8_t		ClockFircStart(void);
+uint8_t		ClockSpllStart(uint8_t Mode);
+uint32_t	ClockGetCoreHz(void);
+
+
+#endif /* __DRV_CLOCK_H */
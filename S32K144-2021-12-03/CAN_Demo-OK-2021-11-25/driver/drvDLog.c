@@ -0,0 +1,425 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvflash.h"
+#include "drvBoot.h"
+#include "drvDLog.h"
+
+//扇区状态
+#define DLOG_SEC_FREE						0				//已擦除
+#define DLOG_SEC_USED						1
+#define DLOG_SEC_DIRTY					2				//内容无效, 待擦除
+#define DLOG_NONE								0xFF
+
+//记录解析结果
+#define DLOG_PARSE_END					0				//后面已擦除
+#define DLOG_PARSE_OK						1
+#define DLOG_PARSE_CRC					2				//长度可信, CRC不符, 跳过
+#define DLOG_PARSE_BAD					3				//记录头损坏, 扇区其余部分不可用
+
+//一条排队写入的记录(或扇区头), 写完前数据留在这里, 读取时也从这里取
+typedef	struct
+{
+		uint8_t				Buf[DLOG_REC_MAX];
+		uint32_t			Addr;
+		volatile uint8_t	Done;
+		uint8_t				Used;
+
+}		DLogPendType;
+
+typedef	struct
+{
+		uint8_t				State[DLOG_SECTOR_NUM];
+		uint32_t			Seq[DLOG_SECTOR_NUM];
+		uint32_t			MaxSeq;
+		uint8_t				Head;						//正在追加的扇区
+		uint32_t			Next;						//下一条记录的地址
+		uint32_t			Index[DLOG_KEY_MAX];		//每个键最新记录的地址, 0:无
+
+		//后台压缩: 把Victim中仍是最新的记录追加到Head, 然后擦除
+		uint8_t				Victim;
+		uint32_t			CompPos;
+		uint8_t				Erasing;
+		volatile uint8_t	EraseDone;
+
+		uint8_t				Ready;
+		uint8_t				Error;
+		DLogPendType	Pend[DLOG_PEND_NUM];
+
+}		DLogStateType;
+
+static DLogStateType	DLog;
+
+
+static uint32_t DLog_Get32(const uint8_t *p)
+{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*************************************************************************
+*  函数名称：DLog_Parse
+*  功能说明：解析Addr处的记录
+*  参数说明：Addr：记录地址
+//	         End：扇区结束地址
+//	         Size：输出记录占用字节数
+*  函数返回：DLOG_PARSE_xxx
+*************************************************************************/
+static uint8_t DLog_Parse(uint32_t Addr, uint32_t End, uint32_t *Size)
+{
+		const uint8_t	*p = FLASH_PTR(const uint8_t, Addr);
+		uint8_t				len;
+
+		if(Addr + 8 > End)	return DLOG_PARSE_END;
+		if(DLog_Get32(p) == 0xFFFFFFFF)	return DLOG_PARSE_END;
+		len = p[2];
+		if((p[3] != DLOG_MARK)||(len > DLOG_DATA_MAX)||(Addr + DLOG_REC_BYTES(len) > End))	return DLOG_PARSE_BAD;
+		*Size = DLOG_REC_BYTES(len);
+		if(DLog_Get32(&p[4 + len]) != BootCrc32(p, 4 + (uint32_t)len))	return DLOG_PARSE_CRC;
+		return DLOG_PARSE_OK;
+}
+
+static uint8_t DLog_Blank(uint32_t Addr, uint32_t Len)
+{
+		for(;Len;Len-=4,Addr+=4)
+		{
+				if(*FLASH_PTR(const uint32_t, Addr) != 0xFFFFFFFF)	return 0;
+		}
+		return 1;
+}
+
+static DLogPendType *DLog_PendGet(void)
+{
+		uint8_t	i;
+
+		for(i=0;i<DLOG_PEND_NUM;i++)
+		{
+				if((DLog.Pend[i].Used == 0)||(DLog.Pend[i].Done != FLASH_JOB_PENDING))
+				{
+						if(DLog.Pend[i].Used && (DLog.Pend[i].Done != FLASH_JOB_OK))	DLog.Error = 1;
+						DLog.Pend[i].Used = 0;
+						return &DLog.Pend[i];
+				}
+		}
+		return 0;
+}
+
+static uint8_t DLog_FreeCount(void)
+{
+		uint8_t	s,n;
+
+		n = 0;
+		for(s=0;s<DLOG_SECTOR_NUM;s++)
+		{
+				if(DLog.State[s] == DLOG_SEC_FREE)	n++;
+		}
+		return n;
+}
+
+/*************************************************************************
+*  函数名称：DLog_Open
+*  功能说明：取一个空闲扇区作为新的追加扇区, 排队写入扇区头
+*  参数说明：Reserve：1:保留最后DLOG_FREE_MIN-1个空闲扇区给压缩
+*  函数返回：0：成功  1：无空闲扇区或队列满
+*************************************************************************/
+static uint8_t DLog_Open(uint8_t Reserve)
+{
+		DLogPendType	*pend;
+		uint8_t				s;
+
+		if(Reserve && (DLog_FreeCount() < DLOG_FREE_MIN))	return 1;
+		for(s=0;s<DLOG_SECTOR_NUM;s++)
+		{
+				if(DLog.State[s] == DLOG_SEC_FREE)	break;
+		}
+		if(s >= DLOG_SECTOR_NUM)	return 1;
+		pend = DLog_PendGet();
+		if(pend == 0)	return 1;
+
+		*(uint32_t *)&pend->Buf[0] = DLOG_MAGIC;
+		*(uint32_t *)&pend->Buf[4] = DLog.MaxSeq + 1;
+		pend->Addr = DLOG_SECTOR_ADDR(s);
+		if(FlashAsyncWrite(DLOG_CMD_ADDR(pend->Addr), DLOG_HEAD_BYTES, pend->Buf, &pend->Done))	return 1;
+		pend->Used = 1;
+
+		DLog.MaxSeq++;
+		DLog.State[s] = DLOG_SEC_USED;
+		DLog.Seq[s]		= DLog.MaxSeq;
+		DLog.Head			= s;
+		DLog.Next			= pend->Addr + DLOG_HEAD_BYTES;
+		return 0;
+}
+
+//追加一条记录, 更新索引; Reserve同DLog_Open
+//Data可以在D-Flash中(压缩搬移), 须在排队写入扇区头之前拷贝出来
+static uint8_t DLog_Put(uint16_t Key, const uint8_t *Data, uint8_t Len, uint8_t Reserve)
+{
+		DLogPendType	*pend;
+		uint32_t			size,crc;
+		uint8_t				i;
+
+		pend = DLog_PendGet();
+		if(pend == 0)	return 1;
+
+		pend->Buf[0] = (uint8_t)Key;
+		pend->Buf[1] = (uint8_t)(Key >> 8);
+		pend->Buf[2] = Len;
+		pend->Buf[3] = DLOG_MARK;
+		for(i=0;i<Len;i++)	pend->Buf[4+i] = Data[i];
+		crc = BootCrc32(pend->Buf, 4 + (uint32_t)Len);
+		for(i=0;i<4;i++)	pend->Buf[4+Len+i] = (uint8_t)(crc >> (8*i));
+		size = DLOG_REC_BYTES(Len);
+		for(i=8+Len;i<size;i++)	pend->Buf[i] = 0xFF;
+
+		//占住缓冲, 开新扇区时不会被扇区头取用
+		pend->Used = 1;
+		pend->Done = FLASH_JOB_PENDING;
+		if((DLog.Head == DLOG_NONE)||(DLog.Next + size > DLOG_SECTOR_ADDR(DLog.Head) + DLOG_SECTOR_BYTES))
+		{
+				if(DLog_Open(Reserve))
+				{
+						pend->Used = 0;
+						return 1;
+				}
+		}
+		pend->Addr = DLog.Next;
+		if(FlashAsyncWrite(DLOG_CMD_ADDR(pend->Addr), size, pend->Buf, &pend->Done))
+		{
+				pend->Used = 0;
+				return 1;
+		}
+
+		DLog.Index[Key] = DLog.Next;
+		DLog.Next += size;
+		return 0;
+}
+
+//按序号从旧到新回放一个扇区, 建立索引, 返回最后一条记录之后的地址
+static uint32_t DLog_Replay(uint8_t s)
+{
+		uint32_t	addr,end,size;
+		uint8_t		r;
+
+		addr = DLOG_SECTOR_ADDR(s) + DLOG_HEAD_BYTES;
+		end	 = DLOG_SECTOR_ADDR(s) + DLOG_SECTOR_BYTES;
+		while(1)
+		{
+				r = DLog_Parse(addr, end, &size);
+				if(r == DLOG_PARSE_END)	return addr;
+				if(r == DLOG_PARSE_BAD)	return end;
+				if((r == DLOG_PARSE_OK)&&(*FLASH_PTR(const uint16_t, addr) < DLOG_KEY_MAX))
+						DLog.Index[*FLASH_PTR(const uint16_t, addr)] = addr;
+				addr += size;
+		}
+}
+
+
+
+/*************************************************************************
+*  函数名称：DLogInit
+*  功能说明：扫描D-Flash: 扇区头有效的按序号从旧到新回放建立索引,
+//	         最新的扇区继续追加; 扇区头为空但内容不全为FF的(擦除中掉电)待擦除
+//	         在EeeInit(分区)之后、异步擦写开始之前调用
+*  参数说明：无
+*  函数返回：0：成功  1：D-Flash不可用
+*************************************************************************/
+uint8_t DLogInit(void)
+{
+		const uint32_t	*head;
+		uint32_t				last,min,next;
+		uint8_t					s,k,sel;
+
+		for(k=0;k<DLOG_KEY_MAX;k++)	DLog.Index[k] = 0;
+		for(k=0;k<DLOG_PEND_NUM;k++)	DLog.Pend[k].Used = 0;
+		DLog.MaxSeq	= 0;
+		DLog.Head		= DLOG_NONE;
+		DLog.Victim	= DLOG_NONE;
+		DLog.Erasing = DLOG_NONE;
+		DLog.Ready	= 0;
+		DLog.Error	= 0;
+
+		//分区后D-Flash小于32KB时不可用
+		k = (uint8_t)((SIM->FCFG1 & SIM_FCFG1_DEPART_MASK) >> SIM_FCFG1_DEPART_SHIFT);
+		if((k == 0x4)||(k == 0x8)||(k == 0xA))
+		{
+				DLog.Error = 1;
+				return 1;
+		}
+		DLog.Ready = 1;
+
+		LMEM->PCCCR = 0x85000001;
+		for(s=0;s<DLOG_SECTOR_NUM;s++)
+		{
+				head = FLASH_PTR(const uint32_t, DLOG_SECTOR_ADDR(s));
+				if((head[0] == DLOG_MAGIC)&&(head[1] != 0xFFFFFFFF))
+				{
+						DLog.State[s] = DLOG_SEC_USED;
+						DLog.Seq[s]		= head[1];
+						if(head[1] > DLog.MaxSeq)	DLog.MaxSeq = head[1];
+				}
+				else
+				{
+						DLog.State[s] = DLog_Blank(DLOG_SECTOR_ADDR(s), DLOG_SECTOR_BYTES) ? DLOG_SEC_FREE : DLOG_SEC_DIRTY;
+				}
+		}
+
+		//序号从小到大回放, 后面的记录覆盖前面的
+		last = 0;
+		while(1)
+		{
+				sel = DLOG_NONE;
+				min = 0xFFFFFFFF;
+				for(s=0;s<DLOG_SECTOR_NUM;s++)
+				{
+						if((DLog.State[s] == DLOG_SEC_USED)&&(DLog.Seq[s] > last)&&(DLog.Seq[s] <= min))
+						{
+								sel = s;
+								min = DLog.Seq[s];
+						}
+				}
+				if(sel == DLOG_NONE)	break;
+				next = DLog_Replay(sel);
+				DLog.Head = sel;
+				DLog.Next = next;
+				last = min;
+		}
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：DLogAppend
+*  功能说明：追加一条记录, 只排队phrase写入, 不等待, 不擦除
+*  参数说明：Key：键, 小于DLOG_KEY_MAX
+//	         Data：数据, 函数返回后可改动
+//	         Len：字节数, 不超过DLOG_DATA_MAX
+*  函数返回：0：已排队  1：参数错误、无空间(等待压缩)或缓冲满
+*************************************************************************/
+uint8_t DLogAppend(uint16_t Key, const uint8_t *Data, uint8_t Len)
+{
+		if((DLog.Ready == 0)||(Key >= DLOG_KEY_MAX)||(Len > DLOG_DATA_MAX))	return 1;
+		return DLog_Put(Key, Data, Len, 1);
+}
+
+/*************************************************************************
+*  函数名称：DLogRead
+*  功能说明：按索引读一个键的最新记录; 还在写入的从缓冲读,
+//	         已写入的先暂停D-Flash擦写再读, 避免读冲突
+*  参数说明：Key：键
+//	         Data：输出, 至少DLOG_DATA_MAX字节
+//	         Len：输出字节数
+*  函数返回：0：成功  1：无记录或CRC错误
+*************************************************************************/
+uint8_t DLogRead(uint16_t Key, uint8_t *Data, uint8_t *Len)
+{
+		const uint8_t	*p;
+		uint32_t			addr,size;
+		uint8_t				i,r;
+
+		if((Key >= DLOG_KEY_MAX)||(DLog.Index[Key] == 0))	return 1;
+		addr = DLog.Index[Key];
+		for(i=0;i<DLOG_PEND_NUM;i++)
+		{
+				if(DLog.Pend[i].Used && (DLog.Pend[i].Addr == addr)&&(DLog.Pend[i].Done == FLASH_JOB_PENDING))
+				{
+						p = DLog.Pend[i].Buf;
+						*Len = p[2];
+						for(i=0;i<p[2];i++)	Data[i] = p[4+i];
+						return 0;
+				}
+		}
+
+		FlashEraseSuspend();
+		LMEM->PCCCR = 0x85000001;
+		r = DLog_Parse(addr, (addr & ~(DLOG_SECTOR_BYTES - 1)) + DLOG_SECTOR_BYTES, &size);
+		if(r == DLOG_PARSE_OK)
+		{
+				p = FLASH_PTR(const uint8_t, addr);
+				*Len = p[2];
+				for(i=0;i<p[2];i++)	Data[i] = p[4+i];
+		}
+		FlashEraseResume();
+		return (r == DLOG_PARSE_OK) ? 0 : 1;
+}
+
+/*************************************************************************
+*  函数名称：DLogTask
+*  功能说明：主循环调用, 只在异步擦写队列空闲时推进一步:
+//	         擦除待擦除扇区; 空闲扇区不足时选序号最小的扇区, 每次搬一条仍为最新的记录,
+//	         搬完后擦除
+*************************************************************************/
+void DLogTask(void)
+{
+		uint32_t	end,size,addr,min;
+		uint8_t		s,r;
+
+		if((DLog.Ready == 0)||FlashAsyncBusy())	return;
+
+		if(DLog.Erasing != DLOG_NONE)
+		{
+				if(DLog.EraseDone == FLASH_JOB_OK)
+				{
+						DLog.State[DLog.Erasing] = DLOG_SEC_FREE;
+				}
+				else
+				{
+						DLog.Error = 1;
+				}
+				DLog.Erasing = DLOG_NONE;
+				return;
+		}
+
+		for(s=0;s<DLOG_SECTOR_NUM;s++)
+		{
+				if(DLog.State[s] == DLOG_SEC_DIRTY)
+				{
+						if(FlashAsyncErase(DLOG_CMD_ADDR(DLOG_SECTOR_ADDR(s)), &DLog.EraseDone) == 0)	DLog.Erasing = s;
+						return;
+				}
+		}
+
+		if(DLog.Victim == DLOG_NONE)
+		{
+				if(DLog_FreeCount() >= DLOG_FREE_MIN)	return;
+				min = 0xFFFFFFFF;
+				for(s=0;s<DLOG_SECTOR_NUM;s++)
+				{
+						if((DLog.State[s] == DLOG_SEC_USED)&&(s != DLog.Head)&&(DLog.Seq[s] < min))
+						{
+								DLog.Victim = s;
+								min = DLog.Seq[s];
+						}
+				}
+				if(DLog.Victim == DLOG_NONE)	return;
+				DLog.CompPos = DLOG_SECTOR_ADDR(DLog.Victim) + DLOG_HEAD_BYTES;
+		}
+
+		LMEM->PCCCR = 0x85000001;
+		end = DLOG_SECTOR_ADDR(DLog.Victim) + DLOG_SECTOR_BYTES;
+		while(1)
+		{
+				addr = DLog.CompPos;
+				r = DLog_Parse(addr, end, &size);
+				if((r == DLOG_PARSE_END)||(r == DLOG_PARSE_BAD))	break;
+				if((r == DLOG_PARSE_OK)&&(*FLASH_PTR(const uint16_t, addr) < DLOG_KEY_MAX)&&(DLog.Index[*FLASH_PTR(const uint16_t, addr)] == addr))
+				{
+						if(DLog_Put(*FLASH_PTR(const uint16_t, addr), FLASH_PTR(const uint8_t, addr) + 4, *FLASH_PTR(const uint8_t, addr + 2), 0) == 0)
+								DLog.CompPos += size;
+						return;
+				}
+				DLog.CompPos += size;
+		}
+
+		//没有最新记录了, 擦除
+		DLog.State[DLog.Victim] = DLOG_SEC_DIRTY;
+		DLog.Victim = DLOG_NONE;
+}
+
+uint8_t DLogFreeSectors(void)
+{
+		if(DLog.Ready == 0)	return 0;
+		return DLog_FreeCount();
+}
+
+//D-Flash不可用或擦写出错
+uint8_t DLogError(void)
+{
+		return DLog.Error;
+}
@@ -0,0 +1,44 @@
+#ifndef __DRV_DLOG_H
+#define __DRV_DLOG_H
+
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvflash.h"
+
+//D-Flash记录日志: 只追加, 同一键的新记录覆盖旧记录, 后台压缩最旧的扇区
+//D-Flash为FlexNVM分区出的32KB(见drvEee.h), 2KB扇区, 与P-Flash不同块, 擦写时程序可继续运行
+#define DLOG_BASE								0x10000000
+#define DLOG_SECTOR_BYTES				2048
+#define DLOG_SECTOR_NUM					16
+#define DLOG_SECTOR_ADDR(s)			(DLOG_BASE + (uint32_t)(s) * DLOG_SECTOR_BYTES)
+//FTFC命令中FlexNVM的地址从0x800000开始
+#define DLOG_CMD_ADDR(a)				((a) - DLOG_BASE + 0x00800000)
+
+//扇区头8字节: 标识, 序号(越大越新)
+#define DLOG_MAGIC							0xD1064C47uL
+#define DLOG_HEAD_BYTES					8
+
+//记录: Key(2) Len(1) Mark(1) Data(Len) CRC32(4), 按8字节phrase补齐
+//CRC覆盖Key到Data, 掉电写了一半的记录CRC不符被跳过
+#define DLOG_MARK								0xA5
+#define DLOG_DATA_MAX						56
+#define DLOG_REC_BYTES(len)			((4 + (uint32_t)(len) + 4 + 7) & ~7uL)
+#define DLOG_REC_MAX						DLOG_REC_BYTES(DLOG_DATA_MAX)
+
+//键为0~DLOG_KEY_MAX-1, RAM索引记录每个键最新记录的地址
+#define DLOG_KEY_MAX						64
+//正在写入的记录缓冲数
+#define DLOG_PEND_NUM						4
+//空闲扇区少于此数时开始压缩, 最后一个空闲扇区只给压缩使用
+#define DLOG_FREE_MIN						2
+
+
+uint8_t		DLogInit(void);
+uint8_t		DLogAppend(uint16_t Key, const uint8_t *Data, uint8_t Len);
+uint8_t		DLogRead(uint16_t Key, uint8_t *Data, uint8_t *Len);
+void			DLogTask(void);
+uint8_t		DLogFreeSectors(void);
+uint8_t		DLogError(void);
+
+
+#endif /* __DRV_DLOG_H */
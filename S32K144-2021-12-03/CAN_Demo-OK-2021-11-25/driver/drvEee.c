@@ -0,0 +1,346 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvflash.h"
+#include "drvEee.h"
+
+//EEE写入作业的伪键号: 头部标识字和写入次数字
+#define EEE_JOB_HEAD						0xFFFE
+#define EEE_JOB_COUNT						0xFFFF
+
+typedef	struct
+{
+		const EeeKeyType	*Keys;
+		uint16_t			Num;
+		uint8_t				Ready;					//FlexRAM已处于EEE模式
+		uint8_t				Suspended;			//EeeSuspend切为RAM, 读写都走Shadow, 恢复后写入
+		uint8_t				Error;
+
+		//待写入的值, Dirty置位的键读写都走这里
+		uint32_t			Shadow[EEE_KEY_MAX];
+		uint32_t			Dirty[(EEE_KEY_MAX + 31) / 32];
+		uint8_t				HeadDirty;
+		uint8_t				CountDirty;
+		uint16_t			Scan;						//下一个检查的键, 轮流写入
+		uint32_t			Writes;					//累计EEE写入次数
+
+		//正在写入的一个字, 经异步擦写队列与Flash擦写串行执行
+		uint8_t				JobBusy;
+		uint16_t			JobKey;
+		uint32_t			JobValue;
+		volatile uint8_t	JobDone;
+
+}		EeeStateType;
+
+static EeeStateType	Eee;
+
+
+static uint8_t Eee_IsDirty(uint16_t Key)
+{
+		return (Eee.Dirty[Key >> 5] >> (Key & 31)) & 1;
+}
+
+//同步执行一条FlexNVM命令(PGMPART/SETRAM), 只在初始化和EeeSuspend/EeeResume中使用, 异步擦写队列须空闲
+static uint8_t Eee_Command(uint8_t Cmd, uint8_t Fccob1, uint8_t Fccob4, uint8_t Fccob5)
+{
+		while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0);
+		FTFC->FSTAT = FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK | FTFC_FSTAT_RDCOLERR_MASK;
+		FTFC->FCCOB[3] = Cmd;										//FCCOB0
+		FTFC->FCCOB[2] = Fccob1;								//FCCOB1
+		FTFC->FCCOB[1] = 0;											//FCCOB2
+		FTFC->FCCOB[0] = 0;											//FCCOB3
+		FTFC->FCCOB[7] = Fccob4;								//FCCOB4
+		FTFC->FCCOB[6] = Fccob5;								//FCCOB5
+		FTFC->FSTAT = FTFC_FSTAT_CCIF_MASK;
+		while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0);
+		return (FTFC->FSTAT & FLASH_ERR_MASK) ? 1 : 0;
+}
+
+
+
+/*************************************************************************
+*  函数名称：EeeInit
+*  功能说明：未分区时按 EEE_SIZE_CODE/EEE_DEPART_CODE 分区, 把FlexRAM设为EEE模式,
+//	         检查头部: 标识不符时全部键写入默认值, 键表变长时新键写入默认值
+//	         在FlashAsyncInit之后、其他Flash操作之前调用
+*  参数说明：Keys：键表, 下标即键号
+//	         Num：键数, 不超过EEE_KEY_MAX
+*  函数返回：0：成功  1：EEE不可用, 只在RAM中保存默认值和写入的值
+*************************************************************************/
+uint8_t EeeInit(const EeeKeyType *Keys, uint16_t Num)
+{
+		uint32_t	head;
+		uint16_t	k,stored;
+
+		if(Num > EEE_KEY_MAX)	Num = EEE_KEY_MAX;
+		Eee.Keys			 = Keys;
+		Eee.Num				 = Num;
+		Eee.Ready			 = 0;
+		Eee.Suspended	 = 0;
+		Eee.Error			 = 0;
+		Eee.HeadDirty	 = 0;
+		Eee.CountDirty = 0;
+		Eee.Scan			 = 0;
+		Eee.Writes		 = 0;
+		Eee.JobBusy		 = 0;
+		for(k=0;k<(EEE_KEY_MAX + 31) / 32;k++)	Eee.Dirty[k] = 0;
+		for(k=0;k<Num;k++)	Eee.Shadow[k] = Keys[k].Default.u;
+
+		if(((SIM->FCFG1 & SIM_FCFG1_DEPART_MASK) >> SIM_FCFG1_DEPART_SHIFT) == EEE_DEPART_NONE)
+		{
+				if(Eee_Command(FLASH_CMD_PGMPART, 0, EEE_SIZE_CODE, EEE_DEPART_CODE))
+				{
+						Eee.Error = 1;
+						return 1;
+				}
+		}
+		if((FTFC->FCNFG & FTFC_FCNFG_EEERDY_MASK) == 0)
+		{
+				if(Eee_Command(FLASH_CMD_SETRAM, 0x00, 0, 0)||((FTFC->FCNFG & FTFC_FCNFG_EEERDY_MASK) == 0))
+				{
+						Eee.Error = 1;
+						return 1;
+				}
+		}
+		Eee.Ready = 1;
+
+		head = *(volatile uint32_t *)FLASH_FLEXRAM_ADDR;
+		if((head & EEE_MAGIC_MASK) == EEE_MAGIC)
+		{
+				stored		 = (uint16_t)head;
+				Eee.Writes = *(volatile uint32_t *)(FLASH_FLEXRAM_ADDR + 4);
+		}
+		else
+		{
+				stored = 0;
+				Eee.CountDirty = 1;
+		}
+		if(stored > Num)	stored = Num;
+		for(k=stored;k<Num;k++)	Eee.Dirty[k >> 5] |= 1uL << (k & 31);
+		if(head != (EEE_MAGIC | Num))	Eee.HeadDirty = 1;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：EeeTask
+*  功能说明：主循环调用, 每次最多排队写入一个字: 先写键, 再写头部标识, 最后写入次数
+//	         同一个键写入前多次修改只写最后的值
+*************************************************************************/
+void EeeTask(void)
+{
+		uint32_t	addr;
+		uint16_t	i,k;
+
+		if(Eee.Ready == 0)	return;
+		if(Eee.JobBusy)
+		{
+				if(Eee.JobDone == FLASH_JOB_PENDING)	return;
+				if(Eee.JobDone != FLASH_JOB_OK)	Eee.Error = 1;
+				Eee.JobBusy = 0;
+		}
+
+		k = EEE_JOB_COUNT;
+		for(i=0;i<Eee.Num;i++)
+		{
+				if(Eee_IsDirty(Eee.Scan))
+				{
+						k = Eee.Scan;
+						break;
+				}
+				if(++Eee.Scan >= Eee.Num)	Eee.Scan = 0;
+		}
+		if(k != EEE_JOB_COUNT)
+		{
+				addr = EEE_KEY_ADDR(k);
+				Eee.JobValue = Eee.Shadow[k];
+		}
+		else if(Eee.HeadDirty)
+		{
+				k = EEE_JOB_HEAD;
+				addr = FLASH_FLEXRAM_ADDR;
+				Eee.JobValue = EEE_MAGIC | Eee.Num;
+		}
+		else if(Eee.CountDirty)
+		{
+				addr = FLASH_FLEXRAM_ADDR + 4;
+				Eee.JobValue = Eee.Writes + 1;
+		}
+		else
+		{
+				return;
+		}
+
+		if(FlashAsyncEeeWrite(addr, &Eee.JobValue, &Eee.JobDone))	return;
+		if(k == EEE_JOB_HEAD)					Eee.HeadDirty = 0;
+		else if(k == EEE_JOB_COUNT)		Eee.CountDirty = 0;
+		else													Eee.Dirty[k >> 5] &= ~(1uL << (k & 31));
+		Eee.JobKey	= k;
+		Eee.JobBusy = 1;
+		if((++Eee.Writes % EEE_COUNT_STEP) == 0)	Eee.CountDirty = 1;
+}
+
+/*************************************************************************
+*  函数名称：EeeSuspend
+*  功能说明：用SETRAM把FlexRAM切为普通RAM, 让P-Flash写入能用Program Section(drvFLASH按RAMRDY选择)
+//	         切换前把各键的值读入Shadow, 暂停期间读写都走Shadow, 改过的键在EeeResume后写入
+//	         EEE数据保存在FlexNVM备份区, 切回时由FTFC重新装入FlexRAM
+*  函数返回：0：已暂停  1：EEE不可用、有EEE写入或Flash作业未完成(稍后再试)、切换失败
+*************************************************************************/
+uint8_t EeeSuspend(void)
+{
+		uint16_t	k;
+
+		if(Eee.Suspended)	return 0;
+		if((Eee.Ready == 0)||Eee.JobBusy||FlashAsyncBusy())	return 1;
+
+		for(k=0;k<Eee.Num;k++)
+		{
+				if(Eee_IsDirty(k) == 0)	Eee.Shadow[k] = *FLASH_PTR(volatile uint32_t, EEE_KEY_ADDR(k));
+		}
+		Eee.Ready = 0;
+		if(Eee_Command(FLASH_CMD_SETRAM, 0xFF, 0, 0)||((FTFC->FCNFG & FTFC_FCNFG_RAMRDY_MASK) == 0))
+		{
+				//仍在EEE模式则照旧使用
+				if(FTFC->FCNFG & FTFC_FCNFG_EEERDY_MASK)	Eee.Ready = 1;
+				else																			Eee.Error = 1;
+				return 1;
+		}
+		Eee.Suspended = 1;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：EeeResume
+*  功能说明：用SETRAM把FlexRAM切回EEE模式, 暂停期间改过的键由EeeTask写入
+//	         FTFC从备份区装入EEE数据, 4KB EEE约需数毫秒, 期间等待
+*  函数返回：0：已恢复或未暂停  1：Flash作业未完成(稍后再试)或切换失败(此后只用RAM中的值)
+*************************************************************************/
+uint8_t EeeResume(void)
+{
+		if(Eee.Suspended == 0)	return 0;
+		if(FlashAsyncBusy())	return 1;
+
+		if(Eee_Command(FLASH_CMD_SETRAM, 0x00, 0, 0)||((FTFC->FCNFG & FTFC_FCNFG_EEERDY_MASK) == 0))
+		{
+				Eee.Suspended = 0;
+				Eee.Error = 1;
+				return 1;
+		}
+		Eee.Suspended = 0;
+		Eee.Ready = 1;
+		return 0;
+}
+
+//有未写完的值, 复位前应等待; 暂停期间改过的键也算, 须先EeeResume
+uint8_t EeeBusy(void)
+{
+		uint16_t	k;
+
+		if((Eee.Ready == 0)&&(Eee.Suspended == 0))	return 0;
+		if(Eee.JobBusy || Eee.HeadDirty)	return 1;
+		for(k=0;k<(EEE_KEY_MAX + 31) / 32;k++)
+		{
+				if(Eee.Dirty[k])	return 1;
+		}
+		return 0;
+}
+
+//EEE不可用或写入出错
+uint8_t EeeError(void)
+{
+		return Eee.Error;
+}
+
+uint16_t EeeKeyNum(void)
+{
+		return Eee.Num;
+}
+
+//累计EEE写入次数(含头部和计数本身), 用于估计FlexNVM寿命
+uint32_t EeeWriteCount(void)
+{
+		return Eee.Writes;
+}
+
+/*************************************************************************
+*  函数名称：EeeGetRaw
+*  功能说明：读一个键的32位原始值, 已写入的直接从FlexRAM读
+*  参数说明：Key：键号
+//	         Value：输出
+*  函数返回：0：成功  1：键号错误
+*************************************************************************/
+uint8_t EeeGetRaw(uint16_t Key, uint32_t *Value)
+{
+		if(Key >= Eee.Num)	return 1;
+		if((Eee.Ready == 0)||Eee_IsDirty(Key)||(Eee.JobBusy && (Eee.JobKey == Key)))
+				*Value = Eee.Shadow[Key];
+		else
+				*Value = *FLASH_PTR(volatile uint32_t, EEE_KEY_ADDR(Key));
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：EeeSetRaw
+*  功能说明：写一个键的32位原始值, 只记入RAM并标记, 由EeeTask在后台写入; 值不变时不写
+*  参数说明：Key：键号
+//	         Value：值
+*  函数返回：0：成功  1：键号错误
+*************************************************************************/
+uint8_t EeeSetRaw(uint16_t Key, uint32_t Value)
+{
+		uint32_t	old;
+
+		if(EeeGetRaw(Key, &old))	return 1;
+		if(old == Value)	return 0;
+		Eee.Shadow[Key] = Value;
+		if(Eee.Ready||Eee.Suspended)	Eee.Dirty[Key >> 5] |= 1uL << (Key & 31);
+		return 0;
+}
+
+//按类型读写, 键号错误或类型不符时读返回0, 写返回1
+uint32_t EeeGetU32(uint16_t Key)
+{
+		EeeValueType	v;
+
+		if((Key >= Eee.Num)||(Eee.Keys[Key].Type != EEE_TYPE_U32)||EeeGetRaw(Key, &v.u))	return 0;
+		return v.u;
+}
+
+int32_t EeeGetI32(uint16_t Key)
+{
+		EeeValueType	v;
+
+		if((Key >= Eee.Num)||(Eee.Keys[Key].Type != EEE_TYPE_I32)||EeeGetRaw(Key, &v.u))	return 0;
+		return v.i;
+}
+
+float EeeGetF32(uint16_t Key)
+{
+		EeeValueType	v;
+
+		if((Key >= Eee.Num)||(Eee.Keys[Key].Type != EEE_TYPE_F32)||EeeGetRaw(Key, &v.u))	return 0;
+		return v.f;
+}
+
+uint8_t EeeSetU32(uint16_t Key, uint32_t Value)
+{
+		if((Key >= Eee.Num)||(Eee.Keys[Key].Type != EEE_TYPE_U32))	return 1;
+		return EeeSetRaw(Key, Value);
+}
+
+uint8_t EeeSetI32(uint16_t Key, int32_t Value)
+{
+		EeeValueType	v;
+
+		if((Key >= Eee.Num)||(Eee.Keys[Key].Type != EEE_TYPE_I32))	return 1;
+		v.i = Value;
+		return EeeSetRaw(Key, v.u);
+}
+
+uint8_t EeeSetF32(uint16_t Key, float Value)
+{
+		EeeValueType	v;
+
+		if((Key >= Eee.Num)||(Eee.Keys[Key].Type != EEE_TYPE_F32))	return 1;
+		v.f = Value;
+		return EeeSetRaw(Key, v.u);
+}
@@ -0,0 +1,67 @@
+#ifndef __DRV_EEE_H
+#define __DRV_EEE_H
+
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvflash.h"
+
+//FlexNVM分区: 4KB EEE(FlexRAM), 32KB D-Flash + 32KB EEE备份区
+//只在未分区的芯片上执行一次, 改分区须先Erase All Blocks
+//FlexRAM处于EEE模式时P-Flash只能按phrase写入(约65KB/s); UDS下载期间用EeeSuspend切为RAM,
+//Program Section约123KB/s(tools/ftfcsim/bench.cpp), 下载结束后EeeResume切回
+#define EEE_SIZE_CODE						0x02
+#define EEE_DEPART_CODE					0x03
+#define EEE_DEPART_NONE					0x0F			//SIM_FCFG1.DEPART: 未分区
+#define EEE_BYTES								4096
+
+//FlexRAM布局: 头16字节(标识|键数, 累计写入次数), 之后每个键一个字, 下标即键号
+#define EEE_MAGIC								0xEE0E0000uL
+#define EEE_MAGIC_MASK					0xFFFF0000uL
+#define EEE_HEAD_BYTES					16
+#define EEE_KEY_ADDR(k)					(FLASH_FLEXRAM_ADDR + EEE_HEAD_BYTES + 4 * (uint32_t)(k))
+#define EEE_KEY_MAX							64
+
+//写入次数每隔EEE_COUNT_STEP次存一次, 掉电最多少计EEE_COUNT_STEP-1次
+#define EEE_COUNT_STEP					64
+
+//键类型, 都按32位存储
+#define EEE_TYPE_U32						0
+#define EEE_TYPE_I32						1
+#define EEE_TYPE_F32						2
+
+typedef	union
+{
+			uint32_t	u;
+			int32_t		i;
+			float			f;
+
+}		EeeValueType;
+
+//键表一项, 新增键只能加在表尾, 已存的值保留, 新键写入默认值
+typedef	struct
+{
+			uint8_t				Type;
+			EeeValueType	Default;
+
+}		EeeKeyType;
+
+uint8_t		EeeInit(const EeeKeyType *Keys, uint16_t Num);
+void			EeeTask(void);
+uint8_t		EeeSuspend(void);
+uint8_t		EeeResume(void);
+uint8_t		EeeBusy(void);
+uint8_t		EeeError(void);
+uint16_t	EeeKeyNum(void);
+uint32_t	EeeWriteCount(void);
+
+uint8_t		EeeGetRaw(uint16_t Key, uint32_t *Value);
+uint8_t		EeeSetRaw(uint16_t Key, uint32_t Value);
+uint32_t	EeeGetU32(uint16_t Key);
+int32_t		EeeGetI32(uint16_t Key);
+float			EeeGetF32(uint16_t Key);
+uint8_t		EeeSetU32(uint16_t Key, uint32_t Value);
+uint8_t		EeeSetI32(uint16_t Key, int32_t Value);
+uint8_t		EeeSetF32(uint16_t Key, float Value);
+
+
+#endif /* __DRV_EEE_H */
@@ -2,8 +2,20 @@
 //#include "hardware.h"
 //#include "drvGPIO.h"
 #include "drvflash.h"
+#include "drvPower.h"
 
 
+//同步执行FCCOB中已准备好的命令, 在RAM中等待完成, 期间关中断
+static void Flash_Launch(void)
+{
+	uint32_t	primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	FlashRamLaunch(0);
+	__set_PRIMASK(primask);
+}
+
 uint8_t 	FLASH_Erase_OneSector(uint32_t	Addr)  //
 {
 	LMEM->PCCCR = 0x85000001;    /* Invalidate cache & enable write buffer, cache */ 
@@ -15,14 +27,15 @@ uint8_t 	FLASH_Erase_OneSector(uint32_t	Addr)  //
 	FTFC->FCCOB[2] = (uint8_t)(Addr>>16); //Flash address [23:16] 
 	FTFC->FCCOB[1] = (uint8_t)(Addr>>8); //Flash address [15:08] 
 	FTFC->FCCOB[0] = (uint8_t)(Addr>>0); //Flash address [7:0]   
-	FTFC->FSTAT = FTFC_FSTAT_CCIF_MASK; //launch command    
-	while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0); //wait for done //program phrase at address 0x0004_0000 
+	Flash_Launch(); //launch command, wait for done
 	while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0); //wait if operation in progress 
+	return (FTFC->FSTAT & FLASH_ERR_MASK) ? 1 : 0;
 }
 
 
 void Flash_Write(uint32_t Addr, uint32_t len, uint8_t *dat) 
 { 
+	while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0); //wait if operation in progress (EEE写入)
 	FTFC->FSTAT = FTFC_FSTAT_FPVIOL_MASK | FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK; 
 	FTFC->FCCOB[3] = 0x07; //Program Phrase command (0x07) 
 	FTFC->FCCOB[2] = (uint8_t)(Addr>>16); //Flash address [23:16] 
@@ -38,121 +51,467 @@ void Flash_Write(uint32_t Addr, uint32_t len, uint8_t *dat)
 	FTFC->FCCOB[9]  = dat[5]; 
 	FTFC->FCCOB[10] =  dat[6]; 
 	FTFC->FCCOB[11] =  dat[7]; 
-	FTFC->FSTAT = FTFC_FSTAT_CCIF_MASK; //launch command    
-	while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0); //wait for done 
+	Flash_Launch(); //launch command, wait for done
 }
 
 
 
-// һд4096ֽ
-void Flash_Write_OneSector(uint32_t Addr, uint8_t *dat )
+/*************************************************************************
+*  函数名称：Flash_Section
+*  功能说明：Program Section(0x0B), 数据先写入FlexRAM(作RAM用), 一条命令写入整段
+*  参数说明：Addr：地址, 16字节对齐
+//	         len：字节数, 16的整数倍且不超过FLASH_SECTION_BYTES
+//	         dat：数据, 可不对齐
+*  函数返回：0：成功  1：失败
+*************************************************************************/
+static uint8_t Flash_Section(uint32_t Addr, uint32_t len, const uint8_t *dat)
 {
-	for(int i=0;i<4096/8;i++)
+	volatile uint32_t	*pRam;
+	uint32_t					i,n;
+
+	pRam = (volatile uint32_t *)FLASH_FLEXRAM_ADDR;
+	for(i=0;i<len/4;i++,dat+=4)
+		pRam[i] = (uint32_t)dat[0] | ((uint32_t)dat[1] << 8) | ((uint32_t)dat[2] << 16) | ((uint32_t)dat[3] << 24);
+
+	n = len / FLASH_SECTION_UNIT(Addr);
+	while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0);
+	FTFC->FSTAT = FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK | FTFC_FSTAT_RDCOLERR_MASK;
+	FTFC->FCCOB[3] = FLASH_CMD_SECTION;
+	FTFC->FCCOB[2] = (uint8_t)(Addr>>16);
+	FTFC->FCCOB[1] = (uint8_t)(Addr>>8);
+	FTFC->FCCOB[0] = (uint8_t)(Addr>>0);
+	FTFC->FCCOB[7] = (uint8_t)(n>>8);						//FCCOB4: 单元数高字节
+	FTFC->FCCOB[6] = (uint8_t)(n>>0);						//FCCOB5
+	Flash_Launch();
+	return (FTFC->FSTAT & FLASH_ERR_MASK) ? 1 : 0;
+}
+
+/*************************************************************************
+*  函数名称：Flash_Write_Section
+*  功能说明：写入一段数据, 16字节对齐的部分按Program Section整段写入,
+//	         头尾不对齐部分及FlexRAM不可用(已用作EEE)时按phrase写入, 不足8字节补0xFF
+*  参数说明：Addr：地址, 8字节对齐
+//	         len：字节数
+//	         dat：数据
+*  函数返回：0：成功  1：失败
+*************************************************************************/
+uint8_t Flash_Write_Section(uint32_t Addr, uint32_t len, const uint8_t *dat)
+{
+	uint8_t		phrase[8];
+	uint32_t	n;
+	uint8_t		i,err;
+
+	err = 0;
+	while(len)
 	{
-		Flash_Write(Addr,8,dat);
-		Addr = Addr+8;
-		dat = dat+8;
+		if(((Addr & (FLASH_SECTION_ALIGN-1)) == 0)&&(len >= FLASH_SECTION_ALIGN)&&(FTFC->FCNFG & FTFC_FCNFG_RAMRDY_MASK))
+		{
+			n = len & ~(FLASH_SECTION_ALIGN-1);
+			if(n > FLASH_SECTION_BYTES)	n = FLASH_SECTION_BYTES;
+			err |= Flash_Section(Addr, n, dat);
+		}
+		else
+		{
+			n = (len < 8) ? len : 8;
+			for(i=0;i<8;i++)	phrase[i] = (i < n) ? dat[i] : 0xFF;
+			Flash_Write(Addr, 8, phrase);
+			if(FTFC->FSTAT & FLASH_ERR_MASK)	err = 1;
+		}
+		Addr += n;
+		dat  += n;
+		len  -= n;
 	}
+	return err;
+}
+
+
+// 一次写入4096字节
+void Flash_Write_OneSector(uint32_t Addr, uint8_t *dat )
+{
+	Flash_Write_Section(Addr, 4096, dat);
 }
 
 
-// һд4096ֽ
+// 一次写入1024字节
 void Flash_Write_1024B(uint32_t Addr, uint8_t *dat )
 {
-	for(int i=0;i<1024/8;i++)
+	Flash_Write_Section(Addr, 1024, dat);
+}
+
+//异步擦写作业队列, 逐个执行, 写入作业逐段推进
+//FlexNVM作业由FTFC中断推进; P-Flash作业由主循环调用FlashAsyncTask在RAM中执行
+typedef	struct
+{
+		FlashJobType			Buf[FLASH_JOB_NUM];
+		volatile uint8_t	Head;
+		volatile uint8_t	Tail;
+		volatile uint8_t	Active;				//有命令在执行或已挂起
+		volatile uint8_t	Suspended;
+		volatile uint8_t	Error;
+		volatile uint8_t	PFlash;				//队尾作业在P-Flash, 命令已装入FCCOB, 等FlashAsyncTask启动
+		volatile uint8_t	Hold;					//暂不启动作业(HSRUN/VLPR下FTFC不执行擦写), 可继续排队
+		uint32_t					Pos;					//当前写入作业已写字节数
+	uint32_t					Step;					//正在执行的命令写入的字节数
+
+}		FlashQueueType;
+
+static FlashQueueType	FlashQueue;
+
+/*************************************************************************
+*  函数名称：FlashAsync_Launch
+*  功能说明：按队尾作业启动一条FTFC命令(擦除扇区、写一段或写一个phrase), 打开完成中断
+//	         16字节对齐的整段用Program Section, 其余按phrase, 最后不足8字节的部分补0xFF
+//	         EEE作业直接写FlexRAM, 由FTFC自行写入备份区, 同样以CCIF置位表示完成
+//	         P-Flash作业只装入FCCOB, 关闭完成中断, 由FlashAsyncTask启动
+*************************************************************************/
+static void FlashAsync_Launch(void)
+{
+	FlashJobType			*job;
+	volatile uint32_t	*pRam;
+	const uint8_t			*p;
+	uint32_t					addr,n,k;
+	uint8_t						i;
+
+	job = &FlashQueue.Buf[FlashQueue.Tail];
+	addr = job->Addr;
+	FlashQueue.PFlash = 0;
+	FTFC->FSTAT = FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK | FTFC_FSTAT_RDCOLERR_MASK;
+	if(job->Cmd == FLASH_CMD_EEE)
+	{
+		*FLASH_PTR(volatile uint32_t, addr) = *(const uint32_t *)job->Data;
+		FlashQueue.Step = 4;
+		FTFC->FCNFG |= FTFC_FCNFG_CCIE_MASK;
+		return;
+	}
+	FTFC->FCCOB[3] = job->Cmd;
+	if(job->Cmd == FLASH_CMD_PROGRAM)
+	{
+		addr += FlashQueue.Pos;
+		n = job->Len - FlashQueue.Pos;
+		if(((addr & (FLASH_SECTION_ALIGN-1)) == 0)&&(n >= FLASH_SECTION_ALIGN)&&(FTFC->FCNFG & FTFC_FCNFG_RAMRDY_MASK))
+		{
+			//整段先放入FlexRAM, 用Program Section一条命令写入
+			n &= ~(FLASH_SECTION_ALIGN-1);
+			k = FLASH_IS_PFLASH(addr) ? FLASH_PF_SECTION_BYTES : FLASH_SECTION_BYTES;
+			if(n > k)	n = k;
+			pRam = (volatile uint32_t *)FLASH_FLEXRAM_ADDR;
+			p = &job->Data[FlashQueue.Pos];
+			for(k=0;k<n/4;k++,p+=4)
+				pRam[k] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+			FTFC->FCCOB[3] = FLASH_CMD_SECTION;
+			FTFC->FCCOB[7] = (uint8_t)((n / FLASH_SECTION_UNIT(addr))>>8);
+			FTFC->FCCOB[6] = (uint8_t)(n / FLASH_SECTION_UNIT(addr));
+			FlashQueue.Step = n;
+		}
+		else
+		{
+			for(i=0;i<8;i++)
+				FTFC->FCCOB[4+i] = (FlashQueue.Pos + i < job->Len) ? job->Data[FlashQueue.Pos + i] : 0xFF;
+			FlashQueue.Step = 8;
+		}
+	}
+	FTFC->FCCOB[2] = (uint8_t)(addr>>16);
+	FTFC->FCCOB[1] = (uint8_t)(addr>>8);
+	FTFC->FCCOB[0] = (uint8_t)(addr>>0);
+	if(FLASH_IS_PFLASH(addr))
+	{
+		FTFC->FCNFG &= ~FTFC_FCNFG_CCIE_MASK;
+		FlashQueue.PFlash = 1;
+		return;
+	}
+	FTFC->FSTAT = FTFC_FSTAT_CCIF_MASK;
+	FTFC->FCNFG |= FTFC_FCNFG_CCIE_MASK;
+}
+
+static uint8_t FlashAsync_Push(uint8_t Cmd, uint32_t Addr, uint32_t Len, const uint8_t *Data, volatile uint8_t *Done)
+{
+	FlashJobType	*job;
+	uint32_t			primask;
+	uint8_t				head;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	head = FlashQueue.Head;
+	if(((head + 1) & (FLASH_JOB_NUM - 1)) == FlashQueue.Tail)
+	{
+		__set_PRIMASK(primask);
+		return 1;
+	}
+	job = &FlashQueue.Buf[head];
+	job->Cmd	= Cmd;
+	job->Addr = Addr;
+	job->Len	= Len;
+	job->Data = Data;
+	job->Done = Done;
+	if(Done)	*Done = FLASH_JOB_PENDING;
+	FlashQueue.Head = (head + 1) & (FLASH_JOB_NUM - 1);
+	if((FlashQueue.Active == 0)&&(FlashQueue.Hold == 0))
 	{
-		Flash_Write(Addr,8,dat);
-		Addr = Addr+8;
-		dat = dat+8;
+		FlashQueue.Active = 1;
+		FlashQueue.Pos		= 0;
+		FlashAsync_Launch();
 	}
+	__set_PRIMASK(primask);
+	return 0;
 }
 
-uint8_t		buf_updata[Flash_Sector_Bytes];
+/*************************************************************************
+*  函数名称：FlashAsyncInit
+*  功能说明：异步擦写初始化, 使能FTFC命令完成中断
+//	         异步作业进行中不可再调用同步的擦写函数; P-Flash作业须在主循环中调用FlashAsyncTask
+*************************************************************************/
+void FlashAsyncInit(void)
+{
+	FlashQueue.Head			 = 0;
+	FlashQueue.Tail			 = 0;
+	FlashQueue.Active		 = 0;
+	FlashQueue.Suspended = 0;
+	FlashQueue.Error		 = 0;
+	FlashQueue.PFlash		 = 0;
+	FlashQueue.Hold			 = 0;
+	FTFC->FCNFG &= ~FTFC_FCNFG_CCIE_MASK;
+	NVIC_ClearPendingIRQ(FTFC_IRQn);
+	NVIC_EnableIRQ(FTFC_IRQn);
+}
 
-void 	FLASH_Update(int16_t Sectors)
+/*************************************************************************
+*  函数名称：FlashAsyncErase
+*  功能说明：排队擦除一个4KB扇区
+*  参数说明：Addr：扇区地址
+//	         Done：作业结果, 可为0
+*  函数返回：0：已排队  1：队列满
+*************************************************************************/
+uint8_t FlashAsyncErase(uint32_t Addr, volatile uint8_t *Done)
 {
-			static uint8_t Erase_Flag1 =0;
-			
-			uint8_t		b;
-			uint8_t		*p;
-			long			i,j;	
-			p = (uint8_t *)(Flash_Update_Addr);
-			if(Erase_Flag1 ==0)
-			{
-					for(i=0; i<(Sectors/4+1); i++)    // СΪ4096ֽ
-					{
-						FLASH_Erase_OneSector(0 + i*4096);  //ҪݴС
-					}
-					Erase_Flag1 =1;
-			}				
-			for(i=0;i<Sectors;i++)
-			{
-				for(j=0;j<Flash_Sector_Bytes;j++)		buf_updata[j] = *p++;
-				Flash_Write_1024B(  i * Flash_Sector_Bytes, buf_updata);	
-			}
-			while(1);   // ɵȴŹλ
+	return FlashAsync_Push(FLASH_CMD_ERASE, Addr, 0, 0, Done);
 }
 
+/*************************************************************************
+*  函数名称：FlashAsyncWrite
+*  功能说明：排队写入一段数据, 不拷贝数据, 作业完成前Data须保持有效
+*  参数说明：Addr：地址, 8字节对齐
+//	         Len：字节数, 最后不足8字节补0xFF
+//	         Data：数据
+//	         Done：作业结果, 可为0
+*  函数返回：0：已排队  1：队列满或参数错误
+*************************************************************************/
+uint8_t FlashAsyncWrite(uint32_t Addr, uint32_t Len, const uint8_t *Data, volatile uint8_t *Done)
+{
+	if((Addr & 7)||(Len == 0))	return 1;
+	return FlashAsync_Push(FLASH_CMD_PROGRAM, Addr, Len, Data, Done);
+}
 
-uint32_t Flash_Read(uint32_t Addr)
+/*************************************************************************
+*  函数名称：FlashAsyncEeeWrite
+*  功能说明：排队向EEE模式的FlexRAM写一个字, 与擦写作业串行, 避免EEE写入中启动FTFC命令
+*  参数说明：Addr：FlexRAM地址, 4字节对齐
+//	         Data：数据, 作业完成前须保持有效
+//	         Done：作业结果, 可为0
+*  函数返回：0：已排队  1：队列满、参数错误或EEE未就绪
+*************************************************************************/
+uint8_t FlashAsyncEeeWrite(uint32_t Addr, const uint32_t *Data, volatile uint8_t *Done)
 {
-	uint32_t *p;
-	p = (uint32_t *)Addr;
-	return *p;
+	if((Addr & 3)||((FTFC->FCNFG & FTFC_FCNFG_EEERDY_MASK) == 0))	return 1;
+	return FlashAsync_Push(FLASH_CMD_EEE, Addr, 4, (const uint8_t *)Data, Done);
 }
 
+//有作业在执行或在队列中等待(含暂停时)
+uint8_t FlashAsyncBusy(void)
+{
+	return FlashQueue.Active || (FlashQueue.Head != FlashQueue.Tail);
+}
 
+/*************************************************************************
+*  函数名称：FlashAsyncHold
+*  功能说明：暂停/放开作业启动, 暂停期间作业照常排队, 放开时启动队首作业
+*  参数说明：On：1:暂停 0:放开
+*  函数返回：0：成功  1：有作业在执行, 不能暂停
+*************************************************************************/
+uint8_t FlashAsyncHold(uint8_t On)
+{
+	uint32_t	primask;
 
-void SOSC_init_8MHz(void) 
-{ 
-	SCG->SOSCDIV=0x00000101; /* SOSCDIV1 & SOSCDIV2 =1: divide by 1 */ 
-	SCG->SOSCCFG=0x00000024; 
-	/* Range=2: Medium freq (SOSC between 1MHz-8MHz)*/ 
-	/* HGO=0: Config xtal osc for low power */ 
-	/* EREFS=1: Input is external XTAL */ 
-	while(SCG->SOSCCSR & SCG_SOSCCSR_LK_MASK); /* Ensure SOSCCSR unlocked */ 
-	SCG->SOSCCSR=0x00000001; 
-	/* LK=0: SOSCCSR can be written */
-	/* SOSCCMRE=0: OSC CLK monitor IRQ if enabled */ 
-	/* SOSCCM=0: OSC CLK monitor disabled */ 
-	/* SOSCERCLKEN=0: Sys OSC 3V ERCLK output clk disabled */ 
-	/* SOSCLPEN=0: Sys OSC disabled in VLP modes */ 
-	/* SOSCSTEN=0: Sys OSC disabled in Stop modes */ 
-	/* SOSCEN=1: Enable oscillator */ 
-	while(!(SCG->SOSCCSR & SCG_SOSCCSR_SOSCVLD_MASK)); /* Wait for sys OSC clk valid */ 
-} 
-
-void SPLL_init_160MHz(void) 
-{ 
-	while(SCG->SPLLCSR & SCG_SPLLCSR_LK_MASK); /* Ensure SPLLCSR unlocked */ 
-	SCG->SPLLCSR = 0x00000000; /* SPLLEN=0: SPLL is disabled (default) */ 
-	SCG->SPLLDIV = 0x00000302; /* SPLLDIV1 divide by 2; SPLLDIV2 divide by 4 */ 
-	SCG->SPLLCFG = 0x00180000; /* PREDIV=0: Divide SOSC_CLK by 0+1=1 */
-	/* MULT=24: Multiply sys pll by 4+24=40 */ 
-	/* SPLL_CLK = 8MHz / 1 * 40 / 2 = 160 MHz */ 
-	while(SCG->SPLLCSR & SCG_SPLLCSR_LK_MASK); /* Ensure SPLLCSR unlocked */ 
-	SCG->SPLLCSR = 0x00000001; 
-	/* LK=0: SPLLCSR can be written */ 
-	/* SPLLCMRE=0: SPLL CLK monitor IRQ if enabled */ 
-	/* SPLLCM=0: SPLL CLK monitor disabled */ 
-	/* SPLLSTEN=0: SPLL disabled in Stop modes */ 
-	/* SPLLEN=1: Enable SPLL */ 
-	while(!(SCG->SPLLCSR & SCG_SPLLCSR_SPLLVLD_MASK)); /* Wait for SPLL valid */ 
-} 
-
-void NormalRUNmode_80MHz (void) 
-{ /* Change to normal RUN mode with 8MHz SOSC, 80 MHz PLL*/ 
-	SCG->RCCR=SCG_RCCR_SCS(6) | SCG_RCCR_DIVCORE(1) | SCG_RCCR_DIVBUS(1) | SCG_RCCR_DIVSLOW(2); 
-	while (((SCG->CSR & SCG_CSR_SCS_MASK) >> SCG_CSR_SCS_SHIFT ) != 6) 
-	{} /* Wait for sys clk src = SPLL */ 
-} 
-
-void Clock_Config(void) 
-{ 
-	SOSC_init_8MHz(); /* Initialize system oscillator for 8 MHz xtal */ 
-	SPLL_init_160MHz(); /* Initialize sysclk to 160 MHz with 8 MHz SOSC */ 
-	NormalRUNmode_80MHz(); /* Init clocks: 80 MHz sysclk & core, 40 MHz bus, 20 MHz flash */ 
-} 
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(On)
+	{
+		if(FlashQueue.Active)
+		{
+			__set_PRIMASK(primask);
+			return 1;
+		}
+		FlashQueue.Hold = 1;
+	}
+	else
+	{
+		FlashQueue.Hold = 0;
+		if((FlashQueue.Active == 0)&&(FlashQueue.Tail != FlashQueue.Head))
+		{
+			FlashQueue.Active = 1;
+			FlashQueue.Pos		= 0;
+			FlashAsync_Launch();
+		}
+	}
+	__set_PRIMASK(primask);
+	return 0;
+}
+
+/*************************************************************************
+*  函数名称：FlashPowerNotify
+*  功能说明：运行模式切换回调: HSRUN/VLPR下FTFC不执行擦写命令,
+//	         进入前有作业在执行则拒绝, 否则暂停作业启动; 回到RUN后放开
+*  参数说明：Event：POWER_BEFORE/POWER_AFTER
+//	         Mode：目标模式/切换后模式
+*  函数返回：0：同意；1：拒绝
+*************************************************************************/
+uint8_t FlashPowerNotify(uint8_t Event, uint8_t Mode)
+{
+	if(Event == POWER_BEFORE)
+		return (Mode != CLOCK_MODE_RUN) ? FlashAsyncHold(1) : 0;
+	FlashAsyncHold(Mode != CLOCK_MODE_RUN);
+	return 0;
+}
+
+//作业出错标志, 出错作业被丢弃, 后续作业继续执行
+uint8_t FlashAsyncError(uint8_t Clear)
+{
+	uint8_t	err;
+
+	err = FlashQueue.Error;
+	if(Clear)	FlashQueue.Error = 0;
+	return err;
+}
+
+/*************************************************************************
+*  函数名称：FlashAsync_Done
+*  功能说明：命令完成, 写入作业继续下一段, 否则结束作业启动下一个
+//	         队列空时关闭完成中断(CCIF空闲时一直为1)
+*************************************************************************/
+static void FlashAsync_Done(void)
+{
+	FlashJobType	*job;
+	uint8_t				err;
+
+	job = &FlashQueue.Buf[FlashQueue.Tail];
+	err = FTFC->FSTAT & FLASH_ERR_MASK;
+
+	if((err == 0)&&(job->Cmd == FLASH_CMD_PROGRAM))
+	{
+		FlashQueue.Pos += FlashQueue.Step;
+		if(FlashQueue.Pos < job->Len)
+		{
+			FlashAsync_Launch();
+			return;
+		}
+	}
+	if(err)	FlashQueue.Error = 1;
+	if(job->Done)	*job->Done = err ? FLASH_JOB_FAIL : FLASH_JOB_OK;
+
+	FlashQueue.Tail = (FlashQueue.Tail + 1) & (FLASH_JOB_NUM - 1);
+	FlashQueue.Pos	= 0;
+	if(FlashQueue.Tail != FlashQueue.Head)
+	{
+		FlashAsync_Launch();
+	}
+	else
+	{
+		FTFC->FCNFG &= ~FTFC_FCNFG_CCIE_MASK;
+		FlashQueue.Active = 0;
+	}
+}
+
+//FlexNVM命令完成中断
+void FTFC_IRQHandler(void)
+{
+	if((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0)	return;
+	if(FlashQueue.PFlash)
+	{
+		FTFC->FCNFG &= ~FTFC_FCNFG_CCIE_MASK;
+		return;
+	}
+	FlashAsync_Done();
+}
+
+/*************************************************************************
+*  函数名称：FlashAsyncTask
+*  功能说明：主循环调用, 执行队尾的P-Flash作业, 每次最多FLASH_TASK_CMDS条命令
+//	         每条命令关中断在RAM中执行, 擦除中有中断挂起时挂起擦除, 下次调用恢复
+*************************************************************************/
+void FlashAsyncTask(void)
+{
+	uint32_t	primask;
+	uint8_t		n,r;
+
+	for(n=0;n<FLASH_TASK_CMDS;n++)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		if((FlashQueue.Active == 0)||(FlashQueue.PFlash == 0)||FlashQueue.Suspended)
+		{
+			__set_PRIMASK(primask);
+			return;
+		}
+		//上次挂起的擦除: 清ERSSUSP后再次启动即恢复
+		FTFC->FCNFG &= ~FTFC_FCNFG_ERSSUSP_MASK;
+		r = FlashRamLaunch(FlashQueue.Buf[FlashQueue.Tail].Cmd == FLASH_CMD_ERASE);
+		if(r == FLASH_RAM_DONE)	FlashAsync_Done();
+		__set_PRIMASK(primask);
+		if(r != FLASH_RAM_DONE)	return;
+	}
+}
+
+/*************************************************************************
+*  函数名称：FlashEraseSuspend
+*  功能说明：暂停异步作业, 正在擦除时挂起擦除(ERSSUSP), 正在写phrase时等其完成
+//	         返回后Flash可读, 用于需要及时响应的工作; 与FlashEraseResume成对调用
+//	         P-Flash作业只在FlashAsyncTask中执行, 此时只需停止推进
+*************************************************************************/
+void FlashEraseSuspend(void)
+{
+	uint32_t	primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(FlashQueue.Active && (FlashQueue.Suspended == 0))
+	{
+		FTFC->FCNFG &= ~FTFC_FCNFG_CCIE_MASK;
+		if(((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0)&&(FlashQueue.Buf[FlashQueue.Tail].Cmd == FLASH_CMD_ERASE))
+			FTFC->FCNFG |= FTFC_FCNFG_ERSSUSP_MASK;
+		while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0);
+		FlashQueue.Suspended = 1;
+	}
+	__set_PRIMASK(primask);
+}
 
+/*************************************************************************
+*  函数名称：FlashEraseResume
+*  功能说明：恢复异步作业, 挂起的擦除重新启动, 已完成的命令由中断继续处理
+*************************************************************************/
+void FlashEraseResume(void)
+{
+	uint32_t	primask;
 
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(FlashQueue.Suspended)
+	{
+		FlashQueue.Suspended = 0;
+		if(FlashQueue.PFlash == 0)
+		{
+			if(FTFC->FCNFG & FTFC_FCNFG_ERSSUSP_MASK)
+			{
+				FTFC->FCNFG &= ~FTFC_FCNFG_ERSSUSP_MASK;
+				FTFC->FSTAT = FTFC_FSTAT_CCIF_MASK;
+			}
+			FTFC->FCNFG |= FTFC_FCNFG_CCIE_MASK;
+		}
+	}
+	__set_PRIMASK(primask);
+}
 
+uint32_t Flash_Read(uint32_t Addr)
+{
+	uint32_t *p;
+	p = FLASH_PTR(uint32_t, Addr);
+	return *p;
+}
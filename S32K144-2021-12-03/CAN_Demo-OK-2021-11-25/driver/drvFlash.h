@@ -1,14 +1,82 @@
+#ifndef __DRV_FLASH_H
+#define __DRV_FLASH_H
+
 #include "S32K144.h"
 
 #define	Flash_Sector_Bytes			1024
-#define	Flash_Config_Addr				0x0001F000
-#define	Flash_Update_Addr				0x00040000
+
+//异步擦写: 作业队列长度(2的幂), 作业状态
+#define	FLASH_JOB_NUM						8
+#define	FLASH_JOB_PENDING				0
+#define	FLASH_JOB_OK						1
+#define	FLASH_JOB_FAIL					2
+#define	FLASH_CMD_ERASE					0x09
+#define	FLASH_CMD_PROGRAM				0x07
+#define	FLASH_CMD_SECTION				0x0B
+#define	FLASH_CMD_PGMPART				0x80
+#define	FLASH_CMD_SETRAM				0x81
+//非FTFC命令: 向EEE模式的FlexRAM写一个字, FTFC在后台写入备份区, 完成前CCIF为0
+#define	FLASH_CMD_EEE						0xEE
+
+//Program Section: 数据经FlexRAM(0x14000000)中转, P-Flash按128位对齐,
+//每条命令的字节数受Section缓冲区大小限制(FlexRAM的一部分), 取1KB
+#define	FLASH_FLEXRAM_ADDR			0x14000000
+#define	FLASH_SECTION_ALIGN			16
+#define	FLASH_SECTION_BYTES			1024
+#define	FLASH_ERR_MASK					(FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK | FTFC_FSTAT_MGSTAT0_MASK)
+
+//FTFC命令地址: P-Flash从0开始, FlexNVM(D-Flash)从0x800000开始, EEE作业为FlexRAM地址
+//P-Flash只有一个块, 命令执行中不能从P-Flash取指或读数据: 命令由RAM中的FlashRamLaunch启动并
+//等待完成, 期间关中断; FlexNVM命令执行中程序和中断照常从P-Flash运行(read-while-write)
+#define	FLASH_NVM_CMD_ADDR			0x00800000
+#define	FLASH_IS_PFLASH(a)			((uint32_t)(a) < FLASH_NVM_CMD_ADDR)
+//Program Section的FCCOB4/5为写入单元数: P-Flash每单元128位, FlexNVM每单元64位
+#define	FLASH_SECTION_UNIT(a)		(FLASH_IS_PFLASH(a) ? FLASH_SECTION_ALIGN : 8)
+//32位Flash/FlexRAM地址转指针, 经uintptr_t中转, 主机64位编译(tools/ftfcsim)时不产生截断警告
+#define	FLASH_PTR(type,a)				((type *)(uintptr_t)(a))
+//P-Flash作业在FlashAsyncTask中执行, 每次最多FLASH_TASK_CMDS条命令, 命令之间开中断
+#define	FLASH_TASK_CMDS					8
+//P-Flash的Program Section每条限256字节, 关中断约1.3ms
+#define	FLASH_PF_SECTION_BYTES	256
+//P-Flash擦除中有中断挂起时挂起擦除先响应中断; 启动或恢复后至少轮询这么多次才挂起, 保证擦除有进展
+#define	FLASH_ERASE_MIN_POLLS		2000
+//FlashRamLaunch返回
+#define	FLASH_RAM_DONE					0
+#define	FLASH_RAM_SUSPENDED			1
+
+//一个擦除或写入作业, Data在作业完成前须保持有效, Done由中断写入作业结果
+typedef	struct
+{
+			uint8_t						Cmd;
+			uint32_t					Addr;
+			uint32_t					Len;
+			const uint8_t			*Data;
+			volatile uint8_t	*Done;
+
+}		FlashJobType;
 
 
 
 uint8_t 	FLASH_Erase_OneSector(uint32_t	Addr);
 void 			Flash_Write_OneSector(uint32_t Addr, uint8_t *dat );
 void 			Flash_Write_1024B(uint32_t Addr, uint8_t *dat );
-void 			FLASH_Update(int16_t Sectors);
-void   		Clock_Config();
 void 			Flash_Write(uint32_t Addr, uint32_t len, uint8_t *dat);
+uint8_t		Flash_Write_Section(uint32_t Addr, uint32_t len, const uint8_t *dat);
+
+void			FlashAsyncInit(void);
+uint8_t		FlashAsyncErase(uint32_t Addr, volatile uint8_t *Done);
+uint8_t		FlashAsyncWrite(uint32_t Addr, uint32_t Len, const uint8_t *Data, volatile uint8_t *Done);
+uint8_t		FlashAsyncEeeWrite(uint32_t Addr, const uint32_t *Data, volatile uint8_t *Done);
+uint8_t		FlashAsyncBusy(void);
+uint8_t		FlashAsyncHold(uint8_t On);
+uint8_t		FlashPowerNotify(uint8_t Event, uint8_t Mode);
+uint8_t		FlashAsyncError(uint8_t Clear);
+void			FlashEraseSuspend(void);
+void			FlashEraseResume(void);
+void			FlashAsyncTask(void);
+void			FTFC_IRQHandler(void);
+
+uint8_t		FlashRamLaunch(uint8_t Suspend);
+
+
+#endif /* __DRV_FLASH_H */
@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvflash.h"
+
+//本文件整体在RAM中执行(见S32K144_64_flash.sct), P-Flash命令执行中不能访问P-Flash:
+//不调用其他函数, 常量只用本函数的文字池(随代码一起拷贝到RAM)
+
+
+/*************************************************************************
+*  函数名称：FlashRamLaunch
+*  功能说明：启动FCCOB中已准备好的命令并等待完成, 须关中断调用
+//	         Suspend为1时(擦除扇区), 有使能的中断挂起即置ERSSUSP挂起擦除后返回,
+//	         调用者开中断响应后清ERSSUSP再次调用即恢复擦除
+*  参数说明：Suspend：1:允许挂起
+*  函数返回：FLASH_RAM_DONE：命令完成  FLASH_RAM_SUSPENDED：擦除已挂起
+*************************************************************************/
+uint8_t FlashRamLaunch(uint8_t Suspend)
+{
+	uint32_t	n;
+	uint8_t		i;
+
+	FTFC->FSTAT = FTFC_FSTAT_CCIF_MASK;
+	n = 0;
+	while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0)
+	{
+		if((Suspend == 0)||(n < FLASH_ERASE_MIN_POLLS))
+		{
+			n++;
+			continue;
+		}
+		for(i=0;i<S32_NVIC_ISER_COUNT;i++)
+			if(S32_NVIC->ISER[i] & S32_NVIC->ISPR[i])	break;
+		if((i < S32_NVIC_ISER_COUNT)||(S32_SCB->ICSR & S32_SCB_ICSR_PENDSTSET_MASK))
+		{
+			FTFC->FCNFG |= FTFC_FCNFG_ERSSUSP_MASK;
+			while((FTFC->FSTAT & FTFC_FSTAT_CCIF_MASK) == 0);
+			//挂起前已擦完时ERSSUSP被清零
+			return (FTFC->FCNFG & FTFC_FCNFG_ERSSUSP_MASK) ? FLASH_RAM_SUSPENDED : FLASH_RAM_DONE;
+		}
+	}
+	return FLASH_RAM_DONE;
+}
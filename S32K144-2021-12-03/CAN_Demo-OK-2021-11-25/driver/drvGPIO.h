@@ -1,42 +1,9 @@
 #ifndef __DRV_GPIO_H
 #define __DRV_GPIO_H
 
-typedef enum system_option
-{
-    SPLL50    = 50,
-    SPLL60    = 60,
-    SPLL70    = 70,
-    SPLL80    = 80,
-    SPLL90    = 90,
-    SPLL100   = 100,
-    SPLL110   = 110,
-    SPLL128   = 128,
-    SPLL136   = 136,
-    SPLL144   = 144,
-    SPLL152   = 152,
-    SPLL160   = 160,
-    SPLL168   = 168,
-    SPLL176   = 176,
-    SPLL184   = 184,
-    SPLL192   = 192,
-    SPLL200   = 200, 
-    SPLL208   = 208,
-    SPLL216   = 216,
-    SPLL224   = 224,
-    SPLL232   = 232,
-    SPLL240   = 240,
-    SPLL248   = 248,
-    SPLL256   = 256,
-    SPLL264   = 264,
-    SPLL272   = 272,
-    SPLL280   = 280,
-    SPLL296   = 296,
-    SPLL304   = 304,
-} system_option;
-
 typedef enum PTxn
 {
-    /*  PTA˿    */ //0~31
+    /*  PTA端口    */ //0~31
     PTA0,
     PTA1,
     PTA2,
@@ -70,7 +37,7 @@ typedef enum PTxn
     PTA30,
     PTA31,
 
-    /*  PTB˿    */   //32~63
+    /*  PTB端口    */   //32~63
     PTB0,
     PTB1,
     PTB2,
@@ -104,7 +71,7 @@ typedef enum PTxn
     PTB30,
     PTB31,
 
-    /*  PTC˿    */
+    /*  PTC端口    */
     PTC0,
     PTC1,
     PTC2,
@@ -138,7 +105,7 @@ typedef enum PTxn
     PTC30,
     PTC31,
 
-    /*  PTD˿    */
+    /*  PTD端口    */
     PTD0,
     PTD1,
     PTD2,
@@ -172,7 +139,7 @@ typedef enum PTxn
     PTD30,
     PTD31,
 
-    /*  PTE˿    */
+    /*  PTE端口    */
     PTE0,
     PTE1,
     PTE2,
@@ -208,9 +175,6 @@ typedef enum PTxn
 
 } PTxn;
 
-void syscloption(system_option SYSPLL);
-void SystemCoreClockSet (void); 
-void SystemClockInit(void);
 void GPIO_enable_port (void);
 void PINS_GPIO_WritePin(GPIO_Type *base1,PORT_Type *base2, uint16_t pin, uint16_t value);
 uint16_t PINS_GPIO_ReadPin(GPIO_Type *base1,PORT_Type *base2, uint16_t pin);
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvflash.h"
+#include "drvBoot.h"
+#include "drvJournal.h"
+
+
+static BootStateType	JournalState;
+
+
+static void Journal_Rec(BootRecType *Rec, uint8_t Type, uint8_t Slot, uint32_t Size, uint32_t Crc)
+{
+	Rec->Tag	 = BOOT_TAG_MAKE(Type, Slot);
+	Rec->Size	 = Size;
+	Rec->Crc	 = Crc;
+	Rec->Check = Rec->Tag ^ Rec->Size ^ Rec->Crc ^ BOOT_CHECK_XOR;
+}
+
+//先写 Crc Check, 再写 Tag Size, 断电时只会留下Tag无效的半条记录
+static uint8_t Journal_Write(uint32_t Addr, BootRecType *Rec)
+{
+	Flash_Write(Addr + 8, 8, (uint8_t *)&Rec->Crc);
+	if(FTFC->FSTAT & FLASH_ERR_MASK)
+		return 1;
+	Flash_Write(Addr, 8, (uint8_t *)&Rec->Tag);
+	if(FTFC->FSTAT & FLASH_ERR_MASK)
+		return 1;
+	return 0;
+}
+
+/*************************************************************************
+*  函数名称：Journal_Compact
+*  功能说明：把当前状态压缩写入另一个日志扇区: 先写状态记录, 最后写代数加1的扇区头,
+//	         扇区头写入前断电, 原扇区仍然有效
+*  参数说明：无
+*  函数返回：0：成功  1：失败
+*************************************************************************/
+static uint8_t Journal_Compact(void)
+{
+	BootRecType	Rec;
+	uint32_t		Dst,Addr;
+	uint8_t			i;
+
+	Dst = (JournalState.Gen && JournalState.Sector == BOOT_JOURNAL0_ADDR) ? BOOT_JOURNAL1_ADDR : BOOT_JOURNAL0_ADDR;
+	FLASH_Erase_OneSector(Dst);
+	if(FTFC->FSTAT & FLASH_ERR_MASK)
+		return 1;
+
+	Addr = Dst + BOOT_REC_BYTES;
+	for(i=0;i<BOOT_SLOT_NUM;i++)
+	{
+		if(JournalState.Valid[i])
+		{
+			Journal_Rec(&Rec, BOOT_REC_IMAGE, i, JournalState.Size[i], JournalState.Crc[i]);
+			if(Journal_Write(Addr, &Rec))	return 1;
+			Addr += BOOT_REC_BYTES;
+		}
+		if(JournalState.Pending[i])
+		{
+			Journal_Rec(&Rec, BOOT_REC_START, i, 0, 0);
+			if(Journal_Write(Addr, &Rec))	return 1;
+			Addr += BOOT_REC_BYTES;
+			if(JournalState.Progress[i])
+			{
+				Journal_Rec(&Rec, BOOT_REC_PROGRESS, i, JournalState.Progress[i], 0);
+				if(Journal_Write(Addr, &Rec))	return 1;
+				Addr += BOOT_REC_BYTES;
+			}
+		}
+	}
+	Journal_Rec(&Rec, BOOT_REC_ACTIVE, JournalState.Active, 0, 0);
+	if(Journal_Write(Addr, &Rec))	return 1;
+	Addr += BOOT_REC_BYTES;
+
+	Journal_Rec(&Rec, BOOT_REC_HEADER, 0, JournalState.Gen + 1, 0);
+	if(Journal_Write(Dst, &Rec))	return 1;
+
+	JournalState.Gen++;
+	JournalState.Sector = Dst;
+	JournalState.Next = Addr;
+	return 0;
+}
+
+
+
+/*************************************************************************
+*  函数名称：JournalInit
+*  功能说明：扫描日志, 建立RAM副本
+*  参数说明：无
+*  函数返回：无
+*************************************************************************/
+void JournalInit(void)
+{
+	BootScan(&JournalState);
+}
+
+/*************************************************************************
+*  函数名称：JournalGet
+*  功能说明：取当前日志状态
+*  参数说明：无
+*  函数返回：状态, 只读
+*************************************************************************/
+const BootStateType *JournalGet(void)
+{
+	return &JournalState;
+}
+
+/*************************************************************************
+*  函数名称：JournalAppend
+*  功能说明：追加一条记录并作用到RAM副本; 日志为空或当前扇区写满时先压缩到另一个扇区
+*  参数说明：Type：记录类型 BOOT_REC_xxx
+//	         Slot：0:A区  1:B区
+//	         Size：长度/进度
+//	         Crc：映像CRC32
+*  函数返回：0：成功  1：失败
+*************************************************************************/
+uint8_t JournalAppend(uint8_t Type, uint8_t Slot, uint32_t Size, uint32_t Crc)
+{
+	BootRecType	Rec;
+
+	if(FlashAsyncBusy())
+		return 1;
+	if(JournalState.Gen == 0 || JournalState.Next + BOOT_REC_BYTES > JournalState.Sector + BOOT_JOURNAL_BYTES)
+	{
+		if(Journal_Compact())
+			return 1;
+	}
+
+	Journal_Rec(&Rec, Type, Slot, Size, Crc);
+	if(Journal_Write(JournalState.Next, &Rec))
+	{
+		JournalState.Next += BOOT_REC_BYTES;
+		return 1;
+	}
+	JournalState.Next += BOOT_REC_BYTES;
+	BootApply(&JournalState, &Rec);
+	return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef __DRV_JOURNAL_H
+#define __DRV_JOURNAL_H
+
+#include <stdint.h>
+#include "drvBoot.h"
+
+//升级日志(应用侧): 启动时扫描一次, 之后在RAM副本上追加记录
+//追加用同步擦写, 调用前异步擦写队列须空闲(FlashAsyncBusy()==0)
+
+void									JournalInit(void);
+const BootStateType		*JournalGet(void);
+uint8_t								JournalAppend(uint8_t Type, uint8_t Slot, uint32_t Size, uint32_t Crc);
+
+
+#endif /* __DRV_JOURNAL_H */
@@ -0,0 +1,255 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvPower.h"
+#include "drvClock.h"
+#include "drvTimer.h"
+
+#define POWER_PMSTAT_RUN				0x01
+#define POWER_PMSTAT_VLPR				0x04
+#define POWER_PMSTAT_HSRUN			0x80
+#define POWER_SCS_FIRC					3
+#define POWER_SCS_SPLL					6
+
+typedef	struct
+{
+		const PowerNotifyType	*Tab;
+		uint8_t				Num;
+		uint8_t				Mode;				//当前模式, 切换后按PMSTAT更新
+		uint64_t			Since;			//进入当前模式的时刻, us
+		uint64_t			ModeUs[3];
+
+}		PowerType;
+
+static PowerType			Power;
+static PowerStatType	PowerStat;
+
+//按PMSTAT读出当前模式
+static uint8_t Power_ReadMode(void)
+{
+		switch(SMC->PMSTAT & SMC_PMSTAT_PMSTAT_MASK)
+		{
+				case POWER_PMSTAT_HSRUN:	return CLOCK_MODE_HSRUN;
+				case POWER_PMSTAT_VLPR:		return CLOCK_MODE_VLPR;
+				default:									return CLOCK_MODE_RUN;
+		}
+}
+
+//等待PMSTAT, 0：到达；1：超时
+static uint8_t Power_WaitStat(uint8_t Stat)
+{
+		uint32_t	n;
+
+		for(n=0;n<CLOCK_WAIT_POLLS;n++)
+		{
+				if((SMC->PMSTAT & SMC_PMSTAT_PMSTAT_MASK) == Stat)	return 0;
+		}
+		return 1;
+}
+
+//等待系统时钟源, 0：到达；1：超时
+static uint8_t Power_WaitScs(uint8_t Scs)
+{
+		uint32_t	n;
+
+		for(n=0;n<CLOCK_WAIT_POLLS;n++)
+		{
+				if(((SCG->CSR & SCG_CSR_SCS_MASK) >> SCG_CSR_SCS_SHIFT) == Scs)	return 0;
+		}
+		return 1;
+}
+
+/*************************************************************************
+*  函数名称：Power_RunRestore
+*  功能说明：切换失败后在RUN模式下尽量回到SPLL 80MHz, 时钟源起不来时停在FIRC或SIRC
+*************************************************************************/
+static void Power_RunRestore(void)
+{
+		if(ClockFircStart() == 0)	ClockSelect(CLOCK_FIRC_CCR);
+		if(((SCG->CSR & SCG_CSR_SCS_MASK) >> SCG_CSR_SCS_SHIFT) == POWER_SCS_SPLL)	return;
+		if(ClockSoscStart())	return;
+		if(ClockSpllStart(CLOCK_MODE_RUN))	return;
+		ClockSelect(CLOCK_RUN_CCR);
+}
+
+/*************************************************************************
+*  函数名称：Power_Switch
+*  功能说明：RUN与HSRUN/VLPR之间切换一步, 时钟切换先经FIRC或SIRC过渡
+*  参数说明：From：当前模式; To：目标模式, 二者之一为RUN
+*  函数返回：0：成功；1：失败, 已回到RUN
+*************************************************************************/
+static uint8_t Power_Switch(uint8_t From, uint8_t To)
+{
+		if(To == CLOCK_MODE_HSRUN)
+		{
+				//SPLL重配期间系统时钟用FIRC
+				if(ClockFircStart()||ClockSelect(CLOCK_FIRC_CCR)||ClockSpllStart(CLOCK_MODE_HSRUN))
+				{
+						Power_RunRestore();
+						return 1;
+				}
+				SCG->HCCR = CLOCK_HSRUN_CCR;
+				SMC->PMCTRL = SMC_PMCTRL_RUNM(3);
+				if(Power_WaitStat(POWER_PMSTAT_HSRUN)||Power_WaitScs(POWER_SCS_SPLL))
+				{
+						SMC->PMCTRL = SMC_PMCTRL_RUNM(0);
+						Power_WaitStat(POWER_PMSTAT_RUN);
+						Power_RunRestore();
+						return 1;
+				}
+				return 0;
+		}
+
+		if(To == CLOCK_MODE_VLPR)
+		{
+				//VLPR只能用SIRC, 其他时钟源必须关闭
+				if(ClockSelect(CLOCK_SIRC_CCR))
+				{
+						Power_RunRestore();
+						return 1;
+				}
+				SCG->VCCR = CLOCK_VLPR_CCR;
+				while(SCG->SPLLCSR & SCG_SPLLCSR_LK_MASK);
+				SCG->SPLLCSR = 0;
+				while(SCG->FIRCCSR & SCG_FIRCCSR_LK_MASK);
+				SCG->FIRCCSR = 0;
+				while(SCG->SOSCCSR & SCG_SOSCCSR_LK_MASK);
+				SCG->SOSCCSR = 0;
+				PMC->REGSC |= PMC_REGSC_BIASEN_MASK;
+				SMC->PMCTRL = SMC_PMCTRL_RUNM(2);
+				if(Power_WaitStat(POWER_PMSTAT_VLPR))
+				{
+						SMC->PMCTRL = SMC_PMCTRL_RUNM(0);
+						Power_WaitStat(POWER_PMSTAT_RUN);
+						Power_RunRestore();
+						return 1;
+				}
+				return 0;
+		}
+
+		//回到RUN
+		if(From == CLOCK_MODE_HSRUN)
+		{
+				//RUN下先用FIRC, SPLL按RUN重配
+				SCG->RCCR = CLOCK_FIRC_CCR;
+				SMC->PMCTRL = SMC_PMCTRL_RUNM(0);
+				if(Power_WaitStat(POWER_PMSTAT_RUN)||Power_WaitScs(POWER_SCS_FIRC))	return 1;
+		}
+		else
+		{
+				//RCCR仍为进入VLPR前的SIRC
+				SMC->PMCTRL = SMC_PMCTRL_RUNM(0);
+				if(Power_WaitStat(POWER_PMSTAT_RUN))	return 1;
+				if(ClockSoscStart())
+				{
+						Power_RunRestore();
+						return 1;
+				}
+		}
+		if(ClockSpllStart(CLOCK_MODE_RUN)||ClockSelect(CLOCK_RUN_CCR))
+		{
+				Power_RunRestore();
+				return 1;
+		}
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：PowerInit
+*  功能说明：登记模式切换回调, 在ClockInit、TimerInit之后调用
+*  参数说明：Tab：回调表, 切换前后按表中顺序调用
+//	         Num：回调数
+*************************************************************************/
+void PowerInit(const PowerNotifyType *Tab, uint8_t Num)
+{
+		uint8_t	i;
+
+		Power.Tab		= Tab;
+		Power.Num		= Num;
+		Power.Mode	= Power_ReadMode();
+		Power.Since	= TimerGetUs();
+		for(i=0;i<3;i++)	Power.ModeUs[i] = 0;
+		PowerGetStat(&PowerStat, 1);
+}
+
+/*************************************************************************
+*  函数名称：PowerSetMode
+*  功能说明：切换运行模式, 先询问全部回调, 切换后更新SystemCoreClock再通知回调
+*  参数说明：Mode：CLOCK_MODE_RUN/HSRUN/VLPR
+*  函数返回：POWER_OK/POWER_REFUSED/POWER_FAIL
+*************************************************************************/
+uint8_t PowerSetMode(uint8_t Mode)
+{
+		uint64_t	t0;
+		uint32_t	dt;
+		uint8_t		i,fail;
+
+		if(Mode > CLOCK_MODE_VLPR)	return POWER_REFUSED;
+		if(Mode == Power.Mode)	return POWER_OK;
+
+		t0 = TimerGetUs();
+		for(i=0;i<Power.Num;i++)
+		{
+				if(Power.Tab[i](POWER_BEFORE, Mode))	break;
+		}
+		if(i < Power.Num)
+		{
+				while(i--)	Power.Tab[i](POWER_AFTER, Power.Mode);
+				PowerStat.Refused++;
+				return POWER_REFUSED;
+		}
+
+		fail = 0;
+		if(Power.Mode != CLOCK_MODE_RUN)	fail = Power_Switch(Power.Mode, CLOCK_MODE_RUN);
+		if((fail == 0)&&(Mode != CLOCK_MODE_RUN))	fail = Power_Switch(CLOCK_MODE_RUN, Mode);
+		SystemCoreClock = ClockGetCoreHz();
+
+		//停留时间记到旧模式, 计时用的LPIT由回调在VLPR前后切换时钟, 计数连续
+		Power.ModeUs[Power.Mode] += t0 - Power.Since;
+		Power.Since = t0;
+		Power.Mode = Power_ReadMode();
+		for(i=0;i<Power.Num;i++)	Power.Tab[i](POWER_AFTER, Power.Mode);
+
+		dt = (uint32_t)(TimerGetUs() - t0);
+		PowerStat.Switches++;
+		PowerStat.LastUs = dt;
+		if(dt > PowerStat.MaxUs)	PowerStat.MaxUs = dt;
+		if(dt > POWER_SWITCH_BUDGET_US)	PowerStat.Overrun++;
+		if(fail)
+		{
+				PowerStat.Fail++;
+				return POWER_FAIL;
+		}
+		return POWER_OK;
+}
+
+uint8_t PowerGetMode(void)
+{
+		return Power.Mode;
+}
+
+/*************************************************************************
+*  函数名称：PowerGetStat
+*  功能说明：读取切换统计, ModeMs含当前模式截至现在的停留时间
+*  参数说明：Clear：1:读后清零
+*************************************************************************/
+void PowerGetStat(PowerStatType *Stat, uint8_t Clear)
+{
+		uint64_t	now;
+		uint8_t		i;
+
+		now = TimerGetUs();
+		Power.ModeUs[Power.Mode] += now - Power.Since;
+		Power.Since = now;
+		for(i=0;i<3;i++)	PowerStat.ModeMs[i] = (uint32_t)(Power.ModeUs[i] / 1000);
+		if(Stat != &PowerStat)	*Stat = PowerStat;
+		if(Clear)
+		{
+				PowerStat.Switches = 0;
+				PowerStat.Refused	 = 0;
+				PowerStat.Fail		 = 0;
+				PowerStat.Overrun	 = 0;
+				PowerStat.LastUs	 = 0;
+				PowerStat.MaxUs		 = 0;
+				for(i=0;i<3;i++)	Power.ModeUs[i] = 0;
+		}
+}
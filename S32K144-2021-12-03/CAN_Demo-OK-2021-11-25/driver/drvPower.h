@@ -0,0 +1,47 @@
+#ifndef __DRV_POWER_H
+#define __DRV_POWER_H
+
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvClock.h"
+
+//运行模式切换: RUN/HSRUN/VLPR(CLOCK_MODE_xxx), 时钟配置见drvClock.h
+//各驱动注册回调, 切换前依次询问, 任一回调拒绝则不切换; 切换后依次通知实际所处模式
+//HSRUN与VLPR之间经RUN切换; 只能在主循环中调用PowerSetMode
+
+//回调事件
+#define POWER_BEFORE						0			//Mode为目标模式, 返回非0拒绝切换
+#define POWER_AFTER							1			//Mode为切换后实际所处模式, 返回值不用
+
+//PowerSetMode返回值
+#define POWER_OK								0
+#define POWER_REFUSED						1			//有回调拒绝, 已通知过的回调再以当前模式调用POWER_AFTER
+#define POWER_FAIL							2			//时钟或模式切换超时, 一般停在RUN(SPLL、FIRC或SIRC), 回调已按实际模式通知
+
+//一次切换(含回调)耗时超过此值计入Overrun, us; VLPR退出时SOSC起振约占1~2ms
+#define POWER_SWITCH_BUDGET_US	3000
+
+//切换前后的回调
+typedef uint8_t (*PowerNotifyType)(uint8_t Event, uint8_t Mode);
+
+//切换统计
+typedef	struct
+{
+			uint32_t	Switches;					//执行了的切换, 含失败
+			uint32_t	Refused;
+			uint32_t	Fail;
+			uint32_t	Overrun;					//耗时超过POWER_SWITCH_BUDGET_US
+			uint32_t	LastUs;
+			uint32_t	MaxUs;
+			uint32_t	ModeMs[3];				//各模式累计停留时间, 下标CLOCK_MODE_xxx
+
+}		PowerStatType;
+
+
+void			PowerInit(const PowerNotifyType *Tab, uint8_t Num);
+uint8_t		PowerSetMode(uint8_t Mode);
+uint8_t		PowerGetMode(void);
+void			PowerGetStat(PowerStatType *Stat, uint8_t Clear);
+
+
+#endif /* __DRV_POWER_H */
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvTimer.h"
+#include "drvPower.h"
+
+//us计数高32位, 通道1每计满2^32us(约71分钟)加1
+static volatile uint32_t	TimerHigh;
+//LPIT换时钟重新启动前的us数, 加在计数上
+static uint64_t	TimerBase;
+static uint8_t	TimerPcs;
+
+//按功能时钟启动LPIT两个通道, 计数从0开始; PCS只能在时钟门控关闭时修改
+static void Timer_Start(uint8_t Pcs, uint32_t Hz)
+{
+		PCC->PCCn[PCC_LPIT_INDEX] = 0;
+		PCC->PCCn[PCC_LPIT_INDEX] = PCC_PCCn_PCS(Pcs);
+		PCC->PCCn[PCC_LPIT_INDEX] |= PCC_PCCn_CGC_MASK;
+		TimerPcs = Pcs;
+
+		LPIT0->MCR = LPIT_MCR_M_CEN_MASK | LPIT_MCR_DBG_EN_MASK;
+		LPIT0->CLRTEN = 0x0F;
+		LPIT0->MSR = 0x0F;
+
+		TimerHigh = 0;
+		LPIT0->TMR[0].TVAL	= Hz / 1000000 - 1;
+		LPIT0->TMR[1].TVAL	= 0xFFFFFFFFuL;
+		LPIT0->TMR[0].TCTRL = 0;
+		LPIT0->TMR[1].TCTRL = LPIT_TMR_TCTRL_CHAIN_MASK;
+		LPIT0->MIER = LPIT_MIER_TIE1_MASK;
+		//两通道同时启动
+		LPIT0->SETTEN = 0x03;
+}
+
+/*************************************************************************
+*  函数名称：TimerInit
+*  功能说明：初始化单调递增的64位us时基
+//	         通道0: 32位周期计数, 每us溢出; 通道1: 链在通道0上, 每us减1
+//	         同时打开DWT周期计数器供 TIMER_CYCLES() 使用
+*************************************************************************/
+void TimerInit(void)
+{
+		TimerBase = 0;
+		Timer_Start(TIMER_CLOCK_PCS, TIMER_CLOCK_HZ);
+
+		NVIC_ClearPendingIRQ(LPIT0_Ch1_IRQn);
+		NVIC_EnableIRQ(LPIT0_Ch1_IRQn);
+
+		//DWT周期计数
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/*************************************************************************
+*  函数名称：TimerGetUs
+*  功能说明：读取上电以来的us数, 可在中断中调用
+//	         通道1向下计数, 取反即为低32位; 溢出中断未及处理时在此补上
+*  函数返回：64位us计数
+*************************************************************************/
+uint64_t TimerGetUs(void)
+{
+		uint32_t	primask,hi,lo;
+		uint64_t	base;
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		base = TimerBase;
+		hi = TimerHigh;
+		lo = ~LPIT0->TMR[1].CVAL;
+		if(LPIT0->MSR & LPIT_MSR_TIF1_MASK)
+		{
+				lo = ~LPIT0->TMR[1].CVAL;
+				hi++;
+		}
+		__set_PRIMASK(primask);
+
+		return base + (((uint64_t)hi << 32) | lo);
+}
+
+/*************************************************************************
+*  函数名称：TimerPowerNotify
+*  功能说明：运行模式切换回调: 进入VLPR前LPIT改用SIRCDIV2, 离开VLPR后SOSC有效时改回
+//	         换时钟时LPIT重新启动, 已计的us数记入TimerBase, 误差小于1us
+*  参数说明：Event：POWER_BEFORE/POWER_AFTER
+//	         Mode：目标模式/切换后模式
+*  函数返回：0：不拒绝切换
+*************************************************************************/
+uint8_t TimerPowerNotify(uint8_t Event, uint8_t Mode)
+{
+		uint32_t	primask;
+		uint8_t		pcs;
+		uint32_t	hz;
+
+		if((Event == POWER_BEFORE)&&(Mode == CLOCK_MODE_VLPR))
+		{
+				pcs = TIMER_VLPR_PCS;
+				hz	= TIMER_VLPR_HZ;
+		}
+		else if((Event == POWER_AFTER)&&(Mode != CLOCK_MODE_VLPR)&&(SCG->SOSCCSR & SCG_SOSCCSR_SOSCVLD_MASK))
+		{
+				pcs = TIMER_CLOCK_PCS;
+				hz	= TIMER_CLOCK_HZ;
+		}
+		else	return 0;
+		if(pcs == TimerPcs)	return 0;
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		TimerBase = TimerGetUs();
+		Timer_Start(pcs, hz);
+		NVIC_ClearPendingIRQ(LPIT0_Ch1_IRQn);
+		__set_PRIMASK(primask);
+		return 0;
+}
+
+void LPIT0_Ch1_IRQHandler(void)
+{
+		LPIT0->MSR = LPIT_MSR_TIF1_MASK;
+		TimerHigh++;
+}
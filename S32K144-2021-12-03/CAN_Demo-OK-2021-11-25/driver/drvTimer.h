@@ -0,0 +1,27 @@
+#ifndef __DRV_TIMER_H
+#define __DRV_TIMER_H
+
+#include <stdint.h>
+#include "S32K144.h"
+#include "drvClock.h"
+
+//LPIT功能时钟: SOSCDIV2 = 8MHz晶振
+#define TIMER_CLOCK_HZ		CLOCK_SOSCDIV2_HZ
+#define TIMER_CLOCK_PCS		1
+//VLPR下SOSC关闭, 改用SIRCDIV2, 切换时us计数连续
+#define TIMER_VLPR_HZ			CLOCK_SIRCDIV2_HZ
+#define TIMER_VLPR_PCS		2
+
+//LPIT0通道0每1us溢出一次, 链式触发通道1做32位us计数, 通道1溢出中断扩展为64位
+
+//内核时钟, DWT周期计数用于测量短时耗(中断处理等), 80MHz时约53秒回绕; 随运行模式变化
+#define TIMER_CPU_HZ			(SystemCoreClock)
+#define TIMER_CYCLES()		(DWT->CYCCNT)
+
+
+void			TimerInit(void);
+uint64_t	TimerGetUs(void);
+uint8_t		TimerPowerNotify(uint8_t Event, uint8_t Mode);
+
+
+#endif /* __DRV_TIMER_H */
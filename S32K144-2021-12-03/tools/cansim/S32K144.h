@@ -0,0 +1,19 @@
+#ifndef __CAN_SIM_S32K144_H
+#define __CAN_SIM_S32K144_H
+
+//主机编译: 用芯片头文件, 芯片的CAN_Type、DMA_Type改名后由cansim.h换成寄存器模型
+//CAN0~2不再指向芯片地址, 驱动经CAN_BASE_TABLE访问模型, 见cansim.h
+#define CAN_Type				CanChipType
+#define CAN_MemMapPtr		CanChipMemMapPtr
+#define DMA_Type				DmaChipType
+#define DMA_MemMapPtr		DmaChipMemMapPtr
+#include "../../CAN_Demo-OK-2021-11-25/platform/devices/S32K144/include/S32K144.h"
+#undef	CAN_Type
+#undef	CAN_MemMapPtr
+#undef	DMA_Type
+#undef	DMA_MemMapPtr
+
+#include "cansim.h"
+
+
+#endif /* __CAN_SIM_S32K144_H */
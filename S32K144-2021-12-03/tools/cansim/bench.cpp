@@ -0,0 +1,1283 @@
+//用cansim运行driver/drvCAN.c: 各通道在满负载总线上收发, 检查丢帧、帧内容和寄存器配置, 按虚拟时钟统计延时
+//编译(g++为一条命令, 分行只为排版):
+//  P=../../CAN_Demo-OK-2021-11-25
+//  g++ -O1 -Wall -x c++ -no-pie -I. -I$P/driver -I$P/VCUAPP -I$P/platform/devices/S32K144/include -I$P/platform/devices
+//      -I$P/platform/devices/S32K144/startup -DCPU_S32K144HFT0VLLT
+//      $P/driver/drvCAN.c $P/driver/drvCANFilter.c $P/driver/drvCANTiming.c $P/VCUAPP/CANRoute.c cansim.cpp bench.cpp -o bench
+//剖析: perf record ./bench, 中断处理函数在主机上的耗时另见输出中的irq ns/frame
+//
+//三路同时接收按不同主循环周期检查环形缓冲区; 逐帧接口与批量接口收发相同帧数的帧率对比; 另有发送MailBox字布局、发送队列按ID优先级的顺序检查,
+//过滤表格式A/B/C经模型收帧与参考定义对照, 路由查找(各2048条标准帧、扩展帧)的正确性和耗时, 位时间求解对照期望表,
+//运行模式切换时各通道的时钟源和收发
+//
+//丢帧、内容不符或统计中RateErr/FormErr/ConfigErr不为0时返回1, 可在CI中检查吞吐和延时回归
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "drvPower.h"
+#include "drvCANTiming.h"
+#include "drvCANFilter.h"
+#include "CANRoute.h"
+#include "cansim.h"
+
+//主循环一圈的时间(us), 取出接收帧、补充发送帧
+#define BENCH_LOOP_US						100
+//每个场景的帧数
+#define BENCH_FRAMES						20000
+//满负载发送时任一帧(即最低优先级帧)的发送延时上限: 超时(CAN_TX_AGE_US)后等MailBox中
+//已装入的帧和先超时的帧发完, 500k下留8ms(约30帧)
+#define BENCH_TX_WAIT_MAX_US		(CAN_TX_AGE_US + 8000)
+
+//帧内容由序号决定, 接收端据此检查
+static void Bench_Frame(uint32_t Seq, uint8_t Ext, CanSimFrameType *f)
+{
+		uint32_t	h;
+		uint8_t		i;
+
+		h = Seq * 2654435761u;
+		memset(f, 0, sizeof(*f));
+		f->IDE = Ext ? 1 : (uint8_t)((h >> 7) & 1);
+		f->ID	 = f->IDE ? ((h >> 3) & 0x1FFFFFFF) : ((h >> 11) & 0x7FF);
+		f->DLC = (uint8_t)(Seq % 9);
+		for(i=0;i<8;i++)	f->Data[i] = (uint8_t)(Seq >> (8 * (i & 3))) ^ (uint8_t)(i * 0x11);
+}
+
+static uint8_t Bench_Same(const CanSimFrameType *f, const CANFrameType *r)
+{
+		if((r->ID != f->ID)||(r->IDE != f->IDE)||(r->DLC != f->DLC))	return 0;
+		return memcmp(r->Data, f->Data, f->DLC) ? 0 : 1;
+}
+
+static void Bench_Init(void)
+{
+		CanSimInit();
+}
+
+static uint8_t Bench_Check(const char *Name, uint8_t Ch)
+{
+		CANStatType	st;
+
+		CANGetStat(Ch, &st, 0);
+		printf("%-24s CAN%u %u bit/s, rx %u tx %u, fifo ovf %u, arb lost %u, irq %u (%.0f ns/irq)\n", Name, Ch,
+					 CanSimBitrate(Ch, 0), CanSimStat[Ch].RxFrames, CanSimStat[Ch].TxFrames, CanSimStat[Ch].FifoOverflow,
+					 CanSimStat[Ch].ArbLost, CanSimStat[Ch].Irqs,
+					 CanSimStat[Ch].Irqs ? (double)CanSimStat[Ch].IrqHostNs / CanSimStat[Ch].Irqs : 0.0);
+		if(CanSimStat[Ch].RateErr || CanSimStat[Ch].FormErr || CanSimStat[Ch].ConfigErr || (st.Bitrate != CanSimBitrate(Ch, 0)))
+		{
+				printf("%-24s rate %u form %u config %u, 驱动波特率 %u\n", "  ** 错误", CanSimStat[Ch].RateErr,
+							 CanSimStat[Ch].FormErr, CanSimStat[Ch].ConfigErr, st.Bitrate);
+				return 1;
+		}
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：Bench_Rx
+*  功能说明：外部节点以100%负载向CANCh发帧, 主循环每BENCH_LOOP_US取一次;
+//	         Hold不为0时前一半时间不取, 检查丢帧计数与实际缺帧一致
+*************************************************************************/
+static uint8_t Bench_Rx(const char *Name, uint8_t Ch, uint8_t Hold)
+{
+		CanSimFrameType	f;
+		CANFrameType		r[32];
+		uint32_t				sent,got,bad,lost,i,n;
+		uint64_t				t0;
+
+		Bench_Init();
+		if(CANInit(Ch, 500))	return 1;
+		t0	 = CanSimNow();
+		sent = got = bad = lost = 0;
+		while((got + lost < BENCH_FRAMES)&&(CanSimNow() - t0 < 10000000uLL))
+		{
+				while((sent < BENCH_FRAMES)&&CanSimSendFree(Ch))
+				{
+						Bench_Frame(sent++, 0, &f);
+						CanSimSend(Ch, &f);
+				}
+				CanSimAdvance(BENCH_LOOP_US);
+				if(Hold && (CanSimNow() - t0 < 200000))	continue;
+				while((n = CANRecBurst(Ch, r, 32)) != 0)
+				{
+						for(i=0;i<n;i++)
+						{
+								//跳过的帧即丢帧
+								do
+								{
+										Bench_Frame(got + lost, 0, &f);
+										if(Bench_Same(&f, &r[i]))	break;
+										lost++;
+								}
+								while(got + lost < sent);
+								if(got + lost >= sent)	bad++;
+								else	got++;
+						}
+				}
+				lost = (sent > got && CanSimBusIdle(Ch)) ? sent - got : lost;
+		}
+		printf("%-24s %u frames in %.1f ms, got %u, lost %u (driver %u), bad %u, bus load %.1f%%\n", Name, sent,
+					 (CanSimNow() - t0) / 1000.0, got, lost, CANGetRxOverrun(Ch), bad,
+					 100.0 * CanSimBusStat[Ch].BusyNs / ((CanSimNow() - t0) * 1000.0));
+		if(bad || (lost != CANGetRxOverrun(Ch)) || (Hold == 0 && lost) || (Hold && lost == 0))
+		{
+				printf("%-24s 丢帧或内容不符\n", "  ** 错误");
+				return 1 | Bench_Check("", Ch);
+		}
+		return Bench_Check("", Ch);
+}
+
+static double Bench_HostNs(void)
+{
+		struct timespec	ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*************************************************************************
+*  函数名称：Bench_RxAll
+*  功能说明：三路同时满负载接收, 主循环每LoopUs取一次, 检查中断放入环形缓冲区的帧不丢、不乱序;
+//	         统计取帧时的最大缓冲深度, 以及主机上每次中断和每帧CANRecBurst的耗时
+//	         Overflow为1时主循环周期超过环形缓冲区容量, 丢帧数须与CANGetRxOverrun一致
+*************************************************************************/
+static uint8_t Bench_RxAll(uint32_t LoopUs, uint8_t Overflow)
+{
+		CanSimFrameType	f;
+		CANFrameType		r[32];
+		uint32_t	sent[CAN_SIM_CH_NUM],got[CAN_SIM_CH_NUM],lost[CAN_SIM_CH_NUM];
+		uint32_t	bad,frames,irqs,drops,n,i;
+		uint64_t	t0,irqNs;
+		uint16_t	depth,maxDepth;
+		double		recNs,t;
+		uint8_t		ch,busy;
+		char			name[32];
+
+		Bench_Init();
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+		{
+				if(CANInit(ch, 500))	return 1;
+				sent[ch] = got[ch] = lost[ch] = 0;
+		}
+		t0 = CanSimNow();
+		bad = 0;
+		maxDepth = 0;
+		recNs = 0;
+		do
+		{
+				for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				{
+						while((sent[ch] < BENCH_FRAMES)&&CanSimSendFree(ch))
+						{
+								Bench_Frame(sent[ch]++, 0, &f);
+								CanSimSend(ch, &f);
+						}
+				}
+				CanSimAdvance(LoopUs);
+				busy = 0;
+				for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				{
+						depth = CANGetQueueDepth(ch);
+						if(depth > maxDepth)	maxDepth = depth;
+						t = Bench_HostNs();
+						while((n = CANRecBurst(ch, r, 32)) != 0)
+						{
+								for(i=0;i<n;i++)
+								{
+										//环形缓冲区满时丢的是新帧, 跳过的序号即丢帧
+										do
+										{
+												Bench_Frame(got[ch] + lost[ch], 0, &f);
+												if(Bench_Same(&f, &r[i]))	break;
+												lost[ch]++;
+										}
+										while(got[ch] + lost[ch] < sent[ch]);
+										if(got[ch] + lost[ch] >= sent[ch])	bad++;
+										else	got[ch]++;
+								}
+						}
+						recNs += Bench_HostNs() - t;
+						if((got[ch] + lost[ch] < BENCH_FRAMES)||(CanSimBusIdle(ch) == 0))	busy = 1;
+				}
+		}
+		while(busy && (CanSimNow() - t0 < 10000000uLL));
+
+		frames = irqs = drops = 0;
+		irqNs = 0;
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+		{
+				frames += got[ch];
+				irqs	 += CanSimStat[ch].Irqs;
+				irqNs	 += CanSimStat[ch].IrqHostNs;
+				//最后一帧收到之后丢的帧没有序号可跳
+				if(CanSimBusIdle(ch))	lost[ch] = sent[ch] - got[ch];
+				if(lost[ch] != CANGetRxOverrun(ch))
+				{
+						printf("%-24s CAN%u lost %u, driver %u, fifo ovf %u\n", "  ** 错误", ch, lost[ch], CANGetRxOverrun(ch),
+									 CanSimStat[ch].FifoOverflow);
+						bad++;
+				}
+				drops	 += lost[ch];
+		}
+		snprintf(name, sizeof(name), "rx 3ch loop %u us", LoopUs);
+		printf("%-24s got %u, lost %u, max ring depth %u/%u, bad %u, %.0f ns/irq, %.0f ns/frame CANRecBurst\n", name,
+					 frames, drops, maxDepth, CAN_RX_RING_SIZE, bad, irqs ? (double)irqNs / irqs : 0.0, frames ? recNs / frames : 0.0);
+		if(bad || (Overflow == 0 && drops) || (Overflow && drops == 0))
+		{
+				printf("%-24s 丢帧或内容不符\n", "  ** 错误");
+				return 1;
+		}
+		return Bench_Check("", 0) | Bench_Check("", 1) | Bench_Check("", 2);
+}
+
+/*************************************************************************
+*  函数名称：Bench_Tx
+*  功能说明：CANCh以队列允许的最快速度发帧, 从总线日志检查帧内容和个数, 统计发送延时
+*************************************************************************/
+static uint8_t Bench_Tx(const char *Name, uint8_t Ch)
+{
+		CanSimFrameType	f,log;
+		CANFrameType		t;
+		CANLatencyType	lat;
+		uint32_t				sent,seen,bad;
+		uint64_t				t0;
+
+		Bench_Init();
+		if(CANInit(Ch, 500))	return 1;
+		t0	 = CanSimNow();
+		sent = seen = bad = 0;
+		while((seen < BENCH_FRAMES)&&(CanSimNow() - t0 < 10000000uLL))
+		{
+				while(sent < BENCH_FRAMES)
+				{
+						Bench_Frame(sent, 0, &f);
+						t.ID	 = f.ID;
+						t.IDE	 = f.IDE;
+						t.DLC	 = f.DLC;
+						t.Time = 0;
+						memcpy(t.Data, f.Data, 8);
+						if(CANSendBurst(Ch, &t, 1) == 0)	break;
+						sent++;
+				}
+				CanSimAdvance(BENCH_LOOP_US);
+				while(CanSimRecv(Ch, &log) == 0)
+				{
+						//队列按优先级发出, 只检查帧本身合法且出自CANCh
+						if((log.Src != Ch)||(log.DLC > 8)||(log.IDE == 0 && log.ID > 0x7FF))	bad++;
+						seen++;
+				}
+		}
+		CANGetLatency(Ch, &lat, 0);
+		printf("%-24s %u frames in %.1f ms, bus load %.1f%%, latency avg %.0f max %u us\n", Name, seen,
+					 (CanSimNow() - t0) / 1000.0, 100.0 * CanSimBusStat[Ch].BusyNs / ((CanSimNow() - t0) * 1000.0),
+					 lat.Num ? (double)lat.Sum / lat.Num : 0.0, lat.Max);
+		if(bad || (seen != BENCH_FRAMES) || (lat.Num != BENCH_FRAMES) || CanSimBusStat[Ch].AckErr || (lat.Max > BENCH_TX_WAIT_MAX_US))
+		{
+				printf("%-24s bad %u, latency samples %u, ack err %u, latency max %u us (limit %u)\n", "  ** 错误", bad, lat.Num,
+							 CanSimBusStat[Ch].AckErr, lat.Max, BENCH_TX_WAIT_MAX_US);
+				return 1 | Bench_Check("", Ch);
+		}
+		return Bench_Check("", Ch);
+}
+
+/*************************************************************************
+*  函数名称：Bench_FD
+*  功能说明：CAN0按500k/2M初始化FD, 外部节点交替发FD(BRS, 64字节)和经典帧, 同时CAN0发FD帧
+*************************************************************************/
+static uint8_t Bench_FD(void)
+{
+		CanSimFrameType	f;
+		CANFDFrameType	fd;
+		CANFrameType		r;
+		uint32_t				sent,got,out,bad,i;
+		uint64_t				t0;
+
+		Bench_Init();
+		if(CANInitFD(CAN0CH, 500, 2000))	return 1;
+		t0 = CanSimNow();
+		sent = got = out = bad = 0;
+		while((got < 2000)&&(CanSimNow() - t0 < 10000000uLL))
+		{
+				while((sent < 2000)&&(CanSimSendFree(0) > 1))
+				{
+						Bench_Frame(sent, 0, &f);
+						if(sent & 1)
+						{
+								f.FD	= 1;
+								f.BRS = 1;
+								f.DLC = 15;
+								for(i=0;i<64;i++)	f.Data[i] = (uint8_t)(sent + i);
+						}
+						CanSimSend(0, &f);
+						sent++;
+				}
+				memset(&fd, 0, sizeof(fd));
+				fd.ID	 = 0x100 + (out & 0xFF);
+				fd.Len = 64;
+				fd.BRS = 1;
+				for(i=0;i<64;i++)	fd.Data[i] = (uint8_t)(out ^ i);
+				if((out < 500)&&(CANSendFD(CAN0CH, &fd) == 0))	out++;
+				CanSimAdvance(BENCH_LOOP_US);
+				while(CANRecFD(CAN0CH, &fd) == 0)
+				{
+						if((fd.Len != 64)||(fd.Data[63] != (uint8_t)(got + 63)))	bad++;
+						got++;
+				}
+				while(CANRecFrame(CAN0CH, &r) == 0)
+				{
+						Bench_Frame(got, 0, &f);
+						if(Bench_Same(&f, &r) == 0)	bad++;
+						got++;
+				}
+		}
+		printf("%-24s rx %u/%u, tx %u, bad %u, data %u bit/s, bus load %.1f%%\n", "fd CAN0 500k/2M", got, sent,
+					 CanSimStat[0].TxFrames, bad, CanSimBitrate(0, 1),
+					 100.0 * CanSimBusStat[0].BusyNs / ((CanSimNow() - t0) * 1000.0));
+		if(bad || (got != 2000) || (CanSimStat[0].TxFrames != out) || (CanSimBitrate(0, 1) != 2000000))
+		{
+				printf("%-24s FD收发不符\n", "  ** 错误");
+				return 1 | Bench_Check("", 0);
+		}
+		return Bench_Check("", 0);
+}
+
+//求解器的期望结果: 8MHz经典位时间为CiA推荐的16Tq/87.5%(1M只能8Tq/75%, 与原工程写死的CTRL1一致),
+//80MHz FD数据段为75%; Rc为1的行应无解
+typedef	struct
+{
+			uint32_t	ClkHz;
+			uint32_t	Bitrate;
+			uint16_t	SamplePermille;
+			const CANTimingLimitType	*Limit;
+			uint8_t		Rc;
+			uint16_t	Presc;
+			uint8_t		Prop;
+			uint8_t		Pseg1;
+			uint8_t		Pseg2;
+			uint16_t	SamplePoint;
+			uint32_t	Rate;
+
+}		BenchTimingType;
+
+static const BenchTimingType	BenchTiming[] =
+{
+		//  时钟      波特率   采样点  范围               Rc  Presc Prop Pseg1 Pseg2  SP   实际波特率
+		{  8000000,  1000000, 875, &CANTimingClassic, 0,   1,   3,   2,    2,   750, 1000000 },
+		{  8000000,   500000, 875, &CANTimingClassic, 0,   1,   8,   5,    2,   875,  500000 },
+		{  8000000,   250000, 875, &CANTimingClassic, 0,   2,   8,   5,    2,   875,  250000 },
+		{  8000000,   125000, 875, &CANTimingClassic, 0,   4,   8,   5,    2,   875,  125000 },
+		{  8000000,   100000, 875, &CANTimingClassic, 0,   5,   8,   5,    2,   875,  100000 },
+		{  8000000,    83000, 875, &CANTimingClassic, 0,   6,   8,   5,    2,   875,   83333 },
+		{  8000000,    50000, 875, &CANTimingClassic, 0,  10,   8,   5,    2,   875,   50000 },
+		{  8000000,    10000, 875, &CANTimingClassic, 0,  50,   8,   5,    2,   875,   10000 },
+		{  8000000,     1000, 875, &CANTimingClassic, 1,   0,   0,   0,    0,     0,       0 },
+		{  8000000,  2000000, 875, &CANTimingClassic, 1,   0,   0,   0,    0,     0,       0 },
+		{ 80000000,   500000, 875, &CANTimingCbt,     0,   2,  59,  10,   10,   875,  500000 },
+		{ 80000000,   250000, 875, &CANTimingCbt,     0,   4,  59,  10,   10,   875,  250000 },
+		{  8000000,     5000, 875, &CANTimingCbt,     0,  20,  59,  10,   10,   875,    5000 },
+		{ 80000000,  2000000, 750, &CANTimingFdData,  0,   2,   9,   5,    5,   750, 2000000 },
+		{ 80000000,  5000000, 750, &CANTimingFdData,  0,   1,   7,   4,    4,   750, 5000000 },
+		{ 80000000,  2000000, 750, &CANTimingFdTdc,   0,   2,   9,   5,    5,   750, 2000000 },
+		{ 80000000,  8000000, 750, &CANTimingFdTdc,   0,   1,   3,   3,    3,   700, 8000000 },
+		{ 80000000,  1000000, 750, &CANTimingFdTdc,   1,   0,   0,   0,    0,     0,       0 },
+};
+
+/*************************************************************************
+*  函数名称：Bench_Timing
+*  功能说明：CANCalcBitTiming对照BenchTiming, 并检查各段不超出Limit、Tq与RJW自洽
+*************************************************************************/
+static uint8_t Bench_Timing(void)
+{
+		const BenchTimingType		*e;
+		const CANTimingLimitType	*l;
+		CANBitTimingType	t;
+		uint16_t	i,bad;
+		uint8_t		rc;
+
+		bad = 0;
+		for(i=0;i<sizeof(BenchTiming)/sizeof(BenchTiming[0]);i++)
+		{
+				e = &BenchTiming[i];
+				l = e->Limit;
+				memset(&t, 0, sizeof(t));
+				rc = CANCalcBitTiming(e->ClkHz, e->Bitrate, e->SamplePermille, l, &t);
+				if(rc != e->Rc)
+				{
+						printf("%-24s %u Hz %u bit/s: rc %u\n", "  ** 错误", e->ClkHz, e->Bitrate, rc);
+						bad++;
+						continue;
+				}
+				if(rc)	continue;
+				if((t.Presc != e->Presc)||(t.Prop != e->Prop)||(t.Pseg1 != e->Pseg1)||(t.Pseg2 != e->Pseg2)||
+					 (t.SamplePoint != e->SamplePoint)||(t.Bitrate != e->Rate)||(t.Tq != 1 + t.Prop + t.Pseg1 + t.Pseg2)||
+					 (e->ClkHz / ((uint32_t)t.Presc * t.Tq) != t.Bitrate)||(t.Presc > l->PrescMax)||(t.Prop < l->PropMin)||
+					 (t.Prop > l->PropMax)||(t.Pseg1 > l->Pseg1Max)||(t.Pseg2 < l->Pseg2Min)||(t.Pseg2 > l->Pseg2Max)||
+					 (t.Rjw == 0)||(t.Rjw > l->RjwMax)||(t.Rjw > t.Pseg1)||(t.Rjw > t.Pseg2)||
+					 (l->SpClkMax && ((uint32_t)(t.Tq - t.Pseg2) * t.Presc > l->SpClkMax)))
+				{
+						printf("%-24s %u Hz %u bit/s: presc %u prop %u pseg1 %u pseg2 %u rjw %u tq %u sp %u -> %u bit/s\n", "  ** 错误",
+									 e->ClkHz, e->Bitrate, t.Presc, t.Prop, t.Pseg1, t.Pseg2, t.Rjw, t.Tq, t.SamplePoint, t.Bitrate);
+						bad++;
+				}
+		}
+		printf("%-24s %u cases, bad %u\n", "bit timing solver", i, bad);
+		return bad ? 1 : 0;
+}
+
+//过滤表检查: 每种情形的ID集合使CANFilterCompile选出对应格式
+#define BENCH_FILTER_IDS				72
+//每种情形另发的随机ID数
+#define BENCH_FILTER_PROBES			2000
+
+static CANFilterIDType	BenchFilterIDs[BENCH_FILTER_IDS];
+static CANFilterTabType	BenchFilterTab;
+static CanSimFrameType	BenchProbe[BENCH_FILTER_IDS * 30 + BENCH_FILTER_PROBES];
+static uint8_t					BenchGot[BENCH_FILTER_IDS * 30 + BENCH_FILTER_PROBES];
+
+static uint32_t Bench_Hash(uint32_t x)
+{
+		x *= 2654435761u;
+		x ^= x >> 13;
+		x *= 0x5BD1E995u;
+		return x ^ (x >> 15);
+}
+
+/*************************************************************************
+*  函数名称：Bench_FilterRef
+*  功能说明：按参考手册的格式A/B/C定义判断过滤表是否接收一帧, 与模型无关, 用来对照模型的结果
+*************************************************************************/
+static uint8_t Bench_FilterRef(const CANFilterTabType *Tab, uint32_t ID, uint8_t IDE)
+{
+		uint32_t	w,e,m;
+		uint16_t	i,n;
+		uint8_t		k;
+
+		n = 8 * (Tab->RFFN + 1);
+		for(i=0;i<n;i++)
+		{
+				e = Tab->Elem[i];
+				m = Tab->Mask[i];
+				switch(Tab->Format)
+				{
+						case CAN_FILTER_FORMAT_A:
+								//31: RTR, 30: IDE, 29~19: 标准ID, 29~1: 扩展ID
+								w = IDE ? ((1uL << 30) | (ID << 1)) : (ID << 19);
+								if(((w ^ e) & m) == 0)	return 1;
+								break;
+						case CAN_FILTER_FORMAT_B:
+								//每半字 15: RTR, 14: IDE, 13~3: 标准ID, 13~0: 扩展ID高14位
+								w = IDE ? ((1uL << 14) | ((ID >> 15) & 0x3FFF)) : (ID << 3);
+								for(k=0;k<2;k++)
+										if(((w ^ (e >> (16 * k))) & (m >> (16 * k)) & 0xFFFF) == 0)	return 1;
+								break;
+						case CAN_FILTER_FORMAT_C:
+								//每字节为ID高8位
+								w = IDE ? ((ID >> 21) & 0xFF) : ((ID >> 3) & 0xFF);
+								for(k=0;k<4;k++)
+										if(((w ^ (e >> (8 * k))) & (m >> (8 * k)) & 0xFF) == 0)	return 1;
+								break;
+						default:
+								return 0;
+				}
+		}
+		return 0;
+}
+
+static void Bench_Probe(uint16_t *Num, uint32_t ID, uint8_t IDE)
+{
+		CanSimFrameType	*f;
+
+		f = &BenchProbe[*Num];
+		memset(f, 0, sizeof(*f));
+		f->IDE = IDE;
+		f->ID	 = ID & (IDE ? 0x1FFFFFFFuL : 0x7FFuL);
+		f->DLC = 2;
+		f->Data[0] = (uint8_t)*Num;
+		f->Data[1] = (uint8_t)(*Num >> 8);
+		(*Num)++;
+}
+
+/*************************************************************************
+*  函数名称：Bench_Filter
+*  功能说明：编译BenchFilterIDs的前Num个ID, 检查所选格式; 写入CAN0后发出集合中的ID、各ID逐位取反的邻居
+//	         和随机ID, 模型(Sim_FifoMatch)的接收结果须与Bench_FilterRef一致, 集合中的ID须全部收到
+*************************************************************************/
+static uint8_t Bench_Filter(const char *Name, uint16_t Num, uint8_t Format)
+{
+		CANFrameType	r;
+		uint16_t	i,n,sent,idx;
+		uint32_t	bad,miss,acc;
+		uint8_t		k;
+
+		Bench_Init();
+		if(CANInit(CAN0CH, 500))	return 1;
+		if(CANFilterCompile(BenchFilterIDs, Num, CAN_RX_FILTER_RFFN_MAX, 8 * (CAN_RX_FILTER_RFFN_MAX + 1), &BenchFilterTab)||
+			 (BenchFilterTab.Format != Format)||CANSetRxFilter(CAN0CH, &BenchFilterTab))
+		{
+				printf("%-24s %s: format %u, 期望 %u\n", "  ** 错误", Name, BenchFilterTab.Format, Format);
+				return 1;
+		}
+
+		n = 0;
+		for(i=0;i<Num;i++)
+		{
+				Bench_Probe(&n, BenchFilterIDs[i].ID, BenchFilterIDs[i].IDE);
+				for(k=0;k<(BenchFilterIDs[i].IDE ? 29 : 11);k++)	Bench_Probe(&n, BenchFilterIDs[i].ID ^ (1uL << k), BenchFilterIDs[i].IDE);
+		}
+		for(i=0;i<BENCH_FILTER_PROBES;i++)	Bench_Probe(&n, Bench_Hash(i + Num * 7919u), (uint8_t)(i & 1));
+		memset(BenchGot, 0, n);
+
+		sent = 0;
+		while((sent < n)||(CanSimBusIdle(0) == 0))
+		{
+				while((sent < n)&&CanSimSendFree(0))	CanSimSend(0, &BenchProbe[sent++]);
+				CanSimAdvance(BENCH_LOOP_US);
+				while(CANRecFrame(CAN0CH, &r) == 0)
+				{
+						idx = (uint16_t)(r.Data[0] | (r.Data[1] << 8));
+						if(idx < n)	BenchGot[idx]++;
+				}
+		}
+
+		bad = 0;
+		miss = 0;
+		acc = 0;
+		for(i=0;i<n;i++)
+		{
+				if(BenchGot[i] != Bench_FilterRef(&BenchFilterTab, BenchProbe[i].ID, BenchProbe[i].IDE))	bad++;
+				acc += BenchGot[i];
+		}
+		//集合中的ID及其邻居按顺序排在前面, 每个ID占1+ID位数个
+		for(i=0,idx=0;i<Num;i++)
+		{
+				if(BenchGot[idx] != 1)	miss++;
+				idx = (uint16_t)(idx + (BenchFilterIDs[i].IDE ? 30 : 12));
+		}
+		printf("%-24s format %c, %u elements, est. false accept %u, probes %u accepted %u, missed %u, ref mismatch %u, hw drop %u\n",
+					 Name, 'A' + BenchFilterTab.Format, BenchFilterTab.Num, BenchFilterTab.FalseAccept, n, acc, miss, bad,
+					 CanSimStat[0].RxMiss);
+		return (bad || miss) ? 1 : Bench_Check("", 0);
+}
+
+/*************************************************************************
+*  函数名称：Bench_Filters
+*  功能说明：格式A精确、格式A掩码合并、格式B和格式C各一种情形
+*************************************************************************/
+static uint8_t Bench_Filters(void)
+{
+		uint16_t	i;
+		uint8_t		err;
+
+		//5个标准帧+3个扩展帧, 每个ID一个元素
+		for(i=0;i<8;i++)
+		{
+				BenchFilterIDs[i].IDE = (i >= 5) ? 1 : 0;
+				BenchFilterIDs[i].ID	= (i >= 5) ? 0x18FEF100uL + i : 0x100uL + i * 0x23;
+		}
+		err = Bench_Filter("filter A exact", 8, CAN_FILTER_FORMAT_A);
+		//编码位置: 标准帧0x100在29~19位, 扩展帧在29~1位并置IDE
+		if((BenchFilterTab.Elem[0] != (0x100uL << 19))||(BenchFilterTab.Elem[5] != (0x40000000uL | (0x18FEF105uL << 1))))
+		{
+				printf("%-24s elem0 %08X elem5 %08X\n", "  ** 错误", BenchFilterTab.Elem[0], BenchFilterTab.Elem[5]);
+				err = 1;
+		}
+
+		//16个连续标准帧, 两两合并为掩码元素
+		for(i=0;i<16;i++)
+		{
+				BenchFilterIDs[i].IDE = 0;
+				BenchFilterIDs[i].ID	= 0x300 + i;
+		}
+		err |= Bench_Filter("filter A masked", 16, CAN_FILTER_FORMAT_A);
+
+		//16个分散的标准帧: 格式B每元素2个完整标准ID, 不多放行
+		for(i=0;i<16;i++)
+		{
+				BenchFilterIDs[i].IDE = 0;
+				BenchFilterIDs[i].ID	= (Bench_Hash(i) >> 11) & 0x7FF;
+		}
+		err |= Bench_Filter("filter B", 16, CAN_FILTER_FORMAT_B);
+		if((BenchFilterTab.Elem[0] >> 16) != ((BenchFilterTab.Elem[0] >> 16) & 0x3FF8))
+		{
+				printf("%-24s elem0 %08X\n", "  ** 错误", BenchFilterTab.Elem[0]);
+				err = 1;
+		}
+
+		//24组高8位各3个扩展帧, 掩码合并放行更多, 格式C按高8位匹配
+		for(i=0;i<72;i++)
+		{
+				BenchFilterIDs[i].IDE = 1;
+				BenchFilterIDs[i].ID	= ((uint32_t)((i % 24) * 10) << 21) | (Bench_Hash(i + 1) & 0x1FFFFF);
+		}
+		err |= Bench_Filter("filter C", 72, CAN_FILTER_FORMAT_C);
+		return err;
+}
+
+/*************************************************************************
+*  函数名称：Bench_MbLayout
+*  功能说明：CANSendBurst后立即读发送MailBox的4个字, 与参考手册的布局对照:
+//	         CS字 CODE 27~24、SRR 22、IDE 21、DLC 19~16, ID字 标准ID 28~18/扩展ID 28~0, 数据按总线顺序大端存放;
+//	         发完后总线上的帧与原帧一致, CS字CODE为8并带时间戳; 另查MailBoxType各位域与整字宏一致
+//	         接收方向的整字读取由Bench_Rx(FIFO、DMA)和Bench_FD(64字节MailBox)覆盖
+*************************************************************************/
+static uint8_t Bench_MbLayout(void)
+{
+		static const CANFrameType	tx[] =
+		{
+				{ 0x7FF,			{ 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 }, 0, 8, 0 },
+				{ 0x1ABCDEF0, { 0xA1, 0xB2, 0xC3, 0x00, 0x00, 0x00, 0x00, 0x00 }, 1, 3, 0 },
+				{ 0x001,			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, 0, 0, 0 },
+				{ 0x00000001, { 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x00, 0x00, 0x00 }, 1, 5, 0 },
+		};
+		CanSimFrameType	f;
+		MailBoxType			mb;
+		volatile uint32_t	*pMB;
+		uint32_t	w[4],e[4];
+		uint16_t	bad;
+		uint8_t		i,k;
+
+		Bench_Init();
+		if(CANInit(CAN0CH, 500))	return 1;
+		pMB = &CanSimReg[0].RAMn[FLEXCAN_TX_MB_START_NO * 4];
+		bad = 0;
+		for(i=0;i<sizeof(tx)/sizeof(tx[0]);i++)
+		{
+				if(CANSendBurst(CAN0CH, &tx[i], 1) != 1)	return 1;
+				for(k=0;k<4;k++)	w[k] = pMB[k];
+				e[0] = (0xCuL << 24) | (tx[i].IDE ? ((1uL << 22) | (1uL << 21)) : 0) | ((uint32_t)tx[i].DLC << 16);
+				e[1] = tx[i].IDE ? tx[i].ID : (tx[i].ID << 18);
+				e[2] = ((uint32_t)tx[i].Data[0] << 24) | ((uint32_t)tx[i].Data[1] << 16) | ((uint32_t)tx[i].Data[2] << 8) | tx[i].Data[3];
+				e[3] = ((uint32_t)tx[i].Data[4] << 24) | ((uint32_t)tx[i].Data[5] << 16) | ((uint32_t)tx[i].Data[6] << 8) | tx[i].Data[7];
+				if(memcmp(w, e, sizeof(w)))
+				{
+						printf("%-24s %08X %08X %08X %08X, 期望 %08X %08X %08X %08X\n", "  ** 错误",
+									 w[0], w[1], w[2], w[3], e[0], e[1], e[2], e[3]);
+						bad++;
+				}
+				CanSimAdvance(1000);
+				if((CanSimRecv(0, &f) != 0)||(Bench_Same(&f, &tx[i]) == 0)||(((pMB[0] >> 24) & 0xF) != 0x8)||
+					 ((pMB[0] & 0xFFFF) == 0))
+				{
+						printf("%-24s tx %u: 总线上的帧或完成后的CS %08X不符\n", "  ** 错误", i, pMB[0]);
+						bad++;
+				}
+		}
+
+		memset(&mb, 0, sizeof(mb));
+		mb.CODE = 0xC;
+		mb.SRR	= 1;
+		mb.IDE	= 1;
+		mb.DLC	= 5;
+		mb.TimeStamp = 0x1234;
+		mb.EDL	= 1;
+		mb.BRS	= 1;
+		mb.ID		= 0x7FFuL << 18;
+		mb.PRIO = 5;
+		memcpy(w, &mb, 8);
+		if((sizeof(MailBoxType) != 16)||
+			 (w[0] != (FLEXCAN_MB_CS_CODE(0xC) | FLEXCAN_MB_CS_SRR | FLEXCAN_MB_CS_IDE | FLEXCAN_MB_CS_LENGTH(5) |
+								 FLEXCAN_MB_CS_TIMESTAMP(0x1234) | FLEXCAN_MB_CS_EDL | FLEXCAN_MB_CS_BRS))||
+			 (w[1] != (uint32_t)(FLEXCAN_MB_ID_IDSTD(0x7FF) | FLEXCAN_MB_ID_PRIO(5))))
+		{
+				printf("%-24s MailBoxType %u bytes, %08X %08X\n", "  ** 错误", (uint32_t)sizeof(MailBoxType), w[0], w[1]);
+				bad++;
+		}
+		printf("%-24s %u tx frames, bad %u\n", "mailbox layout", i, bad);
+		return bad ? 1 : Bench_Check("", 0);
+}
+
+//发送顺序检查的帧数
+#define BENCH_ORDER_FRAMES			4000
+
+typedef	struct
+{
+			CANFrameType	Frame;
+			uint32_t	Key;
+			uint64_t	SubmitNs;					//CANSendBurst接收该帧的时刻
+			uint64_t	SofNs;						//在总线上开始发送的时刻, 0为未发出
+			uint16_t	Sent;
+			uint8_t		Held;							//发出时有等待超过CAN_TX_AGE_US的帧, 队列暂停按ID排序
+
+}		BenchOrderType;
+
+static BenchOrderType		BenchOrder[BENCH_ORDER_FRAMES];
+static uint64_t					BenchOrderMaxNs;			//总线上最长一帧
+
+//与drvCAN.c的CAN_TxKey相同: 按总线上仲裁场比较, 同基本ID时标准帧优先
+static uint32_t Bench_Key(uint32_t ID, uint8_t IDE)
+{
+		if(IDE)	return ((ID & 0x1FFFFFFF) << 1) | 1;
+		return (ID & 0x7FF) << 19;
+}
+
+//ID只取少量取值, 使同ID帧常见; Urgent为1时为标准帧, 优先级高于所有扩展帧, 否则为随机标准帧或扩展帧
+static void Bench_OrderFrame(uint16_t Seq, uint8_t Urgent)
+{
+		BenchOrderType	*o;
+		uint32_t	h;
+
+		o = &BenchOrder[Seq];
+		memset(o, 0, sizeof(*o));
+		h = Bench_Hash(Seq + 0x5A5A);
+		o->Frame.IDE = Urgent ? 0 : (uint8_t)((h >> 31) & 1);
+		o->Frame.ID	 = o->Frame.IDE ? (0x18FF0000uL | ((h >> 8) & 0x1F) << 11) : 0x100 + ((h >> 8) & 0x1F) * 0x21;
+		o->Frame.DLC = 8;
+		o->Frame.Data[0] = (uint8_t)Seq;
+		o->Frame.Data[1] = (uint8_t)(Seq >> 8);
+		o->Key = Bench_Key(o->Frame.ID, o->Frame.IDE);
+}
+
+//取走总线日志, 按数据中的序号记下开始发送时刻
+static void Bench_OrderLog(uint16_t *Order, uint16_t *Num)
+{
+		CanSimFrameType	f;
+		uint16_t	seq;
+
+		while(CanSimRecv(0, &f) == 0)
+		{
+				if(f.Src != CAN0CH)	continue;
+				seq = (uint16_t)(f.Data[0] | (f.Data[1] << 8));
+				if(seq >= BENCH_ORDER_FRAMES)	continue;
+				if((f.ID != BenchOrder[seq].Frame.ID)||(f.IDE != BenchOrder[seq].Frame.IDE))	continue;
+				if(BenchOrder[seq].Sent++ == 0)	BenchOrder[seq].SofNs = f.Time;
+				if(f.Done - f.Time > BenchOrderMaxNs)	BenchOrderMaxNs = f.Done - f.Time;
+				Order[(*Num)++] = seq;
+		}
+}
+
+/*************************************************************************
+*  函数名称：Bench_TxOrder
+*  功能说明：CANSendBurst发送队列与MailBox中止: 一次装满队列时总线上须严格按ID优先级、同ID按提交顺序发出;
+//	         之后随机陆续提交, 每帧恰好发出一次, 同ID不乱序, 且比某帧开始发送早一帧以上提交的
+//	         高优先级帧不得在其后发出(提交时正在总线上的帧不能中止); 有帧等待超过CAN_TX_AGE_US时
+//	         允许倒置, 但任一帧的等待不得超过BENCH_TX_WAIT_MAX_US
+*************************************************************************/
+static uint8_t Bench_TxOrder(void)
+{
+		static uint16_t	order[BENCH_ORDER_FRAMES * 2];
+		CANFrameType	burst[CAN_TX_QUEUE_SIZE];
+		CANFrameType	r;
+		CANStatType		st;
+		BenchOrderType	*a,*b;
+		uint64_t	slack,wait;
+		uint32_t	inv,dup,lost,seqErr,prio,loop,h,held;
+		uint16_t	i,j,k,n,sent,num;
+
+		Bench_Init();
+		if(CANInit(CAN0CH, 500))	return 1;
+		BenchOrderMaxNs = 0;
+
+		//1. 一次提交整个队列
+		for(i=0;i<CAN_TX_QUEUE_SIZE;i++)
+		{
+				Bench_OrderFrame(i, 0);
+				burst[i] = BenchOrder[i].Frame;
+		}
+		n = CANSendBurst(CAN0CH, burst, CAN_TX_QUEUE_SIZE);
+		num = 0;
+		while((CanSimBusIdle(0) == 0)||CANGetQueueDepth(CAN0CH))
+		{
+				CanSimAdvance(BENCH_LOOP_US);
+				while(CANRecFrame(CAN0CH, &r) == 0);
+				Bench_OrderLog(order, &num);
+		}
+		prio = 0;
+		for(i=1;i<num;i++)
+		{
+				j = order[i - 1];
+				k = order[i];
+				if((BenchOrder[j].Key > BenchOrder[k].Key)||((BenchOrder[j].Key == BenchOrder[k].Key)&&(j > k)))	prio++;
+		}
+		printf("%-24s queued %u, sent %u, out of order %u\n", "tx order burst", n, num, prio);
+		if((n != CAN_TX_QUEUE_SIZE)||(num != CAN_TX_QUEUE_SIZE)||prio)
+		{
+				printf("%-24s\n", "  ** 错误");
+				return 1;
+		}
+
+		//2. 每圈以1/32的概率提交10帧扩展帧(多于发送MailBox数), 以1/16的概率提交1帧标准帧,
+		//   平均与500k总线的8字节帧容量相当; 标准帧到达时MailBox常被扩展帧占满, 须靠中止插队
+		sent = 0;
+		num	 = 0;
+		for(loop=0;(sent < BENCH_ORDER_FRAMES)||(CanSimBusIdle(0) == 0)||CANGetQueueDepth(CAN0CH);loop++)
+		{
+				h = Bench_Hash(loop);
+				k = ((h & 31) == 0) ? 10 : (((h >> 5) & 15) == 0);
+				for(j=0;(j<k)&&(sent<BENCH_ORDER_FRAMES);j++)
+				{
+						Bench_OrderFrame(sent, (h & 31) != 0);
+						if(CANSendBurst(CAN0CH, &BenchOrder[sent].Frame, 1) == 0)	break;
+						BenchOrder[sent++].SubmitNs = CanSimNowNs();
+				}
+				CanSimAdvance(BENCH_LOOP_US);
+				while(CANRecFrame(CAN0CH, &r) == 0);
+				Bench_OrderLog(order, &num);
+		}
+
+		//提交时已在总线上的帧不能中止, 提交后一帧时间内不算倒置
+		slack = BenchOrderMaxNs;
+		inv = 0;
+		dup = 0;
+		lost = 0;
+		seqErr = 0;
+		for(i=0;i<BENCH_ORDER_FRAMES;i++)
+		{
+				if(BenchOrder[i].Sent == 0)	lost++;
+				if(BenchOrder[i].Sent > 1)	dup++;
+		}
+		//超时帧从超时到发出期间, 队列不再装入其它帧, MailBox中已有的帧可先于新提交的高优先级帧发出
+		held = 0;
+		wait = 0;
+		for(i=0;i<num;i++)
+		{
+				a = &BenchOrder[order[i]];
+				if(a->SofNs - a->SubmitNs > wait)	wait = a->SofNs - a->SubmitNs;
+				if(a->SofNs - a->SubmitNs < CAN_TX_AGE_US * 1000uLL)	continue;
+				for(j=0;j<num;j++)
+				{
+						b = &BenchOrder[order[j]];
+						if((b->Held == 0)&&(b->SofNs >= a->SubmitNs + CAN_TX_AGE_US * 1000uLL)&&(b->SofNs <= a->SofNs))
+						{
+								b->Held = 1;
+								held++;
+						}
+				}
+		}
+		for(i=0;i<num;i++)
+		{
+				k = order[i];
+				for(j=i+1;j<num;j++)
+				{
+						//j在k之后发出; 同ID须按提交顺序, 高优先级须不晚于提交后slack
+						if((BenchOrder[order[j]].Key == BenchOrder[k].Key)&&(order[j] < k))	seqErr++;
+						if(BenchOrder[k].Held)	continue;
+						if((BenchOrder[order[j]].Key < BenchOrder[k].Key)&&(BenchOrder[order[j]].SubmitNs + slack < BenchOrder[k].SofNs))	inv++;
+				}
+		}
+		CANGetStat(CAN0CH, &st, 0);
+		printf("%-24s submitted %u, sent %u, lost %u, dup %u, same-id reorder %u, priority inversion %u, aborts %u, tx reject %u\n",
+					 "tx order trickle", sent, num, lost, dup, seqErr, inv, CanSimStat[0].Aborts, st.TxReject);
+		printf("%-24s max wait %.0f us (limit %u), sent while aged frame pending %u\n", "", wait / 1000.0, BENCH_TX_WAIT_MAX_US, held);
+		if(lost || dup || seqErr || inv || (num != BENCH_ORDER_FRAMES)||(wait > BENCH_TX_WAIT_MAX_US * 1000uLL))
+		{
+				printf("%-24s\n", "  ** 错误");
+				return 1;
+		}
+		return Bench_Check("", 0);
+}
+
+//路由查找: 标准帧、扩展帧各2048条, 分布在三路源通道
+#define BENCH_ROUTE_STD					2048
+#define BENCH_ROUTE_EXT					2048
+#define BENCH_ROUTE_NUM					(BENCH_ROUTE_STD + BENCH_ROUTE_EXT)
+//不在表中的探测帧数
+#define BENCH_ROUTE_PROBES			200000
+//计时的重复轮数
+#define BENCH_ROUTE_ROUNDS			200
+
+static CANRouteType		BenchRoute[BENCH_ROUTE_NUM];
+
+static int Bench_RouteCmp(const void *a, const void *b)
+{
+		const CANRouteType	*x = (const CANRouteType *)a;
+		const CANRouteType	*y = (const CANRouteType *)b;
+
+		if(x->SrcCh != y->SrcCh)	return x->SrcCh - y->SrcCh;
+		if(x->IDE != y->IDE)			return x->IDE - y->IDE;
+		return (x->SrcID < y->SrcID) ? -1 : (x->SrcID > y->SrcID);
+}
+
+//表中是否有(SrcCh, IDE, ID), 表已排序
+static uint8_t Bench_RouteHas(uint8_t SrcCh, uint8_t IDE, uint32_t ID)
+{
+		CANRouteType	key;
+
+		key.SrcCh = SrcCh;
+		key.IDE		= IDE;
+		key.SrcID = ID;
+		return bsearch(&key, BenchRoute, BENCH_ROUTE_NUM, sizeof(CANRouteType), Bench_RouteCmp) ? 1 : 0;
+}
+
+//按帧计时查找, 返回每次查找的ns; Hit累计找到的条数, 防止查找被优化掉
+static double Bench_RouteTime(const CANFrameType *Frames, const uint8_t *Ch, uint32_t Num, uint32_t *Hit)
+{
+		double		t;
+		uint32_t	i,k,n;
+
+		n = 0;
+		t = Bench_HostNs();
+		for(k=0;k<BENCH_ROUTE_ROUNDS;k++)
+				for(i=0;i<Num;i++)
+						if(CANRouteLookup(Ch[i], &Frames[i]))	n++;
+		t = Bench_HostNs() - t;
+		*Hit = n / BENCH_ROUTE_ROUNDS;
+		return t / ((double)Num * BENCH_ROUTE_ROUNDS);
+}
+
+/*************************************************************************
+*  函数名称：Bench_Route
+*  功能说明：CANRouteInit装入标准帧、扩展帧各2048条随机ID的路由表, 每条须查到自身;
+//	         随机ID、其他通道的同ID和另一种帧格式的同ID都不在表中时须查不到; 统计每次查找的主机耗时
+*************************************************************************/
+static uint8_t Bench_Route(void)
+{
+		static CANFrameType	hitStd[BENCH_ROUTE_STD],hitExt[BENCH_ROUTE_EXT],miss[BENCH_ROUTE_PROBES];
+		static uint8_t			chStd[BENCH_ROUTE_STD],chExt[BENCH_ROUTE_EXT],chMiss[BENCH_ROUTE_PROBES];
+		static uint8_t			stdUsed[CAN_CHANNEL_NUM][CAN_ROUTE_STD_ID_NUM];
+		CANFrameType	f;
+		const CANRouteType	*r;
+		uint32_t	i,k,h,ns,ne,nm,wrong,falseHit,hit;
+		double		tStd,tExt,tMiss;
+		uint8_t		ch;
+
+		//标准帧每通道ID不重复; 扩展帧29位随机, 重复的概率可忽略, 排序后再剔除
+		memset(stdUsed, 0, sizeof(stdUsed));
+		for(i=0,k=0;i<BENCH_ROUTE_STD;k++)
+		{
+				h	 = Bench_Hash(k);
+				ch = (uint8_t)(h % CAN_CHANNEL_NUM);
+				nm = (h >> 8) & 0x7FF;
+				if(stdUsed[ch][nm])	continue;
+				stdUsed[ch][nm] = 1;
+				memset(&BenchRoute[i], 0, sizeof(CANRouteType));
+				BenchRoute[i].SrcCh		= ch;
+				BenchRoute[i].SrcID		= nm;
+				BenchRoute[i].DstMask = CAN_ROUTE_DST((ch + 1) % CAN_CHANNEL_NUM);
+				BenchRoute[i].DstID		= CAN_ROUTE_ID_KEEP;
+				i++;
+		}
+		for(i=0;i<BENCH_ROUTE_EXT;i++)
+		{
+				h = Bench_Hash(i + 0x10000);
+				memset(&BenchRoute[BENCH_ROUTE_STD + i], 0, sizeof(CANRouteType));
+				BenchRoute[BENCH_ROUTE_STD + i].SrcCh	 = (uint8_t)(i % CAN_CHANNEL_NUM);
+				BenchRoute[BENCH_ROUTE_STD + i].IDE		 = 1;
+				BenchRoute[BENCH_ROUTE_STD + i].SrcID	 = h & 0x1FFFFFFF;
+				BenchRoute[BENCH_ROUTE_STD + i].DstMask = CAN_ROUTE_DST((i + 1) % CAN_CHANNEL_NUM);
+				BenchRoute[BENCH_ROUTE_STD + i].DstID	 = CAN_ROUTE_ID_KEEP;
+		}
+		qsort(BenchRoute, BENCH_ROUTE_NUM, sizeof(CANRouteType), Bench_RouteCmp);
+		for(i=1;i<BENCH_ROUTE_NUM;i++)
+		{
+				if(Bench_RouteCmp(&BenchRoute[i - 1], &BenchRoute[i]) == 0)
+				{
+						printf("%-24s 随机扩展帧ID重复\n", "  ** 错误");
+						return 1;
+				}
+		}
+		if(CANRouteInit(BenchRoute, BENCH_ROUTE_NUM))
+		{
+				printf("%-24s CANRouteInit\n", "  ** 错误");
+				return 1;
+		}
+
+		//每条须查到自身
+		wrong = 0;
+		ns = ne = 0;
+		for(i=0;i<BENCH_ROUTE_NUM;i++)
+		{
+				memset(&f, 0, sizeof(f));
+				f.ID	= BenchRoute[i].SrcID;
+				f.IDE = BenchRoute[i].IDE;
+				if(CANRouteLookup(BenchRoute[i].SrcCh, &f) != &BenchRoute[i])	wrong++;
+				if(f.IDE)
+				{
+						hitExt[ne] = f;
+						chExt[ne++] = BenchRoute[i].SrcCh;
+				}
+				else
+				{
+						hitStd[ns] = f;
+						chStd[ns++] = BenchRoute[i].SrcCh;
+				}
+		}
+
+		//不在表中的帧: 随机ID, 表中ID换到其他通道, 表中ID换成另一种帧格式
+		falseHit = 0;
+		for(i=0,nm=0;nm<BENCH_ROUTE_PROBES;i++)
+		{
+				h = Bench_Hash(i + 0x20000);
+				memset(&f, 0, sizeof(f));
+				switch(i % 3)
+				{
+						case 0:
+								f.IDE = (uint8_t)(h & 1);
+								f.ID	= f.IDE ? (Bench_Hash(h) & 0x1FFFFFFF) : ((h >> 1) & 0x7FF);
+								ch		= (uint8_t)((h >> 16) % CAN_CHANNEL_NUM);
+								break;
+						case 1:
+								r			= &BenchRoute[h % BENCH_ROUTE_NUM];
+								f.IDE = r->IDE;
+								f.ID	= r->SrcID;
+								ch		= (uint8_t)((r->SrcCh + 1 + ((h >> 16) & 1)) % CAN_CHANNEL_NUM);
+								break;
+						default:
+								r			= &BenchRoute[h % BENCH_ROUTE_NUM];
+								f.IDE = (uint8_t)!r->IDE;
+								f.ID	= r->SrcID & (f.IDE ? 0x1FFFFFFF : 0x7FF);
+								ch		= r->SrcCh;
+								break;
+				}
+				if(Bench_RouteHas(ch, f.IDE, f.ID))	continue;
+				if(CANRouteLookup(ch, &f))	falseHit++;
+				miss[nm]	 = f;
+				chMiss[nm++] = ch;
+		}
+
+		tStd	= Bench_RouteTime(hitStd, chStd, ns, &hit);
+		if(hit != ns)	wrong++;
+		tExt	= Bench_RouteTime(hitExt, chExt, ne, &hit);
+		if(hit != ne)	wrong++;
+		tMiss = Bench_RouteTime(miss, chMiss, nm, &hit);
+		if(hit)	falseHit++;
+		printf("%-24s %u std + %u ext entries, %u probes: wrong %u, false hit %u; %.1f ns std hit, %.1f ns ext hit, %.1f ns miss\n",
+					 "route lookup", ns, ne, nm, wrong, falseHit, tStd, tExt, tMiss);
+		if(wrong || falseHit)
+		{
+				printf("%-24s\n", "  ** 错误");
+				return 1;
+		}
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：Bench_Api
+*  功能说明：CAN1接到CAN0的总线上, CAN0发BENCH_FRAMES帧、CAN1收, 主循环每BENCH_LOOP_US一圈;
+//	         Burst为0时逐帧调用CANSendData/CANRecData, 否则每次最多32帧调用CANSendBurst/CANRecBurst
+//	         虚拟时间的帧率受总线限制, 两种方式应相同; 主机上只计收发接口调用(含接收检查)的耗时, 得出接口的帧率
+//	         帧用同一ID, 发送队列按提交顺序发出, 接收端按序号检查
+*************************************************************************/
+static CANFrameType	BenchApi[BENCH_FRAMES];
+
+static uint8_t Bench_Api(uint8_t Burst, double *HostFps)
+{
+		CanSimFrameType	f;
+		CANFrameType		r[32],*a;
+		uint32_t				sent,got,bad,id,i,n;
+		uint8_t					dlc,data[8];
+		uint64_t				t0;
+		double					ns,h;
+
+		for(i=0;i<BENCH_FRAMES;i++)
+		{
+				Bench_Frame(i, 0, &f);
+				BenchApi[i].ID	 = 0x123;
+				BenchApi[i].IDE	 = 0;
+				BenchApi[i].DLC	 = f.DLC;
+				BenchApi[i].Time = 0;
+				memcpy(BenchApi[i].Data, f.Data, 8);
+		}
+		Bench_Init();
+		CanSimConnect(CAN1CH, 0);
+		if(CANInit(CAN0CH, 500) || CANInit(CAN1CH, 500))	return 1;
+		t0	 = CanSimNow();
+		sent = got = bad = 0;
+		ns	 = 0;
+		while((got < BENCH_FRAMES)&&(CanSimNow() - t0 < 10000000uLL))
+		{
+				h = Bench_HostNs();
+				if(Burst)
+				{
+						n = BENCH_FRAMES - sent;
+						if(n)	sent += CANSendBurst(CAN0CH, &BenchApi[sent], (uint8_t)(n < 32 ? n : 32));
+				}
+				else
+				{
+						while(sent < BENCH_FRAMES)
+						{
+								a = &BenchApi[sent];
+								if(CANSendData(CAN0CH, a->IDE, a->ID, a->DLC, a->Data))	break;
+								sent++;
+						}
+				}
+				if(Burst)
+				{
+						while((n = CANRecBurst(CAN1CH, r, 32)) != 0)
+						{
+								for(i=0;i<n;i++,got++)
+								{
+										a = &BenchApi[got % BENCH_FRAMES];
+										if((r[i].ID != a->ID)||(r[i].DLC != a->DLC)||memcmp(r[i].Data, a->Data, a->DLC))	bad++;
+								}
+						}
+				}
+				else
+				{
+						while(CANRecData(CAN1CH, &id, &dlc, data) == 0)
+						{
+								a = &BenchApi[got++ % BENCH_FRAMES];
+								if((id != a->ID)||(dlc != a->DLC)||memcmp(data, a->Data, dlc))	bad++;
+						}
+				}
+				ns += Bench_HostNs() - h;
+				CanSimAdvance(BENCH_LOOP_US);
+		}
+		*HostFps = ns > 0 ? got * 1e9 / ns : 0.0;
+		printf("%-24s %u frames in %.1f ms, %.0f frames/s on the bus, api %.0f frames/s (%.0f ns/frame)\n",
+					 Burst ? "api CANSend/RecBurst" : "api CANSend/RecData", got, (CanSimNow() - t0) / 1000.0,
+					 got * 1e6 / (double)(CanSimNow() - t0), *HostFps, got ? ns / got : 0.0);
+		if(bad || (got != BENCH_FRAMES) || CANGetRxOverrun(CAN1CH))
+		{
+				printf("%-24s bad %u, got %u, lost %u\n", "  ** 错误", bad, got, CANGetRxOverrun(CAN1CH));
+				return 1;
+		}
+		return Bench_Check("", CAN0CH) | Bench_Check("", CAN1CH);
+}
+
+static uint8_t Bench_Apis(void)
+{
+		double	single,burst;
+		uint8_t	err;
+
+		err  = Bench_Api(0, &single);
+		err |= Bench_Api(1, &burst);
+		printf("%-24s burst/single api throughput %.2fx\n", "", single > 0 ? burst / single : 0.0);
+		return err;
+}
+
+//外部节点向通道Ch发一帧(FD为1时发64字节BRS帧), 通道同时发一帧经典帧; 返回收到的帧数, *Tx为发出的帧数
+static uint32_t Bench_PowerRxTx(uint8_t Ch, uint8_t FD, uint32_t *Tx)
+{
+		CanSimFrameType	f;
+		CANFrameType		r;
+		CANFDFrameType	fd;
+		uint8_t					d[8];
+		uint32_t				got,tx0;
+
+		Bench_Frame(Ch, 0, &f);
+		if(FD)
+		{
+				f.FD	= 1;
+				f.BRS = 1;
+				f.DLC = 15;
+				memset(f.Data, 0x5A, 64);
+		}
+		CanSimSend(Ch, &f);
+		memset(d, Ch, sizeof(d));
+		tx0 = CanSimStat[Ch].TxFrames;
+		CANSendData(Ch, 0, 0x321, 8, d);
+		CanSimAdvance(2000);
+		got = 0;
+		while(CANRecFrame(Ch, &r) == 0)	got++;
+		if(FD)	while(CANRecFD(Ch, &fd) == 0)	got++;
+		*Tx = CanSimStat[Ch].TxFrames - tx0;
+		return got;
+}
+
+//按drvPower的顺序通知驱动, 其间把模型的SYS_CLK换成Mode下的内核时钟
+static uint8_t Bench_PowerSet(uint8_t Mode, uint32_t SysHz)
+{
+		if(CANPowerNotify(POWER_BEFORE, Mode))	return 1;
+		CanSimClock.SysHz = SysHz;
+		SystemCoreClock		= SysHz;
+		CANPowerNotify(POWER_AFTER, Mode);
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：Bench_Power
+*  功能说明：运行模式切换. CAN0 FD 250k/2M、CAN1 250k: 2M数据段在8MHz晶振下无解, 应拒绝HSRUN;
+//	         VLPR下CAN1改用SYS_CLK(4MHz)照常收发, CAN0关闭不收不发, 回RUN后补发.
+//	         CAN0 FD 250k/1M: 应允许HSRUN, HSRUN下CAN0改用晶振收发FD帧, 回RUN后改回SYS_CLK
+*************************************************************************/
+static uint8_t Bench_Power(void)
+{
+		uint32_t	veto,rx0,rx1,tx0,tx1,clk,rxHs,txHs,clkHs;
+		uint8_t		err;
+
+		err = 0;
+		Bench_Init();
+		CanSimBus[0].Bitrate = 250000;
+		CanSimBus[1].Bitrate = 250000;
+		if(CANInitFD(CAN0CH, 250, 2000)||CANInit(CAN1CH, 250))	return 1;
+		veto = CANPowerVeto(CLOCK_MODE_HSRUN);
+		err |= Bench_PowerSet(CLOCK_MODE_VLPR, CLOCK_VLPR_CORE_HZ);
+		clk = (CanSimReg[1].CTRL1 & CAN_CTRL1_CLKSRC_MASK) ? 1 : 0;
+		rx0 = Bench_PowerRxTx(CAN0CH, 1, &tx0);
+		rx1 = Bench_PowerRxTx(CAN1CH, 0, &tx1);
+		printf("%-24s hsrun veto %u; vlpr CAN1 sysclk %u, rx %u tx %u; CAN0 rx %u tx %u\n", "power 250k/2M",
+					 veto, clk, rx1, tx1, rx0, tx0);
+		err |= (veto != 1)||(clk != 1)||(rx1 != 1)||(tx1 != 1)||(rx0 != 0)||(tx0 != 0);
+		err |= Bench_PowerSet(CLOCK_MODE_RUN, CLOCK_RUN_CORE_HZ);
+		rx0 = Bench_PowerRxTx(CAN0CH, 1, &tx0);
+		rx1 = Bench_PowerRxTx(CAN1CH, 0, &tx1);
+		printf("%-24s run CAN0 rx %u tx %u, CAN1 rx %u tx %u\n", "", rx0, tx0, rx1, tx1);
+		err |= (rx0 != 1)||(tx0 != 2)||(rx1 != 1)||(tx1 != 1);
+		if(err)	printf("%-24s VLPR下未按SYS_CLK收发或HSRUN未按数据段拒绝\n", "  ** 错误");
+		err |= Bench_Check("", CAN0CH) | Bench_Check("", CAN1CH);
+
+		Bench_Init();
+		CanSimBus[0].Bitrate		 = 250000;
+		CanSimBus[0].DataBitrate = 1000000;
+		if(CANInitFD(CAN0CH, 250, 1000))	return 1;
+		veto = CANPowerVeto(CLOCK_MODE_HSRUN);
+		err |= Bench_PowerSet(CLOCK_MODE_HSRUN, CLOCK_HSRUN_CORE_HZ);
+		clkHs = (CanSimReg[0].CTRL1 & CAN_CTRL1_CLKSRC_MASK) ? 1 : 0;
+		rxHs = Bench_PowerRxTx(CAN0CH, 1, &txHs);
+		err |= Bench_PowerSet(CLOCK_MODE_RUN, CLOCK_RUN_CORE_HZ);
+		clk = (CanSimReg[0].CTRL1 & CAN_CTRL1_CLKSRC_MASK) ? 1 : 0;
+		rx0 = Bench_PowerRxTx(CAN0CH, 1, &tx0);
+		printf("%-24s hsrun veto %u, CAN0 sysclk %u rx %u tx %u; run sysclk %u rx %u tx %u\n", "power 250k/1M",
+					 veto, clkHs, rxHs, txHs, clk, rx0, tx0);
+		if((veto != 0)||(clkHs != 0)||(rxHs != 1)||(txHs != 1)||(clk != 1)||(rx0 != 1)||(tx0 != 1))
+		{
+				printf("%-24s HSRUN下FD通道未改用晶振\n", "  ** 错误");
+				err = 1;
+		}
+		return err | Bench_Check("", CAN0CH);
+}
+
+/*************************************************************************
+*  函数名称：Bench_Rate
+*  功能说明：总线改为Bitrate, CAN0按KHz初始化, 检查按寄存器算出的波特率是否与总线一致
+//	         Match为0时应因波特率不符收不到帧(RateErr), 用来确认模型能发现位时间配置错误
+*************************************************************************/
+static uint8_t Bench_Rate(uint32_t Bitrate, uint32_t KHz, uint8_t Match)
+{
+		CanSimFrameType	f;
+		CANFrameType		r;
+		uint32_t				got;
+
+		Bench_Init();
+		CanSimBus[0].Bitrate = Bitrate;
+		if(CANInit(CAN0CH, KHz))	return 1;
+		Bench_Frame(1, 0, &f);
+		CanSimSend(0, &f);
+		CanSimAdvance(1000);
+		got = 0;
+		while(CANRecFrame(CAN0CH, &r) == 0)	got++;
+		printf("%-24s bus %u bit/s, CAN0 %u kbit/s -> %u bit/s, rx %u, rate err %u\n", "bit timing", Bitrate, KHz,
+					 CanSimBitrate(0, 0), got, CanSimStat[0].RateErr);
+		if(Match)	return (got != 1)||CanSimStat[0].RateErr;
+		return (got != 0)||(CanSimStat[0].RateErr == 0);
+}
+
+int main(void)
+{
+		uint8_t	err;
+
+		err  = Bench_Rx("rx fifo irq", CAN0CH, 0);
+		err |= Bench_Rx("rx dma", CAN1CH, 0);
+		err |= Bench_Rx("rx dma overrun", CAN2CH, 1);
+		err |= Bench_RxAll(100, 0);
+		err |= Bench_RxAll(2000, 0);
+		err |= Bench_RxAll(8000, 0);
+		err |= Bench_RxAll(40000, 1);
+		err |= Bench_Tx("tx CAN0", CAN0CH);
+		err |= Bench_Tx("tx CAN1", CAN1CH);
+		err |= Bench_Apis();
+		err |= Bench_FD();
+		err |= Bench_MbLayout();
+		err |= Bench_TxOrder();
+		err |= Bench_Filters();
+		err |= Bench_Route();
+		err |= Bench_Timing();
+		err |= Bench_Power();
+		err |= Bench_Rate(250000, 250, 1);
+		err |= Bench_Rate(83333, 83, 1);
+		err |= Bench_Rate(500000, 250, 0);
+		return err;
+}
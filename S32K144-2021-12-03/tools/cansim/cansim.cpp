@@ -0,0 +1,1272 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "S32K144.h"
+#include "cansim.h"
+
+//FlexCAN0有32个8字节MailBox, FlexCAN1/2各16个
+#define SIM_RAM_WORDS_0					128
+#define SIM_RAM_WORDS_1					64
+//Rx FIFO占MB0~5, 过滤表从MB6开始
+#define SIM_FIFO_MB_NUM					6
+#define SIM_FILTER_WORD					24
+//DMAMUX请求源 FlexCAN0~2
+#define SIM_DMA_SOURCE					54
+//DMA链接嵌套上限, 防止通道自链接死循环
+#define SIM_DMA_LINK_MAX				16
+//中断处理函数返回后仍满足条件的连续次数上限
+#define SIM_IRQ_STORM_MAX				1000
+
+#define SIM_CODE_RX_FULL				0x2
+#define SIM_CODE_RX_EMPTY				0x4
+#define SIM_CODE_RX_OVERRUN			0x6
+#define SIM_CODE_TX_INACTIVE		0x8
+#define SIM_CODE_TX_ABORT				0x9
+#define SIM_CODE_TX_ONCE				0xC
+
+#define SIM_CS_EDL							0x80000000uL
+#define SIM_CS_BRS							0x40000000uL
+#define SIM_CS_SRR							0x00400000uL
+#define SIM_CS_IDE							0x00200000uL
+#define SIM_CS_RTR							0x00100000uL
+#define SIM_CS_CODE(cs)					(((cs) >> 24) & 0xF)
+#define SIM_CS_DLC(cs)					(((cs) >> 16) & 0xF)
+
+//总线状态
+#define SIM_BUS_IDLE						0
+#define SIM_BUS_FRAME						1			//SOF~EOF
+#define SIM_BUS_IFS							2			//帧间隔
+
+//Rx FIFO中的一帧, 与输出MailBox(MB0)相同的4个字
+typedef	struct
+{
+			uint32_t	CS;
+			uint32_t	ID;
+			uint32_t	Data[2];
+			uint16_t	Hit;
+
+}		SimFifoType;
+
+typedef	struct
+{
+			uint8_t		Bus;								//0xFF: 未接入总线
+			uint8_t		Run;								//已退出冻结和关闭, 参与总线
+			double		NomNs;							//位时间, 退出冻结时按寄存器计算
+			double		DataNs;
+			uint32_t	NomHz;
+			uint32_t	DataHz;
+			uint64_t	TimerBase;					//TIMER从TimerHold开始计数的时刻
+			uint32_t	TimerHold;
+			SimFifoType	Fifo[CAN_SIM_FIFO_DEPTH];
+			uint8_t		FifoHead;
+			uint8_t		FifoNum;
+			uint8_t		PopReq;							//DMA已读到MB0第3字
+			uint32_t	AbortCs[32];				//中止完成时的CS, 驱动可能在两次扫描之间装入并中止, 按CS变化识别新的中止请求
+			int8_t		OnBus;							//正在总线上发送的MailBox, -1:无
+
+}		SimChType;
+
+typedef	struct
+{
+			CanSimFrameType	TxQ[CAN_SIM_TXQ_SIZE];		//外部节点待发送
+			uint16_t	TxHead;
+			uint16_t	TxTail;
+			CanSimFrameType	Log[CAN_SIM_LOG_SIZE];
+			uint16_t	LogHead;
+			uint16_t	LogTail;
+			uint8_t		State;
+			CanSimFrameType	Cur;								//总线上的帧
+			uint64_t	DoneNs;
+			uint64_t	EndNs;
+
+}		SimBusType;
+
+typedef	struct
+{
+			uint64_t	Now;								//ns
+			SimChType	Ch[CAN_SIM_CH_NUM];
+			SimBusType	Bus[CAN_SIM_BUS_NUM];
+			uint8_t		InIrq;
+			uint8_t		DmaDepth;
+
+}		CanSimStateType;
+
+CanSimRegType				CanSimReg[CAN_SIM_CH_NUM];
+CanSimDmaType				CanSimDma;
+DMAMUX_Type					CanSimDmamux;
+PCC_Type						CanSimPcc;
+PORT_Type						CanSimPort[PORT_INSTANCE_COUNT];
+CanSimClockType			CanSimClock;
+CanSimBusCfgType		CanSimBus[CAN_SIM_BUS_NUM];
+CanSimStatType			CanSimStat[CAN_SIM_CH_NUM];
+CanSimBusStatType		CanSimBusStat[CAN_SIM_BUS_NUM];
+CanSimDwtType				CanSimDwt;
+uint32_t						CanSimPrimask;
+uint8_t							CanSimNvicOn[NUMBER_OF_INT_VECTORS];
+void								(*CanSimLatencyHook)(uint8_t CANChannel, uint32_t Us);
+
+//驱动用的内核时钟, 芯片上由system_S32K144.c维护
+uint32_t						SystemCoreClock = 80000000uL;
+
+static CanSimStateType	Sim;
+
+static const uint8_t	SimDlcLen[16] = {0,1,2,3,4,5,6,7,8,12,16,20,24,32,48,64};
+static const IRQn_Type	SimCanIrq[CAN_SIM_CH_NUM] = CAN_ORed_0_15_MB_IRQS;
+static void (* const SimCanIsr[CAN_SIM_CH_NUM])(void) =
+{
+		CAN0_ORed_0_15_MB_IRQHandler, CAN1_ORed_0_15_MB_IRQHandler, CAN2_ORed_0_15_MB_IRQHandler
+};
+static void (* const SimDmaIsr[CAN_SIM_CH_NUM])(void) =
+{
+		DMA0_IRQHandler, DMA1_IRQHandler, DMA2_IRQHandler
+};
+
+static void Sim_DmaReq(uint8_t Ch);
+
+
+static uint8_t Sim_ChOf(const void *p)
+{
+		return (uint8_t)(((uintptr_t)p - (uintptr_t)CanSimReg) / sizeof(CanSimRegType));
+}
+
+//MailBox占的字数和数量, FD模式按FDCTRL[MBDSR0]
+static uint8_t Sim_Stride(uint8_t Ch)
+{
+		if(CanSimReg[Ch].MCR.v & CAN_MCR_FDEN_MASK)
+				return (uint8_t)(2 + (8u << ((CanSimReg[Ch].FDCTRL & CAN_FDCTRL_MBDSR0_MASK) >> CAN_FDCTRL_MBDSR0_SHIFT)) / 4);
+		return 4;
+}
+
+static uint8_t Sim_MbLimit(uint8_t Ch)
+{
+		return (uint8_t)(((Ch == 0) ? SIM_RAM_WORDS_0 : SIM_RAM_WORDS_1) / Sim_Stride(Ch));
+}
+
+static volatile uint32_t *Sim_Mb(uint8_t Ch, uint8_t Mb)
+{
+		return &CanSimReg[Ch].RAMn[Mb * Sim_Stride(Ch)];
+}
+
+//Rx FIFO和过滤表占用的MailBox数, 未启用FIFO时为0
+static uint8_t Sim_FifoMbs(uint8_t Ch)
+{
+		if((CanSimReg[Ch].MCR.v & CAN_MCR_RFEN_MASK) == 0)	return 0;
+		return (uint8_t)(SIM_FIFO_MB_NUM + 2 * (((CanSimReg[Ch].CTRL2 & CAN_CTRL2_RFFN_MASK) >> CAN_CTRL2_RFFN_SHIFT) + 1));
+}
+
+//参与收发的最后一个MailBox
+static uint8_t Sim_MbLast(uint8_t Ch)
+{
+		uint8_t	n;
+
+		n = (uint8_t)(CanSimReg[Ch].MCR.v & CAN_MCR_MAXMB_MASK);
+		if(n >= Sim_MbLimit(Ch))	n = Sim_MbLimit(Ch) - 1;
+		return n;
+}
+
+uint8_t CanSimLen(uint8_t FD, uint8_t DLC)
+{
+		DLC &= 0xF;
+		if(FD)	return SimDlcLen[DLC];
+		return (DLC > 8) ? 8 : DLC;
+}
+
+static uint32_t Sim_TimerAt(uint8_t Ch, uint64_t Ns)
+{
+		SimChType	*c;
+
+		c = &Sim.Ch[Ch];
+		if((c->Run == 0)||(c->NomNs <= 0)||(Ns < c->TimerBase))	return c->TimerHold & 0xFFFF;
+		return (c->TimerHold + (uint32_t)((double)(Ns - c->TimerBase) / c->NomNs)) & 0xFFFF;
+}
+
+/*************************************************************************
+*  函数名称：Sim_Configure
+*  功能说明：退出冻结或关闭时按寄存器求波特率, 检查MailBox布局
+*************************************************************************/
+static void Sim_Configure(uint8_t Ch)
+{
+		CanSimRegType	*r;
+		SimChType			*c;
+		uint32_t			pe,presc,tq;
+		uint8_t				maxmb;
+
+		r = &CanSimReg[Ch];
+		c = &Sim.Ch[Ch];
+		pe = (r->CTRL1 & CAN_CTRL1_CLKSRC_MASK) ? CanSimClock.SysHz : CanSimClock.OscHz;
+		if(r->CBT & CAN_CBT_BTF_MASK)
+		{
+				presc = ((r->CBT & CAN_CBT_EPRESDIV_MASK) >> CAN_CBT_EPRESDIV_SHIFT) + 1;
+				tq = 1 + ((r->CBT & CAN_CBT_EPROPSEG_MASK) >> CAN_CBT_EPROPSEG_SHIFT) + 1
+							 + ((r->CBT & CAN_CBT_EPSEG1_MASK) >> CAN_CBT_EPSEG1_SHIFT) + 1
+							 + ((r->CBT & CAN_CBT_EPSEG2_MASK) >> CAN_CBT_EPSEG2_SHIFT) + 1;
+		}
+		else
+		{
+				presc = ((r->CTRL1 & CAN_CTRL1_PRESDIV_MASK) >> CAN_CTRL1_PRESDIV_SHIFT) + 1;
+				tq = 1 + ((r->CTRL1 & CAN_CTRL1_PROPSEG_MASK) >> CAN_CTRL1_PROPSEG_SHIFT) + 1
+							 + ((r->CTRL1 & CAN_CTRL1_PSEG1_MASK) >> CAN_CTRL1_PSEG1_SHIFT) + 1
+							 + ((r->CTRL1 & CAN_CTRL1_PSEG2_MASK) >> CAN_CTRL1_PSEG2_SHIFT) + 1;
+		}
+		c->NomNs = 1e9 * presc * tq / pe;
+		c->NomHz = (uint32_t)((pe + presc * tq / 2) / (presc * tq));
+		c->DataNs = c->NomNs;
+		c->DataHz = c->NomHz;
+		if((r->MCR.v & CAN_MCR_FDEN_MASK)&&(r->FDCTRL & CAN_FDCTRL_FDRATE_MASK))
+		{
+				presc = ((r->FDCBT & CAN_FDCBT_FPRESDIV_MASK) >> CAN_FDCBT_FPRESDIV_SHIFT) + 1;
+				tq = 1 + ((r->FDCBT & CAN_FDCBT_FPROPSEG_MASK) >> CAN_FDCBT_FPROPSEG_SHIFT)
+							 + ((r->FDCBT & CAN_FDCBT_FPSEG1_MASK) >> CAN_FDCBT_FPSEG1_SHIFT) + 1
+							 + ((r->FDCBT & CAN_FDCBT_FPSEG2_MASK) >> CAN_FDCBT_FPSEG2_SHIFT) + 1;
+				c->DataNs = 1e9 * presc * tq / pe;
+				c->DataHz = (uint32_t)((pe + presc * tq / 2) / (presc * tq));
+		}
+
+		maxmb = (uint8_t)(r->MCR.v & CAN_MCR_MAXMB_MASK);
+		if(maxmb >= Sim_MbLimit(Ch))
+		{
+				fprintf(stderr, "cansim: CAN%u MAXMB=%u, 只有%u个MailBox\n", Ch, maxmb, Sim_MbLimit(Ch));
+				CanSimStat[Ch].ConfigErr++;
+		}
+		if((r->MCR.v & CAN_MCR_RFEN_MASK)&&(r->MCR.v & CAN_MCR_FDEN_MASK))
+		{
+				fprintf(stderr, "cansim: CAN%u FD模式不能启用Rx FIFO\n", Ch);
+				CanSimStat[Ch].ConfigErr++;
+		}
+		if(Sim_FifoMbs(Ch) > maxmb + 1)
+		{
+				fprintf(stderr, "cansim: CAN%u Rx FIFO过滤表占%u个MailBox, 超出MAXMB\n", Ch, Sim_FifoMbs(Ch));
+				CanSimStat[Ch].ConfigErr++;
+		}
+}
+
+//按MDIS/FRZ/HALT更新应答位, 进入或退出收发
+static void Sim_Mode(uint8_t Ch)
+{
+		CanSimRegType	*r;
+		SimChType			*c;
+		uint8_t				run;
+
+		r = &CanSimReg[Ch];
+		c = &Sim.Ch[Ch];
+		r->MCR.v &= ~(CAN_MCR_LPMACK_MASK | CAN_MCR_FRZACK_MASK | CAN_MCR_NOTRDY_MASK);
+		if(r->MCR.v & CAN_MCR_MDIS_MASK)	r->MCR.v |= CAN_MCR_LPMACK_MASK | CAN_MCR_NOTRDY_MASK;
+		else if((r->MCR.v & CAN_MCR_FRZ_MASK)&&(r->MCR.v & CAN_MCR_HALT_MASK))	r->MCR.v |= CAN_MCR_FRZACK_MASK | CAN_MCR_NOTRDY_MASK;
+		run = (r->MCR.v & CAN_MCR_NOTRDY_MASK) ? 0 : 1;
+		if(run && (c->Run == 0))
+		{
+				Sim_Configure(Ch);
+				c->TimerBase = Sim.Now;
+				c->Run = 1;
+		}
+		else if((run == 0)&&c->Run)
+		{
+				c->TimerHold = Sim_TimerAt(Ch, Sim.Now);
+				c->Run = 0;
+		}
+}
+
+//软复位: 配置寄存器(CTRL1/CTRL2/CBT/掩码)和MailBox RAM不变
+static void Sim_SoftReset(uint8_t Ch)
+{
+		CanSimRegType	*r;
+		SimChType			*c;
+
+		r = &CanSimReg[Ch];
+		c = &Sim.Ch[Ch];
+		r->MCR.v	= CAN_MCR_FRZ_MASK | CAN_MCR_HALT_MASK | CAN_MCR_SUPV_MASK | CAN_MCR_MAXMB(0xF);
+		r->ECR		= 0;
+		r->ESR1		= 0;
+		r->IMASK1	= 0;
+		r->IFLAG1.v = 0;
+		r->RXFIR	= 0;
+		r->FDCTRL = (r->FDCTRL & ~CAN_FDCTRL_MBDSR0_MASK) | CAN_FDCTRL_FDRATE_MASK;
+		c->Run = 0;
+		c->TimerHold = 0;
+		c->FifoHead = 0;
+		c->FifoNum	= 0;
+		c->PopReq		= 0;
+		c->OnBus		= -1;
+		memset(c->AbortCs, 0, sizeof(c->AbortCs));
+		Sim_Mode(Ch);
+}
+
+//FIFO队首装入MB0, 置BUF5I
+static void Sim_FifoLoad(uint8_t Ch)
+{
+		CanSimRegType	*r;
+		const SimFifoType	*e;
+
+		r = &CanSimReg[Ch];
+		e = &Sim.Ch[Ch].Fifo[Sim.Ch[Ch].FifoHead];
+		r->RAMn[0] = e->CS;
+		r->RAMn[1] = e->ID;
+		r->RAMn[2] = e->Data[0];
+		r->RAMn[3] = e->Data[1];
+		r->RXFIR	 = e->Hit;
+		r->IFLAG1.v |= CAN_IFLAG1_BUF5I_MASK;
+}
+
+static void Sim_FifoPop(uint8_t Ch)
+{
+		SimChType	*c;
+
+		c = &Sim.Ch[Ch];
+		if(c->FifoNum == 0)	return;
+		c->FifoHead = (uint8_t)((c->FifoHead + 1) % CAN_SIM_FIFO_DEPTH);
+		c->FifoNum--;
+		CanSimReg[Ch].IFLAG1.v &= ~CAN_IFLAG1_BUF5I_MASK;
+		if(c->FifoNum)	Sim_FifoLoad(Ch);
+}
+
+//CS、ID字和大端数据字, 与MailBox中的编码相同
+static uint32_t Sim_CsWord(const CanSimFrameType *f)
+{
+		uint32_t	cs;
+
+		cs = ((uint32_t)(f->DLC & 0xF) << 16);
+		if(f->IDE)	cs |= SIM_CS_IDE | SIM_CS_SRR;
+		if(f->RTR)	cs |= SIM_CS_RTR;
+		if(f->FD)		cs |= SIM_CS_EDL;
+		if(f->FD && f->BRS)	cs |= SIM_CS_BRS;
+		return cs;
+}
+
+static uint32_t Sim_IdWord(const CanSimFrameType *f)
+{
+		return f->IDE ? (f->ID & 0x1FFFFFFF) : ((f->ID & 0x7FF) << 18);
+}
+
+static uint32_t Sim_DataWord(const CanSimFrameType *f, uint8_t n)
+{
+		const uint8_t	*p;
+
+		p = &f->Data[4*n];
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/*************************************************************************
+*  函数名称：Sim_FifoMatch
+*  功能说明：按IDAM格式逐个比较过滤元素, 编号小的优先
+//	         IRMQ=1时元素0~min(8+2*RFFN,32)-1用RXIMR, 其余用RXFGMASK; IRMQ=0时都用RXFGMASK
+*  函数返回：命中的元素号(RXFIR[IDHIT]), -1:不接收
+*************************************************************************/
+static int16_t Sim_FifoMatch(uint8_t Ch, const CanSimFrameType *f)
+{
+		CanSimRegType	*r;
+		uint32_t			e,m,w,rel,h;
+		uint16_t			i,n,indiv;
+		uint8_t				fmt,rffn,k;
+
+		r = &CanSimReg[Ch];
+		fmt = (uint8_t)((r->MCR.v & CAN_MCR_IDAM_MASK) >> CAN_MCR_IDAM_SHIFT);
+		if(fmt == 3)	return -1;
+		rffn = (uint8_t)((r->CTRL2 & CAN_CTRL2_RFFN_MASK) >> CAN_CTRL2_RFFN_SHIFT);
+		n = 8 * (rffn + 1);
+		indiv = 0;
+		if(r->MCR.v & CAN_MCR_IRMQ_MASK)	indiv = (uint16_t)((8u + 2u * rffn > CAN_RXIMR_COUNT) ? CAN_RXIMR_COUNT : 8u + 2u * rffn);
+
+		for(i=0;i<n;i++)
+		{
+				e = r->RAMn[SIM_FILTER_WORD + i];
+				m = (i < indiv) ? r->RXIMR[i] : r->RXFGMASK;
+				if(fmt == 0)
+				{
+						//格式A: RTR位31, IDE位30, 标准ID位29~19, 扩展ID位29~1
+						w = ((uint32_t)f->RTR << 31) | ((uint32_t)f->IDE << 30) | (f->IDE ? ((f->ID & 0x1FFFFFFF) << 1) : ((f->ID & 0x7FF) << 19));
+						rel = f->IDE ? 0xFFFFFFFEuL : 0xFFF80000uL;
+						if(((w ^ e) & m & rel) == 0)	return (int16_t)i;
+				}
+				else if(fmt == 1)
+				{
+						//格式B: 两个半字, RTR位15, IDE位14, 标准ID位13~3, 扩展ID高14位在位13~0
+						w = ((uint32_t)f->RTR << 15) | ((uint32_t)f->IDE << 14) | (f->IDE ? ((f->ID >> 15) & 0x3FFF) : ((f->ID & 0x7FF) << 3));
+						rel = f->IDE ? 0xFFFF : 0xFFF8;
+						for(k=0;k<2;k++)
+						{
+								h = k ? 0 : 16;
+								if((((w ^ (e >> h)) & (m >> h)) & rel) == 0)	return (int16_t)i;
+						}
+				}
+				else
+				{
+						//格式C: 四个字节, 标准ID[10:3]或扩展ID[28:21], 不比较IDE/RTR
+						w = f->IDE ? ((f->ID >> 21) & 0xFF) : ((f->ID >> 3) & 0xFF);
+						for(k=0;k<4;k++)
+						{
+								h = 24 - 8*k;
+								if((((w ^ (e >> h)) & (m >> h)) & 0xFF) == 0)	return (int16_t)i;
+						}
+				}
+		}
+		return -1;
+}
+
+static void Sim_FifoPush(uint8_t Ch, const CanSimFrameType *f, uint16_t Hit, uint32_t Stamp)
+{
+		CanSimRegType	*r;
+		SimChType			*c;
+		SimFifoType		*e;
+
+		r = &CanSimReg[Ch];
+		c = &Sim.Ch[Ch];
+		if(c->FifoNum >= CAN_SIM_FIFO_DEPTH)
+		{
+				r->IFLAG1.v |= CAN_IFLAG1_BUF7I_MASK;
+				CanSimStat[Ch].FifoOverflow++;
+				return;
+		}
+		e = &c->Fifo[(c->FifoHead + c->FifoNum) % CAN_SIM_FIFO_DEPTH];
+		e->CS = Sim_CsWord(f) | Stamp;
+		e->ID = Sim_IdWord(f);
+		e->Data[0] = f->RTR ? 0 : Sim_DataWord(f, 0);
+		e->Data[1] = f->RTR ? 0 : Sim_DataWord(f, 1);
+		e->Hit = Hit;
+		c->FifoNum++;
+		CanSimStat[Ch].RxFrames++;
+		if(c->FifoNum == CAN_SIM_FIFO_DEPTH - 1)	r->IFLAG1.v |= CAN_IFLAG1_BUF6I_MASK;
+		if(c->FifoNum == 1)	Sim_FifoLoad(Ch);
+		if(r->MCR.v & CAN_MCR_DMA_MASK)	Sim_DmaReq(Ch);
+}
+
+/*************************************************************************
+*  函数名称：Sim_MbMatch
+*  功能说明：在接收MailBox(EMPTY/FULL/OVERRUN)中按编号找ID、IDE匹配的MailBox
+//	         掩码: IRMQ=1用RXIMR, 否则RXMGMASK(MB14/15用RX14MASK/RX15MASK)
+//	         第一个空闲者接收(EMPTY, 或FULL/OVERRUN且IFLAG已清); 都不空闲时覆盖最后一个匹配者
+*  函数返回：MailBox号, -1:无匹配; *Overrun置1为覆盖
+*************************************************************************/
+static int16_t Sim_MbMatch(uint8_t Ch, const CanSimFrameType *f, uint8_t *Overrun)
+{
+		CanSimRegType	*r;
+		volatile uint32_t	*p;
+		uint32_t			m,rel;
+		int16_t				last;
+		uint8_t				mb,code;
+
+		r = &CanSimReg[Ch];
+		rel = f->IDE ? 0x1FFFFFFFuL : 0x1FFC0000uL;
+		last = -1;
+		*Overrun = 0;
+		for(mb=Sim_FifoMbs(Ch);mb<=Sim_MbLast(Ch);mb++)
+		{
+				p = Sim_Mb(Ch, mb);
+				code = (uint8_t)SIM_CS_CODE(p[0]);
+				if((code != SIM_CODE_RX_EMPTY)&&(code != SIM_CODE_RX_FULL)&&(code != SIM_CODE_RX_OVERRUN))	continue;
+				if(((p[0] & SIM_CS_IDE) ? 1 : 0) != f->IDE)	continue;
+				if(r->MCR.v & CAN_MCR_IRMQ_MASK)	m = (mb < CAN_RXIMR_COUNT) ? r->RXIMR[mb] : 0;
+				else if(mb == 14)	m = r->RX14MASK;
+				else if(mb == 15)	m = r->RX15MASK;
+				else	m = r->RXMGMASK;
+				if((p[1] ^ Sim_IdWord(f)) & m & rel)	continue;
+				last = mb;
+				if((code == SIM_CODE_RX_EMPTY)||((r->IFLAG1.v & (1uL << mb)) == 0))	return mb;
+		}
+		if(last >= 0)	*Overrun = 1;
+		return last;
+}
+
+static uint8_t Sim_RateOk(uint8_t Ch)
+{
+		SimChType	*c;
+
+		c = &Sim.Ch[Ch];
+		if(c->NomHz == 0)	return 0;
+		return ((uint64_t)abs((int32_t)(c->NomHz - CanSimBus[c->Bus].Bitrate)) * 1000000 <= (uint64_t)CAN_SIM_RATE_TOL_PPM * CanSimBus[c->Bus].Bitrate) ? 1 : 0;
+}
+
+/*************************************************************************
+*  函数名称：Sim_Rx
+*  功能说明：控制器收到总线上的一帧: Rx FIFO优先, 其次接收MailBox
+*  参数说明：Stamp：SOF后第一位的TIMER值
+*************************************************************************/
+static void Sim_Rx(uint8_t Ch, const CanSimFrameType *f, uint64_t Sof)
+{
+		CanSimRegType	*r;
+		SimChType			*c;
+		volatile uint32_t	*p;
+		uint32_t			stamp,words;
+		int16_t				n;
+		uint8_t				over,len,i;
+
+		r = &CanSimReg[Ch];
+		c = &Sim.Ch[Ch];
+		if(c->Run == 0)	return;
+		if(Sim_RateOk(Ch) == 0)	return;
+		if(f->FD && ((r->MCR.v & CAN_MCR_FDEN_MASK) == 0))
+		{
+				CanSimStat[Ch].FormErr++;
+				return;
+		}
+		if(f->FD && f->BRS && ((uint64_t)abs((int32_t)(c->DataHz - CanSimBus[c->Bus].DataBitrate)) * 1000000 > (uint64_t)CAN_SIM_RATE_TOL_PPM * CanSimBus[c->Bus].DataBitrate))
+		{
+				CanSimStat[Ch].RateErr++;
+				return;
+		}
+
+		stamp = Sim_TimerAt(Ch, Sof + (uint64_t)c->NomNs);
+		if((r->MCR.v & CAN_MCR_RFEN_MASK)&&(f->FD == 0))
+		{
+				n = Sim_FifoMatch(Ch, f);
+				if(n >= 0)
+				{
+						Sim_FifoPush(Ch, f, (uint16_t)n, stamp);
+						return;
+				}
+		}
+		n = Sim_MbMatch(Ch, f, &over);
+		if(n < 0)
+		{
+				CanSimStat[Ch].RxMiss++;
+				return;
+		}
+
+		p = Sim_Mb(Ch, (uint8_t)n);
+		len = CanSimLen(f->FD, f->DLC);
+		words = Sim_Stride(Ch) - 2;
+		if(len > 4 * words)
+		{
+				CanSimStat[Ch].FormErr++;
+				len = (uint8_t)(4 * words);
+		}
+		p[1] = Sim_IdWord(f);
+		for(i=0;i<words;i++)	p[2+i] = (f->RTR || (4*i >= len)) ? 0 : Sim_DataWord(f, i);
+		p[0] = Sim_CsWord(f) | stamp | ((uint32_t)(over ? SIM_CODE_RX_OVERRUN : SIM_CODE_RX_FULL) << 24);
+		r->IFLAG1.v |= 1uL << n;
+		CanSimStat[Ch].RxFrames++;
+		if(over)	CanSimStat[Ch].MbOverrun++;
+}
+
+//MailBox中的发送帧
+static void Sim_MbFrame(uint8_t Ch, uint8_t Mb, CanSimFrameType *f)
+{
+		volatile uint32_t	*p;
+		uint32_t			cs,w;
+		uint8_t				i,len;
+
+		p = Sim_Mb(Ch, Mb);
+		cs = p[0];
+		w	 = 0;
+		memset(f, 0, sizeof(*f));
+		f->IDE = (cs & SIM_CS_IDE) ? 1 : 0;
+		f->RTR = (cs & SIM_CS_RTR) ? 1 : 0;
+		f->FD	 = ((cs & SIM_CS_EDL)&&(CanSimReg[Ch].MCR.v & CAN_MCR_FDEN_MASK)) ? 1 : 0;
+		f->BRS = (f->FD && (cs & SIM_CS_BRS)&&(CanSimReg[Ch].FDCTRL & CAN_FDCTRL_FDRATE_MASK)) ? 1 : 0;
+		f->DLC = (uint8_t)SIM_CS_DLC(cs);
+		f->ID	 = f->IDE ? (p[1] & 0x1FFFFFFF) : ((p[1] >> 18) & 0x7FF);
+		f->Src = Ch;
+		len = CanSimLen(f->FD, f->DLC);
+		if(len > 4 * (Sim_Stride(Ch) - 2))	len = (uint8_t)(4 * (Sim_Stride(Ch) - 2));
+		for(i=0;i<len;i++)
+		{
+				if((i & 3) == 0)	w = p[2 + i/4];
+				f->Data[i] = (uint8_t)(w >> (24 - 8*(i & 3)));
+		}
+}
+
+//仲裁场按总线上的位顺序拼成32位, 越小越优先: 基本ID、RTR/SRR、IDE、扩展ID、RTR
+static uint32_t Sim_ArbKey(const CanSimFrameType *f)
+{
+		if(f->IDE)
+				return (((f->ID >> 18) & 0x7FF) << 21) | (1uL << 20) | (1uL << 19) | ((f->ID & 0x3FFFF) << 1) | (f->RTR ? 1 : 0);
+		return ((f->ID & 0x7FF) << 21) | ((uint32_t)(f->RTR ? 1 : 0) << 20);
+}
+
+/*************************************************************************
+*  函数名称：Sim_TxScan
+*  功能说明：扫描发送MailBox, 完成未上总线帧的中止(AEN=1, CODE=9, 置IFLAG)
+//	         CTRL1[LBUF]=0时按仲裁场选优先级最高者, 同优先级取编号小者; LBUF=1取编号最小者
+*  函数返回：待发送的MailBox号, -1:无
+*************************************************************************/
+static int16_t Sim_TxScan(uint8_t Ch)
+{
+		CanSimRegType	*r;
+		SimChType			*c;
+		CanSimFrameType	f;
+		uint32_t			key,best,stamp;
+		int16_t				sel;
+		uint8_t				mb,code;
+
+		r = &CanSimReg[Ch];
+		c = &Sim.Ch[Ch];
+		sel = -1;
+		best = 0;
+		if(c->Run == 0)	return -1;
+		for(mb=Sim_FifoMbs(Ch);mb<=Sim_MbLast(Ch);mb++)
+		{
+				if(mb == c->OnBus)	continue;
+				code = (uint8_t)SIM_CS_CODE(Sim_Mb(Ch, mb)[0]);
+				if(code == SIM_CODE_TX_ONCE)
+				{
+						if((sel >= 0)&&(r->CTRL1 & CAN_CTRL1_LBUF_MASK))	continue;
+						Sim_MbFrame(Ch, mb, &f);
+						key = Sim_ArbKey(&f);
+						if((sel < 0)||(key < best))
+						{
+								sel = mb;
+								best = key;
+						}
+				}
+				else if((code == SIM_CODE_TX_ABORT)&&(r->MCR.v & CAN_MCR_AEN_MASK)&&(Sim_Mb(Ch, mb)[0] != c->AbortCs[mb]))
+				{
+						//时间戳取TIMER(为0时取1), 驱动装入MailBox时写0, 重新装入同一帧再中止也能与上次区分
+						stamp = Sim_TimerAt(Ch, Sim.Now);
+						Sim_Mb(Ch, mb)[0] = (Sim_Mb(Ch, mb)[0] & ~0xFFFFuL) | (stamp ? stamp : 1);
+						c->AbortCs[mb] = Sim_Mb(Ch, mb)[0];
+						r->IFLAG1.v |= 1uL << mb;
+						CanSimStat[Ch].Aborts++;
+				}
+		}
+		return sel;
+}
+
+/*************************************************************************
+*  函数名称：CanSimFrameNs
+*  功能说明：一帧在总线上占用的时间, 含3位帧间隔
+//	         经典帧: SOF~CRC按实际位填充(CRC15), 加CRC界定符、ACK、EOF共10位
+//	         FD帧: SOF~数据段按实际位填充, 填充计数和CRC17/21含固定填充位共27/32位,
+//	         BRS时ESI~CRC按数据段波特率
+*  参数说明：Bus：总线号, 按其波特率计算
+*  函数返回：ns
+*************************************************************************/
+typedef	struct
+{
+			uint32_t	Bits;
+			uint16_t	Crc;
+			uint8_t		Last;
+			uint8_t		Run;
+
+}		SimStuffType;
+
+static void Sim_Put(SimStuffType *s, uint32_t v, uint8_t n)
+{
+		uint8_t	bit,nxt;
+
+		while(n--)
+		{
+				bit = (uint8_t)((v >> n) & 1);
+				nxt = (uint8_t)(bit ^ ((s->Crc >> 14) & 1));
+				s->Crc = (uint16_t)((s->Crc << 1) & 0x7FFF);
+				if(nxt)	s->Crc ^= 0x4599;
+				s->Bits++;
+				if((s->Run > 0)&&(bit == s->Last))	s->Run++;
+				else
+				{
+						s->Last = bit;
+						s->Run	= 1;
+				}
+				//连续5个同值位后插入反相位, 填充位参与下一次计数
+				if(s->Run == 5)
+				{
+						s->Bits++;
+						s->Last = (uint8_t)!bit;
+						s->Run	= 1;
+				}
+		}
+}
+
+uint32_t CanSimFrameNs(uint8_t Bus, const CanSimFrameType *Frame)
+{
+		SimStuffType	s;
+		uint32_t			nom,dat;
+		uint16_t			crc;
+		uint8_t				len,i;
+		double				tn,td;
+
+		memset(&s, 0, sizeof(s));
+		len = Frame->RTR ? 0 : CanSimLen(Frame->FD, Frame->DLC);
+		Sim_Put(&s, 0, 1);
+		if(Frame->IDE)
+		{
+				Sim_Put(&s, (Frame->ID >> 18) & 0x7FF, 11);
+				Sim_Put(&s, 3, 2);
+				Sim_Put(&s, Frame->ID & 0x3FFFF, 18);
+		}
+		else	Sim_Put(&s, Frame->ID & 0x7FF, 11);
+
+		tn = 1e9 / CanSimBus[Bus].Bitrate;
+		if(Frame->FD == 0)
+		{
+				//RTR, (标准帧IDE、r0 | 扩展帧r1、r0), DLC
+				Sim_Put(&s, Frame->RTR ? 1 : 0, 1);
+				Sim_Put(&s, 0, 2);
+				Sim_Put(&s, Frame->DLC & 0xF, 4);
+				for(i=0;i<len;i++)	Sim_Put(&s, Frame->Data[i], 8);
+				crc = s.Crc;
+				Sim_Put(&s, crc, 15);
+				return (uint32_t)((s.Bits + 10 + 3) * tn + 0.5);
+		}
+
+		//RRS, (标准帧IDE), FDF, res, BRS
+		if(Frame->IDE)	Sim_Put(&s, 0x2 | (Frame->BRS ? 1 : 0), 4);
+		else						Sim_Put(&s, 0x4 | (Frame->BRS ? 1 : 0), 5);
+		nom = s.Bits;
+		//ESI, DLC, 数据
+		Sim_Put(&s, Frame->DLC & 0xF, 5);
+		for(i=0;i<len;i++)	Sim_Put(&s, Frame->Data[i], 8);
+		dat = s.Bits - nom + ((len > 16) ? 32 : 27);
+		td = (Frame->BRS && CanSimBus[Bus].DataBitrate) ? 1e9 / CanSimBus[Bus].DataBitrate : tn;
+		return (uint32_t)((nom + 10 + 3) * tn + dat * td + 0.5);
+}
+
+//总线上的下一帧: 外部节点队首(已到时刻)和各控制器的候选MailBox比较仲裁场
+static uint8_t Sim_BusStart(uint8_t Bus)
+{
+		SimBusType		*b;
+		CanSimFrameType	f;
+		uint32_t			key,best;
+		int16_t				mb[CAN_SIM_CH_NUM];
+		int8_t				win;
+		uint8_t				ch,have,ext;
+
+		b = &Sim.Bus[Bus];
+		have = 0;
+		best = 0;
+		win = -1;
+		ext = 0;
+		if((b->TxTail != b->TxHead)&&(b->TxQ[b->TxTail].Time <= Sim.Now))
+		{
+				best = Sim_ArbKey(&b->TxQ[b->TxTail]);
+				have = 1;
+				ext = 1;
+		}
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+		{
+				mb[ch] = -1;
+				if((Sim.Ch[ch].Bus != Bus)||(Sim.Ch[ch].Run == 0)||(Sim_RateOk(ch) == 0))	continue;
+				mb[ch] = Sim_TxScan(ch);
+				if(mb[ch] < 0)	continue;
+				Sim_MbFrame(ch, (uint8_t)mb[ch], &f);
+				key = Sim_ArbKey(&f);
+				if(have && (key == best))	CanSimBusStat[Bus].Collision++;
+				if((have == 0)||(key < best))
+				{
+						best = key;
+						win = (int8_t)ch;
+						ext = 0;
+				}
+				have = 1;
+		}
+		if(have == 0)	return 0;
+
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				if((mb[ch] >= 0)&&(ch != win))	CanSimStat[ch].ArbLost++;
+		if(ext)
+		{
+				b->Cur = b->TxQ[b->TxTail];
+				b->TxTail = (b->TxTail + 1) & (CAN_SIM_TXQ_SIZE - 1);
+				b->Cur.Src = CAN_SIM_SRC_EXT;
+		}
+		else
+		{
+				Sim_MbFrame((uint8_t)win, (uint8_t)mb[win], &b->Cur);
+				Sim.Ch[win].OnBus = (int8_t)mb[win];
+		}
+		b->Cur.Time = Sim.Now;
+		b->EndNs	= Sim.Now + CanSimFrameNs(Bus, &b->Cur);
+		b->DoneNs = b->EndNs - (uint64_t)(3e9 / CanSimBus[Bus].Bitrate + 0.5);
+		b->State	= SIM_BUS_FRAME;
+		return 1;
+}
+
+/*************************************************************************
+*  函数名称：Sim_BusDone
+*  功能说明：EOF结束: 各控制器接收, 发送MailBox完成(CODE=8, 时间戳, IFLAG), 记入日志
+//	         无节点应答时外部节点的帧丢弃, 控制器的帧留在MailBox中重发
+*************************************************************************/
+static void Sim_BusDone(uint8_t Bus)
+{
+		SimBusType		*b;
+		CanSimFrameType	*f;
+		volatile uint32_t	*p;
+		uint8_t				ch,ack,src;
+
+		b = &Sim.Bus[Bus];
+		f = &b->Cur;
+		f->Done = b->DoneNs;
+		src = f->Src;
+		b->State = SIM_BUS_IFS;
+
+		ack = (src != CAN_SIM_SRC_EXT) ? CanSimBus[Bus].Ack : 0;
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+		{
+				if((ch == src)||(Sim.Ch[ch].Bus != Bus)||(Sim.Ch[ch].Run == 0))	continue;
+				//波特率不符的控制器既不应答也收不到
+				if(Sim_RateOk(ch))	ack = 1;
+				else	CanSimStat[ch].RateErr++;
+		}
+		if(ack == 0)
+		{
+				CanSimBusStat[Bus].AckErr++;
+				if(src != CAN_SIM_SRC_EXT)	Sim.Ch[src].OnBus = -1;
+				return;
+		}
+
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+		{
+				if(Sim.Ch[ch].Bus != Bus)	continue;
+				if((ch == src)&&(CanSimReg[ch].MCR.v & CAN_MCR_SRXDIS_MASK))	continue;
+				Sim_Rx(ch, f, f->Time);
+		}
+		if((src != CAN_SIM_SRC_EXT)&&(Sim.Ch[src].OnBus >= 0))
+		{
+				p = Sim_Mb(src, (uint8_t)Sim.Ch[src].OnBus);
+				p[0] = (p[0] & ~(0xFuL << 24) & ~0xFFFFuL) | ((uint32_t)SIM_CODE_TX_INACTIVE << 24)
+						 | Sim_TimerAt(src, f->Time + (uint64_t)Sim.Ch[src].NomNs);
+				CanSimReg[src].IFLAG1.v |= 1uL << Sim.Ch[src].OnBus;
+				Sim.Ch[src].OnBus = -1;
+				CanSimStat[src].TxFrames++;
+		}
+
+		CanSimBusStat[Bus].Frames++;
+		CanSimBusStat[Bus].BusyNs += b->EndNs - f->Time;
+		if(((b->LogHead + 1) & (CAN_SIM_LOG_SIZE - 1)) == b->LogTail)	CanSimBusStat[Bus].LogDrop++;
+		else
+		{
+				b->Log[b->LogHead] = *f;
+				b->LogHead = (b->LogHead + 1) & (CAN_SIM_LOG_SIZE - 1);
+		}
+}
+
+//总线空闲时下一帧可以开始的时刻, 无待发帧时为UINT64_MAX
+static uint64_t Sim_BusReady(uint8_t Bus)
+{
+		SimBusType	*b;
+		uint64_t		t;
+		uint8_t			ch;
+
+		b = &Sim.Bus[Bus];
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				if((Sim.Ch[ch].Bus == Bus)&&Sim.Ch[ch].Run && Sim_RateOk(ch)&&(Sim_TxScan(ch) >= 0))	return Sim.Now;
+		if(b->TxTail == b->TxHead)	return UINT64_MAX;
+		t = b->TxQ[b->TxTail].Time;
+		return (t < Sim.Now) ? Sim.Now : t;
+}
+
+/*************************************************************************
+*  函数名称：Sim_Run
+*  功能说明：按时间顺序处理各总线的事件(帧开始、EOF结束、帧间隔结束)直到To,
+//	         每个事件后检查中断, 驱动在中断中装入的帧从下一个空闲时刻参与仲裁
+*************************************************************************/
+static void Sim_Run(uint64_t To)
+{
+		SimBusType	*b;
+		uint64_t		t,next;
+		uint8_t			bus,sel;
+
+		for(;;)
+		{
+				next = UINT64_MAX;
+				sel = 0;
+				for(bus=0;bus<CAN_SIM_BUS_NUM;bus++)
+				{
+						b = &Sim.Bus[bus];
+						if(b->State == SIM_BUS_FRAME)		t = b->DoneNs;
+						else if(b->State == SIM_BUS_IFS)	t = b->EndNs;
+						else	t = Sim_BusReady(bus);
+						if(t < next)
+						{
+								next = t;
+								sel = bus;
+						}
+				}
+				if(next > To)	break;
+
+				if(next > Sim.Now)	Sim.Now = next;
+				b = &Sim.Bus[sel];
+				if(b->State == SIM_BUS_FRAME)				Sim_BusDone(sel);
+				else if(b->State == SIM_BUS_IFS)		b->State = SIM_BUS_IDLE;
+				else if(Sim_BusStart(sel) == 0)			break;
+				CanSimIrqCheck();
+		}
+		if(Sim.Now < To)	Sim.Now = To;
+		//总线空闲时的中止也须完成
+		for(bus=0;bus<CAN_SIM_CH_NUM;bus++)	Sim_TxScan(bus);
+		CanSimIrqCheck();
+}
+
+
+
+//DMA按32位地址访问主机内存, 读到Rx FIFO输出MailBox第3字时记下待移出
+static void Sim_DmaCopy(uint32_t Dst, uint32_t Src, uint8_t Size)
+{
+		uint8_t	ch;
+
+		memcpy((void *)(uintptr_t)Dst, (const void *)(uintptr_t)Src, Size);
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				if((Src == (uint32_t)(uintptr_t)&CanSimReg[ch].RAMn[3])&&(CanSimReg[ch].MCR.v & CAN_MCR_DMA_MASK))	Sim.Ch[ch].PopReq = 1;
+}
+
+static uint32_t Sim_DmaAddr(uint32_t Addr, int16_t Off, uint8_t Mod)
+{
+		uint32_t	m;
+
+		if(Mod == 0)	return Addr + (int32_t)Off;
+		m = (1uL << Mod) - 1;
+		return (Addr & ~m) | ((Addr + (int32_t)Off) & m);
+}
+
+/*************************************************************************
+*  函数名称：Sim_DmaMinor
+*  功能说明：执行通道Ch的一次次循环, 更新CITER, 次循环或主循环结束时按ELINK/MAJORELINK启动链接通道
+//	         主循环结束: SLAST/DLASTSGA调整地址, CITER重装, DONE、INTMAJOR、DREQ
+//	         CITER等于BITER的一半时INTHALF
+*************************************************************************/
+static void Sim_DmaMinor(uint8_t Ch)
+{
+		CanSimTcdType	*t;
+		uint32_t			n,nbytes,s,d;
+		uint16_t			citer,biter,mask;
+		int8_t				link;
+		uint8_t				ssize,dsize,smod,dmod,i;
+
+		if(Sim.DmaDepth >= SIM_DMA_LINK_MAX)	return;
+		Sim.DmaDepth++;
+		t = &CanSimDma.TCD[Ch];
+		t->CSR &= ~DMA_TCD_CSR_DONE_MASK;
+		ssize = (uint8_t)((t->ATTR & DMA_TCD_ATTR_SSIZE_MASK) >> DMA_TCD_ATTR_SSIZE_SHIFT);
+		dsize = (uint8_t)((t->ATTR & DMA_TCD_ATTR_DSIZE_MASK) >> DMA_TCD_ATTR_DSIZE_SHIFT);
+		smod	= (uint8_t)((t->ATTR & DMA_TCD_ATTR_SMOD_MASK) >> DMA_TCD_ATTR_SMOD_SHIFT);
+		dmod	= (uint8_t)((t->ATTR & DMA_TCD_ATTR_DMOD_MASK) >> DMA_TCD_ATTR_DMOD_SHIFT);
+		nbytes = t->NBYTES.MLNO;
+		if((ssize != dsize)||(ssize > 2)||(nbytes == 0)||(nbytes % (1u << ssize)))
+		{
+				//只支持源、目的同宽度的1/2/4字节传输
+				CanSimDma.ERR |= 1uL << Ch;
+				Sim.DmaDepth--;
+				return;
+		}
+		s = t->SADDR;
+		d = t->DADDR;
+		for(n=0;n<nbytes;n+=(1u << ssize))
+		{
+				Sim_DmaCopy(d, s, (uint8_t)(1u << ssize));
+				s = Sim_DmaAddr(s, (int16_t)t->SOFF, smod);
+				d = Sim_DmaAddr(d, (int16_t)t->DOFF, dmod);
+		}
+		t->SADDR = s;
+		t->DADDR = d;
+
+		link = -1;
+		citer = t->CITER.ELINKNO;
+		mask	= (citer & DMA_TCD_CITER_ELINKNO_ELINK_MASK) ? DMA_TCD_CITER_ELINKYES_CITER_LE_MASK : DMA_TCD_CITER_ELINKNO_CITER_MASK;
+		biter = t->BITER.ELINKNO & mask;
+		if((citer & mask) <= 1)
+		{
+				t->SADDR += t->SLAST;
+				if((t->CSR & DMA_TCD_CSR_ESG_MASK) == 0)	t->DADDR += t->DLASTSGA;
+				t->CITER.ELINKNO = t->BITER.ELINKNO;
+				t->CSR |= DMA_TCD_CSR_DONE_MASK;
+				if(t->CSR & DMA_TCD_CSR_INTMAJOR_MASK)	CanSimDma.INT |= 1uL << Ch;
+				if(t->CSR & DMA_TCD_CSR_DREQ_MASK)			CanSimDma.ERQ &= ~(1uL << Ch);
+				if(t->CSR & DMA_TCD_CSR_MAJORELINK_MASK)	link = (int8_t)((t->CSR & DMA_TCD_CSR_MAJORLINKCH_MASK) >> DMA_TCD_CSR_MAJORLINKCH_SHIFT);
+		}
+		else
+		{
+				citer = (uint16_t)((citer & ~mask) | ((citer & mask) - 1));
+				t->CITER.ELINKNO = citer;
+				if((t->CSR & DMA_TCD_CSR_INTHALF_MASK)&&((citer & mask) == biter / 2))	CanSimDma.INT |= 1uL << Ch;
+				if(citer & DMA_TCD_CITER_ELINKNO_ELINK_MASK)
+						link = (int8_t)((citer & DMA_TCD_CITER_ELINKYES_LINKCH_MASK) >> DMA_TCD_CITER_ELINKYES_LINKCH_SHIFT);
+		}
+
+		for(i=0;i<CAN_SIM_CH_NUM;i++)
+		{
+				if(Sim.Ch[i].PopReq == 0)	continue;
+				Sim.Ch[i].PopReq = 0;
+				Sim_FifoPop(i);
+				CanSimStat[i].DmaFrames++;
+		}
+		if(link >= 0)	Sim_DmaMinor((uint8_t)link);
+		Sim.DmaDepth--;
+}
+
+//FlexCAN Ch的Rx FIFO有帧且为DMA模式时, 由DMAMUX选中的通道逐帧搬运
+static void Sim_DmaReq(uint8_t Ch)
+{
+		SimChType	*c;
+		uint32_t	n;
+		uint8_t		dc,num;
+
+		c = &Sim.Ch[Ch];
+		for(dc=0;dc<DMAMUX_CHCFG_COUNT;dc++)
+				if(CanSimDmamux.CHCFG[dc] == (DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(SIM_DMA_SOURCE + Ch)))	break;
+		if(dc == DMAMUX_CHCFG_COUNT)	return;
+
+		for(n=0;(n < CAN_SIM_FIFO_DEPTH)&&c->FifoNum && (CanSimReg[Ch].MCR.v & CAN_MCR_DMA_MASK)&&(CanSimDma.ERQ & (1uL << dc));n++)
+		{
+				num = c->FifoNum;
+				Sim_DmaMinor(dc);
+				//一次次循环未读到MB0第3字, FIFO不会移出, 请求一直保持
+				if(c->FifoNum == num)	break;
+		}
+}
+
+CanSimDmaCmd &CanSimDmaCmd::operator=(uint8_t x)
+{
+		uint32_t	bits;
+		uint8_t		ch;
+
+		v = x;
+		//位6为"全部通道"
+		bits = (x & 0x40) ? 0xFFFFuL : (1uL << (x & 0xF));
+		if(this == &CanSimDma.CERQ)	CanSimDma.ERQ &= ~bits;
+		else if(this == &CanSimDma.SERQ)
+		{
+				CanSimDma.ERQ |= bits;
+				for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+						if(Sim.Ch[ch].FifoNum && (CanSimReg[ch].MCR.v & CAN_MCR_DMA_MASK))	Sim_DmaReq(ch);
+		}
+		else if(this == &CanSimDma.CINT)	CanSimDma.INT &= ~bits;
+		else if(this == &CanSimDma.CERR)	CanSimDma.ERR &= ~bits;
+		else if(this == &CanSimDma.CEEI)	CanSimDma.EEI &= ~bits;
+		else if(this == &CanSimDma.SEEI)	CanSimDma.EEI |= bits;
+		else if(this == &CanSimDma.CDNE)
+		{
+				for(ch=0;ch<DMA_TCD_COUNT;ch++)
+						if(bits & (1uL << ch))	CanSimDma.TCD[ch].CSR &= ~DMA_TCD_CSR_DONE_MASK;
+		}
+		else if(this == &CanSimDma.SSRT)
+		{
+				for(ch=0;ch<DMA_TCD_COUNT;ch++)
+						if(bits & (1uL << ch))	Sim_DmaMinor(ch);
+		}
+		return *this;
+}
+
+
+
+CanSimMcr &CanSimMcr::operator=(uint32_t x)
+{
+		uint8_t	ch;
+
+		ch = Sim_ChOf(this);
+		if(x & CAN_MCR_SOFTRST_MASK)
+		{
+				//关闭时软复位无效
+				if((v & CAN_MCR_MDIS_MASK) == 0)	Sim_SoftReset(ch);
+				return *this;
+		}
+		v = x & ~(CAN_MCR_NOTRDY_MASK | CAN_MCR_FRZACK_MASK | CAN_MCR_LPMACK_MASK);
+		Sim_Mode(ch);
+		return *this;
+}
+
+CanSimIflag &CanSimIflag::operator=(uint32_t x)
+{
+		CanSimRegType	*r;
+		uint32_t			clr;
+		uint8_t				ch;
+
+		ch	= Sim_ChOf(this);
+		r		= &CanSimReg[ch];
+		clr = v & x;
+		v &= ~x;
+		if((r->MCR.v & CAN_MCR_RFEN_MASK)&&((r->MCR.v & CAN_MCR_DMA_MASK) == 0)&&(clr & CAN_IFLAG1_BUF5I_MASK))
+				Sim_FifoPop(ch);
+		return *this;
+}
+
+CanSimTimer &CanSimTimer::operator=(uint32_t x)
+{
+		uint8_t	ch;
+
+		ch = Sim_ChOf(this);
+		Sim.Ch[ch].TimerHold = x & 0xFFFF;
+		Sim.Ch[ch].TimerBase = Sim.Now;
+		return *this;
+}
+
+CanSimTimer::operator uint32_t() const
+{
+		return Sim_TimerAt(Sim_ChOf(this), Sim.Now);
+}
+
+CanSimCycCnt::operator uint32_t() const
+{
+		return (uint32_t)(uint64_t)((double)Sim.Now * SystemCoreClock / 1e9);
+}
+
+//代替driver/drvTimer.c: us时基取自虚拟时钟
+uint64_t TimerGetUs(void)
+{
+		return Sim.Now / 1000;
+}
+
+
+
+/*************************************************************************
+*  函数名称：CanSimInit
+*  功能说明：寄存器复位(FlexCAN关闭), 总线空闲, 虚拟时钟清零; CANi接总线i
+//	         总线默认500kbit/s、FD数据段2Mbit/s、外部节点应答
+*************************************************************************/
+void CanSimInit(void)
+{
+		uint8_t	i;
+
+		memset(&Sim, 0, sizeof(Sim));
+		memset((void *)CanSimReg, 0, sizeof(CanSimReg));
+		memset((void *)&CanSimDma, 0, sizeof(CanSimDma));
+		memset((void *)&CanSimDmamux, 0, sizeof(CanSimDmamux));
+		memset((void *)&CanSimPcc, 0, sizeof(CanSimPcc));
+		memset((void *)CanSimPort, 0, sizeof(CanSimPort));
+		memset(CanSimStat, 0, sizeof(CanSimStat));
+		memset(CanSimBusStat, 0, sizeof(CanSimBusStat));
+		memset(CanSimNvicOn, 0, sizeof(CanSimNvicOn));
+		CanSimPrimask = 0;
+		CanSimClock.OscHz = 8000000uL;
+		CanSimClock.SysHz = 80000000uL;
+		SystemCoreClock		= CanSimClock.SysHz;
+		for(i=0;i<CAN_SIM_CH_NUM;i++)
+		{
+				//复位值: MDIS、FRZ、HALT, MAXMB=15
+				CanSimReg[i].MCR.v = CAN_MCR_MDIS_MASK | CAN_MCR_FRZ_MASK | CAN_MCR_HALT_MASK | CAN_MCR_SUPV_MASK | CAN_MCR_MAXMB(0xF);
+				CanSimReg[i].FDCTRL = CAN_FDCTRL_FDRATE_MASK;
+				Sim_Mode(i);
+				Sim.Ch[i].Bus = i;
+				Sim.Ch[i].OnBus = -1;
+		}
+		for(i=0;i<CAN_SIM_BUS_NUM;i++)
+		{
+				CanSimBus[i].Bitrate		 = 500000uL;
+				CanSimBus[i].DataBitrate = 2000000uL;
+				CanSimBus[i].Ack				 = 1;
+		}
+}
+
+//把控制器接到总线Bus, 0xFF为断开; 多个控制器可接同一总线
+void CanSimConnect(uint8_t CANChannel, uint8_t Bus)
+{
+		Sim.Ch[CANChannel].Bus = Bus;
+}
+
+uint64_t CanSimNow(void)
+{
+		return Sim.Now / 1000;
+}
+
+uint64_t CanSimNowNs(void)
+{
+		return Sim.Now;
+}
+
+/*************************************************************************
+*  函数名称：CanSimAdvance
+*  功能说明：虚拟时钟前进Us微秒, 代表主循环中其他工作的时间;
+//	         期间总线上的收发、DMA和中断按时间顺序发生
+*************************************************************************/
+void CanSimAdvance(uint32_t Us)
+{
+		Sim_Run(Sim.Now + (uint64_t)Us * 1000);
+}
+
+void CanSimAdvanceNs(uint64_t Ns)
+{
+		Sim_Run(Sim.Now + Ns);
+}
+
+/*************************************************************************
+*  函数名称：CanSimSend
+*  功能说明：外部节点发送一帧, 按入队顺序发出, 队首未到Time时后面的帧也等待
+*  参数说明：Bus：总线号
+//	         Frame：Time为最早开始时刻(ns), 0为立即
+*  函数返回：0：成功；1：队列满
+*************************************************************************/
+uint8_t CanSimSend(uint8_t Bus, const CanSimFrameType *Frame)
+{
+		SimBusType	*b;
+		uint16_t		next;
+
+		b = &Sim.Bus[Bus];
+		next = (b->TxHead + 1) & (CAN_SIM_TXQ_SIZE - 1);
+		if(next == b->TxTail)	return 1;
+		b->TxQ[b->TxHead] = *Frame;
+		b->TxQ[b->TxHead].Src = CAN_SIM_SRC_EXT;
+		b->TxHead = next;
+		return 0;
+}
+
+uint16_t CanSimSendFree(uint8_t Bus)
+{
+		return (uint16_t)((Sim.Bus[Bus].TxTail - Sim.Bus[Bus].TxHead - 1) & (CAN_SIM_TXQ_SIZE - 1));
+}
+
+/*************************************************************************
+*  函数名称：CanSimRecv
+*  功能说明：按完成顺序取出总线上出现过的帧(任一节点发出), 含SOF和EOF时刻
+*  函数返回：0：成功；1：日志空
+*************************************************************************/
+uint8_t CanSimRecv(uint8_t Bus, CanSimFrameType *Frame)
+{
+		SimBusType	*b;
+
+		b = &Sim.Bus[Bus];
+		if(b->LogTail == b->LogHead)	return 1;
+		*Frame = b->Log[b->LogTail];
+		b->LogTail = (b->LogTail + 1) & (CAN_SIM_LOG_SIZE - 1);
+		return 0;
+}
+
+//总线空闲且没有待发帧
+uint8_t CanSimBusIdle(uint8_t Bus)
+{
+		return ((Sim.Bus[Bus].State == SIM_BUS_IDLE)&&(Sim_BusReady(Bus) == UINT64_MAX)) ? 1 : 0;
+}
+
+//控制器按寄存器的实际波特率(Data=1为FD数据段), 未退出冻结时为上次配置的值
+uint32_t CanSimBitrate(uint8_t CANChannel, uint8_t Data)
+{
+		return Data ? Sim.Ch[CANChannel].DataHz : Sim.Ch[CANChannel].NomHz;
+}
+
+static uint64_t Sim_HostNs(void)
+{
+		struct timespec	ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000uLL + ts.tv_nsec;
+}
+
+//开中断或时钟推进时检查CAN和DMA中断, 同一中断源连续SIM_IRQ_STORM_MAX次返回后仍挂起即终止
+void CanSimIrqCheck(void)
+{
+		uint64_t	t0;
+		uint32_t	n;
+		uint8_t		ch,hit;
+
+		if(Sim.InIrq)	return;
+		Sim.InIrq = 1;
+		for(n=0;CanSimPrimask == 0;n++)
+		{
+				hit = 0;
+				for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				{
+						if(CanSimNvicOn[SimCanIrq[ch]] && (CanSimReg[ch].IMASK1 & CanSimReg[ch].IFLAG1.v))
+						{
+								t0 = Sim_HostNs();
+								SimCanIsr[ch]();
+								CanSimStat[ch].IrqHostNs += Sim_HostNs() - t0;
+								CanSimStat[ch].Irqs++;
+								hit = 1;
+						}
+						if(CanSimNvicOn[DMA0_IRQn + ch] && (CanSimDma.INT & (1uL << ch)))
+						{
+								t0 = Sim_HostNs();
+								SimDmaIsr[ch]();
+								CanSimStat[ch].IrqHostNs += Sim_HostNs() - t0;
+								CanSimStat[ch].Irqs++;
+								hit = 1;
+						}
+				}
+				if(hit == 0)	break;
+				if(n >= SIM_IRQ_STORM_MAX)
+				{
+						for(ch=0;ch<CAN_SIM_CH_NUM;ch++)	CanSimStat[ch].IrqStorm++;
+						fprintf(stderr, "cansim: 中断标志未清除\n");
+						abort();
+				}
+		}
+		Sim.InIrq = 0;
+}
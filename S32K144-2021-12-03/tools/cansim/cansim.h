@@ -0,0 +1,289 @@
+#ifndef __CAN_SIM_H
+#define __CAN_SIM_H
+
+#include <stdint.h>
+#include <type_traits>
+#include "S32K144.h"
+
+//主机上的FlexCAN模型和虚拟总线, 用于在PC上运行driver/drvCAN.c, 做满负载、吞吐和延时测试
+//驱动源文件按C++编译, 本目录的S32K144.h把CAN_Type/DMA_Type换成下面的寄存器模型,
+//CAN_BASE_TABLE指向CanSimReg[0~2]; PCC/PORT/DMAMUX为普通内存, DWT->CYCCNT取自虚拟时钟
+//
+//FlexCAN: MCR的MDIS/FRZ/HALT/SOFTRST握手, TIMER按位时间计数, IFLAG1写1清零,
+//  MailBox的CODE语义(发送0xC/中止9/完成8, 接收EMPTY/FULL/OVERRUN), IRMQ下找空闲MailBox,
+//  Rx FIFO 6级深度、BUF5I/6I/7I、RXFIR, 过滤表格式A/B/C/D及RXIMR/RXFGMASK, FD的MBDSR0和EDL/BRS,
+//  DMA模式下BUF5I作DMA请求, DMA读到MB0第3字时FIFO移出下一帧
+//位时间: 按CLKSRC、CTRL1或CBT、FDCBT算出的波特率须与总线一致(误差CAN_SIM_RATE_TOL_PPM), 否则不收发
+//总线: 每路总线上挂若干FlexCAN和一个外部节点, 按仲裁场逐位比较(ID小者、同基本ID标准帧)获胜,
+//  节点内按CTRL1[LBUF]选MailBox; 经典帧按实际位填充和CRC15计算帧长, FD帧CRC段按固定填充
+//eDMA: 次循环、主循环计数、ELINK/MAJORELINK链接、SMOD/DMOD取模、SLAST/DLASTSGA、INTHALF/INTMAJOR/DREQ
+//中断: IMASK1&IFLAG1或DMA INT置位、NVIC已使能且未关中断时调用驱动的中断函数;
+//  只在CanSimAdvance和开中断时进入, 不嵌套; 处理函数返回后仍满足条件视为中断风暴
+//驱动中的DMA地址按32位写入TCD, 须用-no-pie链接, 全局变量位于4GB以下
+//不模拟: 错误帧和错误计数(ECR保持0)、远程帧应答、Pretended Networking、节点间时钟漂移
+
+#define CAN_SIM_CH_NUM					3
+#define CAN_SIM_BUS_NUM					3
+//控制器与总线的波特率允许误差, 百万分比
+#ifndef CAN_SIM_RATE_TOL_PPM
+#define CAN_SIM_RATE_TOL_PPM		5000
+#endif
+//外部节点发送队列、总线日志深度(帧), 须为2的幂
+#define CAN_SIM_TXQ_SIZE				1024
+#define CAN_SIM_LOG_SIZE				4096
+//Rx FIFO深度
+#define CAN_SIM_FIFO_DEPTH			6
+//CanSimFrameType.Src: 外部节点发出
+#define CAN_SIM_SRC_EXT					0xFF
+
+//总线上的一帧
+typedef	struct
+{
+			uint32_t	ID;
+			uint8_t		IDE;				//1:扩展帧
+			uint8_t		RTR;
+			uint8_t		FD;					//1:FD帧(EDL)
+			uint8_t		BRS;
+			uint8_t		DLC;				//0~15, 经典帧最多8字节数据
+			uint8_t		Src;				//发出者: FlexCAN通道号或CAN_SIM_SRC_EXT
+			uint8_t		Data[64];
+			uint64_t	Time;				//ns, CanSimSend: 最早开始时刻(0为立即); 日志: SOF时刻
+			uint64_t	Done;				//ns, 日志: EOF结束时刻(收发完成), 不含帧间隔
+
+}		CanSimFrameType;
+
+//协议引擎时钟, CTRL1[CLKSRC]=0:SOSCDIV2  1:SYS_CLK; 在CanSimInit之后修改, 模拟运行模式切换
+typedef	struct
+{
+			uint32_t	OscHz;
+			uint32_t	SysHz;
+
+}		CanSimClockType;
+
+//总线配置, 在CanSimInit之后修改
+typedef	struct
+{
+			uint32_t	Bitrate;			//仲裁段波特率
+			uint32_t	DataBitrate;	//FD数据段波特率, 0:总线上没有FD节点
+			uint8_t		Ack;					//1:外部节点应答控制器发出的帧
+
+}		CanSimBusCfgType;
+
+//FlexCAN统计, 测试后检查RateErr/FormErr/ConfigErr/IrqStorm应为0
+typedef	struct
+{
+			uint32_t	TxFrames;
+			uint32_t	RxFrames;			//写入FIFO或MailBox的帧
+			uint32_t	RxMiss;				//无匹配的过滤元素或MailBox, 被硬件丢弃
+			uint32_t	FifoOverflow;	//FIFO满丢帧(BUF7I)
+			uint32_t	MbOverrun;		//接收MailBox未取走被覆盖(OVERRUN)
+			uint32_t	Aborts;				//中止成功(CODE保持9)
+			uint32_t	ArbLost;			//仲裁失败次数
+			uint32_t	DmaFrames;		//DMA从FIFO读走的帧
+			uint32_t	RateErr;			//波特率与总线不符错过的帧
+			uint32_t	FormErr;			//非FD模式收到FD帧
+			uint32_t	ConfigErr;		//退出冻结时寄存器配置不合法
+			uint32_t	Irqs;
+			uint32_t	IrqStorm;
+			uint64_t	IrqHostNs;		//中断处理函数在主机上的耗时, 供剖析
+
+}		CanSimStatType;
+
+//总线统计
+typedef	struct
+{
+			uint32_t	Frames;
+			uint32_t	AckErr;				//无节点应答, 帧丢弃
+			uint32_t	Collision;		//仲裁场完全相同的帧同时发送
+			uint32_t	LogDrop;			//日志满未记录
+			uint64_t	BusyNs;				//含帧间隔
+
+}		CanSimBusStatType;
+
+//MCR: MDIS/FRZ/HALT的应答位LPMACK/FRZACK/NOTRDY立即跟随, SOFTRST立即完成并自清零
+class CanSimMcr
+{
+public:
+			CanSimMcr &operator=(uint32_t x);
+			CanSimMcr &operator|=(uint32_t x)		{ return *this = v | x; }
+			CanSimMcr &operator&=(uint32_t x)		{ return *this = v & x; }
+			CanSimMcr &operator^=(uint32_t x)		{ return *this = v ^ x; }
+			operator uint32_t() const						{ return v; }
+			uint32_t	v;
+};
+
+//IFLAG1: 写1清零; Rx FIFO模式(非DMA)清BUF5I时FIFO移出下一帧
+class CanSimIflag
+{
+public:
+			CanSimIflag &operator=(uint32_t x);
+			operator uint32_t() const						{ return v; }
+			uint32_t	v;
+};
+
+//TIMER: 读时按虚拟时钟和位时间计算, 冻结和关闭时停止
+class CanSimTimer
+{
+public:
+			CanSimTimer &operator=(uint32_t x);
+			operator uint32_t() const;
+			uint32_t	v;
+};
+
+//与芯片CAN_Type相同的布局, RAMn偏移0x80
+typedef	struct alignas(256)
+{
+			CanSimMcr			MCR;
+	__IO	uint32_t			CTRL1;
+			CanSimTimer		TIMER;
+			uint8_t				RESERVED_0[4];
+	__IO	uint32_t			RXMGMASK;
+	__IO	uint32_t			RX14MASK;
+	__IO	uint32_t			RX15MASK;
+	__IO	uint32_t			ECR;
+	__IO	uint32_t			ESR1;
+			uint8_t				RESERVED_1[4];
+	__IO	uint32_t			IMASK1;
+			uint8_t				RESERVED_2[4];
+			CanSimIflag		IFLAG1;
+	__IO	uint32_t			CTRL2;
+	__IO	uint32_t			ESR2;		//模型中可写
+			uint8_t				RESERVED_3[8];
+	__IO	uint32_t			CRCR;		//模型中可写
+	__IO	uint32_t			RXFGMASK;
+	__IO	uint32_t			RXFIR;
+	__IO	uint32_t			CBT;
+			uint8_t				RESERVED_4[44];
+	__IO	uint32_t			RAMn[CAN_RAMn_COUNT];
+			uint8_t				RESERVED_5[1536];
+	__IO	uint32_t			RXIMR[CAN_RXIMR_COUNT];
+			uint8_t				RESERVED_6[512];
+	__IO	uint32_t			CTRL1_PN;
+	__IO	uint32_t			CTRL2_PN;
+	__IO	uint32_t			WU_MTC;
+	__IO	uint32_t			FLT_ID1;
+	__IO	uint32_t			FLT_DLC;
+	__IO	uint32_t			PL1_LO;
+	__IO	uint32_t			PL1_HI;
+	__IO	uint32_t			FLT_ID2_IDMASK;
+	__IO	uint32_t			PL2_PLMASK_LO;
+	__IO	uint32_t			PL2_PLMASK_HI;
+			uint8_t				RESERVED_7[24];
+			uint32_t			WMB[CAN_WMB_COUNT][4];
+			uint8_t				RESERVED_8[128];
+	__IO	uint32_t			FDCTRL;
+	__IO	uint32_t			FDCBT;
+	__IO	uint32_t			FDCRC;		//模型中可写
+
+}		CanSimRegType;
+
+typedef	CanSimRegType		CAN_Type, *CAN_MemMapPtr;
+
+//eDMA的CERQ/SERQ/CDNE/SSRT/CINT等8位命令寄存器, 写入即执行
+class CanSimDmaCmd
+{
+public:
+			CanSimDmaCmd &operator=(uint8_t x);
+			uint8_t		v;
+};
+
+//TCD沿用芯片头文件中的结构
+typedef	std::remove_extent<decltype(DmaChipType::TCD)>::type		CanSimTcdType;
+
+typedef	struct
+{
+	__IO	uint32_t			CR;
+	__IO	uint32_t			ES;		//模型中可写
+			uint8_t				RESERVED_0[4];
+	__IO	uint32_t			ERQ;
+			uint8_t				RESERVED_1[4];
+	__IO	uint32_t			EEI;
+			CanSimDmaCmd	CEEI;
+			CanSimDmaCmd	SEEI;
+			CanSimDmaCmd	CERQ;
+			CanSimDmaCmd	SERQ;
+			CanSimDmaCmd	CDNE;
+			CanSimDmaCmd	SSRT;
+			CanSimDmaCmd	CERR;
+			CanSimDmaCmd	CINT;
+			uint8_t				RESERVED_2[4];
+	__IO	uint32_t			INT;
+			uint8_t				RESERVED_3[4];
+	__IO	uint32_t			ERR;
+			uint8_t				RESERVED_4[4];
+	__IO	uint32_t			HRS;		//模型中可写
+			uint8_t				RESERVED_5[12];
+	__IO	uint32_t			EARS;
+			uint8_t				RESERVED_6[184];
+	__IO	uint8_t				DCHPRI[DMA_DCHPRI_COUNT];
+			uint8_t				RESERVED_7[3824];
+			CanSimTcdType	TCD[DMA_TCD_COUNT];
+
+}		CanSimDmaType;
+
+typedef	CanSimDmaType		DMA_Type, *DMA_MemMapPtr;
+
+extern CanSimRegType			CanSimReg[CAN_SIM_CH_NUM];
+extern CanSimDmaType			CanSimDma;
+extern DMAMUX_Type				CanSimDmamux;
+extern PCC_Type						CanSimPcc;
+extern PORT_Type					CanSimPort[PORT_INSTANCE_COUNT];
+extern CanSimClockType		CanSimClock;
+extern CanSimBusCfgType		CanSimBus[CAN_SIM_BUS_NUM];
+extern CanSimStatType			CanSimStat[CAN_SIM_CH_NUM];
+extern CanSimBusStatType	CanSimBusStat[CAN_SIM_BUS_NUM];
+extern uint32_t						CanSimPrimask;
+
+//驱动只经此表访问FlexCAN; 直接使用CAN0~2的代码在主机上编译不过
+#undef	CAN0
+#undef	CAN1
+#undef	CAN2
+#undef	CAN_BASE_PTRS
+#define CAN_BASE_TABLE							{ &CanSimReg[0], &CanSimReg[1], &CanSimReg[2] }
+
+#undef	DMA
+#define DMA													(&CanSimDma)
+#undef	DMAMUX
+#define DMAMUX											(&CanSimDmamux)
+#undef	PCC
+#define PCC													(&CanSimPcc)
+#undef	PORTA
+#define PORTA												(&CanSimPort[0])
+#undef	PORTB
+#define PORTB												(&CanSimPort[1])
+#undef	PORTC
+#define PORTC												(&CanSimPort[2])
+#undef	PORTD
+#define PORTD												(&CanSimPort[3])
+#undef	PORTE
+#define PORTE												(&CanSimPort[4])
+
+//drvCAN.c每发出一帧调用一次, 参数为发送延时(us), 见drvCAN.h的CAN_LATENCY_HOOK
+extern void	(*CanSimLatencyHook)(uint8_t CANChannel, uint32_t Us);
+#define CAN_LATENCY_HOOK(ch,us)			{ if(CanSimLatencyHook)	CanSimLatencyHook(ch, us); }
+
+void			CanSimInit(void);
+void			CanSimConnect(uint8_t CANChannel, uint8_t Bus);
+uint64_t	CanSimNow(void);
+uint64_t	CanSimNowNs(void);
+void			CanSimAdvance(uint32_t Us);
+void			CanSimAdvanceNs(uint64_t Ns);
+uint8_t		CanSimSend(uint8_t Bus, const CanSimFrameType *Frame);
+uint16_t	CanSimSendFree(uint8_t Bus);
+uint8_t		CanSimRecv(uint8_t Bus, CanSimFrameType *Frame);
+uint8_t		CanSimBusIdle(uint8_t Bus);
+uint32_t	CanSimBitrate(uint8_t CANChannel, uint8_t Data);
+uint32_t	CanSimFrameNs(uint8_t Bus, const CanSimFrameType *Frame);
+uint8_t		CanSimLen(uint8_t FD, uint8_t DLC);
+void			CanSimIrqCheck(void);
+
+//由driver/drvCAN.c提供
+void			CAN0_ORed_0_15_MB_IRQHandler(void);
+void			CAN1_ORed_0_15_MB_IRQHandler(void);
+void			CAN2_ORed_0_15_MB_IRQHandler(void);
+void			DMA0_IRQHandler(void);
+void			DMA1_IRQHandler(void);
+void			DMA2_IRQHandler(void);
+
+
+#endif /* __CAN_SIM_H */
@@ -0,0 +1,54 @@
+#ifndef __CAN_SIM_CORE_CM4_H
+#define __CAN_SIM_CORE_CM4_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//主机编译用的CMSIS子集: 中断屏蔽、NVIC使能和DWT周期计数交给cansim, 其余为空操作
+#define __I											volatile const
+#define __O											volatile
+#define __IO										volatile
+#define __IM										volatile const
+#define __OM										volatile
+#define __IOM										volatile
+#define __STATIC_INLINE					static inline
+#define __ASM										__asm__
+
+extern uint32_t	CanSimPrimask;
+extern uint8_t	CanSimNvicOn[];
+void						CanSimIrqCheck(void);
+
+static inline uint32_t __get_PRIMASK(void)				{ return CanSimPrimask; }
+static inline void __set_PRIMASK(uint32_t Mask)		{ CanSimPrimask = Mask & 1; CanSimIrqCheck(); }
+static inline void __disable_irq(void)						{ CanSimPrimask = 1; }
+static inline void __enable_irq(void)							{ CanSimPrimask = 0; CanSimIrqCheck(); }
+static inline void __DSB(void)										{}
+static inline void __ISB(void)										{}
+static inline void __NOP(void)										{}
+static inline void __WFI(void)										{}
+static inline uint32_t __REV(uint32_t v)					{ return __builtin_bswap32(v); }
+
+static inline void NVIC_EnableIRQ(IRQn_Type n)			{ CanSimNvicOn[n] = 1; CanSimIrqCheck(); }
+static inline void NVIC_DisableIRQ(IRQn_Type n)			{ CanSimNvicOn[n] = 0; }
+static inline void NVIC_ClearPendingIRQ(IRQn_Type n)	{ (void)n; }
+static inline void NVIC_SetPriority(IRQn_Type n, uint32_t p)	{ (void)n; (void)p; }
+static inline void NVIC_SystemReset(void)						{ fprintf(stderr, "cansim: NVIC_SystemReset\n"); }
+
+//DWT->CYCCNT: 按SystemCoreClock由虚拟时钟换算, 中断处理在虚拟时钟上不占时间
+class CanSimCycCnt
+{
+public:
+			operator uint32_t() const;
+};
+
+typedef	struct
+{
+			CanSimCycCnt	CYCCNT;
+
+}		CanSimDwtType;
+
+extern CanSimDwtType		CanSimDwt;
+#define DWT											(&CanSimDwt)
+
+
+#endif /* __CAN_SIM_CORE_CM4_H */
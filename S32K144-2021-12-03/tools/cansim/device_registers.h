@@ -0,0 +1,8 @@
+#ifndef __CAN_SIM_DEVICE_REGISTERS_H
+#define __CAN_SIM_DEVICE_REGISTERS_H
+
+//VCUAPP/main.c经此包含芯片头文件, 主机上换成本目录的S32K144.h
+#include "S32K144.h"
+
+
+#endif /* __CAN_SIM_DEVICE_REGISTERS_H */
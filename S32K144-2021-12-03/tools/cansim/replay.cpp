@@ -0,0 +1,549 @@
+//用cansim回放candump/Vector ASC日志: 帧按原时刻或压缩后的时刻由外部节点发到虚拟总线, 经FlexCAN模型进入drvCAN接收路径,
+//由VCUAPP/main.c的GatewayInit/GatewayPoll按路由表转发, 统计转发吞吐、丢帧和转发延时分位数
+//编译(g++为一条命令, 分行只为排版):
+//  P=../../CAN_Demo-OK-2021-11-25
+//  g++ -O1 -Wall -x c++ -no-pie -Dmain=VcuMain -ffunction-sections -fdata-sections -Wl,--gc-sections
+//      -I. -I$P/driver -I$P/VCUAPP -I$P/platform/devices/S32K144/include -I$P/platform/devices
+//      -I$P/platform/devices/S32K144/startup -DCPU_S32K144HFT0VLLT
+//      $P/driver/drvCAN.c $P/driver/drvCANFilter.c $P/driver/drvCANTiming.c
+//      $P/VCUAPP/main.c $P/VCUAPP/CANRoute.c $P/VCUAPP/CANTp.c cansim.cpp replay.cpp -o replay
+//  main.c的main改名为VcuMain, 它引用的Flash、电源等函数随之由--gc-sections丢弃, 只链接网关部分
+//
+//用法: ./replay [-s 倍速] [-l 主循环us] [-b kbit/s] [-m 名称=通道] [-x p999上限us] 日志...
+//  -s 1为原时刻(默认), 10为时间压缩到1/10, 0为不按时刻、以总线允许的最快速度连续注入
+//  -l 主循环一圈的时间, 默认50us; -b 总线波特率, 须与GatewayInit一致, 默认250
+//  -m can0=1: candump接口名或ASC通道号(从1起)接到CAN1, 对所有日志有效, 可重复;
+//  未指定的通道每个日志各自按出现顺序接CAN0、1、2
+//  .asc为Vector ASC, 其余按candump解析(-l格式"(时刻) can0 123#11223344", 或-ta格式"(时刻) can0 123 [4] 11 22 33 44")
+//  多个日志各自从第一帧起算, 合并后按时刻回放
+//转发延时: 帧在源总线上接收到在目标总线上发送完成, 由drvCAN.c逐帧给出(CAN_LATENCY_HOOK)
+//日志打不开、没有帧、有帧所在通道接不上CAN0~2、模型统计有RateErr/FormErr/ConfigErr或p999超过-x时返回1
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "S32K144.h"
+#include "drvCAN.h"
+#include "CANRoute.h"
+#include "cansim.h"
+
+//VCUAPP/main.c
+uint8_t	GatewayInit(void);
+uint8_t	GatewayPoll(void);
+
+//所有帧注入完后等待网关排空的上限(us)
+#define REPLAY_DRAIN_US					1000000
+//提前注入的时间窗(ns), 总线空闲、网关无帧时直接跳到下一帧的时刻
+#define REPLAY_AHEAD_NS					10000000uLL
+
+typedef	struct
+{
+			CanSimFrameType	F;
+			double		Sec;						//日志中的时刻
+			uint8_t		Ch;
+
+}		ReplayFrameType;
+
+typedef	struct
+{
+			std::string	Name;
+			uint8_t		Ch;
+			int				File;						//日志在argv中的下标, -1: -m指定, 对所有日志有效
+
+}		ReplayMapType;
+
+static std::vector<ReplayFrameType>	Frames;
+static std::vector<ReplayMapType>		Map;
+static std::vector<uint32_t>				Lat;
+static uint32_t	Skipped;
+static uint32_t	Unmapped;
+static uint8_t	NextCh;					//当前日志下一个自动分配的通道
+static int			CurFile;				//当前日志在argv中的下标
+
+static void Replay_Latency(uint8_t CANChannel, uint32_t Us)
+{
+		(void)CANChannel;
+		Lat.push_back(Us);
+}
+
+//接口名或ASC通道号对应的CAN通道: 先查-m, 再查当前日志已分配的; 0xFF: 当前日志超出3路
+static uint8_t Replay_Ch(const std::string &Name)
+{
+		ReplayMapType	m;
+		size_t				i;
+
+		for(i=0;i<Map.size();i++)
+				if((Map[i].Name == Name)&&((Map[i].File < 0)||(Map[i].File == CurFile)))	return Map[i].Ch;
+		m.Name = Name;
+		m.File = CurFile;
+		m.Ch	 = (NextCh < CAN_SIM_CH_NUM) ? NextCh++ : 0xFF;
+		Map.push_back(m);
+		return m.Ch;
+}
+
+static void Replay_Add(const std::string &Name, double Sec, CanSimFrameType *f)
+{
+		ReplayFrameType	r;
+
+		r.Ch = Replay_Ch(Name);
+		if(r.Ch == 0xFF)
+		{
+				Unmapped++;
+				return;
+		}
+		r.F		= *f;
+		r.Sec = Sec;
+		Frames.push_back(r);
+}
+
+//FD长度对应的DLC, 不是合法长度时返回0xFF
+static uint8_t Replay_Dlc(uint8_t FD, uint32_t Len)
+{
+		uint8_t	d;
+
+		if(FD == 0)	return (Len <= 8) ? (uint8_t)Len : 0xFF;
+		for(d=0;d<16;d++)
+				if(CanSimLen(1, d) == Len)	return d;
+		return 0xFF;
+}
+
+//十六进制ID, 位数超过3或以x结尾为扩展帧; 返回0: 成功
+static uint8_t Replay_Id(const char *s, CanSimFrameType *f)
+{
+		char		*e;
+		size_t	n;
+
+		n = strlen(s);
+		f->ID = (uint32_t)strtoul(s, &e, 16);
+		if(e == s)	return 1;
+		f->IDE = ((n > 3)||(*e == 'x')) ? 1 : 0;
+		if((*e != 0)&&(*e != 'x'))	return 1;
+		if(f->ID > (f->IDE ? 0x1FFFFFFFuL : 0x7FFuL))	return 1;
+		return 0;
+}
+
+/*************************************************************************
+*  函数名称：Replay_Candump
+*  功能说明：解析candump的一行: "(时刻) 接口 ID#数据", FD为"ID##标志数据", 远程帧"ID#R";
+//	         或"(时刻) 接口 ID [长度] 数据..."; 其他行跳过
+*************************************************************************/
+static void Replay_Candump(char *Line)
+{
+		CanSimFrameType	f;
+		char		*p,*tok[80],*s;
+		double	sec;
+		uint32_t	len;
+		uint8_t		i,n,k;
+
+		p = strchr(Line, '(');
+		if(p == 0)
+		{
+				Skipped++;
+				return;
+		}
+		sec = strtod(p + 1, &s);
+		if((s == p + 1)||(*s != ')'))
+		{
+				Skipped++;
+				return;
+		}
+		n = 0;
+		for(p=strtok(s + 1, " \t\r\n");p&&(n<80);p=strtok(0, " \t\r\n"))	tok[n++] = p;
+		if(n < 2)
+		{
+				Skipped++;
+				return;
+		}
+		memset(&f, 0, sizeof(f));
+
+		p = strchr(tok[1], '#');
+		if(p)
+		{
+				*p++ = 0;
+				if(Replay_Id(tok[1], &f))
+				{
+						Skipped++;
+						return;
+				}
+				if(*p == '#')
+				{
+						f.FD	= 1;
+						f.BRS = (p[1] >= '0') ? (uint8_t)(strtoul(std::string(p + 1, 1).c_str(), 0, 16) & 1) : 0;
+						p += 2;
+				}
+				else if((*p == 'R')||(*p == 'r'))
+				{
+						f.RTR = 1;
+						f.DLC = (p[1] >= '0' && p[1] <= '8') ? (uint8_t)(p[1] - '0') : 0;
+						Replay_Add(tok[0], sec, &f);
+						return;
+				}
+				for(len=0;p[0]&&p[1]&&(len<64);p+=2)
+				{
+						if(*p == '.')	p--;
+						else	f.Data[len++] = (uint8_t)strtoul(std::string(p, 2).c_str(), 0, 16);
+				}
+		}
+		else
+		{
+				//-ta格式: ID [长度] 数据..., 远程帧为"remote request"
+				if((n < 3)||Replay_Id(tok[1], &f)||(tok[2][0] != '['))
+				{
+						Skipped++;
+						return;
+				}
+				len = (uint32_t)strtoul(tok[2] + 1, 0, 10);
+				f.FD = (tok[2][1] == '0' && tok[2][2] && tok[2][3] == ']') ? 1 : 0;
+				if(len > 8)	f.FD = 1;
+				if((n > 3)&&(strcmp(tok[3], "remote") == 0))
+				{
+						f.RTR = 1;
+						f.DLC = (uint8_t)len;
+						Replay_Add(tok[0], sec, &f);
+						return;
+				}
+				for(i=3,k=0;(i<n)&&(k<len)&&(k<64);i++)	f.Data[k++] = (uint8_t)strtoul(tok[i], 0, 16);
+				if(k != len)
+				{
+						Skipped++;
+						return;
+				}
+		}
+		f.DLC = Replay_Dlc(f.FD, len);
+		if(f.DLC == 0xFF)
+		{
+				Skipped++;
+				return;
+		}
+		Replay_Add(tok[0], sec, &f);
+}
+
+/*************************************************************************
+*  函数名称：Replay_Asc
+*  功能说明：解析Vector ASC的一行:
+//	         经典帧 "时刻 通道 ID[x] Rx|Tx d|r DLC 数据..."
+//	         FD帧   "时刻 CANFD 通道 Rx|Tx ID[x] [符号名] BRS ESI DLC 数据长度 数据..."
+//	         "base dec"时ID按十进制; 错误帧、统计等其他行跳过
+*************************************************************************/
+static uint8_t	AscDec;
+
+static void Replay_Asc(char *Line)
+{
+		CanSimFrameType	f;
+		char		*p,*tok[90],*e;
+		double	sec;
+		uint32_t	len;
+		uint8_t		i,n,k,d;
+
+		n = 0;
+		for(p=strtok(Line, " \t\r\n");p&&(n<90);p=strtok(0, " \t\r\n"))	tok[n++] = p;
+		if(n == 0)	return;
+		if((n >= 2)&&(strcmp(tok[0], "base") == 0))
+		{
+				AscDec = (strcmp(tok[1], "dec") == 0) ? 1 : 0;
+				return;
+		}
+		sec = strtod(tok[0], &e);
+		if((e == tok[0])||(*e != 0)||(n < 5))
+		{
+				Skipped++;
+				return;
+		}
+		memset(&f, 0, sizeof(f));
+		if(strcmp(tok[1], "CANFD") == 0)
+		{
+				if(n < 9)
+				{
+						Skipped++;
+						return;
+				}
+				//ID后可能有符号名, BRS、ESI各为一位数字
+				i = 5;
+				if(!((tok[i][0] == '0' || tok[i][0] == '1') && tok[i][1] == 0))	i++;
+				if(i + 4 > n)
+				{
+						Skipped++;
+						return;
+				}
+				if(Replay_Id(tok[4], &f) && AscDec == 0)
+				{
+						Skipped++;
+						return;
+				}
+				if(AscDec)	f.ID = (uint32_t)strtoul(tok[4], 0, 10);
+				f.BRS = (uint8_t)(tok[i][0] - '0');
+				d			= (uint8_t)strtoul(tok[i + 2], 0, 16);
+				len		= (uint32_t)strtoul(tok[i + 3], 0, 10);
+				f.FD	= 1;
+				//EDL=0的经典帧也记为CANFD
+				if((len <= 8)&&(d <= 8)&&(d == len)&&(f.BRS == 0)&&(n > i + 3))	f.FD = 0;
+				i = (uint8_t)(i + 4);
+				p = tok[2];
+		}
+		else
+		{
+				if(((tok[3][0] != 'R')&&(tok[3][0] != 'T'))||(Replay_Id(tok[2], &f) && AscDec == 0))
+				{
+						Skipped++;
+						return;
+				}
+				if(AscDec)	f.ID = (uint32_t)strtoul(tok[2], 0, 10);
+				if(tok[4][0] == 'r')
+				{
+						f.RTR = 1;
+						f.DLC = (n > 5) ? (uint8_t)(strtoul(tok[5], 0, 16) & 0xF) : 0;
+						Replay_Add(tok[1], sec, &f);
+						return;
+				}
+				if((tok[4][0] != 'd')||(n < 6))
+				{
+						Skipped++;
+						return;
+				}
+				len = (uint32_t)strtoul(tok[5], 0, 16);
+				if(len > 8)	len = 8;
+				i = 6;
+				p = tok[1];
+		}
+		for(k=0;(k<len)&&(i<n);k++,i++)	f.Data[k] = (uint8_t)strtoul(tok[i], 0, 16);
+		f.DLC = Replay_Dlc(f.FD, len);
+		if((k != len)||(f.DLC == 0xFF))
+		{
+				Skipped++;
+				return;
+		}
+		Replay_Add(p, sec, &f);
+}
+
+static uint8_t Replay_Load(const char *Name)
+{
+		FILE		*fp;
+		char		line[1024];
+		size_t	n,first;
+		double	t0;
+		uint8_t	asc;
+
+		fp = fopen(Name, "r");
+		if(fp == 0)
+		{
+				fprintf(stderr, "replay: 打不开 %s\n", Name);
+				return 1;
+		}
+		n = strlen(Name);
+		asc = ((n > 4)&&(strcasecmp(Name + n - 4, ".asc") == 0)) ? 1 : 0;
+		AscDec = 0;
+		first	 = Frames.size();
+		while(fgets(line, sizeof(line), fp))
+		{
+				if(asc)	Replay_Asc(line);
+				else		Replay_Candump(line);
+		}
+		fclose(fp);
+		//candump为绝对时刻, ASC为相对时刻; 各文件从各自第一帧起算, 同时开始回放
+		for(n=first,t0=1e300;n<Frames.size();n++)
+				if(Frames[n].Sec < t0)	t0 = Frames[n].Sec;
+		for(n=first;n<Frames.size();n++)	Frames[n].Sec -= t0;
+		return 0;
+}
+
+//第p千分位(最近秩)
+static uint32_t Replay_Pct(const std::vector<uint32_t> &v, uint32_t p)
+{
+		size_t	k;
+
+		if(v.empty())	return 0;
+		k = (v.size() * p + 999) / 1000;
+		return v[(k > 0) ? k - 1 : 0];
+}
+
+static double Replay_HostSec(void)
+{
+		struct timespec	ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t Replay_Quiet(void)
+{
+		uint8_t	ch;
+
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+				if((CanSimBusIdle(ch) == 0)||CANGetQueueDepth(ch))	return 0;
+		return 1;
+}
+
+//-Dmain=VcuMain也作用于本文件
+#undef	main
+int main(int argc, char *argv[])
+{
+		CANFrameType	cf;
+		CANStatType		st[CAN_SIM_CH_NUM];
+		const CANRouteType	*r;
+		ReplayMapType	m;
+		CanSimFrameType	f;
+		double		speed,host,span;
+		uint64_t	start,end,t,exp;
+		uint32_t	loop,kbit,limit,in[CAN_SIM_CH_NUM],drop;
+		size_t		i,next;
+		int				a;
+		uint8_t		ch,err,open;
+		char			*eq;
+
+		speed = 1;
+		loop	= 50;
+		kbit	= 250;
+		limit = 0;
+		err		= 0;
+		for(a=1;a<argc;a++)
+		{
+				if((argv[a][0] != '-')||(a + 1 >= argc))	break;
+				switch(argv[a][1])
+				{
+						case 's':	speed = atof(argv[++a]);	break;
+						case 'l':	loop	= (uint32_t)atoi(argv[++a]);	break;
+						case 'b':	kbit	= (uint32_t)atoi(argv[++a]);	break;
+						case 'x':	limit = (uint32_t)atoi(argv[++a]);	break;
+						case 'm':
+								eq = strchr(argv[++a], '=');
+								if((eq == 0)||(atoi(eq + 1) >= CAN_SIM_CH_NUM))
+								{
+										fprintf(stderr, "replay: -m 名称=通道(0~2)\n");
+										return 1;
+								}
+								m.Name = std::string(argv[a], eq - argv[a]);
+								m.Ch	 = (uint8_t)atoi(eq + 1);
+								m.File = -1;
+								Map.push_back(m);
+								break;
+						default:
+								fprintf(stderr, "replay: 未知选项 %s\n", argv[a]);
+								return 1;
+				}
+		}
+		if(a >= argc)
+		{
+				fprintf(stderr, "用法: replay [-s 倍速] [-l 主循环us] [-b kbit/s] [-m 名称=通道] [-x p999上限us] 日志...\n");
+				return 1;
+		}
+		if(loop == 0)	loop = 1;
+		for(;a<argc;a++)
+		{
+				CurFile = a;
+				NextCh	= 0;
+				err |= Replay_Load(argv[a]);
+		}
+		if(err || Frames.empty())
+		{
+				fprintf(stderr, "replay: 没有可回放的帧\n");
+				return 1;
+		}
+		std::stable_sort(Frames.begin(), Frames.end(),
+										 [](const ReplayFrameType &x, const ReplayFrameType &y) { return x.Sec < y.Sec; });
+		span = Frames.back().Sec - Frames.front().Sec;
+
+		CanSimInit();
+		for(ch=0;ch<CAN_SIM_BUS_NUM;ch++)	CanSimBus[ch].Bitrate = kbit * 1000;
+		CanSimLatencyHook = Replay_Latency;
+		open = GatewayInit();
+
+		//按路由表应转发的帧数, FD帧不转发
+		exp = 0;
+		memset(in, 0, sizeof(in));
+		for(i=0;i<Frames.size();i++)
+		{
+				in[Frames[i].Ch]++;
+				if(Frames[i].F.FD)	continue;
+				cf.ID	 = Frames[i].F.ID;
+				cf.IDE = Frames[i].F.IDE;
+				r = CANRouteLookup(Frames[i].Ch, &cf);
+				if(r)	exp += ((r->DstMask >> 0) & 1) + ((r->DstMask >> 1) & 1) + ((r->DstMask >> 2) & 1);
+		}
+
+		host	= Replay_HostSec();
+		start = CanSimNowNs();
+		end		= 0;
+		next	= 0;
+		for(;;)
+		{
+				//时刻在时间窗内的帧交给外部节点, 各总线按日志顺序发出
+				while(next < Frames.size())
+				{
+						f = Frames[next].F;
+						f.Time = (speed > 0) ? start + (uint64_t)((Frames[next].Sec - Frames[0].Sec) * 1e9 / speed) : 0;
+						if((f.Time > CanSimNowNs() + REPLAY_AHEAD_NS)||(CanSimSendFree(Frames[next].Ch) == 0))	break;
+						CanSimSend(Frames[next].Ch, &f);
+						next++;
+				}
+				CanSimAdvance(loop);
+				if(GatewayPoll())	continue;
+				if(Replay_Quiet() == 0)	continue;
+				if(next >= Frames.size())
+				{
+						//注入完且总线、网关都空闲
+						break;
+				}
+				//空闲时跳到下一帧, 按主循环周期对齐
+				t = start + (uint64_t)((Frames[next].Sec - Frames[0].Sec) * 1e9 / speed);
+				if((speed > 0)&&(t > CanSimNowNs() + REPLAY_AHEAD_NS))
+						CanSimAdvanceNs((t - REPLAY_AHEAD_NS - CanSimNowNs()) / (loop * 1000uLL) * (loop * 1000uLL));
+		}
+		for(t=0;(t<REPLAY_DRAIN_US)&&(Replay_Quiet() == 0);t+=loop)
+		{
+				CanSimAdvance(loop);
+				GatewayPoll();
+		}
+		end	 = CanSimNowNs();
+		host = Replay_HostSec() - host;
+
+		printf("replay: %u frames, %u lines skipped, %u frames on unmapped channels, log span %.3f s, ",
+					 (uint32_t)Frames.size(), Skipped, Unmapped, span);
+		if(speed > 0)	printf("speed %gx\n", speed);
+		else					printf("back-to-back\n");
+		for(i=0;i<Map.size();i++)
+		{
+				if(Map[i].Ch == 0xFF)	continue;
+				if(Map[i].File < 0)	printf("  %s -> CAN%u (-m)\n", Map[i].Name.c_str(), Map[i].Ch);
+				else								printf("  %s: %s -> CAN%u\n", argv[Map[i].File], Map[i].Name.c_str(), Map[i].Ch);
+		}
+		if(Unmapped)
+		{
+				printf("  ** 错误 %u帧所在通道超出CAN0~2, 用-m把要回放的通道接上\n", Unmapped);
+				err = 1;
+		}
+
+		drop = 0;
+		for(ch=0;ch<CAN_SIM_CH_NUM;ch++)
+		{
+				CANGetStat(ch, &st[ch], 0);
+				printf("CAN%u %u kbit/s: in %u (bus load %.1f%%), hw filtered %u, rx overrun %u, tx %u, tx reject %u\n", ch,
+							 CanSimBitrate(ch, 0) / 1000, in[ch], 100.0 * CanSimBusStat[ch].BusyNs / (double)(end - start),
+							 CanSimStat[ch].RxMiss, CANGetRxOverrun(ch), CanSimStat[ch].TxFrames, st[ch].TxReject);
+				drop += CANGetRxOverrun(ch) + st[ch].TxReject;
+				if(open & (1 << ch))	printf("  路由源ID放不进过滤表, 过滤表全放行\n");
+				if(CanSimStat[ch].RateErr || CanSimStat[ch].FormErr || CanSimStat[ch].ConfigErr)
+				{
+						printf("  ** 错误 rate %u form %u config %u\n", CanSimStat[ch].RateErr, CanSimStat[ch].FormErr,
+									 CanSimStat[ch].ConfigErr);
+						err = 1;
+				}
+		}
+
+		std::sort(Lat.begin(), Lat.end());
+		printf("forwarded %u of %llu routed, drop %u (rx overrun + tx reject), %.1f frames/s over %.3f s simulated\n",
+					 (uint32_t)Lat.size(), (unsigned long long)exp, drop, Lat.size() / ((end - start) / 1e9), (end - start) / 1e9);
+		printf("forward latency us: p50 %u  p99 %u  p999 %u  max %u\n", Replay_Pct(Lat, 500), Replay_Pct(Lat, 990),
+					 Replay_Pct(Lat, 999), Lat.empty() ? 0 : Lat.back());
+		printf("host: %.3f s, %.0f frames/s\n", host, host > 0 ? Frames.size() / host : 0.0);
+		if(limit && (Replay_Pct(Lat, 999) > limit))
+		{
+				printf("  ** p999 %u us 超过 %u us\n", Replay_Pct(Lat, 999), limit);
+				err = 1;
+		}
+		return err;
+}
@@ -0,0 +1,12 @@
+#ifndef __FTFC_SIM_S32K144_H
+#define __FTFC_SIM_S32K144_H
+
+//主机编译: 用芯片头文件, 把FTFC换成ftfcsim的寄存器模型
+#include "../../CAN_Demo-OK-2021-11-25/platform/devices/S32K144/include/S32K144.h"
+#include "ftfcsim.h"
+
+#undef	FTFC
+#define FTFC										(&FtfcSimReg)
+
+
+#endif /* __FTFC_SIM_S32K144_H */
@@ -0,0 +1,369 @@
+//用ftfcsim运行driver/下的Flash代码, 检查异步作业队列, 按虚拟时钟统计各写入方式的速度和升级、日志流程的耗时
+//编译(g++为一条命令, 分行只为排版):
+//  P=../../CAN_Demo-OK-2021-11-25
+//  g++ -O1 -Wall -x c++ -I. -I$P/driver -I$P/platform/devices/S32K144/include -I$P/platform/devices
+//      -I$P/platform/devices/S32K144/startup -DCPU_S32K144HFT0VLLT
+//      $P/driver/drvFLASH.c $P/driver/drvFlashRam.c $P/driver/drvEee.c $P/driver/drvDLog.c ftfcsim.cpp bench.cpp -o bench
+//
+//统计中Reprogram/Violation/AccErr不为0时返回1, 可在CI中检查驱动的使用规则
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "S32K144.h"
+#include "drvflash.h"
+#include "drvBoot.h"
+#include "drvEee.h"
+#include "drvDLog.h"
+#include "ftfcsim.h"
+
+//主循环一圈的时间(us)
+#define BENCH_LOOP_US						50
+//SysTick周期(us), 统计关中断执行P-Flash命令造成的中断延迟
+#define BENCH_TICK_US						1000
+
+static uint8_t	Image[BOOT_SLOT_SIZE];
+
+//drvDLog用的CRC32, 芯片上由drvBoot.c的CRC模块计算
+uint32_t BootCrc32(const uint8_t *Data, uint32_t Len)
+{
+		uint32_t	c;
+		uint8_t		k;
+
+		c = 0xFFFFFFFF;
+		while(Len--)
+		{
+				c ^= *Data++;
+				for(k=0;k<8;k++)	c = (c >> 1) ^ (0xEDB88320uL & (0 - (c & 1)));
+		}
+		return ~c;
+}
+
+//主循环一圈: 推进P-Flash作业, 其余时间由其他任务占用
+static void Bench_Loop(void)
+{
+		FlashAsyncTask();
+		FtfcSimAdvance(BENCH_LOOP_US);
+}
+
+static void Bench_Init(uint8_t Partitioned)
+{
+		FtfcSimInit(Partitioned);
+		FtfcSimTiming.Tick = BENCH_TICK_US;
+		FlashAsyncInit();
+}
+
+static uint8_t Bench_Check(const char *Name)
+{
+		printf("%-24s erase %u phrase %u section %u eee %u suspend %u irq %u  busy %.1f ms\n", Name,
+					 FtfcSimStat.Erases, FtfcSimStat.Phrases, FtfcSimStat.Sections, FtfcSimStat.EeeWrites,
+					 FtfcSimStat.Suspends, FtfcSimStat.Irqs, FtfcSimStat.BusyUs / 1000.0);
+		printf("%-24s systick %u, max latency %u us\n", "", FtfcSimStat.Ticks, FtfcSimStat.TickLatMax);
+		if(FtfcSimStat.Reprogram || FtfcSimStat.Violation || FtfcSimStat.AccErr)
+		{
+				printf("%-24s reprogram %u violation %u accerr %u\n", "  ** 错误", FtfcSimStat.Reprogram,
+							 FtfcSimStat.Violation, FtfcSimStat.AccErr);
+				return 1;
+		}
+		return 0;
+}
+
+//D-Flash按FTFC命令地址(0x800000起)操作, 读回用芯片地址(0x10000000起)
+#define BENCH_DF_CMD(a)					(0x00800000 + (a))
+#define BENCH_DF_MEM(a)					(0x10000000 + (a))
+
+//读回比较, 0: 相同
+static uint8_t Bench_Verify(uint32_t Addr, const uint8_t *Data, uint32_t Len)
+{
+		uint32_t	i;
+
+		for(i=0;i<Len;i++)
+				if(FtfcSimRead(Addr + i) != Data[i])	return 1;
+		return 0;
+}
+
+//升级时FlexNVM的状态
+#define BENCH_UPD_RAM						0			//未分区, FlexRAM为RAM: Program Section
+#define BENCH_UPD_EEE						1			//FlexRAM为EEE: 退回phrase
+#define BENCH_UPD_SETRAM				2			//同上, 下载前EeeSuspend切为RAM, 结束后EeeResume, 同CANUds编程会话
+
+static const EeeKeyType	BenchKeys[4] = { {EEE_TYPE_U32, {0}}, {EEE_TYPE_U32, {0}}, {EEE_TYPE_I32, {0}}, {EEE_TYPE_F32, {0}} };
+
+//升级: 按UDS下载的方式边擦边写一个slot, 2KB一块
+static uint8_t Bench_Update(uint8_t Mode)
+{
+		static const char	*name[3] = { "(RAM, section)", "(EEE, phrase)", "(EEE->RAM, section)" };
+		volatile uint8_t	done;
+		uint32_t	i,addr,erased;
+		uint64_t	t0,t1,tSus,tRes;
+		uint8_t		err;
+
+		Bench_Init(Mode != BENCH_UPD_RAM);
+		for(i=0;i<BOOT_SLOT_SIZE;i++)	Image[i] = (uint8_t)(i * 2654435761u >> 24);
+		err  = 0;
+		tSus = 0;
+		tRes = 0;
+		if(Mode == BENCH_UPD_SETRAM)
+		{
+				//下载前存过的值和暂停期间改的值, 恢复后都应在EEE中
+				if(EeeInit(BenchKeys, 4)||EeeSetU32(0, 0x11111111))	err = 1;
+				while(EeeBusy())
+				{
+						EeeTask();
+						Bench_Loop();
+				}
+				t1 = FtfcSimNow();
+				if(EeeSuspend()||((FTFC->FCNFG & FTFC_FCNFG_RAMRDY_MASK) == 0))	err = 1;
+				tSus = FtfcSimNow() - t1;
+				if(EeeSetU32(1, 0x22222222)||(EeeGetU32(0) != 0x11111111))	err = 1;
+		}
+
+		t0 = FtfcSimNow();
+		erased = BOOT_SLOT_B_ADDR;
+		for(addr=BOOT_SLOT_B_ADDR;addr<BOOT_SLOT_B_ADDR + BOOT_SLOT_SIZE;addr+=2048)
+		{
+				while(erased < addr + 2048)
+				{
+						while(FlashAsyncErase(erased, 0))	Bench_Loop();
+						erased += 4096;
+				}
+				while(FlashAsyncWrite(addr, 2048, &Image[addr - BOOT_SLOT_B_ADDR], &done))	Bench_Loop();
+				while(done == FLASH_JOB_PENDING)	Bench_Loop();
+		}
+		while(FlashAsyncBusy())	Bench_Loop();
+		t1 = FtfcSimNow();
+
+		for(i=0;i<BOOT_SLOT_SIZE;i++)
+				if(FtfcSimRead(BOOT_SLOT_B_ADDR + i) != Image[i])	break;
+		printf("update %-20s %u KB in %.1f ms, %.1f KB/s%s\n", name[Mode],
+					 BOOT_SLOT_SIZE / 1024, (t1 - t0) / 1000.0,
+					 BOOT_SLOT_SIZE / 1024.0 / ((t1 - t0) / 1e6), (i < BOOT_SLOT_SIZE) ? "  ** 回读不符" : "");
+
+		if(Mode == BENCH_UPD_SETRAM)
+		{
+				t1 = FtfcSimNow();
+				if(EeeResume()||((FTFC->FCNFG & FTFC_FCNFG_EEERDY_MASK) == 0))	err = 1;
+				tRes = FtfcSimNow() - t1;
+				while(EeeBusy())
+				{
+						EeeTask();
+						Bench_Loop();
+				}
+				if((*FLASH_PTR(volatile uint32_t, EEE_KEY_ADDR(0)) != 0x11111111)||
+					 (*FLASH_PTR(volatile uint32_t, EEE_KEY_ADDR(1)) != 0x22222222)||EeeError())	err = 1;
+				printf("  setram                 suspend %.2f ms, resume %.2f ms%s\n", tSus / 1000.0, tRes / 1000.0,
+							 err ? "  ** EEE内容不符" : "");
+		}
+		return Bench_Check("  flash") || (i < BOOT_SLOT_SIZE) || FlashAsyncError(1) || err;
+}
+
+//异步队列测试一次排队的作业数, 正好占满队列(FLASH_JOB_NUM-1)
+#define BENCH_ASYNC_JOBS				7
+//异步P-Flash作业的中断延迟上限(us): 擦除至少运行FLASH_ERASE_MIN_POLLS次轮询(约2ms)才挂起,
+//256字节Section约1.3ms; 同步擦除一个扇区期间一直关中断, 约12ms
+#define BENCH_IRQ_LAT_MAX_US		2500
+
+/*************************************************************************
+*  函数名称：Bench_Async
+*  功能说明：异步擦写队列: 作业按排队顺序完成, 出错作业置FAIL和错误标志且不影响后续作业,
+//	         队列满时拒绝, 队列空后关闭CCIE; 擦除可挂起和恢复; P-Flash作业期间中断延迟有上限
+*  函数返回：0：通过  1：不符
+*************************************************************************/
+static uint8_t Bench_Async(void)
+{
+		volatile uint8_t	done[BENCH_ASYNC_JOBS];
+		uint64_t	t0;
+		uint32_t	lat,sus,i;
+		uint8_t		err,k,order;
+
+		Bench_Init(0);
+		for(i=0;i<4096;i++)	Image[i] = (uint8_t)(i * 2654435761u >> 24);
+		err = 0;
+
+		//D-Flash由中断推进, P-Flash由FlashAsyncTask推进, 两者交替排队; 第5个地址不对齐, 应出错
+		err |= FlashAsyncErase(BENCH_DF_CMD(0), &done[0]);
+		err |= FlashAsyncWrite(BENCH_DF_CMD(0), 1024, Image, &done[1]);
+		err |= FlashAsyncErase(BOOT_SLOT_B_ADDR, &done[2]);
+		err |= FlashAsyncWrite(BOOT_SLOT_B_ADDR, 1000, Image, &done[3]);
+		err |= FlashAsyncErase(BENCH_DF_CMD(0x100), &done[4]);
+		err |= FlashAsyncWrite(BENCH_DF_CMD(1024), 72, &Image[1024], &done[5]);
+		err |= FlashAsyncErase(BENCH_DF_CMD(2048), &done[6]);
+		//执行中的作业仍占队列一格, 可排FLASH_JOB_NUM-1个
+		if(FlashAsyncErase(BENCH_DF_CMD(4096), 0) == 0)	err = 1;
+
+		order = 1;
+		while(FlashAsyncBusy())
+		{
+				Bench_Loop();
+				for(k=1;k<BENCH_ASYNC_JOBS;k++)
+						if((done[k] != FLASH_JOB_PENDING)&&(done[k-1] == FLASH_JOB_PENDING))	order = 0;
+		}
+		for(k=0;k<BENCH_ASYNC_JOBS;k++)
+				if(done[k] != ((k == 4) ? FLASH_JOB_FAIL : FLASH_JOB_OK))	err = 1;
+		if((FlashAsyncError(1) == 0)||FlashAsyncError(0))	err = 1;
+		if(Bench_Verify(BENCH_DF_MEM(0), Image, 1024)||Bench_Verify(BENCH_DF_MEM(1024), &Image[1024], 72)||
+			 Bench_Verify(BOOT_SLOT_B_ADDR, Image, 1000)||(FtfcSimRead(BOOT_SLOT_B_ADDR + 1000) != 0xFF))	err = 1;
+		if(FTFC->FCNFG & FTFC_FCNFG_CCIE_MASK)	err = 1;
+		//不对齐的擦除是有意的, 不计入驱动违规
+		if(FtfcSimStat.AccErr == 1)	FtfcSimStat.AccErr = 0;
+		else	err = 1;
+		printf("async queue: %u jobs%s%s\n", BENCH_ASYNC_JOBS, order ? "" : "  ** 完成顺序不符",
+					 err ? "  ** 作业结果不符" : "");
+
+		//D-Flash擦除中途挂起: FTFC随即空闲, 挂起期间扇区不变, 恢复后擦完
+		k = 0;
+		if(FlashAsyncErase(BENCH_DF_CMD(0), &done[0]))	k = 1;
+		FtfcSimAdvance(FtfcSimTiming.EraseSector / 4);
+		sus = FtfcSimStat.Suspends;
+		t0 = FtfcSimNow();
+		FlashEraseSuspend();
+		lat = (uint32_t)(FtfcSimNow() - t0);
+		if(FtfcSimBusy()||(FtfcSimStat.Suspends != sus + 1)||(FtfcSimRead(BENCH_DF_MEM(0)) != Image[0]))	k = 1;
+		FtfcSimAdvance(FtfcSimTiming.EraseSector * 2);
+		if((done[0] != FLASH_JOB_PENDING)||(FtfcSimRead(BENCH_DF_MEM(0)) != Image[0]))	k = 1;
+		FlashEraseResume();
+		while(FlashAsyncBusy())	Bench_Loop();
+		if((done[0] != FLASH_JOB_OK)||(FtfcSimRead(BENCH_DF_MEM(0)) != 0xFF)||(FtfcSimRead(BENCH_DF_MEM(2047)) != 0xFF))	k = 1;
+		printf("async suspend: erase parked in %u us%s\n", lat, k ? "  ** 挂起/恢复不符" : "");
+		err |= k;
+
+		//SysTick延迟: 同步擦除关中断到擦完, 异步擦除有中断挂起即让出
+		FtfcSimStat.TickLatMax = 0;
+		FLASH_Erase_OneSector(BOOT_SLOT_B_ADDR);
+		FtfcSimAdvance(BENCH_LOOP_US);
+		lat = FtfcSimStat.TickLatMax;
+		FtfcSimStat.TickLatMax = 0;
+		for(i=0;i<4;i++)
+				while(FlashAsyncErase(BOOT_SLOT_B_ADDR + i * 4096, 0))	Bench_Loop();
+		while(FlashAsyncWrite(BOOT_SLOT_B_ADDR, 4096, Image, &done[0]))	Bench_Loop();
+		while(FlashAsyncBusy())	Bench_Loop();
+		k = (FtfcSimStat.TickLatMax > BENCH_IRQ_LAT_MAX_US)||(done[0] != FLASH_JOB_OK)||Bench_Verify(BOOT_SLOT_B_ADDR, Image, 4096);
+		printf("async irq latency: sync erase %u us, async erase+write %u us (limit %u)%s\n", lat,
+					 FtfcSimStat.TickLatMax, BENCH_IRQ_LAT_MAX_US, k ? "  ** 超过上限" : "");
+		err |= k;
+		return Bench_Check("  flash") || err;
+}
+
+//同步写入各方式的测试长度: P-Flash 32KB, D-Flash 8KB
+#define BENCH_WR_PF_BYTES				0x8000
+#define BENCH_WR_DF_BYTES				0x2000
+
+//擦除后按Mode写入一段, 返回写入耗时(us), 读回不符时*Err置1
+#define BENCH_WR_PHRASE					0			//每8字节一条Program Phrase, 原Flash_Write_1024B的做法
+#define BENCH_WR_SECTION				1			//Flash_Write_Section
+static uint64_t Bench_WriteOne(uint8_t Mode, uint32_t Cmd, uint32_t Mem, uint32_t Len, uint8_t *Err)
+{
+		uint64_t	t0;
+		uint32_t	i,sector;
+
+		sector = FLASH_IS_PFLASH(Cmd) ? 4096 : 2048;
+		for(i=0;i<Len;i+=sector)
+				if(FLASH_Erase_OneSector(Cmd + i))	*Err = 1;
+		t0 = FtfcSimNow();
+		if(Mode == BENCH_WR_PHRASE)
+		{
+				for(i=0;i<Len;i+=8)
+				{
+						Flash_Write(Cmd + i, 8, &Image[i]);
+						if(FTFC->FSTAT & FLASH_ERR_MASK)	*Err = 1;
+				}
+		}
+		else if(Flash_Write_Section(Cmd, Len, Image))	*Err = 1;
+		t0 = FtfcSimNow() - t0;
+		if(Bench_Verify(Mem, Image, Len))	*Err = 1;
+		return t0;
+}
+
+/*************************************************************************
+*  函数名称：Bench_Write
+*  功能说明：同步写入的速度: phrase与Program Section各写P-Flash和D-Flash, 输出字节/秒;
+//	         不对齐的头尾按phrase写入, 最后不足8字节补0xFF
+*  函数返回：0：通过  1：不符
+*************************************************************************/
+static uint8_t Bench_Write(void)
+{
+		static const char	*name[2] = { "phrase", "section" };
+		static const uint32_t	len[2] = { BENCH_WR_PF_BYTES, BENCH_WR_DF_BYTES };
+		uint64_t	us;
+		uint8_t		err,e,m,b;
+
+		Bench_Init(0);
+		for(us=0;us<BENCH_WR_PF_BYTES;us++)	Image[us] = (uint8_t)(us * 2654435761u >> 24);
+		err = 0;
+		for(b=0;b<2;b++)
+		{
+				for(m=BENCH_WR_PHRASE;m<=BENCH_WR_SECTION;m++)
+				{
+						e = 0;
+						us = Bench_WriteOne(m, b ? BENCH_DF_CMD(0) : BOOT_SLOT_B_ADDR, b ? BENCH_DF_MEM(0) : BOOT_SLOT_B_ADDR,
+																len[b], &e);
+						printf("write %-7s %-8s %2u KB in %6.1f ms, %8.0f B/s%s\n", b ? "D-Flash" : "P-Flash", name[m],
+									 len[b] / 1024, us / 1000.0, len[b] / (us / 1e6), e ? "  ** 回读不符" : "");
+						err |= e;
+				}
+		}
+
+		//头8字节、尾5字节不对齐
+		e = 0;
+		if(FLASH_Erase_OneSector(BOOT_SLOT_B_ADDR)||Flash_Write_Section(BOOT_SLOT_B_ADDR + 8, 1013, Image)||
+			 Bench_Verify(BOOT_SLOT_B_ADDR + 8, Image, 1013))	e = 1;
+		for(m=0;m<8;m++)
+				if((FtfcSimRead(BOOT_SLOT_B_ADDR + m) != 0xFF)||(FtfcSimRead(BOOT_SLOT_B_ADDR + 1021 + m) != 0xFF))	e = 1;
+		printf("write unaligned head/tail%s\n", e ? "  ** 回读不符" : "");
+		return Bench_Check("  flash") || err || e;
+}
+
+//日志和标定参数: 每圈追加一条记录, 每16圈改一个EEE键
+static uint8_t Bench_Log(uint32_t Num)
+{
+		uint8_t		dat[DLOG_DATA_MAX],len;
+		uint32_t	i,n,rej;
+		uint64_t	t0;
+
+		Bench_Init(0);
+		t0 = FtfcSimNow();
+		if(EeeInit(BenchKeys, 4)||DLogInit())
+		{
+				printf("log: 初始化失败\n");
+				return 1;
+		}
+		printf("log init (partition): %.1f ms\n", (FtfcSimNow() - t0) / 1000.0);
+
+		t0 = FtfcSimNow();
+		rej = 0;
+		for(i=0,n=0;n<Num;i++)
+		{
+				memset(dat, (uint8_t)n, sizeof(dat));
+				if(DLogAppend((uint16_t)(n % DLOG_KEY_MAX), dat, (uint8_t)(8 + n % 24)) == 0)	n++;
+				else	rej++;
+				if((i & 15) == 0)	EeeSetU32((uint16_t)(i & 3), i);
+				DLogTask();
+				EeeTask();
+				Bench_Loop();
+		}
+		while(FlashAsyncBusy()||EeeBusy())
+		{
+				DLogTask();
+				EeeTask();
+				Bench_Loop();
+		}
+		n = 0;
+		if(DLogRead((uint16_t)((Num - 1) % DLOG_KEY_MAX), dat, &len)||(dat[0] != (uint8_t)(Num - 1)))	n = 1;
+		printf("log: %u appends in %.1f ms, %.1f us/append, %u deferred, free sectors %u%s\n", Num,
+					 (FtfcSimNow() - t0) / 1000.0, (double)(FtfcSimNow() - t0) / Num, rej, DLogFreeSectors(),
+					 n ? "  ** 读出不符" : "");
+		return Bench_Check("  flash") || n || DLogError() || EeeError();
+}
+
+int main(void)
+{
+		uint8_t	err;
+
+		err  = Bench_Async();
+		err |= Bench_Write();
+		err |= Bench_Update(BENCH_UPD_RAM);
+		err |= Bench_Update(BENCH_UPD_EEE);
+		err |= Bench_Update(BENCH_UPD_SETRAM);
+		err |= Bench_Log(20000);
+		return err;
+}
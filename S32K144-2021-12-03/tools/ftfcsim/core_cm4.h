@@ -0,0 +1,38 @@
+#ifndef __FTFC_SIM_CORE_CM4_H
+#define __FTFC_SIM_CORE_CM4_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//主机编译用的CMSIS子集: 中断屏蔽和FTFC中断使能交给ftfcsim, 其余为空操作
+#define __I											volatile const
+#define __O											volatile
+#define __IO										volatile
+#define __IM										volatile const
+#define __OM										volatile
+#define __IOM										volatile
+#define __STATIC_INLINE					static inline
+#define __ASM										__asm__
+
+extern uint32_t	FtfcSimPrimask;
+extern uint8_t	FtfcSimIrqOn;
+void						FtfcSimIrqCheck(void);
+
+static inline uint32_t __get_PRIMASK(void)				{ return FtfcSimPrimask; }
+static inline void __set_PRIMASK(uint32_t Mask)		{ FtfcSimPrimask = Mask & 1; FtfcSimIrqCheck(); }
+static inline void __disable_irq(void)						{ FtfcSimPrimask = 1; }
+static inline void __enable_irq(void)							{ FtfcSimPrimask = 0; FtfcSimIrqCheck(); }
+static inline void __DSB(void)										{}
+static inline void __ISB(void)										{}
+static inline void __NOP(void)										{}
+static inline void __WFI(void)										{}
+static inline uint32_t __REV(uint32_t v)					{ return __builtin_bswap32(v); }
+
+static inline void NVIC_EnableIRQ(IRQn_Type n)			{ if(n == FTFC_IRQn)	FtfcSimIrqOn = 1; }
+static inline void NVIC_DisableIRQ(IRQn_Type n)			{ if(n == FTFC_IRQn)	FtfcSimIrqOn = 0; }
+static inline void NVIC_ClearPendingIRQ(IRQn_Type n)	{ (void)n; }
+static inline void NVIC_SetPriority(IRQn_Type n, uint32_t p)	{ (void)n; (void)p; }
+static inline void NVIC_SystemReset(void)						{ fprintf(stderr, "ftfcsim: NVIC_SystemReset\n"); }
+
+
+#endif /* __FTFC_SIM_CORE_CM4_H */
@@ -0,0 +1,2 @@
+//driver/下的源文件以 drvflash.h 包含 drvFlash.h (Keil/Windows不区分大小写)
+#include "drvFlash.h"
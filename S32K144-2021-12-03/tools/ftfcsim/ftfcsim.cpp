@@ -0,0 +1,610 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "S32K144.h"
+#include "ftfcsim.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE			MAP_FIXED
+#endif
+
+#define SIM_PF_BYTES						0x80000
+#define SIM_PF_SECTOR						4096
+#define SIM_PF_UNIT							16						//Program Section/Read 1s Section单位
+#define SIM_DF_CMD_BASE					0x800000
+#define SIM_DF_ADDR							0x10000000
+#define SIM_DF_BYTES						0x10000
+#define SIM_DF_SECTOR						2048
+#define SIM_DF_UNIT							8
+#define SIM_RAM_ADDR						0x14000000
+#define SIM_RAM_BYTES						4096
+#define SIM_DEPART_NONE					0x0F
+#define SIM_EEESIZE_NONE				0x0F
+
+#define SIM_CMD_RD1BLK					0x00
+#define SIM_CMD_RD1SEC					0x01
+#define SIM_CMD_PGMCHK					0x02
+#define SIM_CMD_PGM8						0x07
+#define SIM_CMD_ERSSCR					0x09
+#define SIM_CMD_PGMSEC					0x0B
+#define SIM_CMD_PGMPART					0x80
+#define SIM_CMD_SETRAM					0x81
+#define SIM_CMD_EEE							0xEE					//内部: EEE写一个字
+
+typedef	struct
+{
+			uint8_t		*PFlash;
+			uint8_t		*DFlash;
+			uint8_t		*FlexRam;
+			uint8_t		EeeImg[SIM_RAM_BYTES];		//EEE备份区中的有效数据
+			uint8_t		EeeSeen[SIM_RAM_BYTES];		//上次检查时FlexRAM的内容
+			uint8_t		PfMapped;
+
+			uint8_t		Depart;
+			uint8_t		EeeSize;
+			uint8_t		EeeMode;
+
+			uint64_t	Now;
+			uint8_t		Busy;
+			uint8_t		Cmd;
+			uint32_t	Addr;
+			uint32_t	Len;
+			uint64_t	StartUs;
+			uint64_t	EndUs;
+			uint8_t		Fccob[12];
+			uint8_t		Data[SIM_RAM_BYTES];			//Program Section启动时FlexRAM中的数据
+			uint8_t		SuspendReq;
+
+			uint8_t		Suspended;
+			uint32_t	SuspAddr;
+			uint64_t	SuspRemain;
+
+			uint8_t		InIrq;
+			uint64_t	NextTick;
+			uint64_t	TickAt;						//SysTick挂起的时刻
+
+}		FtfcSimStateType;
+
+FtfcSimRegType			FtfcSimReg;
+FtfcSimTimingType		FtfcSimTiming;
+FtfcSimStatType			FtfcSimStat;
+uint32_t						FtfcSimPrimask;
+uint8_t							FtfcSimIrqOn;
+
+static FtfcSimStateType	Sim;
+
+
+//映射到Addr, 返回1为成功; P-Flash在地址0, 不能以空指针表示失败
+static uint8_t Sim_Map(uintptr_t Addr, size_t Len)
+{
+		void	*p;
+
+		p = mmap((void *)Addr, Len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		return ((p != MAP_FAILED)&&(p == (void *)Addr)) ? 1 : 0;
+}
+
+//FTFC命令地址转换为模型中的存储器, Len字节须在同一块内
+static uint8_t *Sim_Mem(uint32_t Addr, uint32_t Len, uint32_t *Sector, uint32_t *Unit)
+{
+		uint32_t	df;
+
+		df = 0;
+		if(Sim.Depart != SIM_DEPART_NONE)
+		{
+				if(Sim.Depart == 0x03)	df = 0x8000;
+				else if(Sim.Depart == 0x00)	df = SIM_DF_BYTES;
+		}
+		else	df = SIM_DF_BYTES;
+
+		if((Addr < SIM_PF_BYTES)&&(Len <= SIM_PF_BYTES - Addr))
+		{
+				*Sector = SIM_PF_SECTOR;
+				*Unit		= SIM_PF_UNIT;
+				return Sim.PFlash + Addr;
+		}
+		if((Addr >= SIM_DF_CMD_BASE)&&(Addr - SIM_DF_CMD_BASE < df)&&(Len <= df - (Addr - SIM_DF_CMD_BASE)))
+		{
+				*Sector = SIM_DF_SECTOR;
+				*Unit		= SIM_DF_UNIT;
+				return Sim.DFlash + (Addr - SIM_DF_CMD_BASE);
+		}
+		return 0;
+}
+
+static void Sim_Fcfg1(void)
+{
+		SIM->FCFG1 = SIM_FCFG1_DEPART(Sim.Depart) | SIM_FCFG1_EEERAMSIZE(Sim.EeeSize);
+}
+
+static void Sim_RamMode(uint8_t Eee)
+{
+		Sim.EeeMode = Eee;
+		FtfcSimReg.FCNFG.v &= (uint8_t)~(FTFC_FCNFG_RAMRDY_MASK | FTFC_FCNFG_EEERDY_MASK);
+		if(Eee)
+		{
+				memcpy(Sim.FlexRam, Sim.EeeImg, SIM_RAM_BYTES);
+				memcpy(Sim.EeeSeen, Sim.EeeImg, SIM_RAM_BYTES);
+				FtfcSimReg.FCNFG.v |= FTFC_FCNFG_EEERDY_MASK;
+		}
+		else	FtfcSimReg.FCNFG.v |= FTFC_FCNFG_RAMRDY_MASK;
+}
+
+static void Sim_Fail(void)
+{
+		FtfcSimReg.FSTAT.v |= FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_CCIF_MASK;
+		FtfcSimStat.AccErr++;
+		Sim.Busy = 0;
+}
+
+static void Sim_Start(uint32_t Us)
+{
+		Sim.Busy		= 1;
+		Sim.StartUs = Sim.Now;
+		Sim.EndUs		= Sim.Now + (Us ? Us : 1);
+		memcpy(Sim.Fccob, FtfcSimReg.FCCOB, sizeof(Sim.Fccob));
+}
+
+//EEE模式下FlexRAM被改写即启动EEE写入, 命令执行中改写为违规
+static void Sim_EeeScan(void)
+{
+		uint32_t	i;
+
+		if(Sim.EeeMode == 0)	return;
+		for(i=0;i<SIM_RAM_BYTES;i+=4)
+		{
+				if(memcmp(&Sim.FlexRam[i], &Sim.EeeSeen[i], 4) == 0)	continue;
+				memcpy(&Sim.EeeSeen[i], &Sim.FlexRam[i], 4);
+				if(Sim.Busy)
+				{
+						FtfcSimStat.Violation++;
+						continue;
+				}
+				Sim.Cmd	 = SIM_CMD_EEE;
+				Sim.Addr = i;
+				FtfcSimReg.FSTAT.v &= (uint8_t)~FTFC_FSTAT_CCIF_MASK;
+				Sim_Start(FtfcSimTiming.EeeWrite);
+		}
+}
+
+static void Sim_Launch(void)
+{
+		uint32_t	sector,unit,n,i;
+		uint8_t		*m;
+
+		Sim.Cmd  = FtfcSimReg.FCCOB[3];
+		Sim.Addr = ((uint32_t)FtfcSimReg.FCCOB[2] << 16) | ((uint32_t)FtfcSimReg.FCCOB[1] << 8) | FtfcSimReg.FCCOB[0];
+		FtfcSimReg.FSTAT.v &= (uint8_t)~FTFC_FSTAT_CCIF_MASK;
+		n = ((uint32_t)FtfcSimReg.FCCOB[7] << 8) | FtfcSimReg.FCCOB[6];
+		Sim.SuspendReq = 0;
+
+		switch(Sim.Cmd)
+		{
+				case SIM_CMD_RD1BLK:
+						if(Sim_Mem(Sim.Addr, 1, &sector, &unit) == 0)	{ Sim_Fail(); return; }
+						Sim_Start(FtfcSimTiming.Read1sBlock);
+						return;
+
+				case SIM_CMD_RD1SEC:
+						m = 0;
+						if(Sim_Mem(Sim.Addr, 1, &sector, &unit))	m = Sim_Mem(Sim.Addr, n * unit, &sector, &unit);
+						if((m == 0)||(n == 0)||(Sim.Addr & (unit - 1)))	{ Sim_Fail(); return; }
+						Sim.Len = n * unit;
+						Sim_Start((uint32_t)((uint64_t)FtfcSimTiming.Read1sSection1K * Sim.Len / 1024));
+						return;
+
+				case SIM_CMD_PGMCHK:
+						if((Sim_Mem(Sim.Addr, 4, &sector, &unit) == 0)||(Sim.Addr & 3))	{ Sim_Fail(); return; }
+						Sim_Start(FtfcSimTiming.ProgramCheck);
+						return;
+
+				case SIM_CMD_PGM8:
+						if((Sim_Mem(Sim.Addr, 8, &sector, &unit) == 0)||(Sim.Addr & 7))	{ Sim_Fail(); return; }
+						Sim_Start(FtfcSimTiming.Phrase);
+						return;
+
+				case SIM_CMD_ERSSCR:
+						if((Sim_Mem(Sim.Addr, 1, &sector, &unit) == 0)||(Sim.Addr & (sector - 1)))	{ Sim_Fail(); return; }
+						if(Sim.Suspended && (Sim.SuspAddr == Sim.Addr))
+						{
+								Sim.Suspended = 0;
+								Sim_Start((uint32_t)Sim.SuspRemain);
+								return;
+						}
+						Sim.Suspended = 0;
+						Sim_Start(FtfcSimTiming.EraseSector);
+						return;
+
+				case SIM_CMD_PGMSEC:
+						m = 0;
+						if(Sim_Mem(Sim.Addr, 1, &sector, &unit))	m = Sim_Mem(Sim.Addr, n * unit, &sector, &unit);
+						if((m == 0)||(n == 0)||(Sim.Addr & (unit - 1))||(n * unit > SIM_RAM_BYTES)||
+							 ((FtfcSimReg.FCNFG.v & FTFC_FCNFG_RAMRDY_MASK) == 0))
+						{
+								Sim_Fail();
+								return;
+						}
+						Sim.Len = n * unit;
+						memcpy(Sim.Data, Sim.FlexRam, Sim.Len);
+						Sim_Start((uint32_t)((uint64_t)FtfcSimTiming.Section1K * Sim.Len / 1024));
+						return;
+
+				case SIM_CMD_PGMPART:
+						i = FtfcSimReg.FCCOB[6];
+						n = FtfcSimReg.FCCOB[7];
+						if((Sim.Depart != SIM_DEPART_NONE)||((i != 0x00)&&(i != 0x03)&&(i != 0x04)&&(i != 0x08))||
+							 ((n != 0x02)&&(n != 0x03)&&(n != 0x04)&&(n != SIM_EEESIZE_NONE)))
+						{
+								Sim_Fail();
+								return;
+						}
+						Sim_Start(FtfcSimTiming.PgmPart);
+						return;
+
+				case SIM_CMD_SETRAM:
+						if((FtfcSimReg.FCCOB[2] != 0xFF)&&
+							 ((FtfcSimReg.FCCOB[2] != 0x00)||(Sim.Depart == SIM_DEPART_NONE)||(Sim.EeeSize == SIM_EEESIZE_NONE)))
+						{
+								Sim_Fail();
+								return;
+						}
+						Sim_Start(FtfcSimTiming.SetRam);
+						return;
+
+				default:
+						Sim_Fail();
+						return;
+		}
+}
+
+//命令完成, Frac<1时为掉电打断, 擦除和写入只完成前一部分
+static void Sim_Finish(double Frac)
+{
+		uint32_t	sector,unit,i,n;
+		uint8_t		*m;
+
+		Sim.Busy = 0;
+		FtfcSimStat.BusyUs += Sim.Now - Sim.StartUs;
+		if(memcmp(Sim.Fccob, FtfcSimReg.FCCOB, sizeof(Sim.Fccob))&&(Sim.Cmd != SIM_CMD_EEE))	FtfcSimStat.Violation++;
+
+		switch(Sim.Cmd)
+		{
+				case SIM_CMD_RD1BLK:
+						n = (Sim.Addr >= SIM_DF_CMD_BASE) ? SIM_DF_BYTES : SIM_PF_BYTES;
+						m = (Sim.Addr >= SIM_DF_CMD_BASE) ? Sim.DFlash : Sim.PFlash;
+						for(i=0;i<n;i++)	if(m[i] != 0xFF)	break;
+						if(i < n)	FtfcSimReg.FSTAT.v |= FTFC_FSTAT_MGSTAT0_MASK;
+						FtfcSimStat.Verifies++;
+						break;
+
+				case SIM_CMD_RD1SEC:
+						m = Sim_Mem(Sim.Addr, Sim.Len, &sector, &unit);
+						for(i=0;i<Sim.Len;i++)	if(m[i] != 0xFF)	break;
+						if(i < Sim.Len)	FtfcSimReg.FSTAT.v |= FTFC_FSTAT_MGSTAT0_MASK;
+						FtfcSimStat.Verifies++;
+						break;
+
+				case SIM_CMD_PGMCHK:
+						m = Sim_Mem(Sim.Addr, 4, &sector, &unit);
+						if(memcmp(m, &Sim.Fccob[8], 4))	FtfcSimReg.FSTAT.v |= FTFC_FSTAT_MGSTAT0_MASK;
+						FtfcSimStat.Verifies++;
+						break;
+
+				case SIM_CMD_PGM8:
+						m = Sim_Mem(Sim.Addr, 8, &sector, &unit);
+						n = (Frac < 1.0) ? 4 : 8;
+						for(i=0;i<8;i++)
+						{
+								if(m[i] != 0xFF)
+								{
+										FtfcSimReg.FSTAT.v |= FTFC_FSTAT_MGSTAT0_MASK;
+										FtfcSimStat.Reprogram++;
+										break;
+								}
+						}
+						for(i=0;i<n;i++)	m[i] &= Sim.Fccob[4+i];
+						FtfcSimStat.Phrases++;
+						break;
+
+				case SIM_CMD_ERSSCR:
+						m = Sim_Mem(Sim.Addr, 1, &sector, &unit);
+						if(Sim.SuspendReq && (Frac >= 1.0))
+						{
+								Sim.Suspended	 = 1;
+								Sim.SuspAddr	 = Sim.Addr;
+								FtfcSimStat.Suspends++;
+								break;
+						}
+						memset(m, 0xFF, (uint32_t)(sector * Frac));
+						if(Frac >= 1.0)
+						{
+								FtfcSimReg.FCNFG.v &= (uint8_t)~FTFC_FCNFG_ERSSUSP_MASK;
+								FtfcSimStat.Erases++;
+						}
+						break;
+
+				case SIM_CMD_PGMSEC:
+						m = Sim_Mem(Sim.Addr, Sim.Len, &sector, &unit);
+						n = (uint32_t)(Sim.Len * Frac) & ~(unit - 1);
+						for(i=0;i<Sim.Len;i++)
+						{
+								if(m[i] != 0xFF)
+								{
+										FtfcSimReg.FSTAT.v |= FTFC_FSTAT_MGSTAT0_MASK;
+										FtfcSimStat.Reprogram++;
+										break;
+								}
+						}
+						for(i=0;i<n;i++)	m[i] &= Sim.Data[i];
+						if(memcmp(Sim.Data, Sim.FlexRam, Sim.Len))	FtfcSimStat.Violation++;
+						FtfcSimStat.Sections++;
+						break;
+
+				case SIM_CMD_PGMPART:
+						if(Frac < 1.0)	break;
+						Sim.Depart	= Sim.Fccob[6];
+						Sim.EeeSize = Sim.Fccob[7];
+						memset(Sim.EeeImg, 0xFF, SIM_RAM_BYTES);
+						memset(Sim.DFlash, 0xFF, SIM_DF_BYTES);
+						Sim_Fcfg1();
+						break;
+
+				case SIM_CMD_SETRAM:
+						if(Frac < 1.0)	break;
+						Sim_RamMode(Sim.Fccob[2] == 0x00);
+						break;
+
+				case SIM_CMD_EEE:
+						//EEE写入掉电时保留旧值
+						if(Frac < 1.0)	break;
+						memcpy(&Sim.EeeImg[Sim.Addr], &Sim.EeeSeen[Sim.Addr], 4);
+						FtfcSimStat.EeeWrites++;
+						break;
+		}
+		FtfcSimReg.FSTAT.v |= FTFC_FSTAT_CCIF_MASK;
+}
+
+//到达SysTick周期时置挂起, 未响应的不重复计
+static void Sim_Tick(void)
+{
+		if((FtfcSimTiming.Tick == 0)||(Sim.Now < Sim.NextTick))	return;
+		if((S32_SCB->ICSR & S32_SCB_ICSR_PENDSTSET_MASK) == 0)
+		{
+				S32_SCB->ICSR |= S32_SCB_ICSR_PENDSTSET_MASK;
+				Sim.TickAt = Sim.NextTick;
+		}
+		Sim.NextTick += ((Sim.Now - Sim.NextTick) / FtfcSimTiming.Tick + 1) * FtfcSimTiming.Tick;
+}
+
+//未关中断时响应挂起的SysTick
+static void Sim_TickIrq(void)
+{
+		if((FtfcSimPrimask == 0)&&(S32_SCB->ICSR & S32_SCB_ICSR_PENDSTSET_MASK))
+		{
+				S32_SCB->ICSR &= ~S32_SCB_ICSR_PENDSTSET_MASK;
+				FtfcSimStat.Ticks++;
+				if(Sim.Now - Sim.TickAt > FtfcSimStat.TickLatMax)	FtfcSimStat.TickLatMax = (uint32_t)(Sim.Now - Sim.TickAt);
+		}
+}
+
+//时钟推进到To, 期间完成的命令置CCIF
+static void Sim_Run(uint64_t To)
+{
+		Sim_EeeScan();
+		if(Sim.Busy && (Sim.EndUs <= To))
+		{
+				if(Sim.Now < Sim.EndUs)	Sim.Now = Sim.EndUs;
+				Sim_Finish(1.0);
+		}
+		if(Sim.Now < To)	Sim.Now = To;
+		Sim_Tick();
+}
+
+
+
+FtfcSimFstat &FtfcSimFstat::operator=(uint8_t x)
+{
+		Sim_EeeScan();
+		v &= (uint8_t)~(x & (FTFC_FSTAT_RDCOLERR_MASK | FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK));
+		if(x & FTFC_FSTAT_CCIF_MASK)
+		{
+				if(Sim.Busy)	FtfcSimStat.Violation++;
+				else
+				{
+						v &= (uint8_t)~FTFC_FSTAT_MGSTAT0_MASK;
+						if(v & (FTFC_FSTAT_ACCERR_MASK | FTFC_FSTAT_FPVIOL_MASK))	FtfcSimStat.Violation++;
+						else	Sim_Launch();
+				}
+		}
+		return *this;
+}
+
+FtfcSimFstat::operator uint8_t() const
+{
+		Sim_EeeScan();
+		if(Sim.Busy)	Sim_Run(Sim.Now + FtfcSimTiming.Poll);
+		Sim_TickIrq();
+		return FtfcSimReg.FSTAT.v;
+}
+
+FtfcSimFcnfg &FtfcSimFcnfg::operator=(uint8_t x)
+{
+		uint8_t	ro;
+
+		Sim_EeeScan();
+		ro = FTFC_FCNFG_RAMRDY_MASK | FTFC_FCNFG_EEERDY_MASK;
+		v = (uint8_t)((v & ro) | (x & ~ro));
+		//擦除执行中置ERSSUSP, Suspend时间后挂起, 剩余时间留待恢复
+		if((x & FTFC_FCNFG_ERSSUSP_MASK)&&Sim.Busy && (Sim.Cmd == SIM_CMD_ERSSCR)&&(Sim.SuspendReq == 0))
+		{
+				Sim.SuspendReq = 1;
+				if(Sim.EndUs > Sim.Now + FtfcSimTiming.Suspend)
+				{
+						Sim.SuspRemain = Sim.EndUs - (Sim.Now + FtfcSimTiming.Suspend);
+						Sim.EndUs = Sim.Now + FtfcSimTiming.Suspend;
+				}
+				else	Sim.SuspendReq = 0;
+		}
+		return *this;
+}
+
+FtfcSimFcnfg::operator uint8_t() const
+{
+		Sim_EeeScan();
+		return FtfcSimReg.FCNFG.v;
+}
+
+
+
+/*************************************************************************
+*  函数名称：FtfcSimInit
+*  功能说明：映射存储器, 全部擦除, 寄存器复位, 虚拟时钟清零
+*  参数说明：Partitioned：0:FlexNVM未分区  1:已按drvEee.h分区(32KB D-Flash, 4KB EEE)
+*************************************************************************/
+void FtfcSimInit(uint8_t Partitioned)
+{
+		static uint8_t	mapped;
+
+		if(mapped == 0)
+		{
+				Sim.PfMapped = Sim_Map(0, SIM_PF_BYTES);
+				Sim.PFlash	 = (uint8_t *)(uintptr_t)0;
+				if(Sim.PfMapped == 0)
+				{
+						Sim.PFlash = (uint8_t *)malloc(SIM_PF_BYTES);
+						fprintf(stderr, "ftfcsim: P-Flash未映射到地址0 (vm.mmap_min_addr), 用FtfcSimRead读取\n");
+				}
+				Sim.DFlash	= (uint8_t *)(uintptr_t)SIM_DF_ADDR;
+				Sim.FlexRam = (uint8_t *)(uintptr_t)SIM_RAM_ADDR;
+				if((Sim_Map(SIM_DF_ADDR, SIM_DF_BYTES) == 0)||(Sim_Map(SIM_RAM_ADDR, SIM_RAM_BYTES) == 0)||
+					 (Sim_Map(SIM_BASE & ~0xFFFu, 0x1000) == 0)||
+					 (Sim_Map(LMEM_BASE & ~0xFFFu, 0x1000) == 0)||(Sim_Map(MSCM_BASE & ~0xFFFu, 0x1000) == 0)||
+					 (Sim_Map(S32_SCB_BASE & ~0xFFFu, 0x1000) == 0))
+				{
+						fprintf(stderr, "ftfcsim: 存储器映射失败\n");
+						exit(1);
+				}
+				mapped = 1;
+		}
+		memset(&Sim.Depart, 0, sizeof(Sim) - ((uint8_t *)&Sim.Depart - (uint8_t *)&Sim));
+		memset(Sim.PFlash, 0xFF, SIM_PF_BYTES);
+		memset(Sim.DFlash, 0xFF, SIM_DF_BYTES);
+		memset(Sim.FlexRam, 0x00, SIM_RAM_BYTES);
+		memset(Sim.EeeImg, 0xFF, SIM_RAM_BYTES);
+
+		FtfcSimTiming.EraseSector			= 12000;
+		FtfcSimTiming.Phrase					= 90;
+		FtfcSimTiming.Section1K				= 5000;
+		FtfcSimTiming.Read1sSection1K = 60;
+		FtfcSimTiming.Read1sBlock			= 2000;
+		FtfcSimTiming.ProgramCheck		= 95;
+		FtfcSimTiming.Suspend					= 25;
+		FtfcSimTiming.PgmPart					= 70000;
+		FtfcSimTiming.SetRam					= 1500;
+		FtfcSimTiming.EeeWrite				= 385;
+		FtfcSimTiming.Poll						= 1;
+		FtfcSimTiming.Tick						= 0;
+		memset(&FtfcSimStat, 0, sizeof(FtfcSimStat));
+		memset(&FtfcSimReg, 0, sizeof(FtfcSimReg));
+
+		S32_SCB->ICSR = 0;
+		Sim.NextTick = 0;
+		Sim.Depart	= Partitioned ? 0x03 : SIM_DEPART_NONE;
+		Sim.EeeSize = Partitioned ? 0x02 : SIM_EEESIZE_NONE;
+		FtfcSimPowerLoss();
+}
+
+uint64_t FtfcSimNow(void)
+{
+		return Sim.Now;
+}
+
+uint8_t FtfcSimBusy(void)
+{
+		Sim_EeeScan();
+		return Sim.Busy;
+}
+
+/*************************************************************************
+*  函数名称：FtfcSimAdvance
+*  功能说明：虚拟时钟前进Us微秒, 代表主循环中其他工作的时间;
+//	         命令完成且CCIE打开、未关中断时进入FTFC_IRQHandler
+*************************************************************************/
+void FtfcSimAdvance(uint32_t Us)
+{
+		uint64_t	to;
+
+		to = Sim.Now + Us;
+		do
+		{
+				Sim_Run((FtfcSimTiming.Tick && (Sim.NextTick < to)) ? Sim.NextTick : to);
+				FtfcSimIrqCheck();
+		}	while((Sim.Busy && (Sim.EndUs <= to))||(FtfcSimTiming.Tick && (Sim.NextTick <= to)));
+		Sim_Run(to);
+		FtfcSimIrqCheck();
+}
+
+//关中断结束或时钟推进时检查FTFC中断, 处理函数返回后仍满足条件视为中断风暴
+void FtfcSimIrqCheck(void)
+{
+		uint32_t	n;
+
+		if(Sim.InIrq)	return;
+		Sim.InIrq = 1;
+		Sim_TickIrq();
+		for(n=0;FtfcSimIrqOn && (FtfcSimPrimask == 0)&&(FtfcSimReg.FCNFG.v & FTFC_FCNFG_CCIE_MASK)&&
+						(FtfcSimReg.FSTAT.v & FTFC_FSTAT_CCIF_MASK);n++)
+		{
+				if(n > 1000)
+				{
+						fprintf(stderr, "ftfcsim: FTFC中断未清除\n");
+						abort();
+				}
+				FtfcSimStat.Irqs++;
+				FTFC_IRQHandler();
+				Sim_EeeScan();
+		}
+		Sim.InIrq = 0;
+}
+
+/*************************************************************************
+*  函数名称：FtfcSimPowerLoss
+*  功能说明：掉电复位: 执行中的擦除/写入只完成已进行的比例, EEE写入保留旧值,
+//	         寄存器复位, 已分区EEE时FlexRAM重新装入EEE数据
+*************************************************************************/
+void FtfcSimPowerLoss(void)
+{
+		double	frac;
+
+		if(Sim.Busy)
+		{
+				frac = (double)(Sim.Now - Sim.StartUs) / (double)(Sim.EndUs - Sim.StartUs);
+				if(frac >= 1.0)	frac = 0.99;
+				Sim.SuspendReq = 0;
+				Sim_Finish(frac);
+		}
+		Sim.Busy			= 0;
+		Sim.Suspended = 0;
+		Sim.InIrq			= 0;
+		FtfcSimPrimask = 0;
+		FtfcSimIrqOn	 = 0;
+		FtfcSimReg.FSTAT.v = FTFC_FSTAT_CCIF_MASK;
+		FtfcSimReg.FCNFG.v = 0;
+		Sim_Fcfg1();
+		if((Sim.Depart != SIM_DEPART_NONE)&&(Sim.EeeSize != SIM_EEESIZE_NONE))	Sim_RamMode(1);
+		else
+		{
+				memset(Sim.FlexRam, 0x00, SIM_RAM_BYTES);
+				Sim_RamMode(0);
+		}
+}
+
+//按芯片地址读存储器, P-Flash未映射到0时使用
+uint8_t FtfcSimRead(uint32_t Addr)
+{
+		if(Addr < SIM_PF_BYTES)	return Sim.PFlash[Addr];
+		if(Addr - SIM_DF_ADDR < SIM_DF_BYTES)	return Sim.DFlash[Addr - SIM_DF_ADDR];
+		if(Addr - SIM_RAM_ADDR < SIM_RAM_BYTES)	return Sim.FlexRam[Addr - SIM_RAM_ADDR];
+		return 0;
+}
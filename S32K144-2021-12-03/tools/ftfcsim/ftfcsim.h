@@ -0,0 +1,109 @@
+#ifndef __FTFC_SIM_H
+#define __FTFC_SIM_H
+
+#include <stdint.h>
+
+//主机上的FTFC(Flash控制器)模型, 用于在PC上运行driver/下的Flash相关代码并估算耗时
+//驱动源文件按C++编译, 本目录的S32K144.h把FTFC换成下面的寄存器模型, 写FSTAT启动命令,
+//读FSTAT时虚拟时钟前进, 命令按典型耗时完成; 中断只在FtfcSimAdvance和开中断时进入
+//
+//存储器映射到芯片上的地址, 驱动可直接读写:
+//  FlexNVM 0x10000000 64KB, FlexRAM 0x14000000 4KB, SIM/LMEM/MSCM寄存器页
+//  P-Flash 0x00000000 512KB 须 vm.mmap_min_addr=0, 否则只能用FtfcSimRead读
+//
+//支持的命令: 00 Read 1s Block, 01 Read 1s Section, 02 Program Check, 07 Program Phrase,
+//  09 Erase Sector(可ERSSUSP挂起, 同地址重新启动为恢复), 0B Program Section,
+//  80 Program Partition, 81 Set FlexRAM; EEE模式下写FlexRAM即启动一次EEE写入
+//检查: 地址对齐和范围(ACCERR), 写入未擦除的phrase(MGSTAT0, 并计入Reprogram),
+//  命令执行中改FCCOB或写FlexRAM(计入Violation); 不模拟读冲突(RDCOLERR)和保护寄存器
+//中断延迟: Tick不为0时按周期置SysTick挂起(S32_SCB->ICSR.PENDSTSET), 开中断时响应并统计延迟,
+//  驱动在关中断执行P-Flash命令时据此挂起擦除
+
+//命令耗时(us), 取S32K1xx数据手册的典型值, 可在FtfcSimInit之后修改
+typedef	struct
+{
+			uint32_t	EraseSector;			//P-Flash 4KB / D-Flash 2KB
+			uint32_t	Phrase;						//8字节
+			uint32_t	Section1K;				//Program Section每KB
+			uint32_t	Read1sSection1K;	//Read 1s Section每KB
+			uint32_t	Read1sBlock;
+			uint32_t	ProgramCheck;
+			uint32_t	Suspend;					//ERSSUSP到擦除挂起
+			uint32_t	PgmPart;
+			uint32_t	SetRam;
+			uint32_t	EeeWrite;					//EEE写一个32位字
+			uint32_t	Poll;							//读一次FSTAT的CPU时间
+			uint32_t	Tick;							//SysTick周期, 0:不模拟
+
+}		FtfcSimTimingType;
+
+//统计, 测试后检查Reprogram/Violation/AccErr应为0
+typedef	struct
+{
+			uint32_t	Erases;
+			uint32_t	Phrases;
+			uint32_t	Sections;
+			uint32_t	Verifies;
+			uint32_t	EeeWrites;
+			uint32_t	Suspends;
+			uint32_t	Irqs;
+			uint32_t	Ticks;
+			uint32_t	TickLatMax;				//SysTick挂起到响应的最大延迟(us)
+			uint32_t	AccErr;
+			uint32_t	Reprogram;
+			uint32_t	Violation;
+			uint64_t	BusyUs;						//命令执行总时间
+
+}		FtfcSimStatType;
+
+//FSTAT: 写1清零错误位, 写CCIF启动命令; 读时若命令执行中则虚拟时钟前进Poll
+class FtfcSimFstat
+{
+public:
+			FtfcSimFstat &operator=(uint8_t x);
+			operator uint8_t() const;
+			uint8_t		v;
+};
+
+//FCNFG: CCIE/ERSSUSP可写, RAMRDY/EEERDY只读; 复合赋值的操作数按C整型提升取32位, 与8位寄存器同样截断
+class FtfcSimFcnfg
+{
+public:
+			FtfcSimFcnfg &operator=(uint8_t x);
+			FtfcSimFcnfg &operator|=(uint32_t x)	{ return *this = (uint8_t)(v | x); }
+			FtfcSimFcnfg &operator&=(uint32_t x)	{ return *this = (uint8_t)(v & x); }
+			operator uint8_t() const;
+			uint8_t		v;
+};
+
+typedef	struct
+{
+			FtfcSimFstat	FSTAT;
+			FtfcSimFcnfg	FCNFG;
+			uint8_t				FSEC;
+			uint8_t				FOPT;
+			uint8_t				FCCOB[12];
+			uint8_t				FPROT[4];
+			uint8_t				FEPROT;
+			uint8_t				FDPROT;
+
+}		FtfcSimRegType;
+
+extern FtfcSimRegType			FtfcSimReg;
+extern FtfcSimTimingType	FtfcSimTiming;
+extern FtfcSimStatType		FtfcSimStat;
+extern uint32_t						FtfcSimPrimask;
+
+void			FtfcSimInit(uint8_t Partitioned);
+uint64_t	FtfcSimNow(void);
+void			FtfcSimAdvance(uint32_t Us);
+uint8_t		FtfcSimBusy(void);
+void			FtfcSimPowerLoss(void);
+uint8_t		FtfcSimRead(uint32_t Addr);
+void			FtfcSimIrqCheck(void);
+
+//由driver/drvFLASH.c提供
+void			FTFC_IRQHandler(void);
+
+
+#endif /* __FTFC_SIM_H */
@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# 生成差分升级数据流, 格式见 VCUAPP/CANDelta.h
+#
+#   mkdelta.py 旧映像.hex 新映像.hex 输出.dlt
+#
+# 旧映像为ECU上正在运行的slot中的映像(如上次发布的 Hex/S32K144.hex), 新映像链接到另一个slot.
+# 两个slot链接地址不同, 旧映像中指向本slot的地址(向量表, 文字池, 函数指针)在新映像中整体偏移,
+# 这些字用03命令从旧映像按字拷贝并由ECU换算, 其余相同的内容用02拷贝, 不同的部分原样发送.
+# 下载: RequestDownload dataFormatIdentifier=0x10, 地址0, 长度为新映像字节数;
+# 数据流按块TransferData; 之后用打印的CRC32执行例程FF01.
+# 下载中断后FF03续传的部分按普通下载(00)从新映像的偏移处发送.
+#
+# Keil输出的hex总含常驻引导扇区(0x0~0x1000, S32K144_64_flash.sct), 只取slot内的记录, 其余丢弃并告警.
+# slot按 --slot 指定新映像所在slot(旧映像在另一个), 未指定时按slot起始处向量表的复位向量判断.
+#
+#   mkdelta.py --self-test   用构造的引导扇区+slot映像检查slot判断, 记录丢弃和差分还原
+
+import argparse
+import os
+import random
+import struct
+import sys
+import tempfile
+import zlib
+
+SLOT_A = 0x3000
+SLOT_B = 0x41000
+SLOT_SIZE = 0x3E000
+SLOTS = {'A': SLOT_A, 'B': SLOT_B}
+
+OP_END, OP_LIT, OP_COPY, OP_RCOPY, OP_FILL = 0, 1, 2, 3, 4
+MAGIC = 0x31544C44
+
+MIN_MATCH = 8
+MAX_CAND = 32
+
+
+def read_hex(path):
+    mem = {}
+    upper = 0
+    with open(path) as f:
+        for no, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            if line[0] != ':':
+                sys.exit('%s:%d: 不是Intel HEX记录' % (path, no))
+            rec = bytes.fromhex(line[1:])
+            if len(rec) < 5 or len(rec) != rec[0] + 5 or sum(rec) & 0xFF:
+                sys.exit('%s:%d: 长度或校验和错误' % (path, no))
+            n, addr, typ, data = rec[0], (rec[1] << 8) | rec[2], rec[3], rec[4:4 + rec[0]]
+            if typ == 0:
+                for i in range(n):
+                    mem[upper + addr + i] = data[i]
+            elif typ == 1:
+                break
+            elif typ == 2:
+                upper = ((data[0] << 8) | data[1]) << 4
+            elif typ == 4:
+                upper = ((data[0] << 8) | data[1]) << 16
+            elif typ not in (3, 5):
+                sys.exit('%s:%d: 不支持的记录类型 %02X' % (path, no, typ))
+    if not mem:
+        sys.exit('%s: 没有数据' % path)
+    return mem
+
+
+def find_slot(mem, path):
+    """按slot起始处向量表判断: 复位向量(去掉Thumb位)落在本slot内"""
+    found = []
+    for name, base in sorted(SLOTS.items()):
+        if all(base + i in mem for i in range(8)):
+            reset = struct.unpack('<I', bytes(mem[base + i] for i in range(4, 8)))[0]
+            if ((reset & ~1) - base) & 0xFFFFFFFF < SLOT_SIZE:
+                found.append(base)
+    if len(found) != 1:
+        sys.exit('%s: 无法按向量表判断slot, 用 --slot A|B 指定' % path)
+    return found[0]
+
+
+def slot_image(mem, base, path):
+    """取slot内的映像, slot外的记录(引导扇区等)丢弃, 空隙和结尾按擦除值0xFF补齐到8字节"""
+    if base is None:
+        base = find_slot(mem, path)
+    out = sorted(a for a in mem if (a - base) & 0xFFFFFFFF >= SLOT_SIZE)
+    if out:
+        print('%s: 警告: 丢弃slot %08X~%08X 之外的 %d 字节 (%08X~%08X)'
+              % (path, base, base + SLOT_SIZE, len(out), out[0], out[-1]), file=sys.stderr)
+    data = {a: b for a, b in mem.items() if (a - base) & 0xFFFFFFFF < SLOT_SIZE}
+    if not data:
+        sys.exit('%s: slot %08X~%08X 内没有数据' % (path, base, base + SLOT_SIZE))
+    size = (max(data) + 1 - base + 7) & ~7
+    img = bytearray(b'\xff' * size)
+    for a, b in data.items():
+        img[a - base] = b
+    return base, bytes(img)
+
+
+def relocate(old, old_base, new_base):
+    """按ECU的03命令换算旧映像的每个字, 用于匹配"""
+    out = bytearray(old)
+    for i in range(0, len(old) & ~3, 4):
+        w = struct.unpack_from('<I', old, i)[0]
+        if ((w & ~1) - old_base) & 0xFFFFFFFF < SLOT_SIZE:
+            struct.pack_into('<I', out, i, (w + new_base - old_base) & 0xFFFFFFFF)
+    return bytes(out)
+
+
+def index(data, step):
+    idx = {}
+    for i in range(0, len(data) - MIN_MATCH + 1, step):
+        lst = idx.setdefault(data[i:i + MIN_MATCH], [])
+        if len(lst) < MAX_CAND:
+            lst.append(i)
+    return idx
+
+
+def leb(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def best_match(new, pos, src, idx, word):
+    key = new[pos:pos + MIN_MATCH]
+    best_len, best_off = 0, 0
+    for off in idx.get(key, ()):
+        n = 0
+        lim = min(len(new) - pos, len(src) - off)
+        while n < lim and new[pos + n] == src[off + n]:
+            n += 1
+        if word:
+            n &= ~3
+        if n > best_len:
+            best_len, best_off = n, off
+    return best_len, best_off
+
+
+def encode(old, new, old_base, new_base):
+    rel = relocate(old, old_base, new_base)
+    idx_copy = index(old, 1)
+    idx_rel = index(rel, 4)
+
+    out = bytearray(struct.pack('<IIII', MAGIC, len(new), len(old), zlib.crc32(old) & 0xFFFFFFFF))
+    lit = bytearray()
+
+    def flush():
+        if lit:
+            out.extend(bytes([OP_LIT]) + leb(len(lit)) + lit)
+            lit.clear()
+
+    pos = 0
+    while pos < len(new):
+        run = 1
+        while pos + run < len(new) and new[pos + run] == new[pos]:
+            run += 1
+        cl, co = best_match(new, pos, old, idx_copy, False)
+        rl, ro = best_match(new, pos, rel, idx_rel, True) if pos & 3 == 0 and old_base != new_base else (0, 0)
+
+        if max(cl, rl, run) < MIN_MATCH:
+            lit.append(new[pos])
+            pos += 1
+            continue
+        flush()
+        if run >= cl and run >= rl:
+            out.extend(bytes([OP_FILL]) + leb(run) + bytes([new[pos]]))
+            pos += run
+        elif cl >= rl:
+            out.extend(bytes([OP_COPY]) + leb(cl) + leb(co))
+            pos += cl
+        else:
+            out.extend(bytes([OP_RCOPY]) + leb(rl) + leb(ro))
+            pos += rl
+    flush()
+    out.append(OP_END)
+    return bytes(out)
+
+
+def unleb(data, pos):
+    n = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        n |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return n, pos
+
+
+def apply(delta, old, old_base, new_base):
+    """按ECU (VCUAPP/CANDelta.c) 的规则还原新映像, 用于自检"""
+    magic, new_len, old_len, crc = struct.unpack_from('<IIII', delta)
+    if magic != MAGIC or old_len != len(old) or crc != zlib.crc32(old) & 0xFFFFFFFF:
+        raise ValueError('头不符')
+    rel = relocate(old, old_base, new_base)
+    out = bytearray()
+    pos = 16
+    while True:
+        op = delta[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        n, pos = unleb(delta, pos)
+        if op == OP_LIT:
+            out += delta[pos:pos + n]
+            pos += n
+        elif op == OP_FILL:
+            out += bytes([delta[pos]]) * n
+            pos += 1
+        else:
+            off, pos = unleb(delta, pos)
+            out += (old if op == OP_COPY else rel)[off:off + n]
+    if len(out) != new_len:
+        raise ValueError('长度不符')
+    return bytes(out)
+
+
+def write_hex(path, mem):
+    with open(path, 'w') as f:
+        upper = -1
+        addrs = sorted(mem)
+        i = 0
+        while i < len(addrs):
+            a = addrs[i]
+            if a >> 16 != upper:
+                upper = a >> 16
+                rec = bytes([2, 0, 0, 4, upper >> 8, upper & 0xFF])
+                f.write(':%s%02X\n' % (rec.hex().upper(), -sum(rec) & 0xFF))
+            n = 1
+            while n < 16 and i + n < len(addrs) and addrs[i + n] == a + n and (a + n) >> 16 == upper:
+                n += 1
+            rec = bytes([n, (a >> 8) & 0xFF, a & 0xFF, 0]) + bytes(mem[x] for x in addrs[i:i + n])
+            f.write(':%s%02X\n' % (rec.hex().upper(), -sum(rec) & 0xFF))
+            i += n
+        f.write(':00000001FF\n')
+
+
+def test_image(base, code, seed):
+    """构造一个Keil输出的hex内容: 引导扇区 + slot映像(向量表, 指向本slot的文字池, 代码)"""
+    rnd = random.Random(seed)
+    mem = {a: rnd.randrange(256) for a in range(0x410)}
+    mem.update({0x410 + a: rnd.randrange(256) for a in range(0x200)})
+    img = bytearray(struct.pack('<II', 0x20007000, base + 0x401))
+    for i in range(2, 0x100):
+        img += struct.pack('<I', base + 0x400 + 4 * rnd.randrange(0x100) + 1)
+    img += code
+    for i in range(0, len(code) // 4, 64):
+        struct.pack_into('<I', img, 0x400 + 4 * i, base + 0x800 + 8 * i)
+    mem.update({base + a: b for a, b in enumerate(img)})
+    return mem
+
+
+def self_test():
+    rnd = random.Random(1)
+    code = bytearray(rnd.randrange(256) for _ in range(0x6000))
+    new_code = bytearray(code)
+    new_code[0x1234:0x1240] = bytes(12)
+    new_code[0x4000:0x4000] = bytes(rnd.randrange(256) for _ in range(100))
+    old_mem = test_image(SLOT_A, code, 2)
+    new_mem = test_image(SLOT_B, new_code, 3)
+    fail = 0
+
+    with tempfile.TemporaryDirectory() as d:
+        old_hex, new_hex = os.path.join(d, 'a.hex'), os.path.join(d, 'b.hex')
+        write_hex(old_hex, old_mem)
+        write_hex(new_hex, new_mem)
+        old_base, old = slot_image(read_hex(old_hex), None, old_hex)
+        new_base, new = slot_image(read_hex(new_hex), None, new_hex)
+
+    want = bytes(new_mem[a] for a in sorted(new_mem) if a >= SLOT_B)
+    checks = [
+        ('旧映像slot', old_base == SLOT_A),
+        ('新映像slot', new_base == SLOT_B),
+        ('丢弃引导扇区', old[:8] == struct.pack('<II', 0x20007000, SLOT_A + 0x401)),
+        ('新映像内容', new[:len(want)] == want and set(new[len(want):]) <= {0xFF}),
+        ('指定slot', slot_image(new_mem, SLOTS['B'], 'B')[1] == new),
+    ]
+    delta = encode(old, new, old_base, new_base)
+    try:
+        ok = apply(delta, old, old_base, new_base) == new
+    except (ValueError, IndexError):
+        ok = False
+    checks.append(('差分还原', ok))
+    checks.append(('差分大小', len(delta) < len(new) // 4))
+
+    for name, ok in checks:
+        print('%-12s %s' % (name, '通过' if ok else '** 错误'))
+        fail += not ok
+    print('差分 %d 字节 / 新映像 %d 字节' % (len(delta), len(new)))
+    return 1 if fail else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description='生成差分升级数据流')
+    ap.add_argument('old', nargs='?', help='ECU上正在运行的映像 (.hex)')
+    ap.add_argument('new', nargs='?', help='新映像 (.hex), 链接到另一个slot')
+    ap.add_argument('out', nargs='?', help='差分数据输出文件')
+    ap.add_argument('--slot', choices=sorted(SLOTS), help='新映像所在slot, 旧映像在另一个; 默认按向量表判断')
+    ap.add_argument('--self-test', action='store_true', help='自检后退出')
+    a = ap.parse_args()
+    if a.self_test:
+        sys.exit(self_test())
+    if not a.out:
+        ap.error('需要 旧映像 新映像 输出文件')
+
+    new_base = SLOTS[a.slot] if a.slot else None
+    old_base = (SLOT_A if a.slot == 'B' else SLOT_B) if a.slot else None
+    old_base, old = slot_image(read_hex(a.old), old_base, a.old)
+    new_base, new = slot_image(read_hex(a.new), new_base, a.new)
+    if old_base == new_base:
+        print('警告: 新旧映像链接在同一个slot %08X, ECU只能写入另一个slot' % new_base, file=sys.stderr)
+    delta = encode(old, new, old_base, new_base)
+    with open(a.out, 'wb') as f:
+        f.write(delta)
+
+    print('旧映像 %08X  %d 字节  CRC32 %08X' % (old_base, len(old), zlib.crc32(old) & 0xFFFFFFFF))
+    print('新映像 %08X  %d 字节  CRC32 %08X  (RequestDownload长度, 例程FF01参数)'
+          % (new_base, len(new), zlib.crc32(new) & 0xFFFFFFFF))
+    print('差分   %d 字节  %.1f%%' % (len(delta), 100.0 * len(delta) / len(new)))
+
+
+if __name__ == '__main__':
+    main()